@@ -458,6 +458,27 @@ void ParseCommandLine(int argc, const char* argv[],
         })
         .Help("Controls how frequently to sample weights and objects when constructing trees. Possible values are PerTree and PerTreeLevel.");
 
+    parser.AddLongOption("single-precision-score-stats")
+        .NoArgument()
+        .Handler0([plainJsonPtr]() {
+            (*plainJsonPtr)["single_precision_score_stats"] = true;
+        })
+        .Help("Use float instead of double for split score statistics. Halves memory traffic of score calculation with a small loss of precision.");
+
+    parser.AddLongOption("cache-stats-without-sampling")
+        .NoArgument()
+        .Handler0([plainJsonPtr]() {
+            (*plainJsonPtr)["cache_stats_without_sampling"] = true;
+        })
+        .Help("When sampling gives the same objects and weights on every tree level (no bootstrap, subsample 1 or bagging temperature 0), cache split statistics between levels and scan only the smaller side of each split. Takes memory for statistics of all candidates at max depth.");
+
+    parser.AddLongOption("cache-stats-with-bernoulli-sampling")
+        .NoArgument()
+        .Handler0([plainJsonPtr]() {
+            (*plainJsonPtr)["cache_stats_with_bernoulli_sampling"] = true;
+        })
+        .Help("With Bernoulli sampling on every tree level in Plain mode, cache split statistics of all objects between levels and scan only the smaller side of each split and the objects sampled out of the other side. Pays off for subsample close to 1 and unbalanced splits, the first level scans all objects. Takes memory for statistics of all candidates at max depth.");
+
     parser
         .AddLongOption("subsample")
         .RequiredArgument("Float")
@@ -713,6 +734,14 @@ void ParseCommandLine(int argc, const char* argv[],
             (*plainJsonPtr)["file_with_hosts"] = nodeFile;
         });
 
+    parser
+        .AddLongOption("workers-load-learn-pool")
+        .NoArgument()
+        .Help("Workers read and quantize their parts of learn pool, which must be available to them at the same path, instead of receiving them from master")
+        .Handler0([plainJsonPtr]() {
+            (*plainJsonPtr)["workers_load_learn_pool"] = true;
+        });
+
     parser.AddLongOption('r', "seed")
         .AddLongName("random-seed")
         .RequiredArgument("count")
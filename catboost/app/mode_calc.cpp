@@ -27,30 +27,67 @@ static TEvalResult Apply(
 {
     TEvalResult resultApprox;
     TVector<TVector<TVector<double>>>& rawValues = resultApprox.GetRawValuesRef();
-    rawValues.resize(1);
-    if (pool.Docs.Baseline.ysize() > 0) {
-        rawValues[0].assign(pool.Docs.Baseline.begin(), pool.Docs.Baseline.end());
+    const size_t docCount = pool.Docs.GetDocCount();
+    const int approxDimension = model.ObliviousTrees.ApproxDimension;
+    const size_t stageCount = Max<size_t>(1, (end - begin + evalPeriod - 1) / evalPeriod);
+    const auto getStageEnd = [=](size_t stageIdx) {
+        return Min(begin + (stageIdx + 1) * evalPeriod, end);
+    };
+
+    // every stage is filled with approx increment of its own trees first and made cumulative in the end,
+    // so stages are computed independently and nothing is copied between them
+    rawValues.resize(stageCount);
+    if (stageCount > 1 && stageCount >= (size_t)executor->GetThreadCount() + 1) {
+        // many stages: binarize features once and evaluate stages in parallel
+        CheckModelAndPoolCompatibility(model, pool);
+        TFeatureCachedTreeEvaluator evaluator(
+            model,
+            [&pool](const TFloatFeature& floatFeature, size_t index) -> float {
+                return pool.Docs.Factors[floatFeature.FlatFeatureIndex][index];
+            },
+            [&pool](const TCatFeature& catFeature, size_t index) -> int {
+                return ConvertFloatCatFeatureToIntHash(pool.Docs.Factors[catFeature.FlatFeatureIndex][index]);
+            },
+            docCount);
+        executor->ExecRange([&](int stageIdx) {
+            TVector<double> flatApprox(docCount * approxDimension);
+            evaluator.Calc(begin + stageIdx * evalPeriod, getStageEnd(stageIdx), flatApprox);
+            auto& stageApprox = rawValues[stageIdx];
+            stageApprox.resize(approxDimension);
+            for (int dim = 0; dim < approxDimension; ++dim) {
+                stageApprox[dim].yresize(docCount);
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    stageApprox[dim][doc] = flatApprox[doc * approxDimension + dim];
+                }
+            }
+        }, 0, stageCount, NPar::TLocalExecutor::WAIT_COMPLETE);
     } else {
-        rawValues[0].resize(model.ObliviousTrees.ApproxDimension, TVector<double>(pool.Docs.GetDocCount(), 0.0));
+        TModelCalcerOnPool modelCalcerOnPool(model, pool, *executor);
+        TVector<double> flatApprox;
+        for (size_t stageIdx = 0; stageIdx < stageCount; ++stageIdx) {
+            modelCalcerOnPool.ApplyModelMulti(EPredictionType::RawFormulaVal,
+                                              begin + stageIdx * evalPeriod,
+                                              getStageEnd(stageIdx),
+                                              &flatApprox,
+                                              &rawValues[stageIdx]);
+        }
     }
-    TModelCalcerOnPool modelCalcerOnPool(model, pool, *executor);
-    TVector<double> flatApprox;
-    TVector<TVector<double>> approx;
-    for (; begin < end; begin += evalPeriod) {
-        modelCalcerOnPool.ApplyModelMulti(EPredictionType::RawFormulaVal,
-                                          begin,
-                                          Min(begin + evalPeriod, end),
-                                          &flatApprox,
-                                          &approx);
-
-        for (size_t i = 0; i < approx.size(); ++i) {
-            for (size_t j = 0; j < approx[0].size(); ++j) {
-                rawValues.back()[i][j] += approx[i][j];
+
+    for (size_t stageIdx = 0; stageIdx < stageCount; ++stageIdx) {
+        for (int dim = 0; dim < approxDimension; ++dim) {
+            auto& stageApprox = rawValues[stageIdx][dim];
+            if (stageIdx > 0) {
+                const auto& prevStageApprox = rawValues[stageIdx - 1][dim];
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    stageApprox[doc] += prevStageApprox[doc];
+                }
+            } else if (pool.Docs.Baseline.ysize() > 0) {
+                const auto& baseline = pool.Docs.Baseline[dim];
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    stageApprox[doc] += baseline[doc];
+                }
             }
         }
-        if (begin + evalPeriod < end) {
-            rawValues.push_back(rawValues.back());
-        }
     }
     return resultApprox;
 }
@@ -59,6 +96,7 @@ int mode_calc(int argc, const char* argv[]) {
     TAnalyticalModeCommonParams params;
     size_t iterationsLimit = 0;
     size_t evalPeriod = 0;
+    ui32 pipelineQueueDepth = 2;
 
     auto parser = NLastGetopt::TOpts();
     parser.AddHelpOption();
@@ -86,6 +124,9 @@ int mode_calc(int argc, const char* argv[]) {
         });
     parser.AddLongOption("eval-period", "predictions are evaluated every <eval-period> trees")
         .StoreResult(&evalPeriod);
+    parser.AddLongOption("pipeline-queue-depth", "max count of blocks waiting between read, apply and write stages, 0 to process blocks one by one")
+        .RequiredArgument("INT")
+        .StoreResult(&pipelineQueueDepth);
     parser.SetFreeArgsNum(0);
     NLastGetopt::TOptsParseResult parserResult{&parser, argc, argv};
 
@@ -103,7 +144,6 @@ int mode_calc(int argc, const char* argv[]) {
         iterationsLimit = model.GetTreeCount();
     }
     iterationsLimit = Min(iterationsLimit, model.GetTreeCount());
-
     if (evalPeriod == 0) {
         evalPeriod = iterationsLimit;
     } else {
@@ -115,25 +155,21 @@ int mode_calc(int argc, const char* argv[]) {
     NPar::TLocalExecutor executor;
     executor.RunAdditionalThreads(params.ThreadCount - 1);
 
-    SetVerboseLogingMode();
-    bool IsFirstBlock = true;
-    ReadAndProceedPoolInBlocks(params, blockSize, [&](const TPool& poolPart) {
-        if (IsFirstBlock) {
-            ValidateColumnOutput(params.OutputColumnsIds, poolPart, true);
-        }
-        auto approx = Apply(model, poolPart, 0, iterationsLimit, evalPeriod, &executor);
-        TVisibleLabelsHelper visibleLabelsHelper;
-        if (model.ObliviousTrees.ApproxDimension > 1) {  // is multiclass?
-            if(model.ModelInfo.has("multiclass_params")) {
-                visibleLabelsHelper.Initialize(model.ModelInfo.at("multiclass_params"));
-            } else {
-                visibleLabelsHelper.Initialize(model.ObliviousTrees.ApproxDimension);
-            }
+    TVisibleLabelsHelper visibleLabelsHelper;
+    if (model.ObliviousTrees.ApproxDimension > 1) {  // is multiclass?
+        if(model.ModelInfo.has("multiclass_params")) {
+            visibleLabelsHelper.Initialize(model.ModelInfo.at("multiclass_params"));
+        } else {
+            visibleLabelsHelper.Initialize(model.ObliviousTrees.ApproxDimension);
         }
+    }
 
-        SetSilentLogingMode();
+    auto writeBlock = [&](const TPool& poolPart, TEvalResult& approx, bool isFirstBlock, NPar::TLocalExecutor* writeExecutor) {
+        if (isFirstBlock) {
+            ValidateColumnOutput(params.OutputColumnsIds, poolPart, true);
+        }
         approx.OutputToFile(
-                &executor,
+                writeExecutor,
                 params.OutputColumnsIds,
                 visibleLabelsHelper,
                 poolPart,
@@ -143,11 +179,41 @@ int mode_calc(int argc, const char* argv[]) {
                 /*testSetPath*/NCB::TPathWithScheme(),
                 /*testFileWhichOf*/ {0, 0},
                 params.DsvPoolFormatParams.Format,
-                IsFirstBlock,
+                isFirstBlock,
                 std::make_pair(evalPeriod, iterationsLimit)
         );
-        IsFirstBlock = false;
-    }, &executor);
+    };
+
+    if (pipelineQueueDepth == 0) {
+        bool isFirstBlock = true;
+        SetSilentLogingMode();
+        ReadAndProceedPoolInBlocks(params, blockSize, [&](const TPool& poolPart) {
+            auto approx = Apply(model, poolPart, 0, iterationsLimit, evalPeriod, &executor);
+            writeBlock(poolPart, approx, isFirstBlock, &executor);
+            isFirstBlock = false;
+        }, &executor);
+        SetVerboseLogingMode();
+        return 0;
+    }
+
+    // stages run concurrently, so read and write stages get their own smaller executors
+    const int ioThreadCount = Max(1, params.ThreadCount / 4);
+    NPar::TLocalExecutor readExecutor;
+    readExecutor.RunAdditionalThreads(ioThreadCount - 1);
+    NPar::TLocalExecutor writeExecutor;
+    writeExecutor.RunAdditionalThreads(ioThreadCount - 1);
+
+    SetSilentLogingMode();
+    const auto pipelineStats = ReadApplyAndWritePoolInBlocks(params, blockSize, pipelineQueueDepth,
+        [&](const TPool& poolPart) {
+            return Apply(model, poolPart, 0, iterationsLimit, evalPeriod, &executor);
+        },
+        [&](const TPool& poolPart, TEvalResult& approx, bool isFirstBlock) {
+            writeBlock(poolPart, approx, isFirstBlock, &writeExecutor);
+        },
+        &readExecutor);
+    SetVerboseLogingMode();
+    LogPipelineStats(pipelineStats);
 
     return 0;
 }
@@ -4,18 +4,24 @@
 
 #include <catboost/libs/data/doc_pool_data_provider.h>
 #include <catboost/libs/data/load_data.h>
+#include <catboost/libs/logging/logging.h>
 
 #include <library/threading/local_executor/local_executor.h>
 
-template <class TConsumer>
-inline void ReadAndProceedPoolInBlocks(const TAnalyticalModeCommonParams& params,
-                                       ui32 blockSize,
-                                       TConsumer&& poolConsumer,
-                                       NPar::TLocalExecutor* localExecutor) {
-    TPool pool;
-    THolder<NCB::IPoolBuilder> poolBuilder = NCB::InitBuilder(*localExecutor, &pool);
+#include <util/generic/deque.h>
+#include <util/generic/ptr.h>
+#include <util/system/condvar.h>
+#include <util/system/hp_timer.h>
+#include <util/system/mutex.h>
+#include <util/thread/pool.h>
 
-    auto docPoolDataProvider = NCB::GetProcessor<NCB::IDocPoolDataProvider>(
+#include <exception>
+#include <utility>
+
+inline THolder<NCB::IDocPoolDataProvider> GetDocPoolDataProviderForBlocks(const TAnalyticalModeCommonParams& params,
+                                                                          ui32 blockSize,
+                                                                          NPar::TLocalExecutor* localExecutor) {
+    return NCB::GetProcessor<NCB::IDocPoolDataProvider>(
         params.InputPath, // for choosing processor
 
         // processor args
@@ -29,8 +35,202 @@ inline void ReadAndProceedPoolInBlocks(const TAnalyticalModeCommonParams& params
             localExecutor
         }
     );
+}
+
+template <class TConsumer>
+inline void ReadAndProceedPoolInBlocks(const TAnalyticalModeCommonParams& params,
+                                       ui32 blockSize,
+                                       TConsumer&& poolConsumer,
+                                       NPar::TLocalExecutor* localExecutor) {
+    TPool pool;
+    THolder<NCB::IPoolBuilder> poolBuilder = NCB::InitBuilder(*localExecutor, &pool);
+
+    auto docPoolDataProvider = GetDocPoolDataProviderForBlocks(params, blockSize, localExecutor);
 
     while (docPoolDataProvider->DoBlock(poolBuilder.Get())) {
         poolConsumer(pool);
     }
 }
+
+/*
+ * Blocking FIFO with limited capacity used to connect pipeline stages.
+ * After Close() Push fails and Pop returns remaining items and then fails.
+ */
+template <class T>
+class TBoundedPipelineQueue {
+public:
+    explicit TBoundedPipelineQueue(size_t capacity)
+        : Capacity(Max<size_t>(capacity, 1))
+    {
+    }
+
+    bool Push(T&& item) {
+        with_lock (Mutex) {
+            while (Items.size() >= Capacity && !Closed) {
+                CanPush.Wait(Mutex);
+            }
+            if (Closed) {
+                return false;
+            }
+            Items.push_back(std::move(item));
+        }
+        CanPop.Signal();
+        return true;
+    }
+
+    bool Pop(T* item) {
+        with_lock (Mutex) {
+            while (Items.empty() && !Closed) {
+                CanPop.Wait(Mutex);
+            }
+            if (Items.empty()) {
+                return false;
+            }
+            *item = std::move(Items.front());
+            Items.pop_front();
+        }
+        CanPush.Signal();
+        return true;
+    }
+
+    void Close() {
+        with_lock (Mutex) {
+            Closed = true;
+        }
+        CanPush.BroadCast();
+        CanPop.BroadCast();
+    }
+
+private:
+    const size_t Capacity;
+    TMutex Mutex;
+    TCondVar CanPush;
+    TCondVar CanPop;
+    TDeque<T> Items;
+    bool Closed = false;
+};
+
+struct TPipelineStageStats {
+    size_t DocCount = 0;
+    double WorkTime = 0.0; // seconds spent in stage work, waiting on queues is not included
+
+    double GetThroughput() const {
+        return WorkTime > 0.0 ? DocCount / WorkTime : 0.0;
+    }
+};
+
+struct TPipelineStats {
+    TPipelineStageStats Read;
+    TPipelineStageStats Apply;
+    TPipelineStageStats Write;
+};
+
+/*
+ * Three stage pipeline: blocks are read and parsed on the calling thread, applied on the apply thread
+ * and written in input order on the writer thread. At most queueDepth blocks wait between neighbouring stages,
+ * so memory is bounded by about 2 * queueDepth + 3 blocks.
+ * readExecutor is used for parsing only. Stages run concurrently, so applyFunc and writeFunc should use
+ * their own executors for parallel parts instead of sharing readExecutor.
+ * Stages don't change logging mode, set it before the call.
+ *
+ * applyFunc: (const TPool& block) -> TApplyResult
+ * writeFunc: (const TPool& block, TApplyResult& applyResult, bool isFirstBlock) -> void
+ */
+template <class TApplyFunc, class TWriteFunc>
+inline TPipelineStats ReadApplyAndWritePoolInBlocks(const TAnalyticalModeCommonParams& params,
+                                                    ui32 blockSize,
+                                                    ui32 queueDepth,
+                                                    TApplyFunc&& applyFunc,
+                                                    TWriteFunc&& writeFunc,
+                                                    NPar::TLocalExecutor* readExecutor) {
+    using TApplyResult = std::decay_t<decltype(applyFunc(std::declval<const TPool&>()))>;
+    using TReadBlock = THolder<TPool>;
+    using TAppliedBlock = std::pair<THolder<TPool>, TApplyResult>;
+
+    TPipelineStats stats;
+    TBoundedPipelineQueue<TReadBlock> readQueue(queueDepth);
+    TBoundedPipelineQueue<TAppliedBlock> appliedQueue(queueDepth);
+
+    TMutex errorLock;
+    std::exception_ptr error;
+    auto fail = [&](std::exception_ptr stageError) {
+        with_lock (errorLock) {
+            if (!error) {
+                error = stageError;
+            }
+        }
+        readQueue.Close();
+        appliedQueue.Close();
+    };
+
+    auto applyThread = SystemThreadPool()->Run([&]() {
+        try {
+            TReadBlock block;
+            while (readQueue.Pop(&block)) {
+                THPTimer timer;
+                TApplyResult applyResult = applyFunc(*block);
+                stats.Apply.WorkTime += timer.Passed();
+                stats.Apply.DocCount += block->Docs.GetDocCount();
+                if (!appliedQueue.Push(TAppliedBlock(std::move(block), std::move(applyResult)))) {
+                    break;
+                }
+            }
+            appliedQueue.Close();
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    auto writeThread = SystemThreadPool()->Run([&]() {
+        try {
+            TAppliedBlock appliedBlock;
+            bool isFirstBlock = true;
+            while (appliedQueue.Pop(&appliedBlock)) {
+                THPTimer timer;
+                writeFunc(*appliedBlock.first, appliedBlock.second, isFirstBlock);
+                stats.Write.WorkTime += timer.Passed();
+                stats.Write.DocCount += appliedBlock.first->Docs.GetDocCount();
+                isFirstBlock = false;
+                appliedBlock = TAppliedBlock();
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+    });
+
+    try {
+        TPool pool;
+        THolder<NCB::IPoolBuilder> poolBuilder = NCB::InitBuilder(*readExecutor, &pool);
+        auto docPoolDataProvider = GetDocPoolDataProviderForBlocks(params, blockSize, readExecutor);
+        while (true) {
+            THPTimer timer;
+            if (!docPoolDataProvider->DoBlock(poolBuilder.Get())) {
+                break;
+            }
+            // builder refills all pool fields at the start of every block, so the parsed block can be taken away
+            TReadBlock block = MakeHolder<TPool>();
+            block->Swap(pool);
+            stats.Read.WorkTime += timer.Passed();
+            stats.Read.DocCount += block->Docs.GetDocCount();
+            if (!readQueue.Push(std::move(block))) {
+                break;
+            }
+        }
+        readQueue.Close();
+    } catch (...) {
+        fail(std::current_exception());
+    }
+
+    applyThread->Join();
+    writeThread->Join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return stats;
+}
+
+inline void LogPipelineStats(const TPipelineStats& stats) {
+    MATRIXNET_INFO_LOG << "Read: " << stats.Read.DocCount << " docs, " << stats.Read.GetThroughput() << " docs/sec" << Endl;
+    MATRIXNET_INFO_LOG << "Apply: " << stats.Apply.DocCount << " docs, " << stats.Apply.GetThroughput() << " docs/sec" << Endl;
+    MATRIXNET_INFO_LOG << "Write: " << stats.Write.DocCount << " docs, " << stats.Write.GetThroughput() << " docs/sec" << Endl;
+}
@@ -0,0 +1,132 @@
+#include <catboost/libs/algo/error_functions.h>
+#include <catboost/libs/helpers/eval_helpers.h>
+
+#include <library/testing/benchmark/bench.h>
+
+#include <util/generic/singleton.h>
+#include <util/generic/vector.h>
+#include <util/random/fast.h>
+
+#include <cmath>
+
+/*
+ * Each derivatives benchmark iteration processes BlockSize documents, blocks are taken in turn
+ * from DocCount documents, so that data does not stay in cache.
+ * "Scalar" benchmarks run generic IDerCalcer per document loops, others run loss specific range kernels.
+ */
+
+namespace {
+    constexpr int DocCount = 10000000;
+    constexpr int BlockSize = 1000;
+    constexpr int ClassCount = 10;
+
+    struct TBenchmarkData {
+        TVector<double> Approxes;
+        TVector<double> ExpApproxes;
+        TVector<double> ApproxDeltas;
+        TVector<double> ExpApproxDeltas;
+        TVector<float> Targets;
+        TVector<float> Weights;
+
+        TBenchmarkData() {
+            TReallyFastRng32 rng(0);
+            Approxes.yresize(DocCount);
+            ExpApproxes.yresize(DocCount);
+            ApproxDeltas.yresize(DocCount);
+            ExpApproxDeltas.yresize(DocCount);
+            Targets.yresize(DocCount);
+            Weights.yresize(DocCount);
+            for (int doc = 0; doc < DocCount; ++doc) {
+                Approxes[doc] = 6 * rng.GenRandReal1() - 3;
+                ExpApproxes[doc] = std::exp(Approxes[doc]);
+                ApproxDeltas[doc] = 0.2 * rng.GenRandReal1() - 0.1;
+                ExpApproxDeltas[doc] = std::exp(ApproxDeltas[doc]);
+                Targets[doc] = rng.Uniform(2);
+                Weights[doc] = rng.GenRandReal1();
+            }
+        }
+    };
+
+    template <typename TError, bool Scalar>
+    void CalcDersBenchmark(const TError& error, const NBench::NCpu::TParams& iface) {
+        const auto& data = *Singleton<TBenchmarkData>();
+        const auto& approxes = TError::StoreExpApprox ? data.ExpApproxes : data.Approxes;
+        const auto& approxDeltas = TError::StoreExpApprox ? data.ExpApproxDeltas : data.ApproxDeltas;
+        TVector<TDers> ders(BlockSize);
+        for (size_t i = 0; i < iface.Iterations(); ++i) {
+            const int blockStart = (i * BlockSize) % DocCount;
+            const double* blockApproxes = approxes.data() + blockStart;
+            const double* blockApproxDeltas = approxDeltas.data() + blockStart;
+            const float* blockTargets = data.Targets.data() + blockStart;
+            const float* blockWeights = data.Weights.data() + blockStart;
+            if (Scalar) {
+                error.IDerCalcer<TError, TError::StoreExpApprox>::CalcDersRange(
+                    0, BlockSize, /*calcThirdDer*/ false, blockApproxes, blockApproxDeltas, blockTargets, blockWeights, ders.data());
+            } else {
+                error.CalcDersRange(0, BlockSize, /*calcThirdDer*/ false, blockApproxes, blockApproxDeltas, blockTargets, blockWeights, ders.data());
+            }
+            Y_DO_NOT_OPTIMIZE_AWAY(ders[0].Der1);
+        }
+    }
+
+    template <bool UseFastExp>
+    void CalcSoftmaxBenchmark(const NBench::NCpu::TParams& iface) {
+        const auto& data = *Singleton<TBenchmarkData>();
+        TVector<double> approx(ClassCount);
+        TVector<double> softmax(ClassCount);
+        for (size_t i = 0; i < iface.Iterations(); ++i) {
+            const int blockStart = (i * BlockSize * ClassCount) % DocCount;
+            for (int doc = 0; doc < BlockSize; ++doc) {
+                const double* docApprox = data.Approxes.data() + blockStart + doc * ClassCount;
+                approx.assign(docApprox, docApprox + ClassCount);
+                if (UseFastExp) {
+                    CalcSoftmaxWithFastExp(approx, &softmax);
+                } else {
+                    CalcSoftmax(approx, &softmax);
+                }
+                Y_DO_NOT_OPTIMIZE_AWAY(softmax[0]);
+            }
+        }
+    }
+}
+
+Y_CPU_BENCHMARK(CrossEntropyDersScalar, iface) {
+    CalcDersBenchmark<TCrossEntropyError, true>(TCrossEntropyError(/*storeExpApprox*/ true), iface);
+}
+
+Y_CPU_BENCHMARK(CrossEntropyDers, iface) {
+    CalcDersBenchmark<TCrossEntropyError, false>(TCrossEntropyError(/*storeExpApprox*/ true), iface);
+}
+
+Y_CPU_BENCHMARK(RMSEDersScalar, iface) {
+    CalcDersBenchmark<TRMSEError, true>(TRMSEError(/*storeExpApprox*/ false), iface);
+}
+
+Y_CPU_BENCHMARK(RMSEDers, iface) {
+    CalcDersBenchmark<TRMSEError, false>(TRMSEError(/*storeExpApprox*/ false), iface);
+}
+
+Y_CPU_BENCHMARK(QuantileDersScalar, iface) {
+    CalcDersBenchmark<TQuantileError, true>(TQuantileError(/*alpha*/ 0.3, /*storeExpApprox*/ false), iface);
+}
+
+Y_CPU_BENCHMARK(QuantileDers, iface) {
+    CalcDersBenchmark<TQuantileError, false>(TQuantileError(/*alpha*/ 0.3, /*storeExpApprox*/ false), iface);
+}
+
+Y_CPU_BENCHMARK(PoissonDersScalar, iface) {
+    CalcDersBenchmark<TPoissonError, true>(TPoissonError(/*storeExpApprox*/ true), iface);
+}
+
+Y_CPU_BENCHMARK(PoissonDers, iface) {
+    CalcDersBenchmark<TPoissonError, false>(TPoissonError(/*storeExpApprox*/ true), iface);
+}
+
+// MultiClass and QuerySoftMax derivatives are dominated by softmax exponents
+Y_CPU_BENCHMARK(SoftmaxLibm, iface) {
+    CalcSoftmaxBenchmark</*UseFastExp*/ false>(iface);
+}
+
+Y_CPU_BENCHMARK(SoftmaxFastExp, iface) {
+    CalcSoftmaxBenchmark</*UseFastExp*/ true>(iface);
+}
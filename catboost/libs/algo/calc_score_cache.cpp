@@ -1,9 +1,39 @@
 #include "calc_score_cache.h"
+
+#include <catboost/libs/options/enum_helpers.h>
+
 #include <util/system/guard.h>
 
 
+// Sampling which neither drops documents nor changes their weights gives the same sample on every tree level
+static bool IsSamplingLevelIndependent(const NCatboostOptions::TBootstrapConfig& bootstrapConfig) {
+    switch (bootstrapConfig.GetBootstrapType()) {
+        case EBootstrapType::No:
+            return true;
+        case EBootstrapType::Bernoulli:
+            return bootstrapConfig.GetTakenFraction() == 1.0f;
+        case EBootstrapType::Bayesian:
+            return bootstrapConfig.GetBaggingTemperature() == 0.0f;
+        default:
+            return false;
+    }
+}
+
 bool IsSamplingPerTree(const NCatboostOptions::TObliviousTreeLearnerOptions& fitParams) {
-    return fitParams.SamplingFrequency.Get() == ESamplingFrequency::PerTree;
+    if (fitParams.SamplingFrequency.Get() == ESamplingFrequency::PerTree) {
+        return true;
+    }
+    // the cache takes stats of all candidates for max depth, so it is not enabled by default when sampling is per level
+    return fitParams.CacheStatsWithoutSampling.Get() && IsSamplingLevelIndependent(fitParams.BootstrapConfig.Get());
+}
+
+bool IsSampledOutSiblingScoring(const NCatboostOptions::TCatBoostOptions& params) {
+    const auto& treeOptions = params.ObliviousTreeOptions.Get();
+    return treeOptions.CacheStatsWithBernoulliSampling.Get()
+        && !IsSamplingPerTree(treeOptions)
+        && GetBernoulliSampleRate(treeOptions.BootstrapConfig) < 1.0f
+        && IsPlainMode(params.BoostingOptions->BoostingType)
+        && !IsPairwiseScoring(params.LossFunctionDescription->GetLossFunction());
 }
 
 TVector<TBucketStats, TPoolAllocator>& TBucketStatsCache::GetStats(const TSplitCandidate& split, int statsCount, bool* areStatsDirty) {
@@ -22,6 +52,25 @@ TVector<TBucketStats, TPoolAllocator>& TBucketStatsCache::GetStats(const TSplitC
     return *splitStats;
 }
 
+TPairwiseStats& TBucketStatsCache::GetPairwiseStats(const TSplitCandidate& split) {
+    TPairwiseStats* splitStats;
+    with_lock(Lock) {
+        auto& cachedStats = PairwiseStats[split];
+        if (cachedStats == nullptr) {
+            cachedStats = new TPairwiseStats;
+        }
+        splitStats = cachedStats.Get();
+    }
+    return *splitStats;
+}
+
+void TBucketStatsCache::Erase(const TSplitCandidate& split) {
+    with_lock(Lock) {
+        Stats.erase(split);
+        PairwiseStats.erase(split);
+    }
+}
+
 void TBucketStatsCache::GarbageCollect() {
     if (MemoryPool->MemoryWaste() > InitialSize) { // limit memory overhead
         Stats.clear();
@@ -87,6 +136,7 @@ void TCalcScoreFold::Create(const TVector<TFold>& folds, bool isPairwiseScoring,
     LearnWeights.yresize(DocCount);
     SampleWeights.yresize(DocCount);
     Control.yresize(DocCount);
+    IsSampled.yresize(DocCount);
     BodyTailCount = GetMaxBodyTailCount(folds);
     HasPairwiseWeights = !folds[0].BodyTailArr[0].PairwiseWeights.empty();
     IsPairwiseScoring = isPairwiseScoring;
@@ -174,11 +224,12 @@ void TCalcScoreFold::SelectSmallestSplitSide(int curDepth, const TCalcScoreFold&
     srcBlocks.Create(blockParams);
 
     TVectorSlicing dstBlocks;
-    SetSmallestSideControl(curDepth, fold.DocCount, fold.Indices, localExecutor);
+    SetSmallestSideControl(curDepth, fold.DocCount, GetDataPtr(fold.Indices), localExecutor);
     dstBlocks.CreateByControl(blockParams, Control, localExecutor);
 
     DocCount = dstBlocks.Total;
     ClearBodyTail();
+    HasSparseScoringData = false;
     LearnQueriesInfo = fold.LearnQueriesInfo;
     localExecutor->ExecRange([&](int blockIdx) {
         int ignored;
@@ -207,6 +258,7 @@ void TCalcScoreFold::Sample(const TFold& fold, const TVector<TIndexType>& indice
 
     DocCount = dstBlocks.Total;
     ClearBodyTail();
+    HasSparseScoringData = false;
     BodyTailCount = fold.BodyTailArr.ysize();
     LearnQueriesInfo = &fold.LearnQueriesInfo;
     localExecutor->ExecRange([&](int blockIdx) {
@@ -221,6 +273,46 @@ void TCalcScoreFold::Sample(const TFold& fold, const TVector<TIndexType>& indice
     PermutationBlockSize = (BernoulliSampleRate == 1.0f || IsPairwiseScoring) ? fold.PermutationBlockSize : FoldPermutationBlockSizeNotSet;
 }
 
+// Selects all documents on the first tree level. On other levels selects documents of the smallest side of the last split
+// and sampled out documents of the other side, indices are kept as is
+void TCalcScoreFold::SelectSampledOutSibling(int curDepth, const TFold& fold, const TVector<TIndexType>& indices, const TCalcScoreFold& sampledDocs, NPar::TLocalExecutor* localExecutor) {
+    NPar::TLocalExecutor::TExecRangeParams blockParams(0, indices.ysize());
+    blockParams.SetBlockSize(2000);
+    const int blockCount = blockParams.GetBlockCount();
+    TVectorSlicing srcBlocks;
+    srcBlocks.Create(blockParams);
+
+    if (curDepth == 0) {
+        Fill(Control.begin(), Control.end(), true);
+    } else {
+        SetSmallestSideControl(curDepth, indices.ysize(), GetDataPtr(indices), localExecutor);
+        const bool* sampledControlData = GetDataPtr(sampledDocs.Control);
+        bool* controlData = GetDataPtr(Control);
+        localExecutor->ExecRange([=](int docIdx) {
+            controlData[docIdx] = controlData[docIdx] || !sampledControlData[docIdx];
+        }, blockParams, NPar::TLocalExecutor::WAIT_COMPLETE);
+    }
+    TVectorSlicing dstBlocks;
+    dstBlocks.CreateByControl(blockParams, Control, localExecutor);
+
+    DocCount = dstBlocks.Total;
+    ClearBodyTail();
+    HasSparseScoringData = false;
+    BodyTailCount = fold.BodyTailArr.ysize();
+    LearnQueriesInfo = &fold.LearnQueriesInfo;
+    localExecutor->ExecRange([&](int blockIdx) {
+        const auto srcBlock = srcBlocks.Slices[blockIdx];
+        const auto srcControlRef = srcBlock.GetConstRef(Control);
+        const auto dstBlock = dstBlocks.Slices[blockIdx];
+        int ignored;
+        SetElements(srcControlRef, srcBlock.GetConstRef(indices), GetElement<TIndexType>, dstBlock.GetRef(Indices), &ignored);
+        SetElements(srcControlRef, srcBlock.GetConstRef(TVector<size_t>()), [=](const size_t*, size_t j) { return srcBlock.Offset + j; }, dstBlock.GetRef(IndexInFold), &ignored);
+        SetElements(srcControlRef, srcBlock.GetConstRef(sampledDocs.Control), GetElement<bool>, dstBlock.GetRef(IsSampled), &ignored);
+        SelectBlockFromFold(fold, srcBlock, dstBlock);
+    }, 0, blockCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+    PermutationBlockSize = FoldPermutationBlockSizeNotSet;
+}
+
 void TCalcScoreFold::UpdateIndices(const TVector<TIndexType>& indices, NPar::TLocalExecutor* localExecutor) {
     NPar::TLocalExecutor::TExecRangeParams blockParams(0, indices.ysize());
     blockParams.SetBlockSize(2000);
@@ -236,6 +328,7 @@ void TCalcScoreFold::UpdateIndices(const TVector<TIndexType>& indices, NPar::TLo
     }
 
     DocCount = dstBlocks.Total;
+    HasSparseScoringData = false;
     localExecutor->ExecRange([&](int blockIdx) {
         const auto srcBlock = srcBlocks.Slices[blockIdx];
         const auto dstBlock = dstBlocks.Slices[blockIdx];
@@ -245,6 +338,46 @@ void TCalcScoreFold::UpdateIndices(const TVector<TIndexType>& indices, NPar::TLo
     }, 0, blockCount, NPar::TLocalExecutor::WAIT_COMPLETE);
 }
 
+void TCalcScoreFold::PrepareSparseScoring(int learnSampleCount, int leafCount, NPar::TLocalExecutor* localExecutor) {
+    Y_ASSERT(BodyTailCount == 1);
+    NPar::TLocalExecutor::TExecRangeParams blockParams(0, DocCount);
+    blockParams.SetBlockSize(4000);
+    const int blockCount = blockParams.GetBlockCount();
+
+    DocPositions.assign(learnSampleCount, -1);
+    const size_t* learnPermutationData = GetDataPtr(LearnPermutation);
+    int* docPositionsData = DocPositions.data();
+    localExecutor->ExecRange([=](int doc) {
+        docPositionsData[learnPermutationData[doc]] = doc;
+    }, blockParams, NPar::TLocalExecutor::WAIT_COMPLETE);
+
+    const auto& bt = BodyTailArr[0];
+    const TIndexType* indicesData = GetDataPtr(Indices);
+    const float* sampleWeightsData = HasPairwiseWeights ? GetDataPtr(bt.SamplePairwiseWeights) : GetDataPtr(SampleWeights);
+    const int docCount = Min<int>(DocCount, bt.TailFinish);
+    LeafStats.resize(ApproxDimension);
+    for (int dim = 0; dim < ApproxDimension; ++dim) {
+        const double* weightedDerivativesData = GetDataPtr(bt.SampleWeightedDerivatives[dim]);
+        TVector<TVector<TBucketStats>> blockLeafStats(blockCount, TVector<TBucketStats>(leafCount, TBucketStats{0, 0, 0, 0}));
+        localExecutor->ExecRange([&](int blockIdx) {
+            TBucketStats* leafStats = blockLeafStats[blockIdx].data();
+            NPar::TLocalExecutor::BlockedLoopBody(blockParams, [=](int doc) {
+                if (doc < docCount) {
+                    leafStats[indicesData[doc]].SumWeightedDelta += weightedDerivativesData[doc];
+                    leafStats[indicesData[doc]].SumWeight += sampleWeightsData[doc];
+                }
+            })(blockIdx);
+        }, 0, blockCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+        LeafStats[dim].assign(leafCount, TBucketStats{0, 0, 0, 0});
+        for (const auto& leafStats : blockLeafStats) {
+            for (int leaf = 0; leaf < leafCount; ++leaf) {
+                LeafStats[dim][leaf].Add(leafStats[leaf]);
+            }
+        }
+    }
+    HasSparseScoringData = true;
+}
+
 int TCalcScoreFold::GetApproxDimension() const {
     return ApproxDimension;
 }
@@ -257,7 +390,7 @@ int TCalcScoreFold::GetBodyTailCount() const {
     return BodyTailCount;
 }
 
-void TCalcScoreFold::SetSmallestSideControl(int curDepth, int docCount, const TUnsizedVector<TIndexType>& indices, NPar::TLocalExecutor* localExecutor) {
+void TCalcScoreFold::SetSmallestSideControl(int curDepth, int docCount, const TIndexType* indicesData, NPar::TLocalExecutor* localExecutor) {
     Y_ASSERT(curDepth > 0);
 
     NPar::TLocalExecutor::TExecRangeParams blockParams(0, docCount);
@@ -265,7 +398,6 @@ void TCalcScoreFold::SetSmallestSideControl(int curDepth, int docCount, const TU
     const int blockCount = blockParams.GetBlockCount();
 
     TVector<int> blockSize(blockCount, 0);
-    const TIndexType* indicesData = GetDataPtr(indices);
     localExecutor->ExecRange([=, &blockSize](int blockIdx) {
         int size = 0;
         NPar::TLocalExecutor::BlockedLoopBody(blockParams, [=, &size](int docIdx) {
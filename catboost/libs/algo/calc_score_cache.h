@@ -4,15 +4,34 @@
 #include "split.h"
 
 #include <catboost/libs/helpers/restorable_rng.h>
+#include <catboost/libs/options/catboost_options.h>
 #include <catboost/libs/options/restrictions.h>
 #include <catboost/libs/options/oblivious_tree_options.h>
 
+#include <library/containers/2d_array/2d_array.h>
+
 #include <util/memory/pool.h>
 #include <util/system/atomic.h>
 #include <util/system/spinlock.h>
 
+/*
+ * True if documents are sampled once per tree, so statistics from the previous tree level can be reused
+ * and only the smallest side of each split is scanned on the next level.
+ * With cache_stats_without_sampling option per level sampling is treated as per tree one when it does not depend
+ * on the random generator (no bootstrap, Bernoulli with subsample 1 or Bayesian with bagging temperature 0).
+ * Random per level sampling draws other documents and weights on every level, so it reuses stats only
+ * with cache_stats_with_bernoulli_sampling option, see IsSampledOutSiblingScoring.
+ */
 bool IsSamplingPerTree(const NCatboostOptions::TObliviousTreeLearnerOptions& fitParams);
 
+/*
+ * True if per level Bernoulli sampling keeps statistics of all documents of the previous tree level
+ * (cache_stats_with_bernoulli_sampling option, plain boosting, not pairwise scoring).
+ * Statistics of the sample are computed from the smallest side of the last split and from sampled out documents
+ * of the other side, see TCalcScoreFold::SelectSampledOutSibling and CalcSampledOutSiblingStatsKernel.
+ */
+bool IsSampledOutSiblingScoring(const NCatboostOptions::TCatBoostOptions& params);
+
 template<typename TData, typename TAlloc>
 static inline TData* GetDataPtr(TVector<TData, TAlloc>& data, size_t offset = 0) {
     return data.empty() ? nullptr : data.data() + offset;
@@ -38,20 +57,23 @@ static inline int GetMaxBodyTailCount(const TVector<TFold>& folds) {
     return maxBodyTailCount;
 }
 
-struct TBucketStats {
-    double SumWeightedDelta;
-    double SumWeight;
-    double SumDelta;
-    double Count;
+template<typename TValue>
+struct TBucketStatsImpl {
+    TValue SumWeightedDelta;
+    TValue SumWeight;
+    TValue SumDelta;
+    TValue Count;
 
-    inline void Add(const TBucketStats& other) {
+    template<typename TOtherStats>
+    inline void Add(const TOtherStats& other) {
         SumWeightedDelta += other.SumWeightedDelta;
         SumDelta += other.SumDelta;
         SumWeight += other.SumWeight;
         Count += other.Count;
     }
 
-    inline void Remove(const TBucketStats& other) {
+    template<typename TOtherStats>
+    inline void Remove(const TOtherStats& other) {
         SumWeightedDelta -= other.SumWeightedDelta;
         SumDelta -= other.SumDelta;
         SumWeight -= other.SumWeight;
@@ -60,7 +82,12 @@ struct TBucketStats {
     SAVELOAD(SumWeightedDelta, SumWeight, SumDelta, Count);
 };
 
+using TBucketStats = TBucketStatsImpl<double>;
+// Used for score calculation with single_precision_score_stats option, see TObliviousTreeLearnerOptions
+using TBucketStatsSingle = TBucketStatsImpl<float>;
+
 static_assert(std::is_pod<TBucketStats>::value, "TBucketStats must be pod to avoid memory initialization in yresize");
+static_assert(std::is_pod<TBucketStatsSingle>::value, "TBucketStatsSingle must be pod to avoid memory initialization in yresize");
 
 inline static int CountNonCtrBuckets(const TVector<int>& splitCounts, const TVector<TVector<int>>& oneHotValues) {
     int nonCtrBucketCount = 0;
@@ -73,8 +100,21 @@ inline static int CountNonCtrBuckets(const TVector<int>& splitCounts, const TVec
     return nonCtrBucketCount;
 }
 
+struct TBucketPairWeightStatistics {
+    double SmallerBorderWeightSum = 0.0; // The weight sum of pair elements with smaller border.
+    double GreaterBorderRightWeightSum = 0.0; // The weight sum of pair elements with greater border.
+};
+
+// Statistics of pairwise scoring of a split candidate, see CalculatePairwiseScore
+struct TPairwiseStats {
+    TVector<TVector<double>> DerSums; // [leaf][bucket]
+    TArray2D<TVector<TBucketPairWeightStatistics>> PairWeightStatistics; // [leaf][leaf][bucket]
+    int Depth = -1; // tree level of the statistics, -1 if they are not kept
+};
+
 struct TBucketStatsCache {
     THashMap<TSplitCandidate, THolder<TVector<TBucketStats, TPoolAllocator>>> Stats;
+    THashMap<TSplitCandidate, THolder<TPairwiseStats>> PairwiseStats;
     inline void Create(const TVector<TFold>& folds, int bucketCount, int depth) {
         int approxDimension = folds[0].GetApproxDimension();
         int bodyTailCount = GetMaxBodyTailCount(folds);
@@ -83,6 +123,8 @@ struct TBucketStatsCache {
         MemoryPool = new TMemoryPool(InitialSize);
     }
     TVector<TBucketStats, TPoolAllocator>& GetStats(const TSplitCandidate& split, int statsCount, bool* areStatsDirty);
+    TPairwiseStats& GetPairwiseStats(const TSplitCandidate& split);
+    void Erase(const TSplitCandidate& split);
     void GarbageCollect();
 private:
     THolder<TMemoryPool> MemoryPool;
@@ -141,13 +183,20 @@ struct TCalcScoreFold {
     TUnsizedVector<float> SampleWeights;
     const TVector<TQueryInfo>* LearnQueriesInfo;
     TUnsizedVector<TBodyTail> BodyTailArr; // [tail][dim][doc]
+    TUnsizedVector<bool> IsSampled; // [doc] document is in the sample, set by SelectSampledOutSibling
     bool SmallestSplitSideValue;
     int PermutationBlockSize = FoldPermutationBlockSizeNotSet;
+    // Data for scoring of sparse float features in plain mode, valid after PrepareSparseScoring until fold changes
+    TVector<int> DocPositions; // [original doc] position of document in the fold, -1 if it is not sampled
+    TVector<TVector<TBucketStats>> LeafStats; // [dim][leaf] stats of all documents in the leaf
+    bool HasSparseScoringData = false;
 
     void Create(const TVector<TFold>& folds, bool isPairwiseScoring, float sampleRate = 1.0f);
     void SelectSmallestSplitSide(int curDepth, const TCalcScoreFold& fold, NPar::TLocalExecutor* localExecutor);
+    void SelectSampledOutSibling(int curDepth, const TFold& fold, const TVector<TIndexType>& indices, const TCalcScoreFold& sampledDocs, NPar::TLocalExecutor* localExecutor);
     void Sample(const TFold& fold, const TVector<TIndexType>& indices, TRestorableFastRng64* rand, NPar::TLocalExecutor* localExecutor);
     void UpdateIndices(const TVector<TIndexType>& indices, NPar::TLocalExecutor* localExecutor);
+    void PrepareSparseScoring(int learnSampleCount, int leafCount, NPar::TLocalExecutor* localExecutor);
     int GetDocCount() const;
     int GetBodyTailCount() const;
     int GetApproxDimension() const;
@@ -162,7 +211,7 @@ private:
     using TSlice = TVectorSlicing::TSlice;
     template<typename TFoldType>
     void SelectBlockFromFold(const TFoldType& fold, TSlice srcBlock, TSlice dstBlock);
-    void SetSmallestSideControl(int curDepth, int docCount, const TUnsizedVector<TIndexType>& indices, NPar::TLocalExecutor* localExecutor);
+    void SetSmallestSideControl(int curDepth, int docCount, const TIndexType* indices, NPar::TLocalExecutor* localExecutor);
     void SetSampledControl(int docCount, TRestorableFastRng64* rand);
     TUnsizedVector<bool> Control;
     int DocCount;
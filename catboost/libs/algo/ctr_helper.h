@@ -14,6 +14,7 @@ struct TCtrInfo {
     TVector<float> Priors;
 
     Y_SAVELOAD_DEFINE(Type, BorderCount, TargetClassifierIdx, Priors);
+    SAVELOAD(Type, BorderCount, TargetClassifierIdx, Priors);
 };
 
 inline int GetTargetBorderCount(const TCtrInfo& ctrInfo, ui32 targetClassesCount) {
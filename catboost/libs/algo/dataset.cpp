@@ -1,5 +1,8 @@
 #include "dataset.h"
 
+#include <catboost/libs/helpers/binarize_target.h>
+#include <catboost/libs/options/enum_helpers.h>
+
 TDataset BuildDataset(const TPool& pool) {
     TDataset data;
     data.Target = pool.Docs.Target;
@@ -11,3 +14,26 @@ TDataset BuildDataset(const TPool& pool) {
     data.HasGroupWeight = pool.MetaInfo.HasGroupWeight;
     return data;
 }
+
+void Preprocess(const NCatboostOptions::TLossDescription& lossDescription,
+                const TVector<float>& classWeights,
+                const TLabelConverter& labelConverter,
+                TDataset& learnOrTestData) {
+    auto& data = learnOrTestData;
+    if (lossDescription.GetLossFunction() == ELossFunction::Logloss) {
+        PrepareTargetBinary(NCatboostOptions::GetLogLossBorder(lossDescription), &data.Target);
+    }
+
+    if (!classWeights.empty()) {
+        // TODO(annaveronika): check class weight not negative.
+        int dataSize = data.Target.ysize();
+        for (int i = 0; i < dataSize; ++i) {
+            CB_ENSURE(data.Target[i] < classWeights.ysize(), "class " + ToString(data.Target[i]) + " is missing in class weights");
+            data.Weights[i] *= classWeights[data.Target[i]];
+        }
+    }
+
+    if (IsMultiClassError(lossDescription.GetLossFunction())) {
+        PrepareTargetCompressed(labelConverter, &data.Target);
+    }
+}
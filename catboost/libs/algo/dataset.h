@@ -4,7 +4,9 @@
 
 #include <catboost/libs/data_types/pair.h>
 #include <catboost/libs/data_types/query.h>
+#include <catboost/libs/helpers/multiclass_label_helpers/label_converter.h>
 #include <catboost/libs/helpers/query_info_helper.h>
+#include <catboost/libs/options/loss_description.h>
 
 #include <library/binsaver/bin_saver.h>
 
@@ -32,6 +34,12 @@ public:
 
 TDataset BuildDataset(const TPool& pool);
 
+/// Preprocess targets and weights of the `data` as required by loss.
+void Preprocess(const NCatboostOptions::TLossDescription& lossDescription,
+                const TVector<float>& classWeights,
+                const TLabelConverter& labelConverter,
+                TDataset& learnOrTestData);
+
 inline bool HaveGoodQueryIds(const TDataset& data) {
     return data.QueryId.size() == data.Target.size();
 }
@@ -92,6 +92,214 @@ void TCrossEntropyError::CalcDersRange(
     }
 }
 
+namespace {
+    // Per document derivatives of simple losses, inlined into vectorizable range loops below
+    struct TRMSEDers {
+        double CalcDer(double approx, float target) const {
+            return target - approx;
+        }
+
+        template<bool CalcThirdDer>
+        void CalcDers(double approx, float target, TDers* ders) const {
+            ders->Der1 = target - approx;
+            ders->Der2 = TRMSEError::RMSE_DER2;
+            if (CalcThirdDer) {
+                ders->Der3 = TRMSEError::RMSE_DER3;
+            }
+        }
+    };
+
+    struct TQuantileDers {
+        double Alpha;
+
+        double CalcDer(double approx, float target) const {
+            return (target - approx > 0) ? Alpha : -(1 - Alpha);
+        }
+
+        template<bool CalcThirdDer>
+        void CalcDers(double approx, float target, TDers* ders) const {
+            ders->Der1 = CalcDer(approx, target);
+            ders->Der2 = 0.0;
+            if (CalcThirdDer) {
+                ders->Der3 = 0.0;
+            }
+        }
+    };
+
+    struct TPoissonDers {
+        double CalcDer(double approxExp, float target) const {
+            return target - approxExp;
+        }
+
+        template<bool CalcThirdDer>
+        void CalcDers(double approxExp, float target, TDers* ders) const {
+            ders->Der1 = target - approxExp;
+            ders->Der2 = -approxExp;
+            if (CalcThirdDer) {
+                ders->Der3 = -approxExp;
+            }
+        }
+    };
+}
+
+template<bool StoreExpApprox, typename TLossDers>
+static void CalcFirstDerRangeImpl(
+    const TLossDers& lossDers,
+    int start,
+    int count,
+    const double* __restrict approxes,
+    const double* __restrict approxDeltas,
+    const float* __restrict targets,
+    const float* __restrict weights,
+    double* __restrict ders
+) {
+    if (approxDeltas != nullptr) {
+#pragma clang loop vectorize_width(4) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            ders[i] = lossDers.CalcDer(UpdateApprox<StoreExpApprox>(approxes[i], approxDeltas[i]), targets[i]);
+        }
+    } else {
+#pragma clang loop vectorize_width(4) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            ders[i] = lossDers.CalcDer(approxes[i], targets[i]);
+        }
+    }
+    if (weights != nullptr) {
+#pragma clang loop vectorize_width(4) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            ders[i] *= weights[i];
+        }
+    }
+}
+
+template<bool StoreExpApprox, bool CalcThirdDer, typename TLossDers>
+static void CalcDersRangeImpl(
+    const TLossDers& lossDers,
+    int start,
+    int count,
+    const double* __restrict approxes,
+    const double* __restrict approxDeltas,
+    const float* __restrict targets,
+    const float* __restrict weights,
+    TDers* __restrict ders
+) {
+    if (approxDeltas != nullptr) {
+#pragma clang loop vectorize_width(4) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            lossDers.template CalcDers<CalcThirdDer>(UpdateApprox<StoreExpApprox>(approxes[i], approxDeltas[i]), targets[i], &ders[i]);
+        }
+    } else {
+#pragma clang loop vectorize_width(4) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            lossDers.template CalcDers<CalcThirdDer>(approxes[i], targets[i], &ders[i]);
+        }
+    }
+    if (weights != nullptr) {
+#pragma clang loop vectorize_width(8) interleave_count(2)
+        for (int i = start; i < start + count; ++i) {
+            ders[i].Der1 *= weights[i];
+            ders[i].Der2 *= weights[i];
+            if (CalcThirdDer) {
+                ders[i].Der3 *= weights[i];
+            }
+        }
+    }
+}
+
+template<bool StoreExpApprox, typename TLossDers>
+static void CalcLossDersRange(
+    const TLossDers& lossDers,
+    int start,
+    int count,
+    bool calcThirdDer,
+    const double* approxes,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    TDers* ders
+) {
+    if (calcThirdDer) {
+        CalcDersRangeImpl<StoreExpApprox, true>(lossDers, start, count, approxes, approxDeltas, targets, weights, ders);
+    } else {
+        CalcDersRangeImpl<StoreExpApprox, false>(lossDers, start, count, approxes, approxDeltas, targets, weights, ders);
+    }
+}
+
+void TRMSEError::CalcFirstDerRange(
+    int start,
+    int count,
+    const double* approxes,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    double* ders
+) const {
+    CalcFirstDerRangeImpl<StoreExpApprox>(TRMSEDers(), start, count, approxes, approxDeltas, targets, weights, ders);
+}
+
+void TRMSEError::CalcDersRange(
+    int start,
+    int count,
+    bool calcThirdDer,
+    const double* approxes,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    TDers* ders
+) const {
+    CalcLossDersRange<StoreExpApprox>(TRMSEDers(), start, count, calcThirdDer, approxes, approxDeltas, targets, weights, ders);
+}
+
+void TQuantileError::CalcFirstDerRange(
+    int start,
+    int count,
+    const double* approxes,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    double* ders
+) const {
+    CalcFirstDerRangeImpl<StoreExpApprox>(TQuantileDers{Alpha}, start, count, approxes, approxDeltas, targets, weights, ders);
+}
+
+void TQuantileError::CalcDersRange(
+    int start,
+    int count,
+    bool calcThirdDer,
+    const double* approxes,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    TDers* ders
+) const {
+    CalcLossDersRange<StoreExpApprox>(TQuantileDers{Alpha}, start, count, calcThirdDer, approxes, approxDeltas, targets, weights, ders);
+}
+
+void TPoissonError::CalcFirstDerRange(
+    int start,
+    int count,
+    const double* approxExps,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    double* ders
+) const {
+    CalcFirstDerRangeImpl<StoreExpApprox>(TPoissonDers(), start, count, approxExps, approxDeltas, targets, weights, ders);
+}
+
+void TPoissonError::CalcDersRange(
+    int start,
+    int count,
+    bool calcThirdDer,
+    const double* approxExps,
+    const double* approxDeltas,
+    const float* targets,
+    const float* weights,
+    TDers* ders
+) const {
+    CalcLossDersRange<StoreExpApprox>(TPoissonDers(), start, count, calcThirdDer, approxExps, approxDeltas, targets, weights, ders);
+}
+
 void CheckDerivativeOrderForTrain(ui32 derivativeOrder, ELeavesEstimation estimationMethod) {
     if (estimationMethod == ELeavesEstimation::Newton) {
         CB_ENSURE(derivativeOrder >= 2, "Current error function doesn't support Newton leaves estimation method");
@@ -13,11 +13,29 @@
 #include <library/threading/local_executor/local_executor.h>
 #include <library/binsaver/bin_saver.h>
 
+#include <util/generic/algorithm.h>
 #include <util/generic/vector.h>
 #include <util/generic/ymath.h>
 #include <util/system/yassert.h>
 #include <util/string/iterator.h>
 
+// Same as CalcSoftmax, but exponents are calculated by vectorized FastExpInplace,
+// its relative error is within 1e-12 of libm exp, see error_functions_ut
+inline void CalcSoftmaxWithFastExp(const TVector<double>& approx, TVector<double>* softmax) {
+    const double maxApprox = *MaxElement(approx.begin(), approx.end());
+    for (int dim = 0; dim < approx.ysize(); ++dim) {
+        (*softmax)[dim] = approx[dim] - maxApprox;
+    }
+    FastExpInplace(softmax->data(), softmax->size());
+    double sumExpApprox = 0;
+    for (double expApprox : *softmax) {
+        sumExpApprox += expApprox;
+    }
+    for (auto& curSoftmax : *softmax) {
+        curSoftmax /= sumExpApprox;
+    }
+}
+
 template<typename TChild, bool StoreExpApproxParam>
 class IDerCalcer {
 public:
@@ -221,6 +239,27 @@ public:
     double CalcDer3(double /*approx*/, float /*target*/) const {
         return RMSE_DER3;
     }
+
+    void CalcFirstDerRange(
+        int start,
+        int count,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        double* ders
+    ) const;
+
+    void CalcDersRange(
+        int start,
+        int count,
+        bool calcThirdDer,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        TDers* ders
+    ) const;
 };
 
 class TQuantileError : public IDerCalcer<TQuantileError, /*StoreExpApproxParam*/ false> {
@@ -254,6 +293,27 @@ public:
     double CalcDer3(double /*approx*/, float /*target*/) const {
         return QUANTILE_DER2_AND_DER3;
     }
+
+    void CalcFirstDerRange(
+        int start,
+        int count,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        double* ders
+    ) const;
+
+    void CalcDersRange(
+        int start,
+        int count,
+        bool calcThirdDer,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        TDers* ders
+    ) const;
 };
 
 class TLogLinQuantileError : public IDerCalcer<TLogLinQuantileError, /*StoreExpApproxParam*/ true> {
@@ -336,6 +396,27 @@ public:
             ders->Der3 = -approxExp;
         }
     }
+
+    void CalcFirstDerRange(
+        int start,
+        int count,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        double* ders
+    ) const;
+
+    void CalcDersRange(
+        int start,
+        int count,
+        bool calcThirdDer,
+        const double* approxes,
+        const double* approxDeltas,
+        const float* targets,
+        const float* weights,
+        TDers* ders
+    ) const;
 };
 
 class TMultiClassError : public IDerCalcer<TMultiClassError, /*StoreExpApproxParam*/ false> {
@@ -370,7 +451,7 @@ public:
         int approxDimension = approx.ysize();
 
         TVector<double> softmax(approxDimension);
-        CalcSoftmax(approx, &softmax);
+        CalcSoftmaxWithFastExp(approx, &softmax);
 
         for (int dim = 0; dim < approxDimension; ++dim) {
             (*der)[dim] = -softmax[dim];
@@ -633,10 +714,11 @@ public:
         TVector<TDers>* ders
     ) const {
         int start = queriesInfo[queryStartIndex].Begin;
+        TVector<double> expApproxes; // reused by queries of the block
         for (int queryIndex = queryStartIndex; queryIndex < queryEndIndex; ++queryIndex) {
             int begin = queriesInfo[queryIndex].Begin;
             int end = queriesInfo[queryIndex].End;
-            CalcDersForSingleQuery(start, begin - start, end - begin, approxes, targets, weights, ders);
+            CalcDersForSingleQuery(start, begin - start, end - begin, approxes, targets, weights, &expApproxes, ders);
         }
     }
 
@@ -656,6 +738,7 @@ private:
         const TVector<double>& approxes,
         const TVector<float>& targets,
         const TVector<float>& weights,
+        TVector<double>* expApproxesBuffer,
         TVector<TDers>* ders
     ) const {
         double maxApprox = -std::numeric_limits<double>::max();
@@ -674,9 +757,15 @@ private:
             }
         }
         if (sumWeightedTargets > 0) {
+            expApproxesBuffer->yresize(count);
+            TVector<double>& expApproxes = *expApproxesBuffer;
+            for (int dim = offset; dim < offset + count; ++dim) {
+                expApproxes[dim - offset] = approxes[start + dim] - maxApprox;
+            }
+            FastExpInplace(expApproxes.data(), count);
             for (int dim = offset; dim < offset + count; ++dim) {
                 if (weights.empty() || weights[start + dim] > 0) {
-                    double expApprox = exp(approxes[start + dim] - maxApprox);
+                    double expApprox = expApproxes[dim - offset];
                     if (!weights.empty()) {
                         expApprox *= weights[start + dim];
                     }
@@ -7,6 +7,8 @@
 #include <catboost/libs/helpers/query_info_helper.h>
 #include <catboost/libs/helpers/restorable_rng.h>
 
+#include <util/generic/algorithm.h>
+
 static int UpdateSize(int size, const TVector<TQueryInfo>& queryInfo, const TVector<int>& queryIndices, int learnSampleCount) {
     size = Min(size, learnSampleCount);
     if (!queryInfo.empty()) {
@@ -243,6 +245,25 @@ void TFold::DropEmptyCTRs() {
     }
 }
 
+void TFold::TrimOnlineCTR(size_t maxOnlineCTRFeatures, size_t maxOnlineCTRMemory) {
+    TVector<std::pair<ui64, TProjection>> ctrsByLastUse;
+    size_t memoryUsage = 0;
+    for (const auto& projCtr : OnlineCTR) {
+        ctrsByLastUse.emplace_back(projCtr.second.LastUseTick, projCtr.first);
+        memoryUsage += projCtr.second.GetMemoryUsage();
+    }
+    Sort(ctrsByLastUse.begin(), ctrsByLastUse.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    });
+    for (const auto& lastUseProj : ctrsByLastUse) {
+        if (OnlineCTR.size() <= maxOnlineCTRFeatures && memoryUsage <= maxOnlineCTRMemory) {
+            break;
+        }
+        memoryUsage -= OnlineCTR.at(lastUseProj.second).GetMemoryUsage();
+        OnlineCTR.erase(lastUseProj.second);
+    }
+}
+
 void TFold::AssignTarget(const TVector<float>& target, const TVector<TTargetClassifier>& targetClassifiers) {
     AssignPermuted(target, &LearnTarget);
     int learnSampleCount = LearnPermutation.ysize();
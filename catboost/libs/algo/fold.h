@@ -96,12 +96,15 @@ struct TFold {
         return BodyTailArr[0].Approx.ysize();
     }
 
-    void TrimOnlineCTR(size_t maxOnlineCTRFeatures) {
-        if (OnlineCTR.size() > maxOnlineCTRFeatures) {
-            OnlineCTR.clear();
-        }
+    // Call from one thread only, ctr with the oldest use is evicted first by TrimOnlineCTR
+    void MarkCtrUsed(const TProjection& proj) {
+        GetCtrRef(proj).LastUseTick = ++CtrUseTick;
     }
 
+    // Evicts least recently used ctrs of feature combinations until both limits are met,
+    // ctrs of single features are cheap to keep and are never evicted
+    void TrimOnlineCTR(size_t maxOnlineCTRFeatures, size_t maxOnlineCTRMemory);
+
     const TVector<float>& GetLearnWeights() const { return LearnWeights; }
 
     void SaveApproxes(IOutputStream* s) const;
@@ -139,7 +142,7 @@ private:
 
     TOnlineCTRHash OnlineSingleCtrs;
     TOnlineCTRHash OnlineCTR;
-
+    ui64 CtrUseTick = 0;
 
     void AssignTarget(const TVector<float>& target,
                       const TVector<TTargetClassifier>& targetClassifiers);
@@ -5,6 +5,7 @@
 #include <catboost/libs/data/load_data.h>
 
 #include <library/threading/local_executor/local_executor.h>
+#include <util/generic/bitops.h>
 #include <util/generic/set.h>
 
 size_t TAllFeatures::GetDocCount() const {
@@ -12,6 +13,14 @@ size_t TAllFeatures::GetDocCount() const {
         if (!floatHistogram.empty())
             return floatHistogram.size();
     }
+    for (const auto& packedHistogram : PackedFloatHistograms) {
+        if (!packedHistogram.empty())
+            return packedHistogram.size();
+    }
+    for (const auto& sparseFeature : SparseFloatFeatures) {
+        if (sparseFeature.IsSparse())
+            return sparseFeature.DocCount;
+    }
     for (const auto& catFeatures : CatFeaturesRemapped) {
         if (!catFeatures.empty())
             return catFeatures.size();
@@ -159,6 +168,7 @@ static void PrepareSlotsAfter(const TAllFeatures& learnFeatures, TAllFeatures* t
     size_t catFeatureCount = learnFeatures.OneHotValues.size();
     size_t floatFeatureCount = learnFeatures.FloatHistograms.size();
     PrepareSlots(catFeatureCount, floatFeatureCount, testFeatures);
+    testFeatures->FloatFeaturesPacking = learnFeatures.FloatFeaturesPacking;
     testFeatures->IsOneHot = learnFeatures.IsOneHot;
     for (size_t catFeatureIdx = 0; catFeatureIdx < catFeatureCount; ++catFeatureIdx) {
         testFeatures->OneHotValues[catFeatureIdx] = learnFeatures.OneHotValues[catFeatureIdx];
@@ -174,6 +184,139 @@ static void CleanupOneHotFeatures(size_t oneHotMaxSize, TAllFeatures* features)
     }
 }
 
+/// Move bins of float feature into `sparseFeature`, keeping only documents with bin other than `defaultBin`.
+static void MakeFloatFeatureSparse(ui8 defaultBin, TVector<ui8>* hist, TSparseFloatFeature* sparseFeature) {
+    sparseFeature->DocCount = hist->size();
+    sparseFeature->DefaultBin = defaultBin;
+    sparseFeature->DocIndices.clear();
+    sparseFeature->Bins.clear();
+    for (ui32 doc = 0; doc < hist->size(); ++doc) {
+        if ((*hist)[doc] != defaultBin) {
+            sparseFeature->DocIndices.push_back(doc);
+            sparseFeature->Bins.push_back((*hist)[doc]);
+        }
+    }
+    sparseFeature->DocIndices.shrink_to_fit();
+    sparseFeature->Bins.shrink_to_fit();
+    ClearVector(hist);
+}
+
+/// Bits per document of float feature bins if it is packed, rounded up to a power of 2 to share bytes evenly.
+static int GetPackedBitCount(const TFloatFeature& floatFeature) {
+    const int maxBin = floatFeature.Borders.ysize();
+    int bitCount = 1;
+    while (bitCount < (int)GetValueBitCount(maxBin)) {
+        bitCount *= 2;
+    }
+    return bitCount;
+}
+
+/// Store float features with at most MAX_SPARSE_FLOAT_FEATURE_NON_DEFAULT_FRACTION of documents
+/// outside of the most frequent bin in SparseFloatFeatures.
+/// Features with at most MAX_PACKED_FLOAT_FEATURE_BIT_COUNT bits are left to be packed, which takes less memory.
+static void SparsifyFloatFeatures(const TVector<TFloatFeature>& floatFeatures, NPar::TLocalExecutor& localExecutor, TAllFeatures* features) {
+    const int floatFeatureCount = features->FloatHistograms.ysize();
+    features->SparseFloatFeatures.resize(floatFeatureCount);
+    localExecutor.ExecRange([&] (int floatFeatureIdx) {
+        TVector<ui8>& hist = features->FloatHistograms[floatFeatureIdx];
+        if (hist.empty() || GetPackedBitCount(floatFeatures[floatFeatureIdx]) <= MAX_PACKED_FLOAT_FEATURE_BIT_COUNT) {
+            return;
+        }
+        TVector<size_t> binCounts(Max<ui8>() + 1, 0);
+        for (ui8 bin : hist) {
+            ++binCounts[bin];
+        }
+        const ui8 defaultBin = MaxElement(binCounts.begin(), binCounts.end()) - binCounts.begin();
+        const size_t nonDefaultCount = hist.size() - binCounts[defaultBin];
+        if (nonDefaultCount <= MAX_SPARSE_FLOAT_FEATURE_NON_DEFAULT_FRACTION * hist.size()) {
+            MakeFloatFeatureSparse(defaultBin, &hist, &features->SparseFloatFeatures[floatFeatureIdx]);
+        }
+    }, 0, floatFeatureCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+    if (!AnyOf(features->SparseFloatFeatures, [] (const TSparseFloatFeature& feature) { return feature.IsSparse(); })) {
+        features->SparseFloatFeatures.clear();
+    }
+}
+
+/// Store float features of `testFeatures` that are sparse in `learnFeatures` with the same default bin.
+static void SparsifyFloatFeaturesAfter(const TAllFeatures& learnFeatures, NPar::TLocalExecutor& localExecutor, TAllFeatures* testFeatures) {
+    if (!learnFeatures.HasSparseFloatFeatures()) {
+        return;
+    }
+    const int floatFeatureCount = testFeatures->FloatHistograms.ysize();
+    testFeatures->SparseFloatFeatures.resize(floatFeatureCount);
+    localExecutor.ExecRange([&] (int floatFeatureIdx) {
+        TVector<ui8>& hist = testFeatures->FloatHistograms[floatFeatureIdx];
+        if (learnFeatures.IsFloatFeatureSparse(floatFeatureIdx) && !hist.empty()) {
+            const ui8 defaultBin = learnFeatures.SparseFloatFeatures[floatFeatureIdx].DefaultBin;
+            MakeFloatFeatureSparse(defaultBin, &hist, &testFeatures->SparseFloatFeatures[floatFeatureIdx]);
+        }
+    }, 0, floatFeatureCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
+/// Assign bins of binarized float features with at most MAX_PACKED_FLOAT_FEATURE_BIT_COUNT bits to shared bytes.
+/// Features of the same bit count (rounded up to a power of 2) share bytes, so each byte holds 8, 4 or 2 features.
+static void SetupFloatFeaturesPacking(const TVector<TFloatFeature>& floatFeatures, TAllFeatures* features) {
+    const int floatFeatureCount = features->FloatHistograms.ysize();
+    TVector<TFloatFeaturePacking> packing(floatFeatureCount);
+    TVector<int> openPackIdx(MAX_PACKED_FLOAT_FEATURE_BIT_COUNT + 1, -1); // [bitCount]
+    TVector<int> openPackUsedBits(MAX_PACKED_FLOAT_FEATURE_BIT_COUNT + 1, 0); // [bitCount]
+    int packCount = 0;
+    for (int floatFeatureIdx = 0; floatFeatureIdx < floatFeatureCount; ++floatFeatureIdx) {
+        if (features->FloatHistograms[floatFeatureIdx].empty()) {
+            continue;
+        }
+        const int bitCount = GetPackedBitCount(floatFeatures[floatFeatureIdx]);
+        if (bitCount > MAX_PACKED_FLOAT_FEATURE_BIT_COUNT) {
+            continue;
+        }
+        if (openPackIdx[bitCount] == -1 || openPackUsedBits[bitCount] + bitCount > 8) {
+            openPackIdx[bitCount] = packCount++;
+            openPackUsedBits[bitCount] = 0;
+        }
+        packing[floatFeatureIdx].PackIdx = openPackIdx[bitCount];
+        packing[floatFeatureIdx].Shift = openPackUsedBits[bitCount];
+        packing[floatFeatureIdx].BitCount = bitCount;
+        openPackUsedBits[bitCount] += bitCount;
+    }
+    if (packCount > 0) {
+        features->FloatFeaturesPacking.swap(packing);
+    }
+}
+
+/// Move bins of float features into PackedFloatHistograms according to FloatFeaturesPacking.
+static void PackFloatFeatures(NPar::TLocalExecutor& localExecutor, TAllFeatures* features) {
+    if (features->FloatFeaturesPacking.empty()) {
+        return;
+    }
+    TVector<TVector<int>> packFeatures; // [packIdx][featureInPack]
+    for (int floatFeatureIdx = 0; floatFeatureIdx < features->FloatFeaturesPacking.ysize(); ++floatFeatureIdx) {
+        const auto& packing = features->FloatFeaturesPacking[floatFeatureIdx];
+        if (packing.IsPacked()) {
+            if (packing.PackIdx >= packFeatures.ysize()) {
+                packFeatures.resize(packing.PackIdx + 1);
+            }
+            packFeatures[packing.PackIdx].push_back(floatFeatureIdx);
+        }
+    }
+    features->PackedFloatHistograms.resize(packFeatures.size());
+    localExecutor.ExecRange([&] (int packIdx) {
+        const size_t docCount = features->FloatHistograms[packFeatures[packIdx][0]].size();
+        TVector<ui8>& packedHist = features->PackedFloatHistograms[packIdx];
+        packedHist.assign(docCount, 0);
+        ui8* packedHistData = packedHist.data();
+        for (int floatFeatureIdx : packFeatures[packIdx]) {
+            TVector<ui8>& hist = features->FloatHistograms[floatFeatureIdx];
+            Y_ASSERT(hist.size() == docCount);
+            const ui8* histData = hist.data();
+            const ui8 shift = features->FloatFeaturesPacking[floatFeatureIdx].Shift;
+            for (size_t doc = 0; doc < docCount; ++doc) {
+                packedHistData[doc] |= histData[doc] << shift;
+            }
+            ClearVector(&hist);
+        }
+    }, 0, packFeatures.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
 namespace {
     /// Select all documents in range [0, docCount).
     class TSelectAll {
@@ -261,7 +404,7 @@ namespace {
                     }
                 } else {
                     auto floatFeatureIdx = TypedFeatureIdx[featureIdx];
-                    if (learnFeatures.FloatHistograms[floatFeatureIdx].empty()) {
+                    if (learnFeatures.IsFloatFeatureEmpty(floatFeatureIdx)) {
                         IgnoredFeatures.insert(featureIdx);
                     }
                 }
@@ -357,6 +500,15 @@ namespace {
     };
 }
 
+bool IsCategoricalFeaturesEmpty(const TAllFeatures& allFeatures) {
+    for (int i = 0; i < allFeatures.CatFeaturesRemapped.ysize(); ++i) {
+        if (!allFeatures.IsOneHot[i] && !allFeatures.CatFeaturesRemapped[i].empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void PrepareAllFeaturesLearn(const THashSet<int>& categFeatures,
                              const TVector<TFloatFeature>& floatFeatures,
                              const TVector<int>& ignoredFeatures,
@@ -364,6 +516,7 @@ void PrepareAllFeaturesLearn(const THashSet<int>& categFeatures,
                              size_t oneHotMaxSize,
                              ENanMode nanMode,
                              bool clearPool,
+                             bool allowSparseFloatFeatures,
                              NPar::TLocalExecutor& localExecutor,
                              const TVector<size_t>& selectedDocIndices,
                              TDocumentStorage* learnDocStorage,
@@ -378,6 +531,11 @@ void PrepareAllFeaturesLearn(const THashSet<int>& categFeatures,
     binarizer.Binarize(/*allowNans=*/true, learnDocStorage, selectedDocIndices, clearPool, learnFeatures);
     CleanupOneHotFeatures(oneHotMaxSize, learnFeatures);
     CB_ENSURE(learnFeatures->GetDocCount() > 0, "Train dataset is empty after binarization");
+    if (allowSparseFloatFeatures) {
+        SparsifyFloatFeatures(floatFeatures, localExecutor, learnFeatures);
+    }
+    SetupFloatFeaturesPacking(floatFeatures, learnFeatures);
+    PackFloatFeatures(localExecutor, learnFeatures);
     DumpMemUsage("Extract bools done");
 }
 
@@ -399,5 +557,7 @@ void PrepareAllFeaturesTest(const THashSet<int>& categFeatures,
     binarizer.SetupToIgnoreFeaturesAfter(learnFeatures);
     PrepareSlotsAfter(learnFeatures, testFeatures);
     binarizer.Binarize(allowNansOnlyInTest, testDocStorage, selectedDocIndices, clearPool, testFeatures);
+    SparsifyFloatFeaturesAfter(learnFeatures, localExecutor, testFeatures);
+    PackFloatFeatures(localExecutor, testFeatures);
     DumpMemUsage("Extract bools done");
 }
@@ -11,20 +11,111 @@
 #include <util/generic/ymath.h>
 
 
+// Low cardinality float features with at most this many bits per bin are packed several per byte
+constexpr int MAX_PACKED_FLOAT_FEATURE_BIT_COUNT = 4;
+
+// Location of float feature bins inside TAllFeatures::PackedFloatHistograms
+struct TFloatFeaturePacking {
+    int PackIdx = -1; // -1 if feature is stored in TAllFeatures::FloatHistograms
+    ui8 Shift = 0;
+    ui8 BitCount = 8;
+
+    bool IsPacked() const {
+        return PackIdx >= 0;
+    }
+    SAVELOAD(PackIdx, Shift, BitCount);
+};
+
+// Read only view of bins stored a byte per document, either plain or packed several per byte
+// (float features, see TFloatFeaturePacking, and online ctrs, see TOnlineCTR)
+struct TPackedBins {
+    const ui8* Data = nullptr;
+    ui8 Shift = 0;
+    ui8 Mask = 0xFF;
+
+    inline ui8 operator[](size_t doc) const {
+        return (Data[doc] >> Shift) & Mask;
+    }
+
+    // View of the same feature for documents starting from offset
+    inline TPackedBins Skip(size_t offset) const {
+        return {Data + offset, Shift, Mask};
+    }
+};
+
+// Float features with at most this fraction of documents outside of the most frequent bin are stored sparse
+constexpr double MAX_SPARSE_FLOAT_FEATURE_NON_DEFAULT_FRACTION = 0.1;
+
+// Float feature bins where only documents with bin other than DefaultBin are stored
+struct TSparseFloatFeature {
+    ui32 DocCount = 0; // 0 if feature is not sparse
+    ui8 DefaultBin = 0;
+    TVector<ui32> DocIndices; // increasing
+    TVector<ui8> Bins; // [i] is bin of DocIndices[i]
+
+    bool IsSparse() const {
+        return DocCount > 0;
+    }
+
+    void Densify(TVector<ui8>* bins) const {
+        bins->assign(DocCount, DefaultBin);
+        for (size_t i = 0; i < DocIndices.size(); ++i) {
+            (*bins)[DocIndices[i]] = Bins[i];
+        }
+    }
+    SAVELOAD(DocCount, DefaultBin, DocIndices, Bins);
+};
+
 struct TAllFeatures {
     TVector<TVector<ui8>> FloatHistograms; // [featureIdx][doc]
-    // FloatHistograms[featureIdx] might be empty if feature is const.
+    // FloatHistograms[featureIdx] might be empty if feature is const, packed or sparse.
+    TVector<TVector<ui8>> PackedFloatHistograms; // [packIdx][doc], bins of several low cardinality features per byte
+    TVector<TFloatFeaturePacking> FloatFeaturesPacking; // [featureIdx], empty if no features are packed
+    TVector<TSparseFloatFeature> SparseFloatFeatures; // [featureIdx], empty if no features are sparse
     TVector<TVector<int>> CatFeaturesRemapped; // [featureIdx][doc]
     TVector<TVector<int>> OneHotValues; // [featureIdx][valueIdx]
     TVector<bool> IsOneHot;
     size_t GetDocCount() const;
-    SAVELOAD(FloatHistograms, CatFeaturesRemapped, OneHotValues, IsOneHot);
+
+    bool IsFloatFeaturePacked(int featureIdx) const {
+        return !FloatFeaturesPacking.empty() && FloatFeaturesPacking[featureIdx].IsPacked();
+    }
+
+    bool IsFloatFeatureSparse(int featureIdx) const {
+        return !SparseFloatFeatures.empty() && SparseFloatFeatures[featureIdx].IsSparse();
+    }
+
+    bool HasSparseFloatFeatures() const {
+        return !SparseFloatFeatures.empty();
+    }
+
+    bool IsFloatFeatureEmpty(int featureIdx) const {
+        return FloatHistograms[featureIdx].empty() && !IsFloatFeaturePacked(featureIdx) && !IsFloatFeatureSparse(featureIdx);
+    }
+
+    // Sparse features are expanded into denseBuffer, which must outlive the returned view
+    TPackedBins GetFloatFeatureBins(int featureIdx, TVector<ui8>* denseBuffer = nullptr) const {
+        if (IsFloatFeatureSparse(featureIdx)) {
+            Y_ASSERT(denseBuffer != nullptr);
+            SparseFloatFeatures[featureIdx].Densify(denseBuffer);
+            return {denseBuffer->data(), 0, 0xFF};
+        }
+        if (IsFloatFeaturePacked(featureIdx)) {
+            const auto& packing = FloatFeaturesPacking[featureIdx];
+            return {PackedFloatHistograms[packing.PackIdx].data(), packing.Shift, static_cast<ui8>((1 << packing.BitCount) - 1)};
+        }
+        return {FloatHistograms[featureIdx].data(), 0, 0xFF};
+    }
+    SAVELOAD(FloatHistograms, PackedFloatHistograms, FloatFeaturesPacking, SparseFloatFeatures, CatFeaturesRemapped, OneHotValues, IsOneHot);
 };
 
 inline int GetDocCount(const TAllFeatures& allFeatures) {
     return static_cast<int>(allFeatures.GetDocCount());
 }
 
+// true if there are no categorical features which are not one-hot encoded, i.e. no features for ctrs
+bool IsCategoricalFeaturesEmpty(const TAllFeatures& allFeatures);
+
 /// Binarize data from `learnDocStorage` into `learnFeatures`.
 /// One-hot encode categorial features if represented by `oneHotMaxSize` or fewer values.
 /// @param categFeatures - Indices of cat-features
@@ -34,6 +125,7 @@ inline int GetDocCount(const TAllFeatures& allFeatures) {
 /// @param oneHotMaxSize - Limit on the number of cat-values for one-hot encoding
 /// @param nanMode - Select interpretation of NaN values of float features
 /// @param clearPool - Discard features from `learnDocStorage` right after binarization
+/// @param allowSparseFloatFeatures - Store float features with rare non default bins sparse, see IsSparseFloatFeaturesScoring
 /// @param localExecutor - Thread provider
 /// @param selectedDocIndices - Samples in `learnDocStorage` to binarize (empty == all)
 /// @param learnDocStorage - Discardable raw features
@@ -45,6 +137,7 @@ void PrepareAllFeaturesLearn(const THashSet<int>& categFeatures,
                              size_t oneHotMaxSize,
                              ENanMode nanMode,
                              bool clearPool,
+                             bool allowSparseFloatFeatures,
                              NPar::TLocalExecutor& localExecutor,
                              const TVector<size_t>& selectedDocIndices,
                              TDocumentStorage* learnDocStorage,
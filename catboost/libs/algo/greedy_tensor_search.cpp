@@ -11,14 +11,26 @@
 
 #include <library/fast_log/fast_log.h>
 
+#include <util/generic/algorithm.h>
 #include <util/string/builder.h>
 #include <util/system/mem_info.h>
 
-constexpr size_t MAX_ONLINE_CTR_FEATURES = 50;
+// Part of used_ram_limit shared by online ctr caches of all folds
+constexpr size_t ONLINE_CTR_CACHE_RAM_LIMIT_DIVISOR = 4;
 
-void TrimOnlineCTRcache(const TVector<TFold*>& folds) {
+size_t GetMaxOnlineCTRMemory(const NCatboostOptions::TCatBoostOptions& params, size_t foldCount) {
+    const ui64 cpuUsedRamLimit = ParseMemorySizeDescription(params.SystemOptions->CpuUsedRamLimit);
+    if (cpuUsedRamLimit == Max<ui64>()) {
+        return Max<size_t>();
+    }
+    return cpuUsedRamLimit / ONLINE_CTR_CACHE_RAM_LIMIT_DIVISOR / foldCount;
+}
+
+void TrimOnlineCTRcache(const TLearnContext& ctx, const TVector<TFold*>& folds) {
+    const size_t foldCount = ctx.LearnProgress.Folds.size() + 1; // + averaging fold
+    const size_t maxOnlineCTRMemory = GetMaxOnlineCTRMemory(ctx.Params, foldCount);
     for (auto& fold : folds) {
-        fold->TrimOnlineCTR(MAX_ONLINE_CTR_FEATURES);
+        fold->TrimOnlineCTR(MAX_ONLINE_CTR_FEATURES, maxOnlineCTRMemory);
     }
 }
 
@@ -27,7 +39,7 @@ static void AddFloatFeatures(const TDataset& learnData,
                              TBucketStatsCache* statsFromPrevTree,
                              TCandidateList* candList) {
     for (int f = 0; f < learnData.AllFeatures.FloatHistograms.ysize(); ++f) {
-        if (learnData.AllFeatures.FloatHistograms[f].empty()) {
+        if (learnData.AllFeatures.IsFloatFeatureEmpty(f)) {
             continue;
         }
         TCandidateInfo split;
@@ -35,7 +47,7 @@ static void AddFloatFeatures(const TDataset& learnData,
         split.SplitCandidate.Type = ESplitType::FloatFeature;
 
         if (ctx->Rand.GenRandReal1() > ctx->Params.ObliviousTreeOptions->Rsm) {
-            statsFromPrevTree->Stats.erase(split.SplitCandidate);
+            statsFromPrevTree->Erase(split.SplitCandidate);
             continue;
         }
         candList->emplace_back(TCandidatesInfoList(split));
@@ -56,7 +68,7 @@ static void AddOneHotFeatures(const TDataset& learnData,
         split.SplitCandidate.FeatureIdx = cf;
         split.SplitCandidate.Type = ESplitType::OneHotFeature;
         if (ctx->Rand.GenRandReal1() > ctx->Params.ObliviousTreeOptions->Rsm) {
-            statsFromPrevTree->Stats.erase(split.SplitCandidate);
+            statsFromPrevTree->Erase(split.SplitCandidate);
             continue;
         }
 
@@ -107,7 +119,7 @@ static void DropStatsForProjection(const TFold& fold,
                 TCandidateInfo split;
                 split.SplitCandidate.Type = ESplitType::OnlineCtr;
                 split.SplitCandidate.Ctr = TCtr(proj, ctrIdx, border, prior, ctrMeta.BorderCount);
-                statsFromPrevTree->Stats.erase(split.SplitCandidate);
+                statsFromPrevTree->Erase(split.SplitCandidate);
             }
         }
     }
@@ -131,7 +143,7 @@ static void AddSimpleCtrs(const TDataset& learnData,
             continue;
         }
         AddCtrsToCandList(*fold, *ctx, proj, candList);
-        fold->GetCtrRef(proj);
+        fold->MarkCtrUsed(proj);
     }
 }
 
@@ -180,19 +192,23 @@ static void AddTreeCtrs(const TDataset& learnData,
             addedProjHash.insert(proj);
 
             AddCtrsToCandList(*fold, *ctx, proj, candList);
-            fold->GetCtrRef(proj);
+            fold->MarkCtrUsed(proj);
         }
     }
     THashSet<TSplitCandidate> candidatesToErase;
-    for (auto& splitCandidate : statsFromPrevTree->Stats) {
-        if (splitCandidate.first.Type == ESplitType::OnlineCtr) {
-            if (!addedProjHash.has(splitCandidate.first.Ctr.Projection)) {
-                candidatesToErase.insert(splitCandidate.first);
+    const auto collectStaleCtrs = [&](const auto& stats) {
+        for (const auto& splitCandidate : stats) {
+            if (splitCandidate.first.Type == ESplitType::OnlineCtr) {
+                if (!addedProjHash.has(splitCandidate.first.Ctr.Projection)) {
+                    candidatesToErase.insert(splitCandidate.first);
+                }
             }
         }
-    }
+    };
+    collectStaleCtrs(statsFromPrevTree->Stats);
+    collectStaleCtrs(statsFromPrevTree->PairwiseStats);
     for (const auto& splitCandidate : candidatesToErase) {
-        statsFromPrevTree->Stats.erase(splitCandidate);
+        statsFromPrevTree->Erase(splitCandidate);
     }
 }
 
@@ -237,6 +253,19 @@ static void SelectCtrsToDropAfterCalc(size_t memoryLimit,
     }
 }
 
+namespace {
+    // Part of CalcBestScore work scheduled as one local executor job
+    struct TScoreTask {
+        double Cost = 0; // roughly in documents and buckets visited
+        int FloatFeatureGroupIdx = -1;
+        int CandidateIdx = -1;
+        int SubcandidateIdx = -1; // -1 if all subcandidates are scored by the task
+    };
+}
+
+// Cost of computing one online ctr for a document relative to visiting a document when scoring
+constexpr double ONLINE_CTR_COST_PER_DOC = 4.0;
+
 static void CalcBestScore(const TDataset& learnData,
         const TDatasetPtrs& testDataPtrs,
         const TVector<int>& splitCounts,
@@ -249,42 +278,158 @@ static void CalcBestScore(const TDataset& learnData,
     CB_ENSURE(static_cast<ui32>(ctx->LocalExecutor.GetThreadCount()) == ctx->Params.SystemOptions->NumThreads - 1);
 
     TCandidateList& candList = *candidateList;
-    ctx->LocalExecutor.ExecRange([&](int id) {
-        auto& candidate = candList[id];
-        if (candidate.Candidates[0].SplitCandidate.Type == ESplitType::OnlineCtr) {
-            const auto& proj = candidate.Candidates[0].SplitCandidate.Ctr.Projection;
-            if (fold->GetCtrRef(proj).Feature.empty()) {
-                ComputeOnlineCTRs(learnData,
-                                  testDataPtrs,
-                                  *fold,
-                                  proj,
-                                  ctx,
-                                  &fold->GetCtrRef(proj));
-            }
+
+    // float features are scored in groups with one pass over documents per group,
+    // groups are made smaller when there are not enough of them to load all threads
+    TVector<int> candidateIds;
+    TVector<int> floatFeatureIds;
+    const bool isPairwiseScoring = IsPairwiseScoring(ctx->Params.LossFunctionDescription->GetLossFunction());
+    // sample stats are derived per candidate from stats of all documents, see CalcScore
+    const bool isSampledOutSiblingScoring = IsSampledOutSiblingScoring(ctx->Params);
+    for (int id = 0; id < candList.ysize(); ++id) {
+        const auto& candidates = candList[id].Candidates;
+        if (!isPairwiseScoring && !isSampledOutSiblingScoring && candidates.size() == 1 && candidates[0].SplitCandidate.Type == ESplitType::FloatFeature
+            && !learnData.AllFeatures.IsFloatFeatureSparse(candidates[0].SplitCandidate.FeatureIdx))
+        {
+            floatFeatureIds.push_back(id);
+        } else {
+            candidateIds.push_back(id);
+        }
+    }
+    const int threadCount = ctx->LocalExecutor.GetThreadCount() + 1;
+    const int groupSize = Max(1, Min(FLOAT_FEATURES_PER_HISTOGRAM_PASS, floatFeatureIds.ysize() / threadCount));
+    TVector<TVector<int>> floatFeatureGroups;
+    for (int groupStart = 0; groupStart < floatFeatureIds.ysize(); groupStart += groupSize) {
+        const int groupEnd = Min(groupStart + groupSize, floatFeatureIds.ysize());
+        floatFeatureGroups.emplace_back(floatFeatureIds.begin() + groupStart, floatFeatureIds.begin() + groupEnd);
+    }
+
+    const auto calcFloatFeatureGroupScores = [&](const TVector<int>& group) {
+        TVector<TSplitCandidate> splits;
+        for (int id : group) {
+            splits.push_back(candList[id].Candidates[0].SplitCandidate);
+        }
+        const auto scoreBins = CalcScoresForFloatFeatures(learnData.AllFeatures,
+                                                          splitCounts,
+                                                          ctx->SampledDocs,
+                                                          ctx->SmallestSplitSideDocs,
+                                                          *fold,
+                                                          ctx->Params,
+                                                          splits,
+                                                          currentDepth,
+                                                          &ctx->PrevTreeLevelStats);
+        for (int i = 0; i < group.ysize(); ++i) {
+            const int id = group[i];
+            SetBestScore(randSeed + id, {GetScores(scoreBins[i])}, scoreStDev, &candList[id].Candidates);
+        }
+    };
+
+    const int leafCount = 1 << currentDepth;
+    const double docCount = ctx->SampledDocs.GetDocCount();
+    const double totalSampleCount = learnData.GetSampleCount() + GetSampleCount(testDataPtrs);
+    const auto estimateScoreCost = [&](const TSplitCandidate& split) {
+        return docCount + leafCount * (GetSplitCount(splitCounts, learnData.AllFeatures.OneHotValues, split) + 1.0);
+    };
+    const auto isCtrMissing = [&](int id) {
+        const auto& split = candList[id].Candidates[0].SplitCandidate;
+        return split.Type == ESplitType::OnlineCtr && fold->GetCtrRef(split.Ctr.Projection).Feature.empty();
+    };
+    const auto computeCtr = [&](int id) {
+        const auto& proj = candList[id].Candidates[0].SplitCandidate.Ctr.Projection;
+        ComputeOnlineCTRs(learnData,
+                          testDataPtrs,
+                          *fold,
+                          proj,
+                          ctx,
+                          &ctx->LocalExecutor,
+                          &fold->GetCtrRef(proj));
+    };
+    const auto calcSubcandidateScores = [&](int id, int oneCandidate) {
+        const auto& split = candList[id].Candidates[oneCandidate].SplitCandidate;
+        Y_ASSERT(split.Type != ESplitType::OnlineCtr || !fold->GetCtrRef(split.Ctr.Projection).Feature.empty());
+        return GetScores(CalcScore(learnData.AllFeatures,
+                                   splitCounts,
+                                   fold->GetAllCtrs(),
+                                   ctx->SampledDocs,
+                                   ctx->SmallestSplitSideDocs,
+                                   *fold,
+                                   ctx->Params,
+                                   split,
+                                   currentDepth,
+                                   &ctx->PrevTreeLevelStats));
+    };
+
+    // Ctrs to be dropped right after scoring are computed and scored by one task each,
+    // so that no more than a thread count of them are in memory, see SelectCtrsToDropAfterCalc.
+    // Other missing ctrs are computed beforehand, and their candidates are scored by separate tasks.
+    TVector<int> ctrsToCompute;
+    for (int id : candidateIds) {
+        if (isCtrMissing(id) && !candList[id].ShouldDropCtrAfterCalc) {
+            ctrsToCompute.push_back(id);
+        }
+    }
+    ctx->LocalExecutor.ExecRange([&](int i) {
+        computeCtr(ctrsToCompute[i]);
+    }, 0, ctrsToCompute.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+
+    // Tasks are started from the most expensive ones, and idle threads take the next task from the queue,
+    // so the slowest candidates do not end up waited for at the end of the depth
+    TVector<TScoreTask> tasks;
+    for (int groupIdx = 0; groupIdx < floatFeatureGroups.ysize(); ++groupIdx) {
+        TScoreTask task;
+        task.FloatFeatureGroupIdx = groupIdx;
+        task.Cost = docCount;
+        for (int id : floatFeatureGroups[groupIdx]) {
+            task.Cost += estimateScoreCost(candList[id].Candidates[0].SplitCandidate) - docCount;
         }
-        TVector<TVector<double>> allScores(candidate.Candidates.size());
-        ctx->LocalExecutor.ExecRange([&](int oneCandidate) {
-            if (candidate.Candidates[oneCandidate].SplitCandidate.Type == ESplitType::OnlineCtr) {
-                const auto& proj = candidate.Candidates[oneCandidate].SplitCandidate.Ctr.Projection;
-                Y_ASSERT(!fold->GetCtrRef(proj).Feature.empty());
+        tasks.push_back(task);
+    }
+    TVector<TVector<TVector<double>>> allScores(candList.size());
+    for (int id : candidateIds) {
+        const auto& candidates = candList[id].Candidates;
+        allScores[id].resize(candidates.size());
+        if (isCtrMissing(id)) {
+            Y_ASSERT(candList[id].ShouldDropCtrAfterCalc);
+            TScoreTask task;
+            task.CandidateIdx = id;
+            task.Cost = ONLINE_CTR_COST_PER_DOC * totalSampleCount * ctx->CtrsHelper.GetCtrInfo(candidates[0].SplitCandidate.Ctr.Projection).size();
+            for (const auto& candidate : candidates) {
+                task.Cost += estimateScoreCost(candidate.SplitCandidate);
             }
-            allScores[oneCandidate] = GetScores(CalcScore(learnData.AllFeatures,
-                                        splitCounts,
-                                        fold->GetAllCtrs(),
-                                        ctx->SampledDocs,
-                                        ctx->SmallestSplitSideDocs,
-                                        *fold,
-                                        ctx->Params,
-                                        candidate.Candidates[oneCandidate].SplitCandidate,
-                                        currentDepth,
-                                        &ctx->PrevTreeLevelStats));
-        }, NPar::TLocalExecutor::TExecRangeParams(0, candidate.Candidates.ysize())
-         , NPar::TLocalExecutor::WAIT_COMPLETE);
-        if (candidate.Candidates[0].SplitCandidate.Type == ESplitType::OnlineCtr && candidate.ShouldDropCtrAfterCalc) {
-            fold->GetCtrRef(candidate.Candidates[0].SplitCandidate.Ctr.Projection).Feature.clear();
-        }
-        SetBestScore(randSeed + id, allScores, scoreStDev, &candidate.Candidates);
-    }, 0, candList.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+            tasks.push_back(task);
+            continue;
+        }
+        for (int oneCandidate = 0; oneCandidate < candidates.ysize(); ++oneCandidate) {
+            TScoreTask task;
+            task.CandidateIdx = id;
+            task.SubcandidateIdx = oneCandidate;
+            task.Cost = estimateScoreCost(candidates[oneCandidate].SplitCandidate);
+            tasks.push_back(task);
+        }
+    }
+    StableSort(tasks.begin(), tasks.end(), [](const TScoreTask& lhs, const TScoreTask& rhs) {
+        return lhs.Cost > rhs.Cost;
+    });
+
+    ctx->LocalExecutor.ExecRange([&](int taskIdx) {
+        const TScoreTask& task = tasks[taskIdx];
+        if (task.FloatFeatureGroupIdx >= 0) {
+            calcFloatFeatureGroupScores(floatFeatureGroups[task.FloatFeatureGroupIdx]);
+        } else if (task.SubcandidateIdx >= 0) {
+            allScores[task.CandidateIdx][task.SubcandidateIdx] = calcSubcandidateScores(task.CandidateIdx, task.SubcandidateIdx);
+        } else {
+            const int id = task.CandidateIdx;
+            computeCtr(id);
+            ctx->LocalExecutor.ExecRange([&](int oneCandidate) {
+                allScores[id][oneCandidate] = calcSubcandidateScores(id, oneCandidate);
+            }, 0, candList[id].Candidates.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+            fold->GetCtrRef(candList[id].Candidates[0].SplitCandidate.Ctr.Projection).Feature.clear();
+        }
+    }, 0, tasks.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+
+    for (int id : candidateIds) {
+        SetBestScore(randSeed + id, allScores[id], scoreStDev, &candList[id].Candidates);
+    }
 }
 
 void GreedyTensorSearch(const TDataset& learnData,
@@ -296,24 +441,29 @@ void GreedyTensorSearch(const TDataset& learnData,
                         TLearnContext* ctx,
                         TSplitTree* resSplitTree) {
     TSplitTree currentSplitTree;
-    TrimOnlineCTRcache({fold});
+    TrimOnlineCTRcache(*ctx, {fold});
 
     int learnSampleCount = learnData.GetSampleCount();
     int testSampleCount = GetSampleCount(testDataPtrs);
     TVector<TIndexType> indices(learnSampleCount); // always for all documents
     MATRIXNET_INFO_LOG << "\n";
+    // in distributed training master may hold a sample of learn documents only
+    const int allLearnSampleCount = ctx->Params.SystemOptions->IsSingleHost() ? learnSampleCount : ctx->AllDocCount;
 
     if (!ctx->Params.SystemOptions->IsSingleHost()) {
         MapTensorSearchStart(ctx);
     }
 
     const bool isSamplingPerTree = IsSamplingPerTree(ctx->Params.ObliviousTreeOptions);
+    const bool isSampledOutSiblingScoring = IsSampledOutSiblingScoring(ctx->Params);
     if (isSamplingPerTree) {
         if (!ctx->Params.SystemOptions->IsSingleHost()) {
             MapBootstrap(ctx);
         } else {
             Bootstrap(ctx->Params, indices, fold, &ctx->SampledDocs, &ctx->LocalExecutor, &ctx->Rand);
         }
+    }
+    if (isSamplingPerTree || isSampledOutSiblingScoring) {
         ctx->PrevTreeLevelStats.GarbageCollect();
     }
 
@@ -324,9 +474,24 @@ void GreedyTensorSearch(const TDataset& learnData,
         AddSimpleCtrs(learnData, fold, ctx, &ctx->PrevTreeLevelStats, &candList);
         AddTreeCtrs(learnData, currentSplitTree, fold, ctx, &ctx->PrevTreeLevelStats, &candList);
 
+        int ctrCacheHitCount = 0;
+        int ctrCacheMissCount = 0;
+        for (const auto& candidate : candList) {
+            const auto& split = candidate.Candidates[0].SplitCandidate;
+            if (split.Type == ESplitType::OnlineCtr) {
+                if (fold->GetCtrRef(split.Ctr.Projection).Feature.empty()) {
+                    ++ctrCacheMissCount;
+                } else {
+                    ++ctrCacheHitCount;
+                }
+            }
+        }
+        profile.AddCounter("Online CTR cache hits", ctrCacheHitCount);
+        profile.AddCounter("Online CTR cache misses", ctrCacheMissCount);
+
         auto IsInCache = [&fold](const TProjection& proj) -> bool {return fold->GetCtrRef(proj).Feature.empty();};
         auto cpuUsedRamLimit = ParseMemorySizeDescription(ctx->Params.SystemOptions->CpuUsedRamLimit);
-        SelectCtrsToDropAfterCalc(cpuUsedRamLimit, learnSampleCount + testSampleCount, ctx->Params.SystemOptions->NumThreads, IsInCache, &candList);
+        SelectCtrsToDropAfterCalc(cpuUsedRamLimit, allLearnSampleCount + testSampleCount, ctx->Params.SystemOptions->NumThreads, IsInCache, &candList);
 
         CheckInterrupted(); // check after long-lasting operation
         if (!isSamplingPerTree) {
@@ -334,24 +499,43 @@ void GreedyTensorSearch(const TDataset& learnData,
                 MapBootstrap(ctx);
             } else {
                 Bootstrap(ctx->Params, indices, fold, &ctx->SampledDocs, &ctx->LocalExecutor, &ctx->Rand);
+                if (isSampledOutSiblingScoring) {
+                    ctx->SmallestSplitSideDocs.SelectSampledOutSibling(curDepth, *fold, indices, ctx->SampledDocs, &ctx->LocalExecutor);
+                }
             }
         }
         profile.AddOperation(TStringBuilder() << "Bootstrap, depth " << curDepth);
 
-        const double scoreStDev = ctx->Params.ObliviousTreeOptions->RandomStrength * CalcScoreStDev(*fold) * CalcScoreStDevMult(learnSampleCount, modelLength);
+        const double scoreStDev = ctx->Params.ObliviousTreeOptions->RandomStrength * CalcScoreStDev(*fold) * CalcScoreStDevMult(allLearnSampleCount, modelLength);
         if (!ctx->Params.SystemOptions->IsSingleHost()) {
+            TVector<TProjection> ctrProjections;
+            for (const auto& candidate : candList) {
+                const auto& split = candidate.Candidates[0].SplitCandidate;
+                if (split.Type == ESplitType::OnlineCtr) {
+                    ctrProjections.push_back(split.Ctr.Projection);
+                }
+            }
+            MapCalcOnlineCtrs(testDataPtrs, ctrProjections, fold, ctx);
+            profile.AddOperation(TStringBuilder() << "Calc online ctrs " << curDepth);
             MapRemoteCalcScore(scoreStDev, currentSplitTree.GetDepth(), &candList, ctx);
         } else {
+            const bool isSparseScoring = learnData.AllFeatures.HasSparseFloatFeatures() && IsSparseFloatFeaturesScoring(ctx->Params);
+            if (isSparseScoring) {
+                ctx->SampledDocs.PrepareSparseScoring(learnSampleCount, 1 << currentSplitTree.GetDepth(), &ctx->LocalExecutor);
+            }
             const ui64 randSeed = ctx->Rand.GenRand();
             CalcBestScore(learnData, testDataPtrs, splitCounts, currentSplitTree.GetDepth(), randSeed, scoreStDev, &candList, fold, ctx);
         }
 
         size_t maxFeatureValueCount = 1;
+        THashMap<TProjection, size_t> featureValueCounts; // ctrs computed only for scoring are dropped below
         for (const auto& candidate : candList) {
             const auto& split = candidate.Candidates[0].SplitCandidate;
             if (split.Type == ESplitType::OnlineCtr) {
                 const auto& proj = split.Ctr.Projection;
-                maxFeatureValueCount = Max(maxFeatureValueCount, fold->GetCtrRef(proj).FeatureValueCount);
+                const size_t featureValueCount = fold->GetCtrRef(proj).FeatureValueCount;
+                featureValueCounts[proj] = featureValueCount;
+                maxFeatureValueCount = Max(maxFeatureValueCount, featureValueCount);
             }
         }
 
@@ -372,7 +556,7 @@ void GreedyTensorSearch(const TDataset& learnData,
                     !ctx->LearnProgress.UsedCtrSplits.has(std::make_pair(ctrType, projection)) &&
                     score != MINIMAL_SCORE)
                 {
-                    score *= pow(1 + fold->GetCtrRef(projection).FeatureValueCount / static_cast<double>(maxFeatureValueCount),
+                    score *= pow(1 + featureValueCounts.at(projection) / static_cast<double>(maxFeatureValueCount),
                                  -ctx->Params.ObliviousTreeOptions->ModelSizeReg.Get());
                 }
                 if (score > bestScore) {
@@ -394,29 +578,33 @@ void GreedyTensorSearch(const TDataset& learnData,
         auto bestSplit = TSplit(bestSplitCandidate->SplitCandidate, bestSplitCandidate->BestBinBorderId);
         if (bestSplit.Type == ESplitType::OnlineCtr) {
             const auto& proj = bestSplit.Ctr.Projection;
-            if (fold->GetCtrRef(proj).Feature.empty()) {
+            fold->MarkCtrUsed(proj);
+            // workers keep ctrs of the best split, master has no learn documents to compute them
+            if (ctx->Params.SystemOptions->IsSingleHost() && fold->GetCtrRef(proj).Feature.empty()) {
+                profile.AddCounter("Online CTR cache misses", 1);
                 ComputeOnlineCTRs(learnData,
                                   testDataPtrs,
                                   *fold,
                                   proj,
                                   ctx,
+                                  &ctx->LocalExecutor,
                                   &fold->GetCtrRef(proj));
                 DropStatsForProjection(*fold, *ctx, proj, &ctx->PrevTreeLevelStats);
             }
         }
 
+        int redundantIdx = -1;
         if (ctx->Params.SystemOptions->IsSingleHost()) {
             SetPermutedIndices(bestSplit, learnData.AllFeatures, curDepth + 1, *fold, &indices, &ctx->LocalExecutor);
             if (isSamplingPerTree) {
                 ctx->SampledDocs.UpdateIndices(indices, &ctx->LocalExecutor);
-                // TODO(nikitxskv): Pairwise scoring doesn't use statistics from previous tree level. Need to fix it.
+                // Pairwise stats of the next level are derived from the parent ones by scanning all sampled documents, see CalcScore
                 if (!IsPairwiseScoring(ctx->Params.LossFunctionDescription->GetLossFunction())) {
                     ctx->SmallestSplitSideDocs.SelectSmallestSplitSide(curDepth + 1, ctx->SampledDocs, &ctx->LocalExecutor);
                 }
             }
         } else {
-            Y_ASSERT(bestSplit.Type != ESplitType::OnlineCtr);
-            MapSetIndices(*bestSplitCandidate, ctx);
+            redundantIdx = MapSetIndices(*bestSplitCandidate, ctx);
         }
         currentSplitTree.AddSplit(bestSplit);
         MATRIXNET_INFO_LOG << BuildDescription(ctx->Layout, bestSplit);
@@ -425,11 +613,8 @@ void GreedyTensorSearch(const TDataset& learnData,
 
         profile.AddOperation(TStringBuilder() << "Select best split " << curDepth);
 
-        int redundantIdx = -1;
         if (ctx->Params.SystemOptions->IsSingleHost()) {
             redundantIdx = GetRedundantSplitIdx(GetIsLeafEmpty(curDepth + 1, indices));
-        } else {
-            redundantIdx = MapGetRedundantSplitIdx(ctx);
         }
         if (redundantIdx != -1) {
             currentSplitTree.DeleteSplit(redundantIdx);
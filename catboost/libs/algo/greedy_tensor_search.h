@@ -6,7 +6,12 @@
 
 #include <util/generic/vector.h>
 
-void TrimOnlineCTRcache(const TVector<TFold*>& folds);
+constexpr size_t MAX_ONLINE_CTR_FEATURES = 50;
+
+// Online ctr cache memory limit of one fold
+size_t GetMaxOnlineCTRMemory(const NCatboostOptions::TCatBoostOptions& params, size_t foldCount);
+
+void TrimOnlineCTRcache(const TLearnContext& ctx, const TVector<TFold*>& folds);
 
 void GreedyTensorSearch(const TDataset& learnData,
                         const TDatasetPtrs& testDataPtrs,
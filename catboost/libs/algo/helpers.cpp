@@ -1,7 +1,8 @@
 #include "helpers.h"
-
+#include <catboost/libs/distributed/master.h>
 #include <catboost/libs/helpers/exception.h>
 #include <catboost/libs/logging/logging.h>
+#include <catboost/libs/options/enum_helpers.h>
 
 #include <library/malloc/api/malloc.h>
 
@@ -131,6 +132,12 @@ void ConfigureMalloc() {
 #endif
 }
 
+bool IsSparseFloatFeaturesScoring(const NCatboostOptions::TCatBoostOptions& params) {
+    return IsPlainMode(params.BoostingOptions->BoostingType)
+        && !IsPairwiseScoring(params.LossFunctionDescription->GetLossFunction())
+        && params.SystemOptions->IsSingleHost();
+}
+
 void CalcErrors(
     const TDataset& learnData,
     const TDatasetPtrs& testDataPtrs,
@@ -138,7 +145,20 @@ void CalcErrors(
     bool calcMetrics,
     TLearnContext* ctx
 ) {
-    if (learnData.GetSampleCount() > 0) {
+    if (!ctx->Params.SystemOptions->IsSingleHost()) {
+        // workers hold approxes of learn documents, they compute additive metrics only, see Train
+        TVector<bool> skipMetricOnTrain = GetSkipMetricOnTrain(errors);
+        TVector<int> metricIndices;
+        for (int i = 0; i < errors.ysize(); ++i) {
+            if (calcMetrics && !skipMetricOnTrain[i]) {
+                metricIndices.push_back(i);
+            }
+        }
+        ctx->LearnProgress.MetricsAndTimeHistory.LearnMetricsHistory.emplace_back();
+        if (!metricIndices.empty()) {
+            ctx->LearnProgress.MetricsAndTimeHistory.LearnMetricsHistory.back() = MapCalcLearnErrors(errors, metricIndices, ctx);
+        }
+    } else if (learnData.GetSampleCount() > 0) {
         TVector<bool> skipMetricOnTrain = GetSkipMetricOnTrain(errors);
         const auto& data = learnData;
         ctx->LearnProgress.MetricsAndTimeHistory.LearnMetricsHistory.emplace_back();
@@ -13,6 +13,10 @@ void GenerateBorders(const TPool& pool, TLearnContext* ctx, TVector<TFloatFeatur
 
 void ConfigureMalloc();
 
+// Float features are stored sparse only if they are scored sparse: plain boosting, not pairwise scoring, single host.
+// In other modes sparse features would be expanded to dense bins on every score calculation.
+bool IsSparseFloatFeaturesScoring(const NCatboostOptions::TCatBoostOptions& params);
+
 void CalcErrors(
     const TDataset& learnData,
     const TDatasetPtrs& testDataPtrs,
@@ -12,10 +12,9 @@
 static bool GetCtrSplit(const TSplit& split, int idxPermuted,
                         const TOnlineCTR& ctr) {
 
-    ui8 ctrValue = ctr.Feature[split.Ctr.CtrIdx]
-                              [split.Ctr.TargetBorderIdx]
-                              [split.Ctr.PriorIdx]
-                              [idxPermuted];
+    ui8 ctrValue = ctr.GetCtrBins(split.Ctr.CtrIdx,
+                                  split.Ctr.TargetBorderIdx,
+                                  split.Ctr.PriorIdx)[idxPermuted];
     return ctrValue > split.BinBorder;
 }
 
@@ -23,16 +22,29 @@ static inline ui8 GetFeatureSplitIdx(const TSplit& split) {
     return split.BinBorder;
 }
 
-static inline const TVector<ui8>& GetFloatHistogram(const TSplit& split, const TAllFeatures& features) {
-    return features.FloatHistograms[split.FeatureIdx];
+static inline TPackedBins GetFloatHistogram(const TSplit& split, const TAllFeatures& features, TVector<ui8>* sparseBuffer) {
+    return features.GetFloatFeatureBins(split.FeatureIdx, sparseBuffer);
+}
+
+// Bins for float feature splits of the tree, sparse features are expanded into sparseBuffers
+static TVector<TPackedBins> GetFloatHistograms(const TSplitTree& tree, const TAllFeatures& features, TVector<TVector<ui8>>* sparseBuffers) {
+    TVector<TPackedBins> histograms(tree.GetDepth());
+    sparseBuffers->resize(tree.GetDepth());
+    for (int splitIdx = 0; splitIdx < tree.GetDepth(); ++splitIdx) {
+        const auto& split = tree.Splits[splitIdx];
+        if (split.Type == ESplitType::FloatFeature) {
+            histograms[splitIdx] = GetFloatHistogram(split, features, &(*sparseBuffers)[splitIdx]);
+        }
+    }
+    return histograms;
 }
 
 static inline const TVector<int>& GetRemappedCatFeatures(const TSplit& split, const TAllFeatures& features) {
     return features.CatFeaturesRemapped[split.FeatureIdx];
 }
 
-template <typename TCount, bool (*CmpOp)(TCount, TCount), int vectorWidth>
-void BuildIndicesKernel(const size_t* permutation, const TCount* histogram, TCount value, int level, TIndexType* indices) {
+template <typename TCount, bool (*CmpOp)(TCount, TCount), int vectorWidth, typename THistogram>
+void BuildIndicesKernel(const size_t* permutation, THistogram histogram, TCount value, int level, TIndexType* indices) {
     Y_ASSERT(vectorWidth == 4);
     const int perm0 = permutation[0];
     const int perm1 = permutation[1];
@@ -52,11 +64,12 @@ void BuildIndicesKernel(const size_t* permutation, const TCount* histogram, TCou
     indices[3] = idx3 + CmpOp(hist3, value) * level;
 }
 
-template <typename TCount, bool (*CmpOp)(TCount, TCount)>
+// THistogram is either a plain pointer or TPackedBins
+template <typename TCount, bool (*CmpOp)(TCount, TCount), typename THistogram>
 void OfflineCtrBlock(const NPar::TLocalExecutor::TExecRangeParams& params,
                      int blockIdx,
                      const TFold& fold,
-                     const TCount* histogram,
+                     THistogram histogram,
                      TCount value,
                      int level,
                      TIndexType* indices) {
@@ -89,8 +102,10 @@ void SetPermutedIndices(const TSplit& split,
     const int splitWeight = 1 << (curDepth - 1);
     TIndexType* indicesData = indices->data();
     if (split.Type == ESplitType::FloatFeature) {
+        TVector<ui8> sparseBuffer;
+        const TPackedBins histogram = GetFloatHistogram(split, features, &sparseBuffer);
         localExecutor->ExecRange([&](int blockIdx) {
-            OfflineCtrBlock<ui8, IsTrueHistogram>(blockParams, blockIdx, fold, GetFloatHistogram(split, features).data(),
+            OfflineCtrBlock<ui8, IsTrueHistogram>(blockParams, blockIdx, fold, histogram,
                                                   GetFeatureSplitIdx(split), splitWeight, indicesData);
         }, 0, blockParams.GetBlockCount(), NPar::TLocalExecutor::WAIT_COMPLETE);
     } else if (split.Type == ESplitType::OnlineCtr) {
@@ -159,13 +174,15 @@ static void BuildIndicesForLearn(const TSplitTree& tree,
     NPar::TLocalExecutor::TExecRangeParams learnBlockParams(0, learnSampleCount);
     learnBlockParams.SetBlockSize(blockSize);
 
+    TVector<TVector<ui8>> sparseBuffers;
+    const TVector<TPackedBins> floatHistograms = GetFloatHistograms(tree, learnData.AllFeatures, &sparseBuffers);
     auto updateLearnIndex = [&](int blockIdx) {
         for (int splitIdx = 0; splitIdx < tree.GetDepth(); ++splitIdx) {
             const auto& split = tree.Splits[splitIdx];
             const int splitWeight = 1 << splitIdx;
             if (split.Type == ESplitType::FloatFeature) {
                 OfflineCtrBlock<ui8, IsTrueHistogram>(learnBlockParams, blockIdx, fold,
-                    GetFloatHistogram(split, learnData.AllFeatures).data(),
+                    floatHistograms[splitIdx],
                     GetFeatureSplitIdx(split), splitWeight, indices);
             } else if (split.Type == ESplitType::OnlineCtr) {
                 const TOnlineCTR& splitOnlineCtr = *onlineCtrs[splitIdx];
@@ -195,6 +212,8 @@ static void BuildIndicesForTest(const TSplitTree& tree,
     NPar::TLocalExecutor::TExecRangeParams tailBlockParams(0, tailSampleCount);
     tailBlockParams.SetBlockSize(blockSize);
 
+    TVector<TVector<ui8>> sparseBuffers;
+    const TVector<TPackedBins> floatHistograms = GetFloatHistograms(tree, testData.AllFeatures, &sparseBuffers);
     auto updateTailIndex = [&](int blockIdx) {
         TIndexType* tailIndices = indices;
         for (int splitIdx = 0; splitIdx < tree.GetDepth(); ++splitIdx) {
@@ -202,7 +221,7 @@ static void BuildIndicesForTest(const TSplitTree& tree,
             const int splitWeight = 1 << splitIdx;
             if (split.Type == ESplitType::FloatFeature) {
                 const ui8 featureSplitIdx = GetFeatureSplitIdx(split);
-                const ui8* floatHistogramData = GetFloatHistogram(split, testData.AllFeatures).data();
+                const TPackedBins floatHistogramData = floatHistograms[splitIdx];
                 NPar::TLocalExecutor::BlockedLoopBody(tailBlockParams, [&](int doc) {
                     tailIndices[doc] += IsTrueHistogram(floatHistogramData[doc], featureSplitIdx) * splitWeight;
                 })(blockIdx);
@@ -272,6 +291,25 @@ TVector<ui8> BinarizeFeatures(const TFullModel& model, const TPool& pool) {
     return BinarizeFeatures(model, pool, /*start*/0, pool.Docs.GetDocCount());
 }
 
+TVector<TIndexType> BuildTestIndices(const TFold& fold,
+                                     const TSplitTree& tree,
+                                     const TDatasetPtrs& testDataPtrs,
+                                     NPar::TLocalExecutor* localExecutor) {
+    const TVector<const TOnlineCTR*>& onlineCtrs = GetOnlineCtrs(fold, tree);
+
+    TVector<TIndexType> indices(GetSampleCount(testDataPtrs));
+
+    int docOffset = fold.GetLearnSampleCount();
+    int testDocOffset = 0;
+    for (int testIdx = 0; testIdx < testDataPtrs.ysize(); ++testIdx) {
+        const TDataset* testData = testDataPtrs[testIdx];
+        BuildIndicesForTest(tree, *testData, testData->GetSampleCount(), onlineCtrs, docOffset, localExecutor, indices.begin() + testDocOffset);
+        docOffset += testData->GetSampleCount();
+        testDocOffset += testData->GetSampleCount();
+    }
+    return indices;
+}
+
 TVector<TIndexType> BuildIndicesForBinTree(const TFullModel& model, const TVector<ui8>& binarizedFeatures, size_t treeId) {
     if (model.ObliviousTrees.GetEffectiveBinaryFeaturesBucketsCount() == 0) {
         return TVector<TIndexType>();
@@ -23,6 +23,12 @@ TVector<TIndexType> BuildIndices(const TFold& fold,
                                  const TDatasetPtrs& testDataPtrs,
                                  NPar::TLocalExecutor* localExecutor);
 
+// Leaf indices of test documents only, online ctrs of test documents follow learn documents of the fold
+TVector<TIndexType> BuildTestIndices(const TFold& fold,
+                                     const TSplitTree& tree,
+                                     const TDatasetPtrs& testDataPtrs,
+                                     NPar::TLocalExecutor* localExecutor);
+
 struct TFullModel;
 
 TVector<ui8> BinarizeFeatures(const TFullModel& model,
@@ -6,49 +6,39 @@
 #include <catboost/libs/helpers/clear_array.h>
 
 #include <library/containers/dense_hash/dense_hash.h>
+#include <library/threading/local_executor/local_executor.h>
 
-/// Calculate document hashes into range [begin,end) for CTR bucket identification.
-/// @param proj - Projection delivering the feature ids to hash
-/// @param allFeatures - Values of features to hash
-/// @param offset - Begin from this offset when accessing `allFeatures`
-/// @param learnPermutation - Use this permutation when accessing `allFeatures`
-/// @param calculateExactCatHashes - Hash original cat features (true) or one-hot-encoded (false)
-/// @param begin, @param end - Result range
-inline void CalcHashes(const TProjection& proj,
-                       const TAllFeatures& allFeatures,
-                       size_t offset,
-                       const TVector<size_t>* learnPermutation,
-                       bool calculateExactCatHashes,
-                       ui64* begin,
-                       ui64* end) {
+// Smaller ranges are not worth splitting between threads in CalcHashesParallel
+constexpr int MIN_HASH_PARALLEL_BLOCK_SIZE = 10000;
+
+/// Calculate document hashes into range [begin,end), see CalcHashes.
+/// @param learnPermutation - Use learnPermutation[0, end - begin) when accessing `allFeatures` if not nullptr
+inline void CalcHashesImpl(const TProjection& proj,
+                           const TAllFeatures& allFeatures,
+                           size_t offset,
+                           const size_t* learnPermutation,
+                           bool calculateExactCatHashes,
+                           ui64* begin,
+                           ui64* end) {
     const size_t sampleCount = end - begin;
     if (sampleCount == 0) {
         return;
     }
-    if (learnPermutation != nullptr) {
-        Y_VERIFY(offset == 0);
-        Y_VERIFY(sampleCount == learnPermutation->size());
-    }
 
     ui64* hashArr = begin;
     if (calculateExactCatHashes) {
-        TVector<int> exactValues;
         for (const int featureIdx : proj.CatFeatures) {
             const int* featureValues = offset + allFeatures.CatFeaturesRemapped[featureIdx].data();
             // Calculate hashes for model CTR table
-            exactValues.resize(sampleCount);
-            auto& ohv = allFeatures.OneHotValues[featureIdx];
-            for (size_t i = 0; i < sampleCount; ++i) {
-                exactValues[i] = ohv[featureValues[i]];
-            }
+            const auto& ohv = allFeatures.OneHotValues[featureIdx];
             if (learnPermutation != nullptr) {
-                const auto& perm = *learnPermutation;
+                const size_t* perm = learnPermutation;
                 for (size_t i = 0; i < sampleCount; ++i) {
-                    hashArr[i] = CalcHash(hashArr[i], (ui64)exactValues[perm[i]]);
+                    hashArr[i] = CalcHash(hashArr[i], (ui64)ohv[featureValues[perm[i]]]);
                 }
             } else {
                 for (size_t i = 0; i < sampleCount; ++i) {
-                    hashArr[i] = CalcHash(hashArr[i], (ui64)exactValues[i]);
+                    hashArr[i] = CalcHash(hashArr[i], (ui64)ohv[featureValues[i]]);
                 }
             }
         }
@@ -56,7 +46,7 @@ inline void CalcHashes(const TProjection& proj,
         for (const int featureIdx : proj.CatFeatures) {
             const int* featureValues = offset + allFeatures.CatFeaturesRemapped[featureIdx].data();
             if (learnPermutation != nullptr) {
-                const auto& perm = *learnPermutation;
+                const size_t* perm = learnPermutation;
                 for (size_t i = 0; i < sampleCount; ++i) {
                     hashArr[i] = CalcHash(hashArr[i], (ui64)featureValues[perm[i]] + 1);
                 }
@@ -68,10 +58,11 @@ inline void CalcHashes(const TProjection& proj,
         }
     }
 
+    TVector<ui8> sparseBuffer;
     for (const TBinFeature& feature : proj.BinFeatures) {
-        const ui8* featureValues = offset + allFeatures.FloatHistograms[feature.FloatFeature].data();
+        const TPackedBins featureValues = allFeatures.GetFloatFeatureBins(feature.FloatFeature, &sparseBuffer).Skip(offset);
         if (learnPermutation != nullptr) {
-            const auto& perm = *learnPermutation;
+            const size_t* perm = learnPermutation;
             for (size_t i = 0; i < sampleCount; ++i) {
                 const bool isTrueFeature = IsTrueHistogram(featureValues[perm[i]], feature.SplitIdx);
                 hashArr[i] = CalcHash(hashArr[i], (ui64)isTrueFeature);
@@ -87,7 +78,7 @@ inline void CalcHashes(const TProjection& proj,
     for (const TOneHotSplit& feature : proj.OneHotFeatures) {
         const int* featureValues = offset + allFeatures.CatFeaturesRemapped[feature.CatFeatureIdx].data();
         if (learnPermutation != nullptr) {
-            const auto& perm = *learnPermutation;
+            const size_t* perm = learnPermutation;
             for (size_t i = 0; i < sampleCount; ++i) {
                 const bool isTrueFeature = IsTrueOneHotFeature(featureValues[perm[i]], feature.Value);
                 hashArr[i] = CalcHash(hashArr[i], (ui64)isTrueFeature);
@@ -101,6 +92,60 @@ inline void CalcHashes(const TProjection& proj,
     }
 }
 
+/// Calculate document hashes into range [begin,end) for CTR bucket identification.
+/// @param proj - Projection delivering the feature ids to hash
+/// @param allFeatures - Values of features to hash
+/// @param offset - Begin from this offset when accessing `allFeatures`
+/// @param learnPermutation - Use this permutation when accessing `allFeatures`
+/// @param calculateExactCatHashes - Hash original cat features (true) or one-hot-encoded (false)
+/// @param begin, @param end - Result range
+inline void CalcHashes(const TProjection& proj,
+                       const TAllFeatures& allFeatures,
+                       size_t offset,
+                       const TVector<size_t>* learnPermutation,
+                       bool calculateExactCatHashes,
+                       ui64* begin,
+                       ui64* end) {
+    if (learnPermutation != nullptr) {
+        Y_VERIFY(offset == 0);
+        Y_VERIFY(static_cast<size_t>(end - begin) == learnPermutation->size());
+    }
+    CalcHashesImpl(proj, allFeatures, offset, learnPermutation ? learnPermutation->data() : nullptr, calculateExactCatHashes, begin, end);
+}
+
+/// Same as CalcHashes, but documents are split into blocks hashed in parallel.
+inline void CalcHashesParallel(const TProjection& proj,
+                               const TAllFeatures& allFeatures,
+                               size_t offset,
+                               const TVector<size_t>* learnPermutation,
+                               bool calculateExactCatHashes,
+                               NPar::TLocalExecutor* localExecutor,
+                               ui64* begin,
+                               ui64* end) {
+    if (learnPermutation != nullptr) {
+        Y_VERIFY(offset == 0);
+        Y_VERIFY(static_cast<size_t>(end - begin) == learnPermutation->size());
+    }
+    const int sampleCount = end - begin;
+    const int threadCount = localExecutor->GetThreadCount() + 1;
+    const int blockCount = Min(threadCount, (sampleCount + MIN_HASH_PARALLEL_BLOCK_SIZE - 1) / MIN_HASH_PARALLEL_BLOCK_SIZE);
+    if (blockCount <= 1) {
+        CalcHashes(proj, allFeatures, offset, learnPermutation, calculateExactCatHashes, begin, end);
+        return;
+    }
+    NPar::TLocalExecutor::TExecRangeParams blockParams(0, sampleCount);
+    blockParams.SetBlockCount(blockCount);
+    localExecutor->ExecRange([&](int blockId) {
+        const int blockStart = blockId * blockParams.GetBlockSize();
+        const int blockEnd = Min(blockStart + blockParams.GetBlockSize(), sampleCount);
+        if (learnPermutation != nullptr) {
+            CalcHashesImpl(proj, allFeatures, 0, learnPermutation->data() + blockStart, calculateExactCatHashes, begin + blockStart, begin + blockEnd);
+        } else {
+            CalcHashesImpl(proj, allFeatures, offset + blockStart, nullptr, calculateExactCatHashes, begin + blockStart, begin + blockEnd);
+        }
+    }, 0, blockParams.GetBlockCount(), NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
 /// Compute reindexHash and reindex hash values in range [begin,end).
 /// After reindex, hash values belong to [0, reindexHash.Size()].
 /// If reindexHash would become larger than topSize, keep only topSize most
@@ -33,15 +33,6 @@ void TLearnContext::OutputMeta() {
     CreateMetaFile(Files, OutputOptions, GetConstPointers(losses), Params.BoostingOptions->IterationCount);
 }
 
-static bool IsCategoricalFeaturesEmpty(const TAllFeatures& allFeatures) {
-    for (int i = 0; i < allFeatures.CatFeaturesRemapped.ysize(); ++i) {
-        if (!allFeatures.IsOneHot[i] && !allFeatures.CatFeaturesRemapped[i].empty()) {
-            return false;
-        }
-    }
-    return true;
-}
-
 template <typename T>
 static ui32 CalcMatrixCheckSum(ui32 init, const TVector<TVector<T>>& matrix) {
     ui32 checkSum = init;
@@ -54,6 +45,12 @@ static ui32 CalcMatrixCheckSum(ui32 init, const TVector<TVector<T>>& matrix) {
 static ui32 CalcFeaturesCheckSum(const TAllFeatures& allFeatures) {
     ui32 checkSum = 0;
     checkSum = CalcMatrixCheckSum(checkSum, allFeatures.FloatHistograms);
+    checkSum = CalcMatrixCheckSum(checkSum, allFeatures.PackedFloatHistograms);
+    for (const auto& sparseFeature : allFeatures.SparseFloatFeatures) {
+        checkSum = Crc32cExtend(checkSum, &sparseFeature.DefaultBin, sizeof(sparseFeature.DefaultBin));
+        checkSum = Crc32cExtend(checkSum, sparseFeature.DocIndices.data(), sparseFeature.DocIndices.size() * sizeof(ui32));
+        checkSum = Crc32cExtend(checkSum, sparseFeature.Bins.data(), sparseFeature.Bins.size() * sizeof(ui8));
+    }
     checkSum = CalcMatrixCheckSum(checkSum, allFeatures.CatFeaturesRemapped);
     checkSum = CalcMatrixCheckSum(checkSum, allFeatures.OneHotValues);
     return checkSum;
@@ -71,6 +68,10 @@ void TLearnContext::InitContext(const TDataset& learnData, const TDatasetPtrs& t
     if (Params.BoostingOptions->BoostingType == EBoostingType::Plain && noCtrs) {
         foldCount = 1;
     }
+    if (!Params.SystemOptions->IsSingleHost()) {
+        // workers compute online ctrs in the order of their learn documents, see MapCalcOnlineCtrs and TPoolPartLoader
+        foldCount = 1;
+    }
     LearnProgress.Folds.reserve(foldCount);
     UpdateCtrsTargetBordersOption(lossFunction, LearnProgress.ApproxDimension, &Params.CatFeatureParams.Get());
 
@@ -127,6 +127,9 @@ public:
     TBucketStatsCache PrevTreeLevelStats;
     TObj<NPar::IRootEnvironment> RootEnvironment;
     TObj<NPar::IEnvironment> SharedTrainData;
+    // learn documents of all workers in distributed training, master may hold a sample of them only
+    int AllDocCount = 0;
+    double SumAllWeights = 0;
     TProfileInfo Profile;
 };
 
@@ -68,6 +68,12 @@ void CalcNormalization(const TVector<float>& priors, TVector<float>* shift, TVec
 
 
 
+// Ctr values are or-ed into zero filled storage, see TOnlineCTR::ArePriorsPacked
+static inline ui8* GetCtrValuesData(bool arePriorsPacked, int border, int prior, size_t docOffset, TArray2D<TVector<ui8>>* feature, ui8* shift) {
+    *shift = arePriorsPacked ? prior % 2 * 4 : 0;
+    return docOffset + (*feature)[border][arePriorsPacked ? prior / 2 : prior].data();
+}
+
 static void UpdateGoodCount(int curCount, ECtrType ctrType, int* goodCount) {
     if (ctrType == ECtrType::Buckets) {
         *goodCount = curCount;
@@ -105,6 +111,8 @@ static void CalcOnlineCTRClasses(const TVector<size_t>& testOffsets,
                                  const TVector<float>& priors,
                                  int ctrBorderCount,
                                  ECtrType ctrType,
+                                 bool arePriorsPacked,
+                                 const int* initialClassCounts,
                                  TArray2D<TVector<ui8>>* feature) {
     TVector<float> shift;
     TVector<float> norm;
@@ -114,6 +122,15 @@ static void CalcOnlineCTRClasses(const TVector<size_t>& testOffsets,
     TVector<int> totalCountByDoc(blockSize);
     TVector<TVector<int>> goodCountByBorderByDoc(targetBorderCount, TVector<int>(blockSize));
     TBucketsView bv(leafCount, targetClassesCount);
+    if (initialClassCounts != nullptr) {
+        for (size_t leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+            auto bordersData = bv.GetBorders(leafIdx);
+            for (int classIdx = 0; classIdx < targetClassesCount; ++classIdx) {
+                bordersData[classIdx] = initialClassCounts[leafIdx * targetClassesCount + classIdx];
+                bv.GetTotal(leafIdx) += bordersData[classIdx];
+            }
+        }
+    }
 
     auto calcGoodCounts = [&](int blockStart, int nextBlockStart, int docOffset) {
         for (int docId = blockStart; docId < nextBlockStart; ++docId) {
@@ -140,10 +157,11 @@ static void CalcOnlineCTRClasses(const TVector<size_t>& testOffsets,
                 const float shiftX = shift[prior];
                 const float normX = norm[prior];
                 const int* goodCountData = goodCountByBorderByDoc[border].data();
-                ui8* featureData = docOffset + (*feature)[border][prior].data();
+                ui8 valueShift;
+                ui8* featureData = GetCtrValuesData(arePriorsPacked, border, prior, docOffset, feature, &valueShift);
                 for (int docId = blockStart; docId < nextBlockStart; ++docId) {
-                    featureData[docId] = CalcCTR(goodCountData[docId - blockStart], totalCountByDoc[docId - blockStart],
-                                                 priorX, shiftX, normX, ctrBorderCount);
+                    featureData[docId] |= CalcCTR(goodCountData[docId - blockStart], totalCountByDoc[docId - blockStart],
+                                                  priorX, shiftX, normX, ctrBorderCount) << valueShift;
                 }
             }
         }
@@ -165,6 +183,8 @@ static void CalcOnlineCTRSimple(const TVector<size_t>& testOffsets,
                                 const TVector<int>& permutedTargetClass,
                                 const TVector<float>& priors,
                                 int ctrBorderCount,
+                                bool arePriorsPacked,
+                                const int* initialClassCounts,
                                 TArray2D<TVector<ui8>>* feature) {
     TVector<float> shift;
     TVector<float> norm;
@@ -174,6 +194,12 @@ static void CalcOnlineCTRSimple(const TVector<size_t>& testOffsets,
     auto ctrArrSimple = TCtrCalcer::GetCtrHistoryArr(leafCount + blockSize);
     auto totalCount = reinterpret_cast<int*>(ctrArrSimple.data() + leafCount);
     auto goodCount = totalCount + blockSize;
+    if (initialClassCounts != nullptr) {
+        for (size_t leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+            ctrArrSimple[leafIdx].N[0] = initialClassCounts[leafIdx * SIMPLE_CLASSES_COUNT];
+            ctrArrSimple[leafIdx].N[1] = initialClassCounts[leafIdx * SIMPLE_CLASSES_COUNT + 1];
+        }
+    }
 
     auto calcGoodCount = [&](int blockStart, int nextBlockStart, int docOffset) {
         for (int docId = blockStart; docId < nextBlockStart; ++docId) {
@@ -191,10 +217,11 @@ static void CalcOnlineCTRSimple(const TVector<size_t>& testOffsets,
             const float priorX = priors[prior];
             const float shiftX = shift[prior];
             const float normX = norm[prior];
-            ui8* featureData = docOffset + (*feature)[0][prior].data();
+            ui8 valueShift;
+            ui8* featureData = GetCtrValuesData(arePriorsPacked, 0, prior, docOffset, feature, &valueShift);
             for (int docId = blockStart; docId < nextBlockStart; ++docId) {
-                featureData[docId] = CalcCTR(goodCount[docId - blockStart], totalCount[docId - blockStart],
-                                             priorX, shiftX, normX, ctrBorderCount);
+                featureData[docId] |= CalcCTR(goodCount[docId - blockStart], totalCount[docId - blockStart],
+                                              priorX, shiftX, normX, ctrBorderCount) << valueShift;
             }
         }
     };
@@ -216,6 +243,8 @@ static void CalcOnlineCTRMean(const TVector<size_t>& testOffsets,
                               int targetBorderCount,
                               const TVector<float>& priors,
                               int ctrBorderCount,
+                              bool arePriorsPacked,
+                              const int* initialClassCounts,
                               TArray2D<TVector<ui8>>* feature) {
     TVector<float> shift;
     TVector<float> norm;
@@ -225,6 +254,17 @@ static void CalcOnlineCTRMean(const TVector<size_t>& testOffsets,
     TVector<float> sum(blockSize);
     TVector<int> count(blockSize);
     auto ctrArrMean = TCtrCalcer::GetCtrMeanHistoryArr(leafCount);
+    if (initialClassCounts != nullptr) {
+        const int targetClassesCount = targetBorderCount + 1;
+        for (size_t leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+            TCtrMeanHistory& elem = ctrArrMean[leafIdx];
+            for (int classIdx = 0; classIdx < targetClassesCount; ++classIdx) {
+                const int classCount = initialClassCounts[leafIdx * targetClassesCount + classIdx];
+                elem.Sum += static_cast<float>(classIdx) / targetBorderCount * classCount;
+                elem.Count += classCount;
+            }
+        }
+    }
 
     auto calcCount = [&](int blockStart, int nextBlockStart, int docOffset) {
         for (int docId = blockStart; docId < nextBlockStart; ++docId) {
@@ -242,10 +282,11 @@ static void CalcOnlineCTRMean(const TVector<size_t>& testOffsets,
             const float priorX = priors[prior];
             const float shiftX = shift[prior];
             const float normX = norm[prior];
-            ui8* featureData = docOffset + (*feature)[0][prior].data();
+            ui8 valueShift;
+            ui8* featureData = GetCtrValuesData(arePriorsPacked, 0, prior, docOffset, feature, &valueShift);
             for (int docId = blockStart; docId < nextBlockStart; ++docId) {
-                featureData[docId] = CalcCTR(sum[docId - blockStart], count[docId - blockStart],
-                                             priorX, shiftX, normX, ctrBorderCount);
+                featureData[docId] |= CalcCTR(sum[docId - blockStart], count[docId - blockStart],
+                                              priorX, shiftX, normX, ctrBorderCount) << valueShift;
             }
         }
     };
@@ -266,6 +307,7 @@ static void CalcOnlineCTRCounter(const TVector<size_t>& testOffsets,
                                  int denominator,
                                  const TVector<float>& priors,
                                  int ctrBorderCount,
+                                 bool arePriorsPacked,
                                  TArray2D<TVector<ui8>>* feature) {
     TVector<float> shift;
     TVector<float> norm;
@@ -285,9 +327,10 @@ static void CalcOnlineCTRCounter(const TVector<size_t>& testOffsets,
             const float priorX = priors[prior];
             const float shiftX = shift[prior];
             const float normX = norm[prior];
-            ui8* featureData = docOffset + (*feature)[0][prior].data();
+            ui8 valueShift;
+            ui8* featureData = GetCtrValuesData(arePriorsPacked, 0, prior, docOffset, feature, &valueShift);
             for (int docId = blockStart; docId < nextBlockStart; ++docId) {
-                featureData[docId] = CalcCTR(ctrTotal[docId - blockStart], denominator, priorX, shiftX, normX, ctrBorderCount);
+                featureData[docId] |= CalcCTR(ctrTotal[docId - blockStart], denominator, priorX, shiftX, normX, ctrBorderCount) << valueShift;
             }
         }
     };
@@ -309,11 +352,104 @@ static inline void CountOnlineCTRTotal(const TVector<ui64>& hashArr, int sampleC
     }
 }
 
+// Ctrs of documents with leaf indices in enumeratedCatFeatures, per leaf counters start from initialClassCounts if it is not null
+static void CalcOnlineCTRsForLeaves(const TVector<size_t>& testOffsets,
+                                    const TVector<ui64>& enumeratedCatFeatures,
+                                    size_t leafCount,
+                                    const TVector<TCtrInfo>& ctrInfo,
+                                    const TFold& fold,
+                                    const TVector<int>& counterCTRTotal,
+                                    int counterCTRDenominator,
+                                    const TVector<TVector<int>>* initialClassCounts,
+                                    NPar::TLocalExecutor* localExecutor,
+                                    TOnlineCTR* dst) {
+    const size_t totalSampleCount = testOffsets.back();
+    // filled before the parallel region, threads writing neighbouring bits of TVector<bool> would race
+    dst->ArePriorsPacked.resize(ctrInfo.size());
+    for (int ctrIdx = 0; ctrIdx < ctrInfo.ysize(); ++ctrIdx) {
+        dst->ArePriorsPacked[ctrIdx] = ctrInfo[ctrIdx].BorderCount <= MAX_PACKED_PRIORS_CTR_BORDER_COUNT && ctrInfo[ctrIdx].Priors.size() > 1;
+    }
+    // ctrs of the projection are independent, each one is a sequential pass over permuted documents
+    localExecutor->ExecRange([&](int ctrIdx) {
+        const ECtrType ctrType = ctrInfo[ctrIdx].Type;
+        const ui32 classifierId = ctrInfo[ctrIdx].TargetClassifierIdx;
+        int targetClassesCount = fold.TargetClassesCount[classifierId];
+
+        const ui32 targetBorderCount = GetTargetBorderCount(ctrInfo[ctrIdx], targetClassesCount);
+        const ui32 ctrBorderCount = ctrInfo[ctrIdx].BorderCount;
+        const auto& priors = ctrInfo[ctrIdx].Priors;
+        const bool arePriorsPacked = dst->ArePriorsPacked[ctrIdx];
+        const int* ctrInitialClassCounts = initialClassCounts != nullptr ? (*initialClassCounts)[classifierId].data() : nullptr;
+        const int priorStorageCount = arePriorsPacked ? (priors.ysize() + 1) / 2 : priors.ysize();
+        dst->Feature[ctrIdx].SetSizes(priorStorageCount, targetBorderCount);
+
+        for (ui32 border = 0; border < targetBorderCount; ++border) {
+            for (int priorStorageIdx = 0; priorStorageIdx < priorStorageCount; ++priorStorageIdx) {
+                Clear(&dst->Feature[ctrIdx][border][priorStorageIdx], totalSampleCount);
+            }
+        }
+
+        if (ctrType == ECtrType::Borders && targetClassesCount == SIMPLE_CLASSES_COUNT) {
+            CalcOnlineCTRSimple(
+                testOffsets,
+                enumeratedCatFeatures,
+                leafCount,
+                fold.LearnTargetClass[classifierId],
+                priors,
+                ctrBorderCount,
+                arePriorsPacked,
+                ctrInitialClassCounts,
+                &dst->Feature[ctrIdx]);
+
+        } else if (ctrType == ECtrType::BinarizedTargetMeanValue) {
+            CalcOnlineCTRMean(
+                testOffsets,
+                enumeratedCatFeatures,
+                leafCount,
+                fold.LearnTargetClass[classifierId],
+                targetClassesCount - 1,
+                priors,
+                ctrBorderCount,
+                arePriorsPacked,
+                ctrInitialClassCounts,
+                &dst->Feature[ctrIdx]);
+
+        } else if (ctrType == ECtrType::Buckets ||
+                   (ctrType == ECtrType::Borders && targetClassesCount > SIMPLE_CLASSES_COUNT)) {
+            CalcOnlineCTRClasses(
+                testOffsets,
+                enumeratedCatFeatures,
+                leafCount,
+                fold.LearnTargetClass[classifierId],
+                targetClassesCount,
+                GetTargetBorderCount(ctrInfo[ctrIdx], targetClassesCount),
+                priors,
+                ctrBorderCount,
+                ctrType,
+                arePriorsPacked,
+                ctrInitialClassCounts,
+                &dst->Feature[ctrIdx]);
+        } else {
+            Y_ASSERT(ctrType == ECtrType::Counter);
+            CalcOnlineCTRCounter(
+                testOffsets,
+                counterCTRTotal,
+                enumeratedCatFeatures,
+                counterCTRDenominator,
+                priors,
+                ctrBorderCount,
+                arePriorsPacked,
+                &dst->Feature[ctrIdx]);
+        }
+    }, 0, dst->Feature.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
 void ComputeOnlineCTRs(const TDataset& learnData,
                        const TDatasetPtrs& testDataPtrs,
                        const TFold& fold,
                        const TProjection& proj,
                        const TLearnContext* ctx,
+                       NPar::TLocalExecutor* localExecutor,
                        TOnlineCTR* dst) {
     const TCtrHelper& ctrHelper = ctx->CtrsHelper;
     const auto& ctrInfo = ctrHelper.GetCtrInfo(proj);
@@ -349,10 +485,10 @@ void ComputeOnlineCTRs(const TDataset& learnData,
         rehashHashTlsVal.Get().MakeEmpty(learnData.AllFeatures.OneHotValues[proj.CatFeatures[0]].size());
     } else {
         Clear(&hashArr, totalSampleCount);
-        CalcHashes(proj, learnData.AllFeatures, 0, &fold.LearnPermutation, false, hashArr.begin(), hashArr.begin() + learnSampleCount);
+        CalcHashesParallel(proj, learnData.AllFeatures, 0, &fold.LearnPermutation, false, localExecutor, hashArr.begin(), hashArr.begin() + learnSampleCount);
         for (size_t docOffset = learnSampleCount, testIdx = 0; docOffset < totalSampleCount && testIdx < testDataPtrs.size(); ++testIdx) {
             const size_t testSampleCount = testDataPtrs[testIdx]->GetSampleCount();
-            CalcHashes(proj, testDataPtrs[testIdx]->AllFeatures, 0, nullptr, false, hashArr.begin() + docOffset, hashArr.begin() + docOffset + testSampleCount);
+            CalcHashesParallel(proj, testDataPtrs[testIdx]->AllFeatures, 0, nullptr, false, localExecutor, hashArr.begin() + docOffset, hashArr.begin() + docOffset + testSampleCount);
             docOffset += testSampleCount;
         }
         size_t approxBucketsCount = 1;
@@ -385,68 +521,16 @@ void ComputeOnlineCTRs(const TDataset& learnData,
         counterCTRDenominator = *MaxElement(counterCTRTotal.begin(), counterCTRTotal.end());
     }
 
-    for (int ctrIdx = 0; ctrIdx < dst->Feature.ysize(); ++ctrIdx) {
-        const ECtrType ctrType = ctrInfo[ctrIdx].Type;
-        const ui32 classifierId = ctrInfo[ctrIdx].TargetClassifierIdx;
-        int targetClassesCount = fold.TargetClassesCount[classifierId];
-
-        const ui32 targetBorderCount = GetTargetBorderCount(ctrInfo[ctrIdx], targetClassesCount);
-        const ui32 ctrBorderCount = ctrInfo[ctrIdx].BorderCount;
-        const auto& priors = ctrInfo[ctrIdx].Priors;
-        dst->Feature[ctrIdx].SetSizes(priors.size(), targetBorderCount);
-
-        for (ui32 border = 0; border < targetBorderCount; ++border) {
-            for (int prior = 0; prior < priors.ysize(); ++prior) {
-                Clear(&dst->Feature[ctrIdx][border][prior], totalSampleCount);
-            }
-        }
-
-        if (ctrType == ECtrType::Borders && targetClassesCount == SIMPLE_CLASSES_COUNT) {
-            CalcOnlineCTRSimple(
-                testOffsets,
-                hashArr,
-                leafCount,
-                fold.LearnTargetClass[classifierId],
-                priors,
-                ctrBorderCount,
-                &dst->Feature[ctrIdx]);
-
-        } else if (ctrType == ECtrType::BinarizedTargetMeanValue) {
-            CalcOnlineCTRMean(
-                testOffsets,
-                hashArr,
-                leafCount,
-                fold.LearnTargetClass[classifierId],
-                targetClassesCount - 1,
-                priors,
-                ctrBorderCount,
-                &dst->Feature[ctrIdx]);
-
-        } else if (ctrType == ECtrType::Buckets ||
-                   (ctrType == ECtrType::Borders && targetClassesCount > SIMPLE_CLASSES_COUNT)) {
-            CalcOnlineCTRClasses(
-                testOffsets,
-                hashArr,
-                leafCount,
-                fold.LearnTargetClass[classifierId],
-                targetClassesCount,
-                GetTargetBorderCount(ctrInfo[ctrIdx], targetClassesCount),
-                priors,
-                ctrBorderCount,
-                ctrType,
-                &dst->Feature[ctrIdx]);
-        } else {
-            Y_ASSERT(ctrType == ECtrType::Counter);
-            CalcOnlineCTRCounter(
-                testOffsets,
-                counterCTRTotal,
-                hashArr,
-                counterCTRDenominator,
-                priors,
-                ctrBorderCount,
-                &dst->Feature[ctrIdx]);
-        }
-    }
+    CalcOnlineCTRsForLeaves(testOffsets,
+                            hashArr,
+                            leafCount,
+                            ctrInfo,
+                            fold,
+                            counterCTRTotal,
+                            counterCTRDenominator,
+                            /*initialClassCounts*/ nullptr,
+                            localExecutor,
+                            dst);
 }
 
 void CalcFinalCtrsImpl(
@@ -583,3 +667,71 @@ void CalcFinalCtrs(const ECtrType ctrType,
     }
     CalcFinalCtrsImpl(ctrType, ctrLeafCountLimit, permutedTargetClass, permutedTargets, sampleCount, targetClassesCount, &hashArr, result);
 }
+
+void ComputeShardOnlineCTRs(const TVector<ui64>& leafIndices,
+                            size_t leafCount,
+                            size_t featureValueCount,
+                            const TVector<TCtrInfo>& ctrInfo,
+                            const TVector<TVector<int>>& prefixClassCounts,
+                            const TVector<int>& counterCTRTotal,
+                            int counterCTRDenominator,
+                            const TFold& fold,
+                            NPar::TLocalExecutor* localExecutor,
+                            TOnlineCTR* dst) {
+    Y_ASSERT(leafIndices.size() == fold.LearnPermutation.size());
+    dst->Feature.resize(ctrInfo.size());
+    dst->FeatureValueCount = featureValueCount;
+    CalcOnlineCTRsForLeaves(/*testOffsets*/ {leafIndices.size()},
+                            leafIndices,
+                            leafCount,
+                            ctrInfo,
+                            fold,
+                            counterCTRTotal,
+                            counterCTRDenominator,
+                            &prefixClassCounts,
+                            localExecutor,
+                            dst);
+}
+
+void ComputeTestOnlineCTRs(const TVector<ui64>& testLeafIndices,
+                           const TDatasetPtrs& testDataPtrs,
+                           size_t leafCount,
+                           size_t featureValueCount,
+                           const TVector<TCtrInfo>& ctrInfo,
+                           const TVector<TVector<int>>& learnClassCounts,
+                           const TVector<int>& counterCTRTotal,
+                           int counterCTRDenominator,
+                           const TFold& fold,
+                           NPar::TLocalExecutor* localExecutor,
+                           TOnlineCTR* dst) {
+    Y_ASSERT(testLeafIndices.size() == GetSampleCount(testDataPtrs));
+    // fold learn documents go to an extra leaf, so that test documents see the counters of all learn documents only
+    const size_t learnSampleCount = fold.LearnPermutation.size();
+    const size_t learnLeafIdx = leafCount;
+    TVector<ui64> leafIndices(learnSampleCount, learnLeafIdx);
+    leafIndices.insert(leafIndices.end(), testLeafIndices.begin(), testLeafIndices.end());
+    TVector<TVector<int>> initialClassCounts(learnClassCounts.size());
+    for (int classifierIdx = 0; classifierIdx < learnClassCounts.ysize(); ++classifierIdx) {
+        const auto& classCounts = learnClassCounts[classifierIdx];
+        if (!classCounts.empty()) {
+            initialClassCounts[classifierIdx] = classCounts;
+            initialClassCounts[classifierIdx].resize((leafCount + 1) * fold.TargetClassesCount[classifierIdx]);
+        }
+    }
+    TVector<int> extendedCounterTotal = counterCTRTotal;
+    if (!extendedCounterTotal.empty()) {
+        extendedCounterTotal.resize(leafCount + 1);
+    }
+    dst->Feature.resize(ctrInfo.size());
+    dst->FeatureValueCount = featureValueCount;
+    CalcOnlineCTRsForLeaves(CalcTestOffsets(learnSampleCount, testDataPtrs),
+                            leafIndices,
+                            leafCount + 1,
+                            ctrInfo,
+                            fold,
+                            extendedCounterTotal,
+                            counterCTRDenominator,
+                            &initialClassCounts,
+                            localExecutor,
+                            dst);
+}
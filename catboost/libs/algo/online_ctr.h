@@ -5,15 +5,42 @@
 #include "target_classifier.h"
 #include "dataset.h"
 
+#include <library/threading/local_executor/local_executor.h>
 
 struct TFold;
 
 const int SIMPLE_CLASSES_COUNT = 2;
 
 
+// Ctr values with at most this border count fit in 4 bits, so values for two priors share one byte
+constexpr ui32 MAX_PACKED_PRIORS_CTR_BORDER_COUNT = 15;
+
 struct TOnlineCTR {
-    TVector<TArray2D<TVector<ui8>>> Feature; // Feature[ctrIdx][classIdx][priorIdx][docIdx]
+    // Feature[ctrIdx][classIdx][priorIdx][docIdx] or, if ArePriorsPacked[ctrIdx],
+    // Feature[ctrIdx][classIdx][priorIdx / 2][docIdx] with odd priors in the high 4 bits, use GetCtrBins to read
+    TVector<TArray2D<TVector<ui8>>> Feature;
+    TVector<bool> ArePriorsPacked; // [ctrIdx]
     size_t FeatureValueCount = 0;
+    ui64 LastUseTick = 0; // see TFold::MarkCtrUsed
+
+    TPackedBins GetCtrBins(int ctrIdx, int targetBorderIdx, int priorIdx) const {
+        if (ArePriorsPacked[ctrIdx]) {
+            return {Feature[ctrIdx][targetBorderIdx][priorIdx / 2].data(), static_cast<ui8>(priorIdx % 2 * 4), 0xF};
+        }
+        return {Feature[ctrIdx][targetBorderIdx][priorIdx].data(), 0, 0xFF};
+    }
+
+    size_t GetMemoryUsage() const {
+        size_t memoryUsage = 0;
+        for (const auto& ctr : Feature) {
+            for (size_t y = 0; y < ctr.GetYSize(); ++y) {
+                for (size_t x = 0; x < ctr.GetXSize(); ++x) {
+                    memoryUsage += ctr[y][x].capacity() * sizeof(ui8);
+                }
+            }
+        }
+        return memoryUsage;
+    }
 };
 
 using TOnlineCTRHash = THashMap<TProjection, TOnlineCTR>;
@@ -33,8 +60,41 @@ void ComputeOnlineCTRs(const TDataset& learnData,
                        const TFold& fold,
                        const TProjection& proj,
                        const TLearnContext* ctx,
+                       NPar::TLocalExecutor* localExecutor,
                        TOnlineCTR* dst);
 
+struct TCtrInfo;
+
+/// Compute online ctrs of learn documents of one shard in distributed training.
+/// leafIndices[doc] is the shard leaf of fold document doc, counters of preceding shards are in
+/// prefixClassCounts[targetClassifierIdx][leafIdx * targetClassesCount + classIdx], Counter ctrs
+/// use counterCTRTotal[leafIdx] and counterCTRDenominator of the whole dataset.
+void ComputeShardOnlineCTRs(const TVector<ui64>& leafIndices,
+                            size_t leafCount,
+                            size_t featureValueCount,
+                            const TVector<TCtrInfo>& ctrInfo,
+                            const TVector<TVector<int>>& prefixClassCounts,
+                            const TVector<int>& counterCTRTotal,
+                            int counterCTRDenominator,
+                            const TFold& fold,
+                            NPar::TLocalExecutor* localExecutor,
+                            TOnlineCTR* dst);
+
+/// Compute online ctrs of test documents in distributed training, ctrs of fold learn documents are not computed.
+/// testLeafIndices[doc] is the leaf of document doc of concatenated test sets, counters of learn documents of all
+/// shards are in learnClassCounts[targetClassifierIdx][leafIdx * targetClassesCount + classIdx], see ComputeShardOnlineCTRs.
+void ComputeTestOnlineCTRs(const TVector<ui64>& testLeafIndices,
+                           const TDatasetPtrs& testDataPtrs,
+                           size_t leafCount,
+                           size_t featureValueCount,
+                           const TVector<TCtrInfo>& ctrInfo,
+                           const TVector<TVector<int>>& learnClassCounts,
+                           const TVector<int>& counterCTRTotal,
+                           int counterCTRDenominator,
+                           const TFold& fold,
+                           NPar::TLocalExecutor* localExecutor,
+                           TOnlineCTR* dst);
+
 class TCtrValueTable;
 
 void CalcFinalCtrs(
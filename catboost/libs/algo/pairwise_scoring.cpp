@@ -15,6 +15,25 @@ TVector<TVector<double>> ComputeDerSums(
     return derSums;
 }
 
+static inline void AddPairWeight(
+    int winnerLeafId,
+    int loserLeafId,
+    int winnerBucketId,
+    int loserBucketId,
+    float sampleWeight,
+    TArray2D<TVector<TBucketPairWeightStatistics>>* pairWeightStatistics
+) {
+    auto& bucketStatisticDirect = (*pairWeightStatistics)[winnerLeafId][loserLeafId];
+    auto& bucketStatisticReverse = (*pairWeightStatistics)[loserLeafId][winnerLeafId];
+    if (winnerBucketId > loserBucketId) {
+        bucketStatisticReverse[loserBucketId].SmallerBorderWeightSum -= sampleWeight;
+        bucketStatisticReverse[winnerBucketId].GreaterBorderRightWeightSum -= sampleWeight;
+    } else {
+        bucketStatisticDirect[loserBucketId].GreaterBorderRightWeightSum -= sampleWeight;
+        bucketStatisticDirect[winnerBucketId].SmallerBorderWeightSum -= sampleWeight;
+    }
+}
+
 TArray2D<TVector<TBucketPairWeightStatistics>> ComputePairWeightStatistics(
     const TVector<TQueryInfo>& queriesInfo,
     int leafCount,
@@ -37,21 +56,120 @@ TArray2D<TVector<TBucketPairWeightStatistics>> ComputePairWeightStatistics(
                 if (winnerBucketId == loserBucketId && winnerLeafId == loserLeafId) {
                     continue;
                 }
-                auto& bucketStatisticDirect = pairWeightStatistics[winnerLeafId][loserLeafId];
-                auto& bucketStatisticReverse = pairWeightStatistics[loserLeafId][winnerLeafId];
-                if (winnerBucketId > loserBucketId) {
-                    bucketStatisticReverse[loserBucketId].SmallerBorderWeightSum -= pair.SampleWeight;
-                    bucketStatisticReverse[winnerBucketId].GreaterBorderRightWeightSum -= pair.SampleWeight;
-                } else {
-                    bucketStatisticDirect[loserBucketId].GreaterBorderRightWeightSum -= pair.SampleWeight;
-                    bucketStatisticDirect[winnerBucketId].SmallerBorderWeightSum -= pair.SampleWeight;
-                }
+                AddPairWeight(winnerLeafId, loserLeafId, winnerBucketId, loserBucketId, pair.SampleWeight, &pairWeightStatistics);
             }
         }
     }
     return pairWeightStatistics;
 }
 
+void ComputePairwiseStatsFromParent(
+    TConstArrayRef<double> weightedDerivativesData,
+    const TVector<TQueryInfo>& queriesInfo,
+    int leafCount,
+    int bucketCount,
+    const TVector<ui32>& leafIndices,
+    const TVector<ui32>& bucketIndices,
+    const TPairwiseStats& parentStats,
+    TPairwiseStats* stats
+) {
+    // the last split is the highest bit of leaf index
+    const int parentLeafCount = leafCount / 2;
+    Y_ASSERT(parentStats.DerSums.ysize() == parentLeafCount);
+    TVector<int> leafDocCounts(leafCount);
+    for (size_t docId = 0; docId < weightedDerivativesData.size(); ++docId) {
+        ++leafDocCounts[leafIndices[docId]];
+    }
+    TVector<bool> isSmallerChild(leafCount);
+    for (int parentLeafId = 0; parentLeafId < parentLeafCount; ++parentLeafId) {
+        const bool isFirstChildSmaller = leafDocCounts[parentLeafId] <= leafDocCounts[parentLeafId + parentLeafCount];
+        isSmallerChild[parentLeafId] = isFirstChildSmaller;
+        isSmallerChild[parentLeafId + parentLeafCount] = !isFirstChildSmaller;
+    }
+
+    auto& derSums = stats->DerSums;
+    derSums.assign(leafCount, TVector<double>(bucketCount, 0.0));
+    for (size_t docId = 0; docId < weightedDerivativesData.size(); ++docId) {
+        if (isSmallerChild[leafIndices[docId]]) {
+            derSums[leafIndices[docId]][bucketIndices[docId]] += weightedDerivativesData[docId];
+        }
+    }
+
+    auto& pairWeightStatistics = stats->PairWeightStatistics;
+    pairWeightStatistics.SetSizes(leafCount, leafCount);
+    pairWeightStatistics.FillEvery(TVector<TBucketPairWeightStatistics>(bucketCount));
+    // pairs of documents of the same bucket separated by the last split are skipped on the parent level
+    TVector<TVector<double>> separatedPairWeightSums(parentLeafCount, TVector<double>(bucketCount, 0.0));
+    for (int queryId = 0; queryId < queriesInfo.ysize(); ++queryId) {
+        const TQueryInfo& queryInfo = queriesInfo[queryId];
+        const int begin = queryInfo.Begin;
+        const int end = queryInfo.End;
+        for (int docId = begin; docId < end; ++docId) {
+            for (const auto& pair : queryInfo.Competitors[docId - begin]) {
+                const int winnerBucketId = bucketIndices[docId];
+                const int loserBucketId = bucketIndices[begin + pair.Id];
+                const int winnerLeafId = leafIndices[docId];
+                const int loserLeafId = leafIndices[begin + pair.Id];
+                if (!isSmallerChild[winnerLeafId] && !isSmallerChild[loserLeafId]) {
+                    continue;
+                }
+                if (winnerBucketId == loserBucketId) {
+                    if (winnerLeafId == loserLeafId) {
+                        continue;
+                    }
+                    if (winnerLeafId % parentLeafCount == loserLeafId % parentLeafCount) {
+                        separatedPairWeightSums[winnerLeafId % parentLeafCount][winnerBucketId] += pair.SampleWeight;
+                    }
+                }
+                AddPairWeight(winnerLeafId, loserLeafId, winnerBucketId, loserBucketId, pair.SampleWeight, &pairWeightStatistics);
+            }
+        }
+    }
+
+    for (int leafId = 0; leafId < leafCount; ++leafId) {
+        if (isSmallerChild[leafId]) {
+            continue;
+        }
+        const auto& parentDerSums = parentStats.DerSums[leafId % parentLeafCount];
+        const auto& siblingDerSums = derSums[leafId ^ parentLeafCount];
+        for (int bucketId = 0; bucketId < bucketCount; ++bucketId) {
+            derSums[leafId][bucketId] = parentDerSums[bucketId] - siblingDerSums[bucketId];
+        }
+    }
+    for (int x = 0; x < leafCount; ++x) {
+        for (int y = 0; y < leafCount; ++y) {
+            if (isSmallerChild[x] || isSmallerChild[y]) {
+                continue;
+            }
+            const int siblingX = x ^ parentLeafCount;
+            const int siblingY = y ^ parentLeafCount;
+            const auto& parentXY = parentStats.PairWeightStatistics[x % parentLeafCount][y % parentLeafCount];
+            const auto& siblingXY = pairWeightStatistics[siblingX][y];
+            const auto& xSiblingY = pairWeightStatistics[x][siblingY];
+            const auto& siblingXSiblingY = pairWeightStatistics[siblingX][siblingY];
+            auto& xy = pairWeightStatistics[x][y];
+            for (int bucketId = 0; bucketId < bucketCount; ++bucketId) {
+                xy[bucketId].SmallerBorderWeightSum = parentXY[bucketId].SmallerBorderWeightSum
+                    - siblingXY[bucketId].SmallerBorderWeightSum
+                    - xSiblingY[bucketId].SmallerBorderWeightSum
+                    - siblingXSiblingY[bucketId].SmallerBorderWeightSum;
+                xy[bucketId].GreaterBorderRightWeightSum = parentXY[bucketId].GreaterBorderRightWeightSum
+                    - siblingXY[bucketId].GreaterBorderRightWeightSum
+                    - xSiblingY[bucketId].GreaterBorderRightWeightSum
+                    - siblingXSiblingY[bucketId].GreaterBorderRightWeightSum;
+            }
+            if (x == y) {
+                // separated pairs of the same bucket are in statistics of the children but not of the parent
+                const auto& separatedWeightSums = separatedPairWeightSums[x % parentLeafCount];
+                for (int bucketId = 0; bucketId < bucketCount; ++bucketId) {
+                    xy[bucketId].SmallerBorderWeightSum -= separatedWeightSums[bucketId];
+                    xy[bucketId].GreaterBorderRightWeightSum -= separatedWeightSums[bucketId];
+                }
+            }
+        }
+    }
+}
+
 static double CalculateScore(const TVector<double>& avrg, const TVector<double>& sumDer, const TArray2D<double>& sumWeights) {
     double score = 0;
     for (int x = 0; x < sumDer.ysize(); ++x) {
@@ -5,11 +5,6 @@
 #include "index_calcer.h"
 #include "split.h"
 
-struct TBucketPairWeightStatistics {
-    double SmallerBorderWeightSum = 0.0; // The weight sum of pair elements with smaller border.
-    double GreaterBorderRightWeightSum = 0.0; // The weight sum of pair elements with greater border.
-};
-
 TVector<TVector<double>> ComputeDerSums(
     TConstArrayRef<double> weightedDerivativesData,
     int leafCount,
@@ -26,6 +21,19 @@ TArray2D<TVector<TBucketPairWeightStatistics>> ComputePairWeightStatistics(
     const TVector<ui32>& bucketIndices
 );
 
+// Leaves of the last split are children of leaves of parentStats. Statistics of the smaller child of each parent leaf
+// are computed from its documents and pairs, statistics of the larger child are parent ones minus the rest of them.
+void ComputePairwiseStatsFromParent(
+    TConstArrayRef<double> weightedDerivativesData,
+    const TVector<TQueryInfo>& queriesInfo,
+    int leafCount,
+    int bucketCount,
+    const TVector<ui32>& leafIndices,
+    const TVector<ui32>& bucketIndices,
+    const TPairwiseStats& parentStats,
+    TPairwiseStats* stats
+);
+
 void EvaluateBucketScores(
     const TVector<TVector<double>>& derSums,
     const TArray2D<TVector<TBucketPairWeightStatistics>>& pairWeightStatistics,
@@ -36,6 +44,7 @@ void EvaluateBucketScores(
     TVector<TScoreBin>* scoreBins
 );
 
+// stats of the current level are computed from parentStats of the previous level if they are not null
 template<typename TFullIndexType>
 inline void CalculatePairwiseScore(
     const TVector<TFullIndexType>& singleIdx,
@@ -46,6 +55,8 @@ inline void CalculatePairwiseScore(
     ESplitType splitType,
     float l2DiagReg,
     float pairwiseBucketWeightPriorReg,
+    const TPairwiseStats* parentStats,
+    TPairwiseStats* stats,
     TVector<TScoreBin>* scoreBins
 ) {
     const int docCount = singleIdx.ysize();
@@ -55,7 +66,28 @@ inline void CalculatePairwiseScore(
         bucketIndices[docId] = singleIdx[docId] % bucketCount;
     }
 
-    const TVector<TVector<double>> derSums = ComputeDerSums(weightedDerivativesData, leafCount, bucketCount, leafIndices, bucketIndices);
-    const TArray2D<TVector<TBucketPairWeightStatistics>> pairWeightStatistics = ComputePairWeightStatistics(queriesInfo, leafCount, bucketCount, leafIndices, bucketIndices);
-    EvaluateBucketScores(derSums, pairWeightStatistics, bucketCount, splitType, l2DiagReg, pairwiseBucketWeightPriorReg, scoreBins);
+    if (parentStats != nullptr) {
+        ComputePairwiseStatsFromParent(weightedDerivativesData, queriesInfo, leafCount, bucketCount, leafIndices, bucketIndices, *parentStats, stats);
+    } else {
+        stats->DerSums = ComputeDerSums(weightedDerivativesData, leafCount, bucketCount, leafIndices, bucketIndices);
+        auto pairWeightStatistics = ComputePairWeightStatistics(queriesInfo, leafCount, bucketCount, leafIndices, bucketIndices);
+        stats->PairWeightStatistics.Swap(pairWeightStatistics);
+    }
+    EvaluateBucketScores(stats->DerSums, stats->PairWeightStatistics, bucketCount, splitType, l2DiagReg, pairwiseBucketWeightPriorReg, scoreBins);
+}
+
+template<typename TFullIndexType>
+inline void CalculatePairwiseScore(
+    const TVector<TFullIndexType>& singleIdx,
+    TConstArrayRef<double> weightedDerivativesData,
+    const TVector<TQueryInfo>& queriesInfo,
+    int leafCount,
+    int bucketCount,
+    ESplitType splitType,
+    float l2DiagReg,
+    float pairwiseBucketWeightPriorReg,
+    TVector<TScoreBin>* scoreBins
+) {
+    TPairwiseStats stats;
+    CalculatePairwiseScore(singleIdx, weightedDerivativesData, queriesInfo, leafCount, bucketCount, splitType, l2DiagReg, pairwiseBucketWeightPriorReg, /*parentStats*/ nullptr, &stats, scoreBins);
 }
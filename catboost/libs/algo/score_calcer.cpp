@@ -6,6 +6,8 @@
 
 #include <catboost/libs/options/defaults_helper.h>
 
+#include <util/generic/algorithm.h>
+
 #include <type_traits>
 
 int GetSplitCount(const TVector<int>& splitsCount,
@@ -21,21 +23,22 @@ int GetSplitCount(const TVector<int>& splitsCount,
     }
 }
 
+// blockStats is not null in single precision mode, see CalcStatsKernelSinglePrecision
 template<typename TFullIndexType, typename TIsCaching>
 static TVector<TScoreBin> CalcScoreImpl(const TIsCaching& isCaching,
         const TVector<TFullIndexType>& singleIdx,
         const TCalcScoreFold& fold,
         const TFold& initialFold,
         bool isPlainMode,
-        bool isPairwiseScoring,
         float l2Regularizer,
-        float pairwiseBucketWeightPriorReg,
         ESplitType splitType,
         const TStatsIndexer& indexer,
         int depth,
         int splitStatsCount,
-        TBucketStats* splitStats) {
+        TBucketStats* splitStats,
+        TBucketStatsSingle* blockStats) {
     Y_ASSERT(!isCaching || depth > 0);
+    Y_ASSERT(!isCaching || blockStats == nullptr);
     const int approxDimension = fold.GetApproxDimension();
     const int leafCount = 1 << depth;
     TVector<TScoreBin> scoreBins(indexer.BucketCount);
@@ -44,33 +47,100 @@ static TVector<TScoreBin> CalcScoreImpl(const TIsCaching& isCaching,
         double sumAllWeights = initialFold.BodyTailArr[bodyTailIdx].BodySumWeight;
         int docCount = initialFold.BodyTailArr[bodyTailIdx].BodyFinish;
         for (int dim = 0; dim < approxDimension; ++dim) {
-            if (isPairwiseScoring) {
-                Y_ASSERT(approxDimension == 1 && fold.GetBodyTailCount() == 1);
-                CalculatePairwiseScore(
-                    singleIdx,
-                    MakeArrayRef(bt.WeightedDerivatives[0].data(), singleIdx.size()),
-                    *fold.LearnQueriesInfo,
-                    leafCount,
-                    indexer.BucketCount,
-                    splitType,
-                    l2Regularizer,
-                    pairwiseBucketWeightPriorReg,
-                    &scoreBins
-                );
+            TBucketStats* stats = splitStats + (bodyTailIdx * approxDimension + dim) * splitStatsCount;
+            if (blockStats != nullptr) {
+                CalcStatsKernelSinglePrecision(singleIdx, fold, isPlainMode, indexer, depth, bt, dim, blockStats, stats);
             } else {
-                TBucketStats* stats = splitStats + (bodyTailIdx * approxDimension + dim) * splitStatsCount;
                 CalcStatsKernel(isCaching, singleIdx, fold, isPlainMode, indexer, depth, bt, dim, stats);
-                if (isPlainMode) {
-                    UpdateScoreBin(stats, leafCount, indexer, splitType, l2Regularizer, /*isPlainMode=*/std::true_type(), sumAllWeights, docCount, &scoreBins);
-                } else {
-                    UpdateScoreBin(stats, leafCount, indexer, splitType, l2Regularizer, /*isPlainMode=*/std::false_type(), sumAllWeights, docCount, &scoreBins);
-                }
+            }
+            if (isPlainMode) {
+                UpdateScoreBin(stats, leafCount, indexer, splitType, l2Regularizer, /*isPlainMode=*/std::true_type(), sumAllWeights, docCount, &scoreBins);
+            } else {
+                UpdateScoreBin(stats, leafCount, indexer, splitType, l2Regularizer, /*isPlainMode=*/std::false_type(), sumAllWeights, docCount, &scoreBins);
             }
         }
     }
     return scoreBins;
 }
 
+// allDocsStats are kept between tree levels, see CalcSampledOutSiblingStatsKernel
+template<typename TFullIndexType>
+static TVector<TScoreBin> CalcSampledOutSiblingScoreImpl(const TVector<TFullIndexType>& singleIdx,
+        const TCalcScoreFold& fold,
+        const TFold& initialFold,
+        float l2Regularizer,
+        ESplitType splitType,
+        const TStatsIndexer& indexer,
+        int depth,
+        int splitStatsCount,
+        TBucketStats* allDocsStats) {
+    Y_ASSERT(fold.GetBodyTailCount() == 1);
+    const int leafCount = 1 << depth;
+    const double sumAllWeights = initialFold.BodyTailArr[0].BodySumWeight;
+    const int docCount = initialFold.BodyTailArr[0].BodyFinish;
+    TVector<TScoreBin> scoreBins(indexer.BucketCount);
+    TVector<TBucketStats> sampleStats;
+    sampleStats.yresize(indexer.CalcSize(depth));
+    for (int dim = 0; dim < fold.GetApproxDimension(); ++dim) {
+        CalcSampledOutSiblingStatsKernel(singleIdx, fold, indexer, depth, dim, allDocsStats + dim * splitStatsCount, sampleStats.data());
+        UpdateScoreBin(sampleStats.data(), leafCount, indexer, splitType, l2Regularizer, /*isPlainMode=*/std::true_type(), sumAllWeights, docCount, &scoreBins);
+    }
+    return scoreBins;
+}
+
+// Stats of sparse float feature are calculated from its non default documents only,
+// stats of the default bucket are leaf totals minus stats of all other buckets.
+static void CalcSparseFloatFeatureStats(const TSparseFloatFeature& feature,
+        const TCalcScoreFold& fold,
+        const TStatsIndexer& indexer,
+        int leafCount,
+        int dim,
+        TBucketStats* stats) {
+    Fill(stats, stats + indexer.BucketCount * leafCount, TBucketStats{0, 0, 0, 0});
+    const auto& bt = fold.BodyTailArr[0];
+    const double* weightedDerivativesData = GetDataPtr(bt.SampleWeightedDerivatives[dim]);
+    const float* sampleWeightsData = bt.PairwiseWeights.empty() ? GetDataPtr(fold.SampleWeights) : GetDataPtr(bt.SamplePairwiseWeights);
+    const TIndexType* indices = GetDataPtr(fold.Indices);
+    const int* docPositions = fold.DocPositions.data();
+    const int tailFinish = bt.TailFinish;
+    for (size_t i = 0; i < feature.DocIndices.size(); ++i) {
+        const int doc = docPositions[feature.DocIndices[i]];
+        if (doc < 0 || doc >= tailFinish) {
+            continue;
+        }
+        TBucketStats& leafStats = stats[indexer.GetIndex(indices[doc], feature.Bins[i])];
+        leafStats.SumWeightedDelta += weightedDerivativesData[doc];
+        leafStats.SumWeight += sampleWeightsData[doc];
+    }
+    for (int leaf = 0; leaf < leafCount; ++leaf) {
+        TBucketStats defaultStats = fold.LeafStats[dim][leaf];
+        for (int bucket = 0; bucket < indexer.BucketCount; ++bucket) {
+            defaultStats.Remove(stats[indexer.GetIndex(leaf, bucket)]);
+        }
+        stats[indexer.GetIndex(leaf, feature.DefaultBin)].Add(defaultStats);
+    }
+}
+
+static TVector<TScoreBin> CalcSparseFloatFeatureScore(const TSparseFloatFeature& feature,
+        const TCalcScoreFold& fold,
+        const TFold& initialFold,
+        float l2Regularizer,
+        const TStatsIndexer& indexer,
+        int depth) {
+    Y_ASSERT(fold.HasSparseScoringData && fold.GetBodyTailCount() == 1);
+    const int leafCount = 1 << depth;
+    const double sumAllWeights = initialFold.BodyTailArr[0].BodySumWeight;
+    const int docCount = initialFold.BodyTailArr[0].BodyFinish;
+    TVector<TScoreBin> scoreBins(indexer.BucketCount);
+    TVector<TBucketStats> stats;
+    stats.yresize(indexer.CalcSize(depth));
+    for (int dim = 0; dim < fold.GetApproxDimension(); ++dim) {
+        CalcSparseFloatFeatureStats(feature, fold, indexer, leafCount, dim, stats.data());
+        UpdateScoreBin(stats.data(), leafCount, indexer, ESplitType::FloatFeature, l2Regularizer, /*isPlainMode=*/std::true_type(), sumAllWeights, docCount, &scoreBins);
+    }
+    return scoreBins;
+}
+
 TVector<TScoreBin> CalcScore(const TAllFeatures& af,
                           const TVector<int>& splitsCount,
                           const std::tuple<const TOnlineCTRHash&, const TOnlineCTRHash&>& allCtrs,
@@ -86,44 +156,364 @@ TVector<TScoreBin> CalcScore(const TAllFeatures& af,
     const int bucketIndexBits = GetValueBitCount(bucketCount) + depth + 1;
     const bool isPairwiseScoring = IsPairwiseScoring(fitParams.LossFunctionDescription->GetLossFunction());
 
-    decltype(auto) SelectCalcScoreImpl = [&] (auto isCaching, const TCalcScoreFold& fold, int splitStatsCount, auto* splitStats) {
-        const bool isPlainMode = IsPlainMode(fitParams.BoostingOptions->BoostingType);
+    if (split.Type == ESplitType::FloatFeature && af.IsFloatFeatureSparse(split.FeatureIdx) && fold.HasSparseScoringData) {
         const float l2Regularizer = static_cast<const float>(fitParams.ObliviousTreeOptions->L2Reg);
-        const float pairwiseBucketWeightPriorReg = static_cast<const float>(fitParams.ObliviousTreeOptions->PairwiseNonDiagReg);
+        return CalcSparseFloatFeatureScore(af.SparseFloatFeatures[split.FeatureIdx], fold, initialFold, l2Regularizer, indexer, depth);
+    }
+
+    // Calls calc(singleIdx) with index type wide enough for leaves and buckets of the split
+    decltype(auto) CallWithSingleIndex = [&] (const TCalcScoreFold& fold, const auto& calc) {
         if (bucketIndexBits <= 8) {
             TVector<ui8> singleIdx;
             BuildSingleIndex(fold, af, allCtrs, split, indexer, &singleIdx);
-            return CalcScoreImpl(isCaching, singleIdx, fold, initialFold, isPlainMode, isPairwiseScoring, l2Regularizer, pairwiseBucketWeightPriorReg, split.Type, indexer, depth, splitStatsCount, GetDataPtr(*splitStats));
+            return calc(singleIdx);
         } else if (bucketIndexBits <= 16) {
             TVector<ui16> singleIdx;
             BuildSingleIndex(fold, af, allCtrs, split, indexer, &singleIdx);
-            return CalcScoreImpl(isCaching, singleIdx, fold, initialFold, isPlainMode, isPairwiseScoring, l2Regularizer, pairwiseBucketWeightPriorReg, split.Type, indexer, depth, splitStatsCount, GetDataPtr(*splitStats));
+            return calc(singleIdx);
         } else if (bucketIndexBits <= 32) {
             TVector<ui32> singleIdx;
             BuildSingleIndex(fold, af, allCtrs, split, indexer, &singleIdx);
-            return CalcScoreImpl(isCaching, singleIdx, fold, initialFold, isPlainMode, isPairwiseScoring, l2Regularizer, pairwiseBucketWeightPriorReg, split.Type, indexer, depth, splitStatsCount, GetDataPtr(*splitStats));
+            return calc(singleIdx);
         }
         CB_ENSURE(false, "too deep or too much splitsCount for score calculation");
     };
+    const bool isPlainMode = IsPlainMode(fitParams.BoostingOptions->BoostingType);
+    const float l2Regularizer = static_cast<const float>(fitParams.ObliviousTreeOptions->L2Reg);
+    decltype(auto) SelectCalcScoreImpl = [&] (auto isCaching, const TCalcScoreFold& fold, int splitStatsCount, auto* splitStats, TBucketStatsSingle* blockStats) {
+        return CallWithSingleIndex(fold, [&] (const auto& singleIdx) {
+            return CalcScoreImpl(isCaching, singleIdx, fold, initialFold, isPlainMode, l2Regularizer, split.Type, indexer, depth, splitStatsCount, GetDataPtr(*splitStats), blockStats);
+        });
+    };
     const auto& treeOptions = fitParams.ObliviousTreeOptions.Get();
 
-    // Pairwise scoring doesn't use statistics from previous tree level
-    if (!IsSamplingPerTree(treeOptions) || isPairwiseScoring) {
-        TVector<TBucketStats> scratchSplitStats;
+    if (isPairwiseScoring) {
+        Y_ASSERT(fold.GetApproxDimension() == 1 && fold.GetBodyTailCount() == 1);
+        const float pairwiseBucketWeightPriorReg = static_cast<const float>(treeOptions.PairwiseNonDiagReg);
+        const int leafCount = 1 << depth;
+        TPairwiseStats* cachedStats = nullptr;
+        const TPairwiseStats* parentStats = nullptr;
+        if (IsSamplingPerTree(treeOptions)) {
+            cachedStats = &statsFromPrevTree->GetPairwiseStats(split); // thread-safe access
+            if (depth > 0 && cachedStats->Depth == depth - 1) {
+                parentStats = cachedStats;
+            }
+        }
+        TPairwiseStats stats;
+        TVector<TScoreBin> scoreBins(indexer.BucketCount);
+        CallWithSingleIndex(fold, [&] (const auto& singleIdx) {
+            CalculatePairwiseScore(
+                singleIdx,
+                MakeArrayRef(fold.BodyTailArr[0].WeightedDerivatives[0].data(), singleIdx.size()),
+                *fold.LearnQueriesInfo,
+                leafCount,
+                indexer.BucketCount,
+                split.Type,
+                l2Regularizer,
+                pairwiseBucketWeightPriorReg,
+                parentStats,
+                &stats,
+                &scoreBins
+            );
+        });
+        if (cachedStats != nullptr) {
+            // stats take leafCount^2 * bucketCount, they are kept for the next level while they take
+            // no more than cached stats of plain scoring and subtracting them is cheaper than a pass over documents
+            const ui64 statsCount = static_cast<ui64>(leafCount) * leafCount * indexer.BucketCount;
+            const ui64 nextStatsCount = 4 * statsCount;
+            const bool isNextLevelCached = depth + 1 < static_cast<int>(treeOptions.MaxDepth)
+                && statsCount <= static_cast<ui64>(indexer.CalcSize(treeOptions.MaxDepth))
+                && nextStatsCount <= static_cast<ui64>(fold.GetDocCount());
+            if (isNextLevelCached) {
+                DoSwap(cachedStats->DerSums, stats.DerSums);
+                cachedStats->PairWeightStatistics.Swap(stats.PairWeightStatistics);
+                cachedStats->Depth = depth;
+            } else {
+                *cachedStats = TPairwiseStats();
+            }
+        }
+        return scoreBins;
+    }
+
+    if (IsSampledOutSiblingScoring(fitParams)) {
+        const int splitStatsCount = indexer.CalcSize(treeOptions.MaxDepth);
+        const int statsCount = fold.GetApproxDimension() * splitStatsCount;
+        bool areStatsDirty;
+        TVector<TBucketStats, TPoolAllocator>& allDocsStats = statsFromPrevTree->GetStats(split, statsCount, &areStatsDirty); // thread-safe access
+        if (depth == 0 || !areStatsDirty) {
+            return CallWithSingleIndex(prevLevelData, [&] (const auto& singleIdx) {
+                return CalcSampledOutSiblingScoreImpl(singleIdx, prevLevelData, initialFold, l2Regularizer, split.Type, indexer, depth, splitStatsCount, GetDataPtr(allDocsStats));
+            });
+        }
+        // stats of all documents are unknown for candidates not scored on the previous level, the sample is scanned instead
+        statsFromPrevTree->Erase(split);
+    }
+
+    if (!IsSamplingPerTree(treeOptions)) {
         const int splitStatsCount = indexer.CalcSize(depth);
         const int statsCount = splitStatsCount;
+        TVector<TBucketStats> scratchSplitStats;
         scratchSplitStats.yresize(statsCount);
-        return SelectCalcScoreImpl(/*isCaching*/ std::false_type(), fold, /*splitStatsCount*/ 0, &scratchSplitStats);
+        if (treeOptions.SinglePrecisionScoreStats.Get()) {
+            TVector<TBucketStatsSingle> blockStats;
+            blockStats.yresize(statsCount);
+            return SelectCalcScoreImpl(/*isCaching*/ std::false_type(), fold, /*splitStatsCount*/ 0, &scratchSplitStats, blockStats.data());
+        }
+        return SelectCalcScoreImpl(/*isCaching*/ std::false_type(), fold, /*splitStatsCount*/ 0, &scratchSplitStats, /*blockStats*/ nullptr);
     } else {
         const int splitStatsCount = indexer.CalcSize(treeOptions.MaxDepth);
         const int statsCount = fold.GetBodyTailCount() * fold.GetApproxDimension() * splitStatsCount;
         bool areStatsDirty;
         TVector<TBucketStats, TPoolAllocator>& splitStats = statsFromPrevTree->GetStats(split, statsCount, &areStatsDirty); // thread-safe access
         if (depth == 0 || areStatsDirty) {
-            return SelectCalcScoreImpl(/*isCaching*/ std::false_type(), fold, splitStatsCount, &splitStats);
+            return SelectCalcScoreImpl(/*isCaching*/ std::false_type(), fold, splitStatsCount, &splitStats, /*blockStats*/ nullptr);
         } else {
-            return SelectCalcScoreImpl(/*isCaching*/ std::true_type(), prevLevelData, splitStatsCount, &splitStats);
+            return SelectCalcScoreImpl(/*isCaching*/ std::true_type(), prevLevelData, splitStatsCount, &splitStats, /*blockStats*/ nullptr);
         }
     }
     CB_ENSURE(false, "too deep or too much splitsCount for score calculation");
 }
+
+namespace {
+    template<typename TStats>
+    struct TFeatureHistogram {
+        TPackedBins Bins;
+        int BucketCount;
+        TStats* Stats;
+    };
+}
+
+static inline size_t GetOriginalDocIdx(const size_t* docPermutation, size_t doc) {
+    return docPermutation == nullptr ? doc : docPermutation[doc];
+}
+
+// Update bootstraped sums on [docBegin, docEnd) in buckets of all features
+template<typename TStats>
+static void UpdateWeightedHistograms(const TIndexType* indices,
+                                     const size_t* docPermutation,
+                                     const double* weightedDer,
+                                     const float* sampleWeights,
+                                     int docBegin,
+                                     int docEnd,
+                                     TConstArrayRef<TFeatureHistogram<TStats>> histograms) {
+    for (int doc = docBegin; doc < docEnd; ++doc) {
+        const size_t originalDocIdx = GetOriginalDocIdx(docPermutation, doc);
+        const int leafOffset = indices[doc];
+        const double der = weightedDer[doc];
+        const double weight = sampleWeights[doc];
+        for (const auto& histogram : histograms) {
+            TStats& leafStats = histogram.Stats[leafOffset * histogram.BucketCount + histogram.Bins[originalDocIdx]];
+            leafStats.SumWeightedDelta += der;
+            leafStats.SumWeight += weight;
+        }
+    }
+}
+
+// Update not bootstraped sums on [docBegin, docEnd) in buckets of all features
+template<typename TStats>
+static void UpdateDeltaCountHistograms(const TIndexType* indices,
+                                       const size_t* docPermutation,
+                                       const double* derivatives,
+                                       const float* learnWeights,
+                                       int docBegin,
+                                       int docEnd,
+                                       TConstArrayRef<TFeatureHistogram<TStats>> histograms) {
+    for (int doc = docBegin; doc < docEnd; ++doc) {
+        const size_t originalDocIdx = GetOriginalDocIdx(docPermutation, doc);
+        const int leafOffset = indices[doc];
+        const double der = derivatives[doc];
+        const double weight = learnWeights == nullptr ? 1.0 : learnWeights[doc];
+        for (const auto& histogram : histograms) {
+            TStats& leafStats = histogram.Stats[leafOffset * histogram.BucketCount + histogram.Bins[originalDocIdx]];
+            leafStats.SumDelta += der;
+            leafStats.Count += weight;
+        }
+    }
+}
+
+// featureBlockStats are not empty in single precision mode, histograms are accumulated in them by document blocks,
+// see UpdateStatsBySinglePrecisionBlocks
+template<typename TIsCaching>
+static void CalcFloatFeaturesScoreImpl(const TIsCaching& isCaching,
+        const TAllFeatures& af,
+        const TCalcScoreFold& fold,
+        const TFold& initialFold,
+        bool isPlainMode,
+        float l2Regularizer,
+        TConstArrayRef<TSplitCandidate> splits,
+        const TVector<TStatsIndexer>& indexers,
+        const TVector<TBucketStats*>& featureStats,
+        const TVector<TBucketStatsSingle*>& featureBlockStats,
+        const TVector<int>& splitStatsCounts,
+        const TVector<int>& featureIds,
+        int depth,
+        TVector<TVector<TScoreBin>>* scoreBins) {
+    Y_ASSERT(!isCaching || depth > 0);
+    Y_ASSERT(!isCaching || featureBlockStats.empty());
+    const bool isSinglePrecision = !featureBlockStats.empty();
+    const int approxDimension = fold.GetApproxDimension();
+    const int leafCount = 1 << depth;
+    const TIndexType* indices = GetDataPtr(fold.Indices);
+    const size_t* learnPermutation = GetDataPtr(fold.LearnPermutation);
+    // same as in SetSingleIndex: permutation of one block is identity
+    const size_t* docPermutation = fold.PermutationBlockSize == fold.GetDocCount() ? nullptr : learnPermutation;
+
+    TVector<TFeatureHistogram<TBucketStats>> histograms(featureIds.size());
+    TVector<TFeatureHistogram<TBucketStatsSingle>> blockHistograms(isSinglePrecision ? featureIds.size() : 0);
+    int blockStatsCount = 0;
+    for (int featureId : featureIds) {
+        blockStatsCount += indexers[featureId].CalcSize(depth);
+    }
+    // Calls update(blockBegin, blockEnd) for document blocks of [docBegin, docEnd) and adds block histograms to histograms
+    const auto updateBySinglePrecisionBlocks = [&](int docBegin, int docEnd, const auto& update) {
+        const int blockSize = GetSinglePrecisionStatsBlockSize(blockStatsCount);
+        for (int blockBegin = docBegin; blockBegin < docEnd; blockBegin += blockSize) {
+            update(blockBegin, Min(docEnd, blockBegin + blockSize));
+            for (int i = 0; i < featureIds.ysize(); ++i) {
+                FlushSinglePrecisionStats(indexers[featureIds[i]].CalcSize(depth), blockHistograms[i].Stats, histograms[i].Stats);
+            }
+        }
+    };
+    for (int bodyTailIdx = 0; bodyTailIdx < fold.GetBodyTailCount(); ++bodyTailIdx) {
+        const auto& bt = fold.BodyTailArr[bodyTailIdx];
+        double sumAllWeights = initialFold.BodyTailArr[bodyTailIdx].BodySumWeight;
+        int docCount = initialFold.BodyTailArr[bodyTailIdx].BodyFinish;
+        for (int dim = 0; dim < approxDimension; ++dim) {
+            for (int i = 0; i < featureIds.ysize(); ++i) {
+                const int featureId = featureIds[i];
+                const auto& indexer = indexers[featureId];
+                TBucketStats* stats = featureStats[featureId] + (bodyTailIdx * approxDimension + dim) * splitStatsCounts[featureId];
+                if (isCaching) {
+                    Fill(stats + indexer.CalcSize(depth - 1), stats + indexer.CalcSize(depth), TBucketStats{0, 0, 0, 0});
+                } else {
+                    Fill(stats, stats + indexer.CalcSize(depth), TBucketStats{0, 0, 0, 0});
+                }
+                const auto bins = af.GetFloatFeatureBins(splits[featureId].FeatureIdx);
+                histograms[i] = TFeatureHistogram<TBucketStats>{bins, indexer.BucketCount, stats};
+                if (isSinglePrecision) {
+                    TBucketStatsSingle* blockStats = featureBlockStats[featureId];
+                    Fill(blockStats, blockStats + indexer.CalcSize(depth), TBucketStatsSingle{0, 0, 0, 0});
+                    blockHistograms[i] = TFeatureHistogram<TBucketStatsSingle>{bins, indexer.BucketCount, blockStats};
+                }
+            }
+
+            const bool hasPairwiseWeights = !bt.PairwiseWeights.empty();
+            const float* weightsData = hasPairwiseWeights ? GetDataPtr(bt.PairwiseWeights) : GetDataPtr(fold.LearnWeights);
+            const float* sampleWeightsData = hasPairwiseWeights ? GetDataPtr(bt.SamplePairwiseWeights) : GetDataPtr(fold.SampleWeights);
+            const double* weightedDerivativesData = GetDataPtr(bt.WeightedDerivatives[dim]);
+            const double* sampleWeightedDerivativesData = GetDataPtr(bt.SampleWeightedDerivatives[dim]);
+            if (isSinglePrecision) {
+                const auto updateWeighted = [&](int blockBegin, int blockEnd) {
+                    UpdateWeightedHistograms<TBucketStatsSingle>(indices, docPermutation, sampleWeightedDerivativesData, sampleWeightsData, blockBegin, blockEnd, blockHistograms);
+                };
+                if (isPlainMode) {
+                    updateBySinglePrecisionBlocks(0, bt.TailFinish, updateWeighted);
+                } else {
+                    updateBySinglePrecisionBlocks(0, bt.BodyFinish, [&](int blockBegin, int blockEnd) {
+                        UpdateDeltaCountHistograms<TBucketStatsSingle>(indices, docPermutation, weightedDerivativesData, weightsData, blockBegin, blockEnd, blockHistograms);
+                    });
+                    updateBySinglePrecisionBlocks(bt.BodyFinish, bt.TailFinish, updateWeighted);
+                }
+            } else if (isPlainMode) {
+                UpdateWeightedHistograms<TBucketStats>(indices, docPermutation, sampleWeightedDerivativesData, sampleWeightsData, 0, bt.TailFinish, histograms);
+            } else {
+                UpdateDeltaCountHistograms<TBucketStats>(indices, docPermutation, weightedDerivativesData, weightsData, 0, bt.BodyFinish, histograms);
+                UpdateWeightedHistograms<TBucketStats>(indices, docPermutation, sampleWeightedDerivativesData, sampleWeightsData, bt.BodyFinish, bt.TailFinish, histograms);
+            }
+
+            for (int i = 0; i < featureIds.ysize(); ++i) {
+                const int featureId = featureIds[i];
+                const auto& indexer = indexers[featureId];
+                if (isCaching) {
+                    FixUpStats(depth, indexer, fold.SmallestSplitSideValue, histograms[i].Stats);
+                }
+                auto& featureScoreBins = (*scoreBins)[featureId];
+                if (isPlainMode) {
+                    UpdateScoreBin(histograms[i].Stats, leafCount, indexer, ESplitType::FloatFeature, l2Regularizer, /*isPlainMode=*/std::true_type(), sumAllWeights, docCount, &featureScoreBins);
+                } else {
+                    UpdateScoreBin(histograms[i].Stats, leafCount, indexer, ESplitType::FloatFeature, l2Regularizer, /*isPlainMode=*/std::false_type(), sumAllWeights, docCount, &featureScoreBins);
+                }
+            }
+        }
+    }
+}
+
+TVector<TVector<TScoreBin>> CalcScoresForFloatFeatures(const TAllFeatures& af,
+                                                      const TVector<int>& splitsCount,
+                                                      const TCalcScoreFold& fold,
+                                                      const TCalcScoreFold& prevLevelData,
+                                                      const TFold& initialFold,
+                                                      const NCatboostOptions::TCatBoostOptions& fitParams,
+                                                      TConstArrayRef<TSplitCandidate> splits,
+                                                      int depth,
+                                                      TBucketStatsCache* statsFromPrevTree) {
+    Y_ASSERT(!IsPairwiseScoring(fitParams.LossFunctionDescription->GetLossFunction()));
+    Y_ASSERT(!IsSampledOutSiblingScoring(fitParams));
+    const auto& treeOptions = fitParams.ObliviousTreeOptions.Get();
+    const bool isPlainMode = IsPlainMode(fitParams.BoostingOptions->BoostingType);
+    const float l2Regularizer = static_cast<const float>(treeOptions.L2Reg);
+    const bool isSamplingPerTree = IsSamplingPerTree(treeOptions);
+    const int featureCount = splits.size();
+
+    TVector<TStatsIndexer> indexers;
+    indexers.reserve(featureCount);
+    TVector<TVector<TScoreBin>> scoreBins(featureCount);
+    for (const auto& split : splits) {
+        Y_ASSERT(split.Type == ESplitType::FloatFeature);
+        indexers.emplace_back(GetSplitCount(splitsCount, af.OneHotValues, split) + 1);
+        scoreBins[indexers.ysize() - 1].resize(indexers.back().BucketCount);
+    }
+    TVector<int> allFeatureIds(featureCount);
+    Iota(allFeatureIds.begin(), allFeatureIds.end(), 0);
+    const TVector<int> splitStatsCounts(featureCount, 0);
+
+    if (!isSamplingPerTree) {
+        TVector<TVector<TBucketStats>> scratchSplitStats(featureCount);
+        TVector<TBucketStats*> featureStats(featureCount);
+        TVector<TVector<TBucketStatsSingle>> blockStats;
+        TVector<TBucketStatsSingle*> featureBlockStats;
+        if (treeOptions.SinglePrecisionScoreStats.Get()) {
+            blockStats.resize(featureCount);
+            featureBlockStats.resize(featureCount);
+        }
+        for (int featureId = 0; featureId < featureCount; ++featureId) {
+            scratchSplitStats[featureId].yresize(indexers[featureId].CalcSize(depth));
+            featureStats[featureId] = GetDataPtr(scratchSplitStats[featureId]);
+            if (!featureBlockStats.empty()) {
+                blockStats[featureId].yresize(indexers[featureId].CalcSize(depth));
+                featureBlockStats[featureId] = GetDataPtr(blockStats[featureId]);
+            }
+        }
+        CalcFloatFeaturesScoreImpl(/*isCaching*/ std::false_type(), af, fold, initialFold, isPlainMode, l2Regularizer,
+            splits, indexers, featureStats, featureBlockStats, splitStatsCounts, allFeatureIds, depth, &scoreBins);
+        return scoreBins;
+    }
+
+    // stats are cached between tree levels, cache is kept in double precision
+    TVector<TBucketStats*> featureStats(featureCount);
+    TVector<int> cachedSplitStatsCounts(featureCount);
+    TVector<int> nonCachingFeatureIds;
+    TVector<int> cachingFeatureIds;
+    for (int featureId = 0; featureId < featureCount; ++featureId) {
+        const int splitStatsCount = indexers[featureId].CalcSize(treeOptions.MaxDepth);
+        const int statsCount = fold.GetBodyTailCount() * fold.GetApproxDimension() * splitStatsCount;
+        bool areStatsDirty;
+        TVector<TBucketStats, TPoolAllocator>& splitStats = statsFromPrevTree->GetStats(splits[featureId], statsCount, &areStatsDirty); // thread-safe access
+        featureStats[featureId] = GetDataPtr(splitStats);
+        cachedSplitStatsCounts[featureId] = splitStatsCount;
+        if (depth == 0 || areStatsDirty) {
+            nonCachingFeatureIds.push_back(featureId);
+        } else {
+            cachingFeatureIds.push_back(featureId);
+        }
+    }
+    if (!nonCachingFeatureIds.empty()) {
+        CalcFloatFeaturesScoreImpl(/*isCaching*/ std::false_type(), af, fold, initialFold, isPlainMode, l2Regularizer,
+            splits, indexers, featureStats, /*featureBlockStats*/ {}, cachedSplitStatsCounts, nonCachingFeatureIds, depth, &scoreBins);
+    }
+    if (!cachingFeatureIds.empty()) {
+        CalcFloatFeaturesScoreImpl(/*isCaching*/ std::true_type(), af, prevLevelData, initialFold, isPlainMode, l2Regularizer,
+            splits, indexers, featureStats, /*featureBlockStats*/ {}, cachedSplitStatsCounts, cachingFeatureIds, depth, &scoreBins);
+    }
+    return scoreBins;
+}
@@ -64,6 +64,24 @@ TVector<TScoreBin> CalcScore(
     int depth,
     TBucketStatsCache* statsFromPrevTree);
 
+// Float feature candidates are scored by groups of this size in one pass over documents.
+constexpr int FLOAT_FEATURES_PER_HISTOGRAM_PASS = 16;
+
+// Same as CalcScore for a group of float feature split candidates.
+// Bucket statistics of all features in the group are accumulated in one pass over documents,
+// so leaf indices and derivatives are read once per group instead of once per feature.
+// Pairwise scoring is not supported.
+TVector<TVector<TScoreBin>> CalcScoresForFloatFeatures(
+    const TAllFeatures& af,
+    const TVector<int>& splitsCount,
+    const TCalcScoreFold& fold,
+    const TCalcScoreFold& prevLevelData,
+    const TFold& initialFold,
+    const NCatboostOptions::TCatBoostOptions& fitParams,
+    TConstArrayRef<TSplitCandidate> splits,
+    int depth,
+    TBucketStatsCache* statsFromPrevTree);
+
 // Statistics (sums for score calculation) are stored in an array. This class helps navigating in this array.
 struct TStatsIndexer {
     const int BucketCount;
@@ -87,10 +105,11 @@ inline const TOnlineCTR& GetCtr(const std::tuple<const TOnlineCTRHash&, const TO
 
 // Helper function for calculating index of leaf for each document given a new split.
 // Calculates indices when a permutation is given.
-template<typename TBucketIndexType, typename TFullIndexType>
+// TBucketIndex is any random access container of bucket indices, e.g. TVector or TPackedBins.
+template<typename TBucketIndex, typename TFullIndexType>
 inline void SetSingleIndex(const TCalcScoreFold& fold,
                            const TStatsIndexer& indexer,
-                           const TVector<TBucketIndexType>& bucketIndex,
+                           const TBucketIndex& bucketIndex,
                            const size_t* docPermutation,
                            TVector<TFullIndexType>* singleIdx) {
     const size_t docCount = fold.GetDocCount();
@@ -135,10 +154,11 @@ inline void BuildSingleIndex(const TCalcScoreFold& fold,
     if (split.Type == ESplitType::OnlineCtr) {
         const TCtr& ctr = split.Ctr;
         const size_t* docSubset = GetDataPtr(fold.IndexInFold);
-        SetSingleIndex(fold, indexer, GetCtr(allCtrs, ctr.Projection).Feature[ctr.CtrIdx][ctr.TargetBorderIdx][ctr.PriorIdx], docSubset, singleIdx);
+        SetSingleIndex(fold, indexer, GetCtr(allCtrs, ctr.Projection).GetCtrBins(ctr.CtrIdx, ctr.TargetBorderIdx, ctr.PriorIdx), docSubset, singleIdx);
     } else if (split.Type == ESplitType::FloatFeature) {
         const size_t* learnPermutation = GetDataPtr(fold.LearnPermutation);
-        SetSingleIndex(fold, indexer, af.FloatHistograms[split.FeatureIdx], learnPermutation, singleIdx);
+        TVector<ui8> sparseBuffer;
+        SetSingleIndex(fold, indexer, af.GetFloatFeatureBins(split.FeatureIdx, &sparseBuffer), learnPermutation, singleIdx);
     } else {
         Y_ASSERT(split.Type == ESplitType::OneHotFeature);
         const size_t* learnPermutation = GetDataPtr(fold.LearnPermutation);
@@ -147,33 +167,62 @@ inline void BuildSingleIndex(const TCalcScoreFold& fold,
 }
 
 // Update bootstraped sums on [docBegin, docEnd) in a bucket
-template<typename TFullIndexType>
-inline void UpdateWeighted(const TVector<TFullIndexType>& singleIdx, const double* weightedDer, const float* sampleWeights, int docBegin, int docEnd, TBucketStats* stats) {
+template<typename TFullIndexType, typename TStats>
+inline void UpdateWeighted(const TVector<TFullIndexType>& singleIdx, const double* weightedDer, const float* sampleWeights, int docBegin, int docEnd, TStats* stats) {
     for (int doc = docBegin; doc < docEnd; ++doc) {
-        TBucketStats& leafStats = stats[singleIdx[doc]];
+        TStats& leafStats = stats[singleIdx[doc]];
         leafStats.SumWeightedDelta += weightedDer[doc];
         leafStats.SumWeight += sampleWeights[doc];
     }
 }
 
 // Update not bootstraped sums on [docBegin, docEnd) in a bucket
-template<typename TFullIndexType>
-inline void UpdateDeltaCount(const TVector<TFullIndexType>& singleIdx, const double* derivatives, const float* learnWeights, int docCount, TBucketStats* stats) {
+template<typename TFullIndexType, typename TStats>
+inline void UpdateDeltaCount(const TVector<TFullIndexType>& singleIdx, const double* derivatives, const float* learnWeights, int docBegin, int docEnd, TStats* stats) {
     if (learnWeights == nullptr) {
-        for (int doc = 0; doc < docCount; ++doc) {
-            TBucketStats& leafStats = stats[singleIdx[doc]];
+        for (int doc = docBegin; doc < docEnd; ++doc) {
+            TStats& leafStats = stats[singleIdx[doc]];
             leafStats.SumDelta += derivatives[doc];
             leafStats.Count += 1;
         }
     } else {
-        for (int doc = 0; doc < docCount; ++doc) {
-            TBucketStats& leafStats = stats[singleIdx[doc]];
+        for (int doc = docBegin; doc < docEnd; ++doc) {
+            TStats& leafStats = stats[singleIdx[doc]];
             leafStats.SumDelta += derivatives[doc];
             leafStats.Count += learnWeights[doc];
         }
     }
 }
 
+// With single_precision_score_stats documents are accumulated in float stats by blocks and every block is added
+// to double stats, so float counts stay exact and float rounding errors don't grow with document count.
+// Block is not smaller than stats count, otherwise adding blocks would cost more than accumulating them.
+constexpr int SINGLE_PRECISION_STATS_MIN_BLOCK_SIZE = 1 << 12;
+constexpr int SINGLE_PRECISION_STATS_MAX_BLOCK_SIZE = 1 << 20;
+
+inline int GetSinglePrecisionStatsBlockSize(int statsCount) {
+    return Min(Max(SINGLE_PRECISION_STATS_MIN_BLOCK_SIZE, statsCount), SINGLE_PRECISION_STATS_MAX_BLOCK_SIZE);
+}
+
+// Add block stats to stats and clear block stats
+inline void FlushSinglePrecisionStats(int statsCount, TBucketStatsSingle* blockStats, TBucketStats* stats) {
+    for (int statIdx = 0; statIdx < statsCount; ++statIdx) {
+        stats[statIdx].Add(blockStats[statIdx]);
+        blockStats[statIdx] = TBucketStatsSingle{0, 0, 0, 0};
+    }
+}
+
+// Calls updateStats(blockBegin, blockEnd, blockStats) for document blocks of [docBegin, docEnd) and adds blockStats to stats
+template<typename TUpdateStats>
+inline void UpdateStatsBySinglePrecisionBlocks(int docBegin, int docEnd, int statsCount, TBucketStatsSingle* blockStats, TBucketStats* stats, TUpdateStats&& updateStats) {
+    Fill(blockStats, blockStats + statsCount, TBucketStatsSingle{0, 0, 0, 0});
+    const int blockSize = GetSinglePrecisionStatsBlockSize(statsCount);
+    for (int blockBegin = docBegin; blockBegin < docEnd; blockBegin += blockSize) {
+        updateStats(blockBegin, Min(docEnd, blockBegin + blockSize), blockStats);
+        FlushSinglePrecisionStats(statsCount, blockStats, stats);
+    }
+}
+
 // Calculate score numerator summand
 inline double CountDp(double avrg, const TBucketStats& leafStats) {
     return avrg * leafStats.SumWeightedDelta;
@@ -185,9 +234,10 @@ inline double CountD2(double avrg, const TBucketStats& leafStats) {
 }
 
 // This function calculates resulting sums for each split given statistics that are calculated for each bucket of the histogram.
-template<typename TIsPlainMode>
+// Sums over buckets are always accumulated in double.
+template<typename TIsPlainMode, typename TStats>
 inline void UpdateScoreBin(
-    const TBucketStats* stats,
+    const TStats* stats,
     int leafCount,
     const TStatsIndexer& indexer,
     ESplitType splitType,
@@ -200,8 +250,7 @@ inline void UpdateScoreBin(
     for (int leaf = 0; leaf < leafCount; ++leaf) {
         TBucketStats allStats{0, 0, 0, 0};
         for (int bucket = 0; bucket < indexer.BucketCount; ++bucket) {
-            const TBucketStats& leafStats = stats[indexer.GetIndex(leaf, bucket)];
-            allStats.Add(leafStats);
+            allStats.Add(stats[indexer.GetIndex(leaf, bucket)]);
         }
         TBucketStats trueStats{0, 0, 0, 0};
         TBucketStats falseStats{0, 0, 0, 0};
@@ -229,7 +278,8 @@ inline void UpdateScoreBin(
                     falseStats.Add(stats[indexer.GetIndex(leaf, splitIdx - 1)]);
                 }
                 falseStats.Remove(stats[indexer.GetIndex(leaf, splitIdx)]);
-                trueStats = stats[indexer.GetIndex(leaf, splitIdx)];
+                trueStats = TBucketStats{0, 0, 0, 0};
+                trueStats.Add(stats[indexer.GetIndex(leaf, splitIdx)]);
                 double trueAvrg, falseAvrg;
                 if (isPlainMode) {
                     trueAvrg = CalcAverage(trueStats.SumWeightedDelta, trueStats.SumWeight, l2Regularizer, sumAllWeights, allDocCount);
@@ -250,7 +300,8 @@ int GetSplitCount(const TVector<int>& splitsCount,
                   const TVector<TVector<int>>& oneHotValues,
                   const TSplitCandidate& split);
 
-inline void FixUpStats(int depth, const TStatsIndexer& indexer, bool selectedSplitValue, TBucketStats* stats) {
+template<typename TStats>
+inline void FixUpStats(int depth, const TStatsIndexer& indexer, bool selectedSplitValue, TStats* stats) {
     const int halfOfStats = indexer.CalcSize(depth - 1);
     if (selectedSplitValue == true) {
         for (int statIdx = 0; statIdx < halfOfStats; ++statIdx) {
@@ -264,7 +315,7 @@ inline void FixUpStats(int depth, const TStatsIndexer& indexer, bool selectedSpl
     }
 }
 
-template<typename TFullIndexType, typename TIsCaching>
+template<typename TFullIndexType, typename TIsCaching, typename TStats>
 inline void CalcStatsKernel(const TIsCaching& isCaching,
                             const TVector<TFullIndexType>& singleIdx,
                             const TCalcScoreFold& fold,
@@ -273,12 +324,12 @@ inline void CalcStatsKernel(const TIsCaching& isCaching,
                             int depth,
                             const TCalcScoreFold::TBodyTail& bt,
                             int dim,
-                            TBucketStats* stats) {
+                            TStats* stats) {
     Y_ASSERT(!isCaching || depth > 0);
     if (isCaching) {
-        Fill(stats + indexer.CalcSize(depth - 1), stats + indexer.CalcSize(depth), TBucketStats{0, 0, 0, 0});
+        Fill(stats + indexer.CalcSize(depth - 1), stats + indexer.CalcSize(depth), TStats{0, 0, 0, 0});
     } else {
-        Fill(stats, stats + indexer.CalcSize(depth), TBucketStats{0, 0, 0, 0});
+        Fill(stats, stats + indexer.CalcSize(depth), TStats{0, 0, 0, 0});
     }
 
     const bool hasPairwiseWeights = !bt.PairwiseWeights.empty();
@@ -287,10 +338,90 @@ inline void CalcStatsKernel(const TIsCaching& isCaching,
     if (isPlainMode) {
         UpdateWeighted(singleIdx, GetDataPtr(bt.SampleWeightedDerivatives[dim]), sampleWeightsData, 0, bt.TailFinish, stats);
     } else {
-        UpdateDeltaCount(singleIdx, GetDataPtr(bt.WeightedDerivatives[dim]), weightsData, bt.BodyFinish, stats);
+        UpdateDeltaCount(singleIdx, GetDataPtr(bt.WeightedDerivatives[dim]), weightsData, 0, bt.BodyFinish, stats);
         UpdateWeighted(singleIdx, GetDataPtr(bt.SampleWeightedDerivatives[dim]), sampleWeightsData, bt.BodyFinish, bt.TailFinish, stats);
     }
     if (isCaching) {
         FixUpStats(depth, indexer, fold.SmallestSplitSideValue, stats);
     }
 }
+
+// Calculates plain mode stats of the sample from documents selected by TCalcScoreFold::SelectSampledOutSibling.
+// allDocsStats keep stats of all documents of the previous level and are updated to the current level:
+// documents of the smallest side are added to them as in CalcStatsKernel, and stats of the sample on the other side
+// are stats of all its documents minus stats of its sampled out documents.
+template<typename TFullIndexType>
+inline void CalcSampledOutSiblingStatsKernel(const TVector<TFullIndexType>& singleIdx,
+                                             const TCalcScoreFold& fold,
+                                             const TStatsIndexer& indexer,
+                                             int depth,
+                                             int dim,
+                                             TBucketStats* allDocsStats,
+                                             TBucketStats* sampleStats) {
+    const int statsCount = indexer.CalcSize(depth);
+    const int halfOfStats = depth == 0 ? 0 : indexer.CalcSize(depth - 1);
+    Fill(sampleStats, sampleStats + statsCount, TBucketStats{0, 0, 0, 0});
+    Fill(allDocsStats + halfOfStats, allDocsStats + statsCount, TBucketStats{0, 0, 0, 0});
+
+    const auto& bt = fold.BodyTailArr[0];
+    const double* weightedDerivativesData = GetDataPtr(bt.SampleWeightedDerivatives[dim]);
+    const float* sampleWeightsData = bt.PairwiseWeights.empty() ? GetDataPtr(fold.SampleWeights) : GetDataPtr(bt.SamplePairwiseWeights);
+    const bool* isSampledData = GetDataPtr(fold.IsSampled);
+    // all documents are on the smallest side on the first level
+    const bool smallestSplitSideValue = depth == 0 || fold.SmallestSplitSideValue;
+    for (int doc = 0; doc < bt.TailFinish; ++doc) {
+        const int statIdx = singleIdx[doc];
+        const bool splitValue = statIdx >= halfOfStats;
+        if (splitValue == smallestSplitSideValue) {
+            TBucketStats& docStats = allDocsStats[splitValue ? statIdx : statIdx + halfOfStats];
+            docStats.SumWeightedDelta += weightedDerivativesData[doc];
+            docStats.SumWeight += sampleWeightsData[doc];
+            if (isSampledData[doc]) {
+                sampleStats[statIdx].SumWeightedDelta += weightedDerivativesData[doc];
+                sampleStats[statIdx].SumWeight += sampleWeightsData[doc];
+            }
+        } else {
+            sampleStats[statIdx].SumWeightedDelta -= weightedDerivativesData[doc];
+            sampleStats[statIdx].SumWeight -= sampleWeightsData[doc];
+        }
+    }
+    if (depth > 0) {
+        FixUpStats(depth, indexer, fold.SmallestSplitSideValue, allDocsStats);
+        const int largestSideOffset = fold.SmallestSplitSideValue ? 0 : halfOfStats;
+        for (int statIdx = largestSideOffset; statIdx < largestSideOffset + halfOfStats; ++statIdx) {
+            sampleStats[statIdx].Add(allDocsStats[statIdx]);
+        }
+    }
+}
+
+// Same as CalcStatsKernel without caching, but documents are accumulated in blockStats by blocks, see UpdateStatsBySinglePrecisionBlocks
+template<typename TFullIndexType>
+inline void CalcStatsKernelSinglePrecision(const TVector<TFullIndexType>& singleIdx,
+                                           const TCalcScoreFold& fold,
+                                           bool isPlainMode,
+                                           const TStatsIndexer& indexer,
+                                           int depth,
+                                           const TCalcScoreFold::TBodyTail& bt,
+                                           int dim,
+                                           TBucketStatsSingle* blockStats,
+                                           TBucketStats* stats) {
+    const int statsCount = indexer.CalcSize(depth);
+    Fill(stats, stats + statsCount, TBucketStats{0, 0, 0, 0});
+
+    const bool hasPairwiseWeights = !bt.PairwiseWeights.empty();
+    const float* weightsData = hasPairwiseWeights ? GetDataPtr(bt.PairwiseWeights) : GetDataPtr(fold.LearnWeights);
+    const float* sampleWeightsData = hasPairwiseWeights ? GetDataPtr(bt.SamplePairwiseWeights) : GetDataPtr(fold.SampleWeights);
+    const double* sampleWeightedDerivativesData = GetDataPtr(bt.SampleWeightedDerivatives[dim]);
+    const auto updateWeighted = [&](int blockBegin, int blockEnd, TBucketStatsSingle* blockStatsData) {
+        UpdateWeighted(singleIdx, sampleWeightedDerivativesData, sampleWeightsData, blockBegin, blockEnd, blockStatsData);
+    };
+    if (isPlainMode) {
+        UpdateStatsBySinglePrecisionBlocks(0, bt.TailFinish, statsCount, blockStats, stats, updateWeighted);
+    } else {
+        const double* weightedDerivativesData = GetDataPtr(bt.WeightedDerivatives[dim]);
+        UpdateStatsBySinglePrecisionBlocks(0, bt.BodyFinish, statsCount, blockStats, stats, [&](int blockBegin, int blockEnd, TBucketStatsSingle* blockStatsData) {
+            UpdateDeltaCount(singleIdx, weightedDerivativesData, weightsData, blockBegin, blockEnd, blockStatsData);
+        });
+        UpdateStatsBySinglePrecisionBlocks(bt.BodyFinish, bt.TailFinish, statsCount, blockStats, stats, updateWeighted);
+    }
+}
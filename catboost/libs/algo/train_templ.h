@@ -3,6 +3,7 @@
 #include "approx_calcer.h"
 #include "fold.h"
 #include "greedy_tensor_search.h"
+#include "index_calcer.h"
 #include "online_ctr.h"
 #include "tensor_search_helpers.h"
 
@@ -11,21 +12,18 @@
 #include <catboost/libs/helpers/interrupt.h>
 #include <catboost/libs/logging/profile_info.h>
 
-struct TCompetitor;
+#include <util/generic/algorithm.h>
 
-static void NormalizeLeafValues(const TVector<TIndexType>& indices, int learnSampleCount, TVector<TVector<double>>* treeValues) {
-    TVector<int> weights((*treeValues)[0].ysize());
-    for (int docIdx = 0; docIdx < learnSampleCount; ++docIdx) {
-        ++weights[indices[docIdx]];
-    }
+struct TCompetitor;
 
+static void NormalizeLeafValues(const TVector<int>& leafDocCounts, TVector<TVector<double>>* treeValues) {
     double avrg = 0;
-    for (int i = 0; i < weights.ysize(); ++i) {
-        avrg += weights[i] * (*treeValues)[0][i];
+    for (int i = 0; i < leafDocCounts.ysize(); ++i) {
+        avrg += leafDocCounts[i] * (*treeValues)[0][i];
     }
 
     int sumWeight = 0;
-    for (int w : weights) {
+    for (int w : leafDocCounts) {
         sumWeight += w;
     }
     avrg /= sumWeight;
@@ -35,6 +33,14 @@ static void NormalizeLeafValues(const TVector<TIndexType>& indices, int learnSam
     }
 }
 
+static void NormalizeLeafValues(const TVector<TIndexType>& indices, int learnSampleCount, TVector<TVector<double>>* treeValues) {
+    TVector<int> weights((*treeValues)[0].ysize());
+    for (int docIdx = 0; docIdx < learnSampleCount; ++docIdx) {
+        ++weights[indices[docIdx]];
+    }
+    NormalizeLeafValues(weights, treeValues);
+}
+
 template <typename TError>
 void UpdateLearningFold(
     const TDataset& learnData,
@@ -152,6 +158,67 @@ void UpdateAveragingFold(
     }
 }
 
+// Workers update approxes of their learn documents, master, which may hold a sample of learn documents only,
+// gets leaf values over all of them and updates approxes of test documents, see MapLoadPlainFold
+template <typename TError>
+void UpdateDistributedAveragingFold(
+    const TDatasetPtrs& testDataPtrs,
+    const TSplitTree& bestSplitTree,
+    TLearnContext* ctx,
+    TVector<TVector<double>>* treeValues
+) {
+    TProfileInfo& profile = ctx->Profile;
+    NCatboostDistributed::TLeafStats leafStats;
+    MapSetApproxes<TError>(bestSplitTree, treeValues, &leafStats, ctx);
+    profile.AddOperation("CalcApprox tree struct and update tree structure approx");
+    CheckInterrupted(); // check after long-lasting operation
+
+    ctx->LearnProgress.TreeStats.emplace_back().LeafWeightsSum = leafStats.SumWeights;
+    if (IsPairwiseError(ctx->Params.LossFunctionDescription->GetLossFunction())) {
+        NormalizeLeafValues(leafStats.DocCounts, treeValues);
+    }
+    Y_ASSERT(treeValues->ysize() == 1);
+    const double learningRate = ctx->Params.BoostingOptions->LearningRate;
+    for (auto& leafVal : (*treeValues)[0]) {
+        leafVal *= learningRate;
+    }
+    if (testDataPtrs.empty()) {
+        return;
+    }
+
+    TFold& averagingFold = ctx->LearnProgress.AveragingFold;
+    TVector<TProjection> ctrProjections;
+    for (const auto& split : bestSplitTree.Splits) {
+        if (split.Type != ESplitType::OnlineCtr) {
+            continue;
+        }
+        const auto& proj = split.Ctr.Projection;
+        averagingFold.MarkCtrUsed(proj);
+        if (averagingFold.GetCtr(proj).Feature.empty() && !IsIn(ctrProjections, proj)) {
+            ctrProjections.push_back(proj);
+        }
+    }
+    MapCalcTestOnlineCtrs(testDataPtrs, ctrProjections, &averagingFold, ctx);
+    profile.AddOperation("Calc online ctrs of test documents");
+
+    const TVector<TIndexType> testIndices = BuildTestIndices(averagingFold, bestSplitTree, testDataPtrs, &ctx->LocalExecutor);
+    const double* treeValuesData = (*treeValues)[0].data();
+    size_t testOffset = 0;
+    for (int testIdx = 0; testIdx < testDataPtrs.ysize(); ++testIdx) {
+        double* testApproxData = ctx->LearnProgress.TestApprox[testIdx][0].data();
+        const TIndexType* indicesData = testIndices.data() + testOffset;
+        const size_t testSampleCount = testDataPtrs[testIdx]->GetSampleCount();
+        ctx->LocalExecutor.ExecRange(
+            [&](size_t docIdx){
+                testApproxData[docIdx] += treeValuesData[indicesData[docIdx]];
+            },
+            NPar::TLocalExecutor::TExecRangeParams(0, testSampleCount).SetBlockSize(1000),
+            NPar::TLocalExecutor::WAIT_COMPLETE
+        );
+        testOffset += testSampleCount;
+    }
+}
+
 template <typename TError>
 void TrainOneIter(const TDataset& learnData, const TDatasetPtrs& testDataPtrs, TLearnContext* ctx) {
     TError error = BuildError<TError>(ctx->Params, ctx->ObjectiveDescriptor);
@@ -201,8 +268,19 @@ void TrainOneIter(const TDataset& learnData, const TDatasetPtrs& testDataPtrs, T
             trainFolds.push_back(&ctx->LearnProgress.Folds[foldId]);
         }
 
-        TrimOnlineCTRcache(trainFolds);
-        TrimOnlineCTRcache({ &ctx->LearnProgress.AveragingFold });
+        TrimOnlineCTRcache(*ctx, trainFolds);
+        TrimOnlineCTRcache(*ctx, { &ctx->LearnProgress.AveragingFold });
+        if (!ctx->Params.SystemOptions->IsSingleHost()) {
+            TVector<TVector<double>> treeValues; // [dim][leafId]
+            UpdateDistributedAveragingFold<TError>(testDataPtrs, bestSplitTree, ctx, &treeValues);
+
+            ctx->LearnProgress.LeafValues.push_back(treeValues);
+            ctx->LearnProgress.TreeStruct.push_back(bestSplitTree);
+
+            profile.AddOperation("Update final approxes");
+            CheckInterrupted(); // check after long-lasting operation
+            return;
+        }
         {
             TVector<TFold*> allFolds = trainFolds;
             allFolds.push_back(&ctx->LearnProgress.AveragingFold);
@@ -214,12 +292,14 @@ void TrainOneIter(const TDataset& learnData, const TDatasetPtrs& testDataPtrs, T
                 TFold* Fold;
                 TOnlineCTR* Ctr;
                 void DoTask(TLearnContext* ctx) {
-                    ComputeOnlineCTRs(*LearnData, TestDatas, *Fold, Projection, ctx, Ctr);
+                    ComputeOnlineCTRs(*LearnData, TestDatas, *Fold, Projection, ctx, &ctx->LocalExecutor, Ctr);
                 }
             };
 
             TVector<TLocalJobData> parallelJobsData;
             THashSet<TProjection> seenProjections;
+            int ctrCacheHitCount = 0;
+            int ctrCacheMissCount = 0;
             for (const auto& split : bestSplitTree.Splits) {
                 if (split.Type != ESplitType::OnlineCtr) {
                     continue;
@@ -230,8 +310,12 @@ void TrainOneIter(const TDataset& learnData, const TDatasetPtrs& testDataPtrs, T
                     continue;
                 }
                 for (auto* foldPtr : allFolds) {
-                    if (!foldPtr->GetCtrs(proj).has(proj) || foldPtr->GetCtr(proj).Feature.empty()) {
+                    foldPtr->MarkCtrUsed(proj);
+                    if (foldPtr->GetCtr(proj).Feature.empty()) {
                         parallelJobsData.emplace_back(TLocalJobData{ &learnData, testDataPtrs, proj, foldPtr, &foldPtr->GetCtrRef(proj) });
+                        ++ctrCacheMissCount;
+                    } else {
+                        ++ctrCacheHitCount;
                     }
                 }
                 seenProjections.insert(proj);
@@ -240,19 +324,16 @@ void TrainOneIter(const TDataset& learnData, const TDatasetPtrs& testDataPtrs, T
             ctx->LocalExecutor.ExecRange([&](int taskId){
                 parallelJobsData[taskId].DoTask(ctx);
             }, 0, parallelJobsData.size(), NPar::TLocalExecutor::WAIT_COMPLETE);
-
+            profile.AddCounter("Online CTR cache hits", ctrCacheHitCount);
+            profile.AddCounter("Online CTR cache misses", ctrCacheMissCount);
         }
         profile.AddOperation("ComputeOnlineCTRs for tree struct (train folds and test fold)");
         CheckInterrupted(); // check after long-lasting operation
 
-        if (ctx->Params.SystemOptions->IsSingleHost()) {
-            const TVector<ui64> randomSeeds = GenRandUI64Vector(foldCount, ctx->Rand.GenRand());
-            ctx->LocalExecutor.ExecRange([&](int foldId) {
-                UpdateLearningFold(learnData, testDataPtrs, error, bestSplitTree, randomSeeds[foldId], trainFolds[foldId], ctx);
-            }, 0, foldCount, NPar::TLocalExecutor::WAIT_COMPLETE);
-        } else {
-            MapSetApproxes<TError>(bestSplitTree, ctx);
-        }
+        const TVector<ui64> randomSeeds = GenRandUI64Vector(foldCount, ctx->Rand.GenRand());
+        ctx->LocalExecutor.ExecRange([&](int foldId) {
+            UpdateLearningFold(learnData, testDataPtrs, error, bestSplitTree, randomSeeds[foldId], trainFolds[foldId], ctx);
+        }, 0, foldCount, NPar::TLocalExecutor::WAIT_COMPLETE);
 
         profile.AddOperation("CalcApprox tree struct and update tree structure approx");
         CheckInterrupted(); // check after long-lasting operation
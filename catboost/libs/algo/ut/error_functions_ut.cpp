@@ -0,0 +1,153 @@
+#include <catboost/libs/algo/error_functions.h>
+#include <catboost/libs/helpers/eval_helpers.h>
+
+#include <library/unittest/registar.h>
+
+#include <util/generic/vector.h>
+#include <util/generic/ymath.h>
+#include <util/random/fast.h>
+
+#include <cmath>
+#include <limits>
+
+static const double DerivativesTolerance = 1e-12;
+
+// Range kernel of TError against the generic IDerCalcer per document loop on the same data
+template <typename TError>
+static void CheckRangeKernels(const TError& error) {
+    using TGenericDerCalcer = IDerCalcer<TError, TError::StoreExpApprox>;
+    const int docCount = 1003; // not a multiple of vector width
+    const int start = 5;
+    const int count = docCount - 2 * start;
+    TReallyFastRng32 rng(3);
+    TVector<double> approxes(docCount);
+    TVector<double> approxDeltas(docCount);
+    TVector<float> targets(docCount);
+    TVector<float> weights(docCount);
+    for (int doc = 0; doc < docCount; ++doc) {
+        approxes[doc] = 6 * rng.GenRandReal1() - 3;
+        approxDeltas[doc] = 0.2 * rng.GenRandReal1() - 0.1;
+        if (TError::StoreExpApprox) {
+            approxes[doc] = std::exp(approxes[doc]);
+            approxDeltas[doc] = std::exp(approxDeltas[doc]);
+        }
+        targets[doc] = rng.Uniform(4);
+        weights[doc] = rng.GenRandReal1();
+    }
+    for (const double* deltas : {(const double*)nullptr, (const double*)approxDeltas.data()}) {
+        for (const float* docWeights : {(const float*)nullptr, (const float*)weights.data()}) {
+            TVector<double> firstDers(docCount, 0);
+            TVector<double> expectedFirstDers(docCount, 0);
+            error.CalcFirstDerRange(start, count, approxes.data(), deltas, targets.data(), docWeights, firstDers.data());
+            error.TGenericDerCalcer::CalcFirstDerRange(start, count, approxes.data(), deltas, targets.data(), docWeights, expectedFirstDers.data());
+            for (int doc = 0; doc < docCount; ++doc) {
+                UNIT_ASSERT_DOUBLES_EQUAL(firstDers[doc], expectedFirstDers[doc], DerivativesTolerance);
+            }
+            for (bool calcThirdDer : {false, true}) {
+                TVector<TDers> ders(docCount, TDers{0, 0, 0});
+                TVector<TDers> expectedDers(docCount, TDers{0, 0, 0});
+                error.CalcDersRange(start, count, calcThirdDer, approxes.data(), deltas, targets.data(), docWeights, ders.data());
+                error.TGenericDerCalcer::CalcDersRange(start, count, calcThirdDer, approxes.data(), deltas, targets.data(), docWeights, expectedDers.data());
+                for (int doc = 0; doc < docCount; ++doc) {
+                    UNIT_ASSERT_DOUBLES_EQUAL(ders[doc].Der1, expectedDers[doc].Der1, DerivativesTolerance);
+                    UNIT_ASSERT_DOUBLES_EQUAL(ders[doc].Der2, expectedDers[doc].Der2, DerivativesTolerance);
+                    if (calcThirdDer) {
+                        UNIT_ASSERT_DOUBLES_EQUAL(ders[doc].Der3, expectedDers[doc].Der3, DerivativesTolerance);
+                    }
+                }
+            }
+        }
+    }
+}
+
+Y_UNIT_TEST_SUITE(TErrorFunctionsTest) {
+    Y_UNIT_TEST(TestRangeKernelsEqualGenericLoop) {
+        CheckRangeKernels(TRMSEError(/*storeExpApprox*/ false));
+        TQuantileError quantileError(/*storeExpApprox*/ false);
+        quantileError.Alpha = 0.3;
+        CheckRangeKernels(quantileError);
+        CheckRangeKernels(TPoissonError(/*storeExpApprox*/ true));
+    }
+
+    Y_UNIT_TEST(TestMultiClassDersWithFastExpEqualLibmExp) {
+        const int classCount = 7;
+        TReallyFastRng32 rng(5);
+        const TMultiClassError error(/*storeExpApprox*/ false);
+        TVector<double> approx(classCount);
+        TVector<double> der(classCount);
+        TArray2D<double> der2(classCount, classCount);
+        TVector<double> softmax(classCount);
+        for (int doc = 0; doc < 1000; ++doc) {
+            // wide range, so that some exponents underflow
+            for (auto& value : approx) {
+                value = (doc % 2 == 0 ? 20 : 1000) * (rng.GenRandReal1() - 0.5);
+            }
+            const int target = rng.Uniform(classCount);
+            const float weight = doc % 3 == 0 ? 1.0f : rng.GenRandReal1();
+            error.CalcDersMulti(approx, target, weight, &der, &der2);
+            CalcSoftmax(approx, &softmax);
+            for (int dimY = 0; dimY < classCount; ++dimY) {
+                const double expectedDer = weight * ((dimY == target ? 1 : 0) - softmax[dimY]);
+                UNIT_ASSERT_DOUBLES_EQUAL(der[dimY], expectedDer, DerivativesTolerance);
+                for (int dimX = 0; dimX < classCount; ++dimX) {
+                    const double expectedDer2 = weight * (softmax[dimY] * softmax[dimX] - (dimX == dimY ? softmax[dimY] : 0));
+                    UNIT_ASSERT_DOUBLES_EQUAL(der2[dimY][dimX], expectedDer2, DerivativesTolerance);
+                }
+            }
+        }
+    }
+
+    Y_UNIT_TEST(TestQuerySoftMaxDersWithFastExpEqualLibmExp) {
+        const double lambdaReg = 0.01;
+        const TQuerySoftMaxError error(lambdaReg, /*storeExpApprox*/ false);
+        TReallyFastRng32 rng(7);
+        TVector<TQueryInfo> queriesInfo;
+        TVector<double> approxes;
+        TVector<float> targets;
+        TVector<float> weights;
+        for (int queryIdx = 0; queryIdx < 50; ++queryIdx) {
+            // queries of different sizes reuse one exponents buffer
+            const int querySize = 1 + rng.Uniform(queryIdx % 2 == 0 ? 5 : 100);
+            queriesInfo.emplace_back(approxes.ysize(), approxes.ysize() + querySize);
+            for (int doc = 0; doc < querySize; ++doc) {
+                approxes.push_back((queryIdx % 3 == 0 ? 1000 : 10) * (rng.GenRandReal1() - 0.5));
+                targets.push_back(rng.GenRandReal1() < 0.3 ? 1.0f : 0.0f);
+                weights.push_back(rng.GenRandReal1() < 0.1 ? 0.0f : rng.GenRandReal1());
+            }
+        }
+        for (const TVector<float>& docWeights : {TVector<float>(), weights}) {
+            TVector<TDers> ders(approxes.size());
+            error.CalcDersForQueries(0, queriesInfo.ysize(), approxes, targets, docWeights, queriesInfo, &ders);
+            for (const auto& queryInfo : queriesInfo) {
+                auto getWeight = [&] (int doc) {
+                    return docWeights.empty() ? 1.0 : docWeights[doc];
+                };
+                double maxApprox = -std::numeric_limits<double>::max();
+                double sumWeightedTargets = 0;
+                for (int doc = queryInfo.Begin; doc < queryInfo.End; ++doc) {
+                    if (getWeight(doc) > 0) {
+                        maxApprox = Max(maxApprox, approxes[doc]);
+                        sumWeightedTargets += getWeight(doc) * targets[doc];
+                    }
+                }
+                double sumExpApprox = 0;
+                for (int doc = queryInfo.Begin; doc < queryInfo.End; ++doc) {
+                    if (getWeight(doc) > 0) {
+                        sumExpApprox += getWeight(doc) * std::exp(approxes[doc] - maxApprox);
+                    }
+                }
+                for (int doc = queryInfo.Begin; doc < queryInfo.End; ++doc) {
+                    double expectedDer1 = 0;
+                    double expectedDer2 = 0;
+                    if (sumWeightedTargets > 0 && getWeight(doc) > 0) {
+                        const double p = getWeight(doc) * std::exp(approxes[doc] - maxApprox) / sumExpApprox;
+                        expectedDer1 = getWeight(doc) * targets[doc] - sumWeightedTargets * p;
+                        expectedDer2 = sumWeightedTargets * (p * (p - 1.0) - lambdaReg);
+                    }
+                    UNIT_ASSERT_DOUBLES_EQUAL(ders[doc].Der1, expectedDer1, DerivativesTolerance * Max(1.0, sumWeightedTargets));
+                    UNIT_ASSERT_DOUBLES_EQUAL(ders[doc].Der2, expectedDer2, DerivativesTolerance * Max(1.0, sumWeightedTargets));
+                }
+            }
+        }
+    }
+}
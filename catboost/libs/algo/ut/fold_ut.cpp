@@ -0,0 +1,73 @@
+#include <catboost/libs/algo/fold.h>
+
+#include <library/unittest/registar.h>
+
+#include <util/generic/vector.h>
+
+static TProjection MakeCatFeaturesProjection(const TVector<int>& catFeatures) {
+    TProjection proj;
+    proj.CatFeatures = catFeatures;
+    return proj;
+}
+
+static void AddOnlineCtr(const TProjection& proj, size_t binCount, TFold* fold) {
+    TOnlineCTR& ctr = fold->GetCtrRef(proj);
+    ctr.Feature.resize(1);
+    ctr.ArePriorsPacked.assign(1, false);
+    ctr.Feature[0].SetSizes(1, 1);
+    ctr.Feature[0][0][0].resize(binCount);
+}
+
+Y_UNIT_TEST_SUITE(TFoldTest) {
+    Y_UNIT_TEST(TestTrimOnlineCtrEvictsLeastRecentlyUsed) {
+        TFold fold;
+        TVector<TProjection> projections;
+        for (int featureIdx = 0; featureIdx < 5; ++featureIdx) {
+            projections.push_back(MakeCatFeaturesProjection({featureIdx, featureIdx + 1}));
+            AddOnlineCtr(projections.back(), /*binCount*/ 100, &fold);
+        }
+        const TProjection singleFeatureProjection = MakeCatFeaturesProjection({10});
+        AddOnlineCtr(singleFeatureProjection, /*binCount*/ 1000, &fold);
+        const size_t ctrMemory = fold.GetCtr(projections[0]).GetMemoryUsage();
+        UNIT_ASSERT(ctrMemory > 0);
+
+        for (int projIdx : {0, 1, 2, 3, 4, 1, 0}) {
+            fold.MarkCtrUsed(projections[projIdx]);
+        }
+        fold.MarkCtrUsed(singleFeatureProjection);
+        // from the least recently used: 2, 3, 4, 1, 0
+        auto isCached = [&] (int projIdx) {
+            return fold.GetCtrs(projections[projIdx]).has(projections[projIdx]);
+        };
+
+        fold.TrimOnlineCTR(/*maxOnlineCTRFeatures*/ 5, /*maxOnlineCTRMemory*/ 5 * ctrMemory);
+        for (int projIdx = 0; projIdx < projections.ysize(); ++projIdx) {
+            UNIT_ASSERT(isCached(projIdx));
+        }
+
+        // count limit
+        fold.TrimOnlineCTR(/*maxOnlineCTRFeatures*/ 4, /*maxOnlineCTRMemory*/ 5 * ctrMemory);
+        UNIT_ASSERT(!isCached(2));
+        for (int projIdx : {0, 1, 3, 4}) {
+            UNIT_ASSERT(isCached(projIdx));
+        }
+
+        // memory limit is stricter than count limit
+        fold.TrimOnlineCTR(/*maxOnlineCTRFeatures*/ 3, /*maxOnlineCTRMemory*/ 2 * ctrMemory);
+        UNIT_ASSERT(!isCached(3));
+        UNIT_ASSERT(!isCached(4));
+        UNIT_ASSERT(isCached(0));
+        UNIT_ASSERT(isCached(1));
+
+        // recently used ctr survives
+        fold.MarkCtrUsed(projections[1]);
+        fold.TrimOnlineCTR(/*maxOnlineCTRFeatures*/ 1, /*maxOnlineCTRMemory*/ 5 * ctrMemory);
+        UNIT_ASSERT(!isCached(0));
+        UNIT_ASSERT(isCached(1));
+
+        // ctrs of single features are not evicted and not counted
+        fold.TrimOnlineCTR(/*maxOnlineCTRFeatures*/ 0, /*maxOnlineCTRMemory*/ 0);
+        UNIT_ASSERT(!isCached(1));
+        UNIT_ASSERT(fold.GetCtrs(singleFeatureProjection).has(singleFeatureProjection));
+    }
+}
@@ -0,0 +1,134 @@
+#include <catboost/libs/algo/full_features.h>
+
+#include <library/unittest/registar.h>
+
+#include <util/random/fast.h>
+#include <util/generic/vector.h>
+
+static TVector<float> MakeUniformBorders(int borderCount) {
+    TVector<float> borders;
+    for (int borderIdx = 0; borderIdx < borderCount; ++borderIdx) {
+        borders.push_back((borderIdx + 1.0f) / (borderCount + 1));
+    }
+    return borders;
+}
+
+static ui8 GetExpectedBin(float value, const TVector<float>& borders) {
+    ui8 bin = 0;
+    while (bin < borders.size() && value > borders[bin]) {
+        ++bin;
+    }
+    return bin;
+}
+
+Y_UNIT_TEST_SUITE(TFullFeaturesTest) {
+    Y_UNIT_TEST(TestFloatFeaturesPacking) {
+        const size_t docCount = 1000;
+        const TVector<int> borderCounts = {1, 3, 10, 100, 1, 2, 15, 1};
+
+        TReallyFastRng32 rng(17);
+        TDocumentStorage docStorage;
+        docStorage.Resize(docCount, borderCounts.size(), /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+        TVector<TFloatFeature> floatFeatures;
+        for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+            floatFeatures.emplace_back(/*hasNans*/ false, featureIdx, featureIdx, MakeUniformBorders(borderCounts[featureIdx]));
+            for (size_t doc = 0; doc < docCount; ++doc) {
+                docStorage.Factors[featureIdx][doc] = rng.GenRandReal2();
+            }
+        }
+        const TDocumentStorage docStorageCopy = docStorage;
+
+        NPar::TLocalExecutor localExecutor;
+        localExecutor.RunAdditionalThreads(3);
+        TAllFeatures learnFeatures;
+        PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+            /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ true, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &learnFeatures);
+
+        UNIT_ASSERT_VALUES_EQUAL(learnFeatures.GetDocCount(), docCount);
+        UNIT_ASSERT(!learnFeatures.IsFloatFeaturePacked(3));
+        for (int featureIdx : {0, 1, 2, 4, 5, 6, 7}) {
+            UNIT_ASSERT(learnFeatures.IsFloatFeaturePacked(featureIdx));
+            UNIT_ASSERT(learnFeatures.FloatHistograms[featureIdx].empty());
+        }
+        // binary features share one byte, so do 2 bit and 4 bit ones
+        UNIT_ASSERT_VALUES_EQUAL(learnFeatures.PackedFloatHistograms.ysize(), 3);
+
+        TAllFeatures testFeatures;
+        PrepareAllFeaturesTest(/*categFeatures*/ {}, floatFeatures, learnFeatures, /*allowNansOnlyInTest*/ false,
+            ENanMode::Forbidden, /*clearPool*/ false, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &testFeatures);
+
+        for (const TAllFeatures* features : {&learnFeatures, &testFeatures}) {
+            for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+                UNIT_ASSERT(!features->IsFloatFeatureEmpty(featureIdx));
+                const TPackedBins bins = features->GetFloatFeatureBins(featureIdx);
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    UNIT_ASSERT_VALUES_EQUAL(bins[doc], GetExpectedBin(docStorageCopy.Factors[featureIdx][doc], floatFeatures[featureIdx].Borders));
+                }
+            }
+        }
+    }
+
+    Y_UNIT_TEST(TestSparseFloatFeatures) {
+        const size_t docCount = 1000;
+        const int valueCount = 20;
+        TVector<float> borders;
+        for (int value = 0; value + 1 < valueCount; ++value) {
+            borders.push_back(value + 0.5f);
+        }
+        const TVector<float> packableBorders = {0.5f, 1.5f, 2.5f};
+
+        TReallyFastRng32 rng(17);
+        TDocumentStorage docStorage;
+        docStorage.Resize(docCount, 3, /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            // features 0 and 2 are 2 in 97% of documents, feature 1 is dense
+            docStorage.Factors[0][doc] = rng.GenRandReal2() < 0.97 ? 2.0f : rng.Uniform(valueCount);
+            docStorage.Factors[1][doc] = rng.Uniform(valueCount);
+            docStorage.Factors[2][doc] = rng.GenRandReal2() < 0.97 ? 2.0f : rng.Uniform(4);
+        }
+        const TDocumentStorage docStorageCopy = docStorage;
+        const TVector<TFloatFeature> floatFeatures = {
+            TFloatFeature(/*hasNans*/ false, 0, 0, borders),
+            TFloatFeature(/*hasNans*/ false, 1, 1, borders),
+            TFloatFeature(/*hasNans*/ false, 2, 2, packableBorders)
+        };
+
+        NPar::TLocalExecutor localExecutor;
+        localExecutor.RunAdditionalThreads(3);
+        TAllFeatures learnFeatures;
+        PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+            /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ true, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &learnFeatures);
+
+        UNIT_ASSERT(learnFeatures.IsFloatFeatureSparse(0));
+        UNIT_ASSERT(!learnFeatures.IsFloatFeaturePacked(0));
+        UNIT_ASSERT(!learnFeatures.IsFloatFeatureSparse(1));
+        UNIT_ASSERT_VALUES_EQUAL(learnFeatures.SparseFloatFeatures[0].DefaultBin, 2);
+        UNIT_ASSERT(learnFeatures.SparseFloatFeatures[0].DocIndices.size() < docCount / 10);
+        // packed bins take less memory than sparse ones
+        UNIT_ASSERT(!learnFeatures.IsFloatFeatureSparse(2));
+        UNIT_ASSERT(learnFeatures.IsFloatFeaturePacked(2));
+
+        TAllFeatures testFeatures;
+        PrepareAllFeaturesTest(/*categFeatures*/ {}, floatFeatures, learnFeatures, /*allowNansOnlyInTest*/ false,
+            ENanMode::Forbidden, /*clearPool*/ false, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &testFeatures);
+        UNIT_ASSERT(testFeatures.IsFloatFeatureSparse(0));
+
+        for (const TAllFeatures* features : {&learnFeatures, &testFeatures}) {
+            UNIT_ASSERT_VALUES_EQUAL(features->GetDocCount(), docCount);
+            for (int featureIdx = 0; featureIdx < floatFeatures.ysize(); ++featureIdx) {
+                TVector<ui8> sparseBuffer;
+                const TPackedBins bins = features->GetFloatFeatureBins(featureIdx, &sparseBuffer);
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    UNIT_ASSERT_VALUES_EQUAL(bins[doc], GetExpectedBin(docStorageCopy.Factors[featureIdx][doc], floatFeatures[featureIdx].Borders));
+                }
+            }
+        }
+
+        // modes which don't score sparse features keep them dense
+        TAllFeatures denseLearnFeatures;
+        PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+            /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ false, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &denseLearnFeatures);
+        UNIT_ASSERT(!denseLearnFeatures.HasSparseFloatFeatures());
+        UNIT_ASSERT_VALUES_EQUAL(denseLearnFeatures.FloatHistograms[0].size(), docCount);
+    }
+}
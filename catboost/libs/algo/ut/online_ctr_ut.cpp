@@ -0,0 +1,95 @@
+#include <catboost/libs/algo/online_ctr.h>
+#include <catboost/libs/algo/ctr_helper.h>
+#include <catboost/libs/algo/fold.h>
+
+#include <library/threading/local_executor/local_executor.h>
+#include <library/unittest/registar.h>
+
+#include <util/generic/algorithm.h>
+#include <util/generic/vector.h>
+#include <util/random/fast.h>
+
+Y_UNIT_TEST_SUITE(TOnlineCtrTest) {
+    Y_UNIT_TEST(TestPackedPriorsEqualUnpackedPriors) {
+        const size_t docCount = 2000;
+        const size_t leafCount = 37;
+        const TVector<int> targetClassesCounts = {2, 3};
+
+        TReallyFastRng32 rng(11);
+        TFold fold;
+        fold.LearnPermutation.resize(docCount);
+        fold.TargetClassesCount = targetClassesCounts;
+        fold.LearnTargetClass.resize(targetClassesCounts.size());
+        TVector<ui64> leafIndices(docCount);
+        TVector<int> counterCTRTotal(leafCount, 0);
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            fold.LearnPermutation[doc] = doc;
+            for (int classifierIdx = 0; classifierIdx < targetClassesCounts.ysize(); ++classifierIdx) {
+                fold.LearnTargetClass[classifierIdx].push_back(rng.Uniform(targetClassesCounts[classifierIdx]));
+            }
+            leafIndices[doc] = rng.Uniform(leafCount);
+            ++counterCTRTotal[leafIndices[doc]];
+        }
+        const int counterCTRDenominator = *MaxElement(counterCTRTotal.begin(), counterCTRTotal.end());
+        TVector<TVector<int>> prefixClassCounts; // no preceding shards
+        for (int targetClassesCount : targetClassesCounts) {
+            prefixClassCounts.emplace_back(leafCount * targetClassesCount, 0);
+        }
+
+        // odd prior count leaves the high half of the last packed byte unused
+        const TVector<float> priors = {0.0f, 0.5f, 1.0f};
+        TVector<TCtrInfo> packedCtrInfo;
+        auto addCtrInfo = [&] (ECtrType type, ui32 targetClassifierIdx) {
+            TCtrInfo ctrInfo;
+            ctrInfo.Type = type;
+            ctrInfo.BorderCount = MAX_PACKED_PRIORS_CTR_BORDER_COUNT;
+            ctrInfo.TargetClassifierIdx = targetClassifierIdx;
+            ctrInfo.Priors = priors;
+            packedCtrInfo.push_back(ctrInfo);
+        };
+        addCtrInfo(ECtrType::Borders, /*targetClassifierIdx*/ 0);
+        addCtrInfo(ECtrType::Borders, /*targetClassifierIdx*/ 1);
+        addCtrInfo(ECtrType::Buckets, /*targetClassifierIdx*/ 1);
+        addCtrInfo(ECtrType::BinarizedTargetMeanValue, /*targetClassifierIdx*/ 1);
+        addCtrInfo(ECtrType::Counter, /*targetClassifierIdx*/ 0);
+
+        NPar::TLocalExecutor localExecutor;
+        localExecutor.RunAdditionalThreads(3);
+        TOnlineCTR packedCtr;
+        ComputeShardOnlineCTRs(leafIndices, leafCount, leafCount, packedCtrInfo, prefixClassCounts, counterCTRTotal,
+            counterCTRDenominator, fold, &localExecutor, &packedCtr);
+
+        for (int priorIdx = 0; priorIdx < priors.ysize(); ++priorIdx) {
+            // ctrs with a single prior are not packed
+            TVector<TCtrInfo> unpackedCtrInfo = packedCtrInfo;
+            for (auto& ctrInfo : unpackedCtrInfo) {
+                ctrInfo.Priors = {priors[priorIdx]};
+            }
+            TOnlineCTR unpackedCtr;
+            ComputeShardOnlineCTRs(leafIndices, leafCount, leafCount, unpackedCtrInfo, prefixClassCounts, counterCTRTotal,
+                counterCTRDenominator, fold, &localExecutor, &unpackedCtr);
+
+            for (int ctrIdx = 0; ctrIdx < packedCtrInfo.ysize(); ++ctrIdx) {
+                UNIT_ASSERT(packedCtr.ArePriorsPacked[ctrIdx]);
+                UNIT_ASSERT(!unpackedCtr.ArePriorsPacked[ctrIdx]);
+                const auto& ctrInfo = packedCtrInfo[ctrIdx];
+                const int targetBorderCount = GetTargetBorderCount(ctrInfo, targetClassesCounts[ctrInfo.TargetClassifierIdx]);
+                for (int border = 0; border < targetBorderCount; ++border) {
+                    const TPackedBins packedBins = packedCtr.GetCtrBins(ctrIdx, border, priorIdx);
+                    const TPackedBins unpackedBins = unpackedCtr.GetCtrBins(ctrIdx, border, /*priorIdx*/ 0);
+                    for (size_t doc = 0; doc < docCount; ++doc) {
+                        UNIT_ASSERT(unpackedBins[doc] <= MAX_PACKED_PRIORS_CTR_BORDER_COUNT);
+                        UNIT_ASSERT_VALUES_EQUAL(packedBins[doc], unpackedBins[doc]);
+                    }
+                }
+            }
+        }
+        // the unused high half of the last packed byte stays zero
+        for (int ctrIdx = 0; ctrIdx < packedCtrInfo.ysize(); ++ctrIdx) {
+            const auto& lastPriorStorage = packedCtr.Feature[ctrIdx][0][priors.size() / 2];
+            for (size_t doc = 0; doc < docCount; ++doc) {
+                UNIT_ASSERT_VALUES_EQUAL(lastPriorStorage[doc] >> 4, 0);
+            }
+        }
+    }
+}
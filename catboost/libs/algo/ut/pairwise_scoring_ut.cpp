@@ -2,6 +2,8 @@
 #include <catboost/libs/algo/pairwise_scoring.h>
 #include <catboost/libs/algo/pairwise_leaves_calculation.h>
 
+#include <util/random/fast.h>
+
 static double CalculateScore(const TVector<double>& avrg, const TVector<double>& sumDer, const TArray2D<double>& sumWeights) {
     double score = 0;
     for (int x = 0; x < sumDer.ysize(); ++x) {
@@ -140,4 +142,66 @@ Y_UNIT_TEST_SUITE(PairwiseScoringTest) {
         UNIT_ASSERT_DOUBLES_EQUAL(scoreBins1[1].DP, scoreBins2[1].DP, 1e-6);
         UNIT_ASSERT_DOUBLES_EQUAL(scoreBins1[2].DP, scoreBins2[2].DP, 1e-6);
     }
+
+    Y_UNIT_TEST(PairwiseScoringFromParentStats) {
+        const int docCount = 300;
+        const int queryCount = 10;
+        const int bucketCount = 5;
+        const int depth = 2;
+        const int leafCount = 1 << depth;
+        TReallyFastRng32 rng(17);
+        TVector<TIndexType> singleIdx(docCount), parentSingleIdx(docCount);
+        TVector<double> ders(docCount);
+        for (int docId = 0; docId < docCount; ++docId) {
+            const int leaf = rng.Uniform(leafCount);
+            const int bucket = rng.Uniform(bucketCount);
+            singleIdx[docId] = leaf * bucketCount + bucket;
+            // parent leaf doesn't have the bit of the last split
+            parentSingleIdx[docId] = (leaf & (leafCount / 2 - 1)) * bucketCount + bucket;
+            ders[docId] = rng.GenRandReal2() - 0.5;
+        }
+        TVector<TQueryInfo> queriesInfo;
+        const int querySize = docCount / queryCount;
+        for (int queryId = 0; queryId < queryCount; ++queryId) {
+            queriesInfo.push_back({queryId * querySize, (queryId + 1) * querySize});
+            auto& comps = queriesInfo.back().Competitors;
+            comps.resize(querySize);
+            for (int pairId = 0; pairId < 3 * querySize; ++pairId) {
+                const int winnerId = rng.Uniform(querySize);
+                const int loserId = rng.Uniform(querySize);
+                if (winnerId != loserId) {
+                    comps[winnerId].push_back({loserId, static_cast<float>(0.5 + rng.GenRandReal2())});
+                }
+            }
+        }
+        const auto dersRef = MakeArrayRef(ders.data(), ders.size());
+        const ESplitType splitType = ESplitType::FloatFeature;
+        const float l2DiagReg = 0.3;
+        const float pairwiseNonDiagReg = 0.1;
+        TPairwiseStats parentStats;
+        TVector<TScoreBin> parentScoreBins(bucketCount - 1);
+        CalculatePairwiseScore(parentSingleIdx, dersRef, queriesInfo, leafCount / 2, bucketCount, splitType, l2DiagReg, pairwiseNonDiagReg, /*parentStats*/ nullptr, &parentStats, &parentScoreBins);
+
+        TPairwiseStats stats, statsFromParent;
+        TVector<TScoreBin> scoreBins(bucketCount - 1), scoreBinsFromParent(bucketCount - 1), scoreBinsSimple(bucketCount - 1);
+        CalculatePairwiseScore(singleIdx, dersRef, queriesInfo, leafCount, bucketCount, splitType, l2DiagReg, pairwiseNonDiagReg, /*parentStats*/ nullptr, &stats, &scoreBins);
+        CalculatePairwiseScore(singleIdx, dersRef, queriesInfo, leafCount, bucketCount, splitType, l2DiagReg, pairwiseNonDiagReg, &parentStats, &statsFromParent, &scoreBinsFromParent);
+        CalculatePairwiseScoreSimple(singleIdx, dersRef, queriesInfo, leafCount, bucketCount, splitType, l2DiagReg, pairwiseNonDiagReg, &scoreBinsSimple);
+
+        for (int leaf = 0; leaf < leafCount; ++leaf) {
+            for (int bucket = 0; bucket < bucketCount; ++bucket) {
+                UNIT_ASSERT_DOUBLES_EQUAL(statsFromParent.DerSums[leaf][bucket], stats.DerSums[leaf][bucket], 1e-9);
+                for (int otherLeaf = 0; otherLeaf < leafCount; ++otherLeaf) {
+                    const auto& expected = stats.PairWeightStatistics[leaf][otherLeaf][bucket];
+                    const auto& fromParent = statsFromParent.PairWeightStatistics[leaf][otherLeaf][bucket];
+                    UNIT_ASSERT_DOUBLES_EQUAL(fromParent.SmallerBorderWeightSum, expected.SmallerBorderWeightSum, 1e-9);
+                    UNIT_ASSERT_DOUBLES_EQUAL(fromParent.GreaterBorderRightWeightSum, expected.GreaterBorderRightWeightSum, 1e-9);
+                }
+            }
+        }
+        for (int splitId = 0; splitId < bucketCount - 1; ++splitId) {
+            UNIT_ASSERT_DOUBLES_EQUAL(scoreBinsFromParent[splitId].DP, scoreBins[splitId].DP, 1e-6);
+            UNIT_ASSERT_DOUBLES_EQUAL(scoreBinsFromParent[splitId].DP, scoreBinsSimple[splitId].DP, 1e-6);
+        }
+    }
 }
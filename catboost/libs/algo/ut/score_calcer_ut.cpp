@@ -0,0 +1,359 @@
+#include <catboost/libs/algo/score_calcer.h>
+#include <catboost/libs/algo/calc_score_cache.h>
+#include <catboost/libs/algo/dataset.h>
+#include <catboost/libs/algo/fold.h>
+#include <catboost/libs/algo/full_features.h>
+#include <catboost/libs/algo/tensor_search_helpers.h>
+#include <catboost/libs/helpers/restorable_rng.h>
+#include <catboost/libs/options/catboost_options.h>
+
+#include <library/unittest/registar.h>
+
+#include <util/generic/algorithm.h>
+#include <util/generic/vector.h>
+#include <util/generic/ymath.h>
+#include <util/random/fast.h>
+
+static TVector<float> MakeUniformBorders(int borderCount) {
+    TVector<float> borders;
+    for (int borderIdx = 0; borderIdx < borderCount; ++borderIdx) {
+        borders.push_back((borderIdx + 1.0f) / (borderCount + 1));
+    }
+    return borders;
+}
+
+static void CheckGroupedFloatFeaturesScoring(EBoostingType boostingType, EBootstrapType bootstrapType, bool singlePrecisionScoreStats) {
+    const size_t docCount = 5000;
+    const TVector<int> borderCounts = {1, 3, 15, 64, 200};
+    const int maxDepth = 2;
+
+    NCatboostOptions::TCatBoostOptions options(ETaskType::CPU);
+    options.BoostingOptions->BoostingType.Set(boostingType);
+    options.ObliviousTreeOptions->MaxDepth.Set(maxDepth);
+    options.ObliviousTreeOptions->BootstrapConfig->GetBootstrapType().Set(bootstrapType);
+    if (bootstrapType == EBootstrapType::Bernoulli) {
+        options.ObliviousTreeOptions->BootstrapConfig->GetTakenFraction().Set(0.5f);
+    }
+    options.ObliviousTreeOptions->SinglePrecisionScoreStats.Set(singlePrecisionScoreStats);
+    options.ObliviousTreeOptions->CacheStatsWithoutSampling.Set(true);
+    options.SetNotSpecifiedOptionsToDefaults();
+
+    TReallyFastRng32 rng(42);
+    TDocumentStorage docStorage;
+    docStorage.Resize(docCount, borderCounts.size(), /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+    TVector<TFloatFeature> floatFeatures;
+    for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+        floatFeatures.emplace_back(/*hasNans*/ false, featureIdx, featureIdx, MakeUniformBorders(borderCounts[featureIdx]));
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            docStorage.Factors[featureIdx][doc] = rng.GenRandReal2();
+        }
+    }
+    NPar::TLocalExecutor localExecutor;
+    localExecutor.RunAdditionalThreads(3);
+    TDataset learnData;
+    PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+        /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ true, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &learnData.AllFeatures);
+    learnData.Target.yresize(docCount);
+    for (size_t doc = 0; doc < docCount; ++doc) {
+        learnData.Target[doc] = rng.GenRandReal2();
+    }
+
+    TRestorableFastRng64 rand(0);
+    TVector<TFold> folds;
+    folds.push_back(TFold::BuildPlainFold(learnData, /*targetClassifiers*/ {}, /*shuffle*/ true, /*permuteBlockSize*/ 1,
+        /*approxDimension*/ 1, /*storeExpApproxes*/ false, /*hasPairwiseWeights*/ false, rand));
+    TFold& fold = folds[0];
+    for (auto& derivative : fold.BodyTailArr[0].WeightedDerivatives[0]) {
+        derivative = rng.GenRandReal2() - 0.5;
+    }
+    TCalcScoreFold sampledDocs;
+    sampledDocs.Create(folds, /*isPairwiseScoring*/ false, GetBernoulliSampleRate(options.ObliviousTreeOptions->BootstrapConfig));
+    TCalcScoreFold smallestSplitSideDocs;
+    smallestSplitSideDocs.Create(folds, /*isPairwiseScoring*/ false);
+    TVector<TIndexType> indices(docCount);
+    Bootstrap(options, indices, &fold, &sampledDocs, &localExecutor, &rand);
+
+    const int bucketCount = Accumulate(borderCounts.begin(), borderCounts.end(), 0) + borderCounts.ysize();
+    TBucketStatsCache groupedStatsCache;
+    groupedStatsCache.Create(folds, bucketCount, maxDepth);
+    TBucketStatsCache candidateStatsCache;
+    candidateStatsCache.Create(folds, bucketCount, maxDepth);
+    TVector<TSplitCandidate> splits(borderCounts.size());
+    for (int featureIdx = 0; featureIdx < splits.ysize(); ++featureIdx) {
+        splits[featureIdx].FeatureIdx = featureIdx;
+    }
+
+    // float block sums may be added in a different order by the grouped pass
+    const double relativeTolerance = singlePrecisionScoreStats ? 1e-5 : 1e-9;
+    for (int depth = 0; depth < maxDepth; ++depth) {
+        if (depth > 0) {
+            for (auto& index : indices) {
+                index = rng.Uniform(1 << depth);
+            }
+            if (IsSamplingPerTree(options.ObliviousTreeOptions)) {
+                // stats of the previous level are reused for the smallest side of the split
+                sampledDocs.UpdateIndices(indices, &localExecutor);
+                smallestSplitSideDocs.SelectSmallestSplitSide(depth, sampledDocs, &localExecutor);
+            } else {
+                Bootstrap(options, indices, &fold, &sampledDocs, &localExecutor, &rand);
+            }
+        }
+        const auto groupedScoreBins = CalcScoresForFloatFeatures(learnData.AllFeatures, borderCounts, sampledDocs,
+            smallestSplitSideDocs, fold, options, splits, depth, &groupedStatsCache);
+        UNIT_ASSERT_VALUES_EQUAL(groupedScoreBins.size(), splits.size());
+        for (int featureIdx = 0; featureIdx < splits.ysize(); ++featureIdx) {
+            const auto scores = GetScores(CalcScore(learnData.AllFeatures, borderCounts, fold.GetAllCtrs(), sampledDocs,
+                smallestSplitSideDocs, fold, options, splits[featureIdx], depth, &candidateStatsCache));
+            const auto groupedScores = GetScores(groupedScoreBins[featureIdx]);
+            UNIT_ASSERT_VALUES_EQUAL(groupedScores.size(), scores.size());
+            for (int splitIdx = 0; splitIdx < scores.ysize(); ++splitIdx) {
+                UNIT_ASSERT_DOUBLES_EQUAL(groupedScores[splitIdx], scores[splitIdx], relativeTolerance * Max(1.0, Abs(scores[splitIdx])));
+            }
+        }
+    }
+}
+
+static void CheckSparseFloatFeaturesScoring(EBootstrapType bootstrapType) {
+    const size_t docCount = 5000;
+    const TVector<int> borderCounts = {31, 31, 200};
+    const int maxDepth = 3;
+
+    NCatboostOptions::TCatBoostOptions options(ETaskType::CPU);
+    options.BoostingOptions->BoostingType.Set(EBoostingType::Plain);
+    options.ObliviousTreeOptions->MaxDepth.Set(maxDepth);
+    options.ObliviousTreeOptions->BootstrapConfig->GetBootstrapType().Set(bootstrapType);
+    if (bootstrapType == EBootstrapType::Bernoulli) {
+        options.ObliviousTreeOptions->BootstrapConfig->GetTakenFraction().Set(0.5f);
+    }
+    options.SetNotSpecifiedOptionsToDefaults();
+
+    TReallyFastRng32 rng(7);
+    TDocumentStorage docStorage;
+    docStorage.Resize(docCount, borderCounts.size(), /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+    TVector<TFloatFeature> floatFeatures;
+    for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+        floatFeatures.emplace_back(/*hasNans*/ false, featureIdx, featureIdx, MakeUniformBorders(borderCounts[featureIdx]));
+        // the most frequent value falls into the first, a middle and the last bin
+        const float defaultValue = featureIdx / (borderCounts.ysize() - 1.0f);
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            docStorage.Factors[featureIdx][doc] = rng.GenRandReal2() < 0.95 ? defaultValue : rng.GenRandReal2();
+        }
+    }
+    NPar::TLocalExecutor localExecutor;
+    localExecutor.RunAdditionalThreads(3);
+    TDataset learnData;
+    PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+        /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ true, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &learnData.AllFeatures);
+    for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+        UNIT_ASSERT(learnData.AllFeatures.IsFloatFeatureSparse(featureIdx));
+    }
+    learnData.Target.yresize(docCount);
+    for (size_t doc = 0; doc < docCount; ++doc) {
+        learnData.Target[doc] = rng.GenRandReal2();
+    }
+
+    TRestorableFastRng64 rand(0);
+    TVector<TFold> folds;
+    folds.push_back(TFold::BuildPlainFold(learnData, /*targetClassifiers*/ {}, /*shuffle*/ true, /*permuteBlockSize*/ 1,
+        /*approxDimension*/ 1, /*storeExpApproxes*/ false, /*hasPairwiseWeights*/ false, rand));
+    TFold& fold = folds[0];
+    for (auto& derivative : fold.BodyTailArr[0].WeightedDerivatives[0]) {
+        derivative = rng.GenRandReal2() - 0.5;
+    }
+    TCalcScoreFold sampledDocs;
+    sampledDocs.Create(folds, /*isPairwiseScoring*/ false, GetBernoulliSampleRate(options.ObliviousTreeOptions->BootstrapConfig));
+    TCalcScoreFold smallestSplitSideDocs;
+    smallestSplitSideDocs.Create(folds, /*isPairwiseScoring*/ false);
+    TBucketStatsCache statsCache;
+    statsCache.Create(folds, Accumulate(borderCounts.begin(), borderCounts.end(), 0) + borderCounts.ysize(), maxDepth);
+    TVector<TIndexType> indices(docCount);
+
+    for (int depth = 0; depth < maxDepth; ++depth) {
+        for (auto& index : indices) {
+            index = rng.Uniform(1 << depth);
+        }
+        Bootstrap(options, indices, &fold, &sampledDocs, &localExecutor, &rand);
+        TVector<TVector<double>> denseScores;
+        for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+            TSplitCandidate split;
+            split.FeatureIdx = featureIdx;
+            denseScores.push_back(GetScores(CalcScore(learnData.AllFeatures, borderCounts, fold.GetAllCtrs(), sampledDocs,
+                smallestSplitSideDocs, fold, options, split, depth, &statsCache)));
+        }
+        sampledDocs.PrepareSparseScoring(docCount, 1 << depth, &localExecutor);
+        for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+            TSplitCandidate split;
+            split.FeatureIdx = featureIdx;
+            const auto sparseScores = GetScores(CalcScore(learnData.AllFeatures, borderCounts, fold.GetAllCtrs(), sampledDocs,
+                smallestSplitSideDocs, fold, options, split, depth, &statsCache));
+            UNIT_ASSERT_VALUES_EQUAL(sparseScores.size(), denseScores[featureIdx].size());
+            for (int splitIdx = 0; splitIdx < sparseScores.ysize(); ++splitIdx) {
+                // stats of the default bucket are leaf totals minus stats of other buckets
+                const double expectedScore = denseScores[featureIdx][splitIdx];
+                UNIT_ASSERT_DOUBLES_EQUAL(sparseScores[splitIdx], expectedScore, 1e-6 * Max(1.0, Abs(expectedScore)));
+            }
+        }
+    }
+}
+
+static NCatboostOptions::TCatBoostOptions MakeBernoulliSamplingOptions(EBoostingType boostingType, int maxDepth, bool cacheStatsWithBernoulliSampling) {
+    NCatboostOptions::TCatBoostOptions options(ETaskType::CPU);
+    options.BoostingOptions->BoostingType.Set(boostingType);
+    options.ObliviousTreeOptions->MaxDepth.Set(maxDepth);
+    options.ObliviousTreeOptions->BootstrapConfig->GetBootstrapType().Set(EBootstrapType::Bernoulli);
+    options.ObliviousTreeOptions->BootstrapConfig->GetTakenFraction().Set(0.5f);
+    options.ObliviousTreeOptions->CacheStatsWithBernoulliSampling.Set(cacheStatsWithBernoulliSampling);
+    options.SetNotSpecifiedOptionsToDefaults();
+    return options;
+}
+
+static void CheckSampledOutSiblingScoring(EBoostingType boostingType) {
+    const size_t docCount = 5000;
+    const TVector<int> borderCounts = {1, 15, 64};
+    const int maxDepth = 4;
+
+    const auto options = MakeBernoulliSamplingOptions(boostingType, maxDepth, /*cacheStatsWithBernoulliSampling*/ true);
+    const auto referenceOptions = MakeBernoulliSamplingOptions(boostingType, maxDepth, /*cacheStatsWithBernoulliSampling*/ false);
+    UNIT_ASSERT(!IsSampledOutSiblingScoring(referenceOptions));
+    UNIT_ASSERT_VALUES_EQUAL(IsSampledOutSiblingScoring(options), boostingType == EBoostingType::Plain);
+
+    TReallyFastRng32 rng(11);
+    TDocumentStorage docStorage;
+    docStorage.Resize(docCount, borderCounts.size(), /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+    TVector<TFloatFeature> floatFeatures;
+    for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+        floatFeatures.emplace_back(/*hasNans*/ false, featureIdx, featureIdx, MakeUniformBorders(borderCounts[featureIdx]));
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            docStorage.Factors[featureIdx][doc] = rng.GenRandReal2();
+        }
+    }
+    NPar::TLocalExecutor localExecutor;
+    localExecutor.RunAdditionalThreads(3);
+    TDataset learnData;
+    PrepareAllFeaturesLearn(/*categFeatures*/ {}, floatFeatures, /*ignoredFeatures*/ {}, /*ignoreRedundantCatFeatures*/ false,
+        /*oneHotMaxSize*/ 2, ENanMode::Forbidden, /*clearPool*/ false, /*allowSparseFloatFeatures*/ false, localExecutor, /*selectedDocIndices*/ {}, &docStorage, &learnData.AllFeatures);
+    learnData.Target.yresize(docCount);
+    for (size_t doc = 0; doc < docCount; ++doc) {
+        learnData.Target[doc] = rng.GenRandReal2();
+    }
+
+    TRestorableFastRng64 rand(0);
+    TVector<TFold> folds;
+    folds.push_back(TFold::BuildPlainFold(learnData, /*targetClassifiers*/ {}, /*shuffle*/ true, /*permuteBlockSize*/ 1,
+        /*approxDimension*/ 1, /*storeExpApproxes*/ false, /*hasPairwiseWeights*/ false, rand));
+    TFold& fold = folds[0];
+    for (auto& derivative : fold.BodyTailArr[0].WeightedDerivatives[0]) {
+        derivative = rng.GenRandReal2() - 0.5;
+    }
+    TCalcScoreFold sampledDocs;
+    sampledDocs.Create(folds, /*isPairwiseScoring*/ false, GetBernoulliSampleRate(options.ObliviousTreeOptions->BootstrapConfig));
+    TCalcScoreFold sampledOutSiblingDocs;
+    sampledOutSiblingDocs.Create(folds, /*isPairwiseScoring*/ false);
+    const int bucketCount = Accumulate(borderCounts.begin(), borderCounts.end(), 0) + borderCounts.ysize();
+    TBucketStatsCache statsCache;
+    statsCache.Create(folds, bucketCount, maxDepth);
+    TBucketStatsCache referenceStatsCache;
+    referenceStatsCache.Create(folds, bucketCount, maxDepth);
+    TVector<TIndexType> indices(docCount, 0);
+
+    for (int depth = 0; depth < maxDepth; ++depth) {
+        if (depth > 0) {
+            // splits are skewed, so that the smallest side is the true side on some levels and the false one on others
+            const double trueSideFraction = depth % 2 == 0 ? 0.3 : 0.7;
+            for (auto& index : indices) {
+                if (rng.GenRandReal2() < trueSideFraction) {
+                    index |= 1 << (depth - 1);
+                }
+            }
+        }
+        Bootstrap(options, indices, &fold, &sampledDocs, &localExecutor, &rand);
+        sampledOutSiblingDocs.SelectSampledOutSibling(depth, fold, indices, sampledDocs, &localExecutor);
+        for (int featureIdx = 0; featureIdx < borderCounts.ysize(); ++featureIdx) {
+            TSplitCandidate split;
+            split.FeatureIdx = featureIdx;
+            if (featureIdx == 0 && depth == 1) {
+                // candidates skipped on a level are scored from the sample on the next one
+                statsCache.Erase(split);
+                continue;
+            }
+            const auto scores = GetScores(CalcScore(learnData.AllFeatures, borderCounts, fold.GetAllCtrs(), sampledDocs,
+                sampledOutSiblingDocs, fold, options, split, depth, &statsCache));
+            const auto expectedScores = GetScores(CalcScore(learnData.AllFeatures, borderCounts, fold.GetAllCtrs(), sampledDocs,
+                sampledOutSiblingDocs, fold, referenceOptions, split, depth, &referenceStatsCache));
+            UNIT_ASSERT_VALUES_EQUAL(scores.size(), expectedScores.size());
+            for (int splitIdx = 0; splitIdx < scores.ysize(); ++splitIdx) {
+                // stats of the largest side are differences of sums over all documents
+                UNIT_ASSERT_DOUBLES_EQUAL(scores[splitIdx], expectedScores[splitIdx], 1e-6 * Max(1.0, Abs(expectedScores[splitIdx])));
+            }
+        }
+    }
+}
+
+Y_UNIT_TEST_SUITE(TScoreCalcerTest) {
+    Y_UNIT_TEST(TestSinglePrecisionStatsBlocksOnLargeBucket) {
+        // float count stops growing at 2^24, float sum of 0.1 drifts much earlier
+        const int docCount = (1 << 25) + 3;
+        const int statsCount = 2;
+        TVector<TBucketStatsSingle> blockStats(statsCount);
+        TVector<TBucketStats> stats(statsCount, TBucketStats{0, 0, 0, 0});
+        int maxBlockDocCount = 0;
+        UpdateStatsBySinglePrecisionBlocks(0, docCount, statsCount, blockStats.data(), stats.data(), [&](int blockBegin, int blockEnd, TBucketStatsSingle* blockStatsData) {
+            maxBlockDocCount = Max(maxBlockDocCount, blockEnd - blockBegin);
+            for (int doc = blockBegin; doc < blockEnd; ++doc) {
+                TBucketStatsSingle& bucketStats = blockStatsData[doc % 3 == 0];
+                bucketStats.SumDelta += 0.1f;
+                bucketStats.Count += 1;
+                bucketStats.SumWeightedDelta -= 0.1f;
+                bucketStats.SumWeight += 0.5f;
+            }
+        });
+        UNIT_ASSERT(maxBlockDocCount <= SINGLE_PRECISION_STATS_MAX_BLOCK_SIZE);
+        const double firstBucketDocCount = docCount / 3 + 1;
+        const double secondBucketDocCount = docCount - firstBucketDocCount;
+        UNIT_ASSERT_VALUES_EQUAL(stats[1].Count, firstBucketDocCount);
+        UNIT_ASSERT_VALUES_EQUAL(stats[0].Count, secondBucketDocCount);
+        UNIT_ASSERT_DOUBLES_EQUAL(stats[0].SumWeight, 0.5 * secondBucketDocCount, 0);
+        UNIT_ASSERT_DOUBLES_EQUAL(stats[0].SumDelta, 0.1 * secondBucketDocCount, 1e-5 * secondBucketDocCount);
+        UNIT_ASSERT_DOUBLES_EQUAL(stats[0].SumWeightedDelta, -0.1 * secondBucketDocCount, 1e-5 * secondBucketDocCount);
+        UNIT_ASSERT_DOUBLES_EQUAL(stats[1].SumDelta, 0.1 * firstBucketDocCount, 1e-5 * firstBucketDocCount);
+        for (const auto& bucketStats : blockStats) {
+            UNIT_ASSERT_VALUES_EQUAL(bucketStats.Count, 0.0f);
+        }
+    }
+
+    Y_UNIT_TEST(TestGroupedFloatFeaturesScoresEqualPerCandidateScores) {
+        for (EBoostingType boostingType : {EBoostingType::Plain, EBoostingType::Ordered}) {
+            // stats cached between levels
+            CheckGroupedFloatFeaturesScoring(boostingType, EBootstrapType::No, /*singlePrecisionScoreStats*/ false);
+            // stats computed from scratch on every level
+            CheckGroupedFloatFeaturesScoring(boostingType, EBootstrapType::Bernoulli, /*singlePrecisionScoreStats*/ false);
+            CheckGroupedFloatFeaturesScoring(boostingType, EBootstrapType::Bernoulli, /*singlePrecisionScoreStats*/ true);
+        }
+    }
+
+    Y_UNIT_TEST(TestStatsCacheWithoutSamplingIsOptIn) {
+        NCatboostOptions::TObliviousTreeLearnerOptions treeOptions(ETaskType::CPU);
+        treeOptions.SamplingFrequency.Set(ESamplingFrequency::PerTreeLevel);
+        treeOptions.BootstrapConfig->GetBootstrapType().Set(EBootstrapType::No);
+        UNIT_ASSERT(!IsSamplingPerTree(treeOptions));
+        treeOptions.CacheStatsWithoutSampling.Set(true);
+        UNIT_ASSERT(IsSamplingPerTree(treeOptions));
+        treeOptions.BootstrapConfig->GetBootstrapType().Set(EBootstrapType::Bernoulli);
+        treeOptions.BootstrapConfig->GetTakenFraction().Set(0.5f);
+        UNIT_ASSERT(!IsSamplingPerTree(treeOptions));
+        treeOptions.SamplingFrequency.Set(ESamplingFrequency::PerTree);
+        UNIT_ASSERT(IsSamplingPerTree(treeOptions));
+    }
+
+    Y_UNIT_TEST(TestSampledOutSiblingScoresEqualSampleScores) {
+        CheckSampledOutSiblingScoring(EBoostingType::Plain);
+        // ordered boosting scans the sample on every level
+        CheckSampledOutSiblingScoring(EBoostingType::Ordered);
+    }
+
+    Y_UNIT_TEST(TestSparseFloatFeaturesScoresEqualDenseScores) {
+        CheckSparseFloatFeaturesScoring(EBootstrapType::No);
+        // documents out of the sample are skipped by sparse scoring
+        CheckSparseFloatFeaturesScoring(EBootstrapType::Bernoulli);
+    }
+}
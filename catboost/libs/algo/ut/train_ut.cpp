@@ -1,4 +1,5 @@
 #include <catboost/libs/train_lib/train_model.h>
+#include <catboost/libs/algo/apply.h>
 #include <catboost/libs/algo/features_layout.h>
 #include <catboost/libs/options/plain_options_helper.h>
 
@@ -7,6 +8,7 @@
 
 #include <util/random/fast.h>
 #include <util/generic/vector.h>
+#include <util/generic/ymath.h>
 
 Y_UNIT_TEST_SUITE(TTrainTest) {
     Y_UNIT_TEST(TestRepeatableTrain) {
@@ -157,4 +159,41 @@ Y_UNIT_TEST_SUITE(TTrainTest) {
             UNIT_ASSERT_EQUAL(layout.GetExternalFeatureCount(), 7);
         }
     }
+
+    Y_UNIT_TEST(TestSinglePrecisionScoreStats) {
+        const size_t TestDocCount = 2000;
+        const size_t FactorCount = 10;
+
+        TReallyFastRng32 rng(123);
+        TPool pool;
+        pool.Docs.Resize(TestDocCount, FactorCount, /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+        for (size_t i = 0; i < TestDocCount; ++i) {
+            for (size_t j = 0; j < FactorCount; ++j) {
+                pool.Docs.Factors[j][i] = rng.GenRandReal2();
+            }
+            pool.Docs.Target[i] = pool.Docs.Factors[0][i] + 2 * pool.Docs.Factors[1][i] * pool.Docs.Factors[2][i] + 0.1 * rng.GenRandReal2();
+        }
+
+        auto calcRmse = [&](bool singlePrecisionScoreStats) {
+            NJson::TJsonValue plainFitParams;
+            plainFitParams.InsertValue("random_seed", 5);
+            plainFitParams.InsertValue("iterations", 50);
+            plainFitParams.InsertValue("train_dir", ".");
+            plainFitParams.InsertValue("single_precision_score_stats", singlePrecisionScoreStats);
+            TEvalResult testApprox;
+            TPool testPool;
+            TFullModel model;
+            TrainModel(plainFitParams, Nothing(), Nothing(), pool, false, testPool, "", &model, &testApprox);
+            const auto approx = ApplyModel(model, pool);
+            double sumSquaredError = 0;
+            for (size_t i = 0; i < TestDocCount; ++i) {
+                sumSquaredError += Sqr(approx[i] - pool.Docs.Target[i]);
+            }
+            return sqrt(sumSquaredError / TestDocCount);
+        };
+
+        const double doubleStatsRmse = calcRmse(false);
+        const double singleStatsRmse = calcRmse(true);
+        UNIT_ASSERT_DOUBLES_EQUAL(singleStatsRmse, doubleStatsRmse, 0.01 * doubleStatsRmse);
+    }
 }
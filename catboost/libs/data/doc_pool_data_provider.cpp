@@ -12,6 +12,7 @@
 
 #include <library/object_factory/object_factory.h>
 
+#include <util/generic/algorithm.h>
 #include <util/generic/maybe.h>
 #include <util/generic/strbuf.h>
 #include <util/generic/vector.h>
@@ -22,8 +23,12 @@
 
 #include <util/stream/file.h>
 
+#include <util/system/filemap.h>
+#include <util/system/fstat.h>
 #include <util/system/types.h>
 
+#include <cstring>
+
 
 namespace NCB {
 
@@ -74,7 +79,7 @@ namespace NCB {
     {
     }
 
-    float TTargetConverter::operator()(const TString& word) const {
+    float TTargetConverter::operator()(TStringBuf word) const {
         if (ClassNames.empty()) {
             CB_ENSURE(!IsNanValue(word), "NaN not supported for target");
             return FromString<float>(word);
@@ -86,7 +91,7 @@ namespace NCB {
             }
         }
 
-        CB_ENSURE(false, "Unknown class name: " + word);
+        CB_ENSURE(false, "Unknown class name: " << word);
         return UNDEFINED_CLASS;
     }
 
@@ -134,6 +139,49 @@ namespace NCB {
         return categFeatures;
     }
 
+    constexpr ptrdiff_t MAPPED_CHUNK_SIZE = 16 << 20; // bytes of pool file parsed by one task of DoMapped
+
+    const char* GetNextLineBegin(const char* position, const char* end) {
+        const char* lineEnd = static_cast<const char*>(memchr(position, '\n', end - position));
+        return lineEnd ? lineEnd + 1 : end;
+    }
+
+    // same lines as IInputStream::ReadLine gives: without line end, the last line can have no line end
+    ui32 CountLines(const char* begin, const char* end) {
+        if (begin == end) {
+            return 0;
+        }
+        return Count(begin, end, '\n') + (end[-1] != '\n');
+    }
+
+    // line without line end, nextLineBegin is the end of the line with its line end
+    TStringBuf GetLine(const char* begin, const char* nextLineBegin) {
+        const char* lineEnd = nextLineBegin;
+        if (lineEnd > begin && lineEnd[-1] == '\n') {
+            --lineEnd;
+        }
+        if (lineEnd > begin && lineEnd[-1] == '\r') {
+            --lineEnd;
+        }
+        return TStringBuf(begin, lineEnd);
+    }
+
+    template <class TFunc>
+    void ForEachLine(const char* begin, const char* end, TFunc&& func) {
+        while (begin < end) {
+            const char* nextLineBegin = GetNextLineBegin(begin, end);
+            func(GetLine(begin, nextLineBegin));
+            begin = nextLineBegin;
+        }
+    }
+
+    TStringBuf GetToken(TStringBuf line, char delimiter, int tokenIdx) {
+        for (int idx = 0; idx < tokenIdx; ++idx) {
+            line = line.After(delimiter);
+        }
+        return line.Before(delimiter);
+    }
+
     }
 
 
@@ -211,10 +259,13 @@ namespace NCB {
         CB_ENSURE(!(PoolMetaInfo.HasWeights && PoolMetaInfo.HasGroupWeight), "Pool must have either Weight column or GroupWeight column");
 
         CatFeatures = GetCategFeatures(columnsDescription);
+        if (PoolMetaInfo.HasGroupId) {
+            GroupIdColumnIdx = FindIf(columnsDescription, [](const TColumn& column) {
+                return column.Type == EColumn::GroupId;
+            }) - columnsDescription.begin();
+        }
 
         InitFeatureIds(header);
-
-        AsyncRowProcessor.ReadBlockAsync(GetReadFunc());
     }
 
     TVector<TColumn> TCBDsvDataProvider::CreateColumnsDescription(ui32 columnsCount) {
@@ -272,110 +323,242 @@ namespace NCB {
     }
 
 
-    void TCBDsvDataProvider::ProcessBlock(IPoolBuilder* poolBuilder) {
-        poolBuilder->StartNextBlock(AsyncRowProcessor.GetParseBufferSize());
-
-        auto& columnsDescription = PoolMetaInfo.ColumnsInfo->Columns;
-
-        auto parseBlock = [&](TString& line, int lineIdx) {
-            ui32 featureId = 0;
-            ui32 baselineIdx = 0;
-            TVector<float> features;
-            features.yresize(PoolMetaInfo.FeatureCount);
-
-            int tokenCount = 0;
-            TVector<TStringBuf> tokens = StringSplitter(line).Split(FieldDelimiter).ToList<TStringBuf>();
-            for (const auto& token : tokens) {
-                switch (columnsDescription[tokenCount].Type) {
-                    case EColumn::Categ: {
-                        if (!FeatureIgnored[featureId]) {
-                            if (IsNanValue(token)) {
-                                features[featureId] = poolBuilder->GetCatFeatureValue("nan");
-                            } else {
-                                features[featureId] = poolBuilder->GetCatFeatureValue(token);
-                            }
+    void TCBDsvDataProvider::ParseLine(TStringBuf line, ui32 localIdx, ui64 lineNumber, TVector<float>* features, IPoolBuilder* poolBuilder) const {
+        const auto& columnsDescription = PoolMetaInfo.ColumnsInfo->Columns;
+        ui32 featureId = 0;
+        ui32 baselineIdx = 0;
+        features->yresize(PoolMetaInfo.FeatureCount);
+
+        int tokenCount = 0;
+        for (const auto& it : StringSplitter(line).Split(FieldDelimiter)) {
+            CB_ENSURE(tokenCount < columnsDescription.ysize(), "wrong columns number in pool line " << lineNumber
+                      << ": expected " << columnsDescription.ysize() << ", found more");
+            const TStringBuf token = it.Token();
+            switch (columnsDescription[tokenCount].Type) {
+                case EColumn::Categ: {
+                    if (!FeatureIgnored[featureId]) {
+                        if (IsNanValue(token)) {
+                            (*features)[featureId] = poolBuilder->GetCatFeatureValue("nan");
+                        } else {
+                            (*features)[featureId] = poolBuilder->GetCatFeatureValue(token);
                         }
-                        ++featureId;
-                        break;
                     }
-                    case EColumn::Num: {
-                        if (!FeatureIgnored[featureId]) {
-                            float val;
-                            if (!TryFromString<float>(token, val)) {
-                                if (IsNanValue(token)) {
-                                    val = std::numeric_limits<float>::quiet_NaN();
-                                } else if (token.length() == 0) {
-                                    val = std::numeric_limits<float>::quiet_NaN();
-                                } else {
-                                    CB_ENSURE(false, "Factor " << featureId << " (column " << tokenCount + 1 << ") is declared `Num`," <<
-                                        " but has value '" << token << "' in row "
-                                        << AsyncRowProcessor.GetLinesProcessed() + lineIdx + 1
-                                        << " that cannot be parsed as float. Try correcting column description file.");
-                                }
+                    ++featureId;
+                    break;
+                }
+                case EColumn::Num: {
+                    if (!FeatureIgnored[featureId]) {
+                        float val;
+                        if (!TryFromString<float>(token, val)) {
+                            if (IsNanValue(token)) {
+                                val = std::numeric_limits<float>::quiet_NaN();
+                            } else if (token.length() == 0) {
+                                val = std::numeric_limits<float>::quiet_NaN();
+                            } else {
+                                CB_ENSURE(false, "Factor " << featureId << " (column " << tokenCount + 1 << ") is declared `Num`," <<
+                                    " but has value '" << token << "' in row " << lineNumber
+                                    << " that cannot be parsed as float. Try correcting column description file.");
                             }
-                            features[featureId] = val == 0.0f ? 0.0f : val; // remove negative zeros
                         }
-                        ++featureId;
-                        break;
-                    }
-                    case EColumn::Label: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for Label. Label should be float.");
-                        poolBuilder->AddTarget(lineIdx, ConvertTarget(FromString<TString>(token)));
-                        break;
-                    }
-                    case EColumn::Weight: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for weight");
-                        poolBuilder->AddWeight(lineIdx, FromString<float>(token));
-                        break;
-                    }
-                    case EColumn::Auxiliary: {
-                        break;
-                    }
-                    case EColumn::GroupId: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for GroupId");
-                        poolBuilder->AddQueryId(lineIdx, CalcGroupIdFor(token));
-                        break;
-                    }
-                    case EColumn::GroupWeight: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for GroupWeight");
-                        poolBuilder->AddWeight(lineIdx, FromString<float>(token));
-                        break;
-                    }
-                    case EColumn::SubgroupId: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for SubgroupId");
-                        poolBuilder->AddSubgroupId(lineIdx, CalcSubgroupIdFor(token));
-                        break;
-                    }
-                    case EColumn::Baseline: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for Baseline");
-                        poolBuilder->AddBaseline(lineIdx, baselineIdx, FromString<double>(token));
-                        ++baselineIdx;
-                        break;
-                    }
-                    case EColumn::DocId: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for DocId");
-                        poolBuilder->AddDocId(lineIdx, token);
-                        break;
-                    }
-                    case EColumn::Timestamp: {
-                        CB_ENSURE(token.length() != 0, "empty values not supported for Timestamp");
-                        poolBuilder->AddTimestamp(lineIdx, FromString<ui64>(token));
-                        break;
-                    }
-                    default: {
-                        CB_ENSURE(false, "wrong column type");
+                        (*features)[featureId] = val == 0.0f ? 0.0f : val; // remove negative zeros
                     }
+                    ++featureId;
+                    break;
+                }
+                case EColumn::Label: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for Label. Label should be float.");
+                    poolBuilder->AddTarget(localIdx, ConvertTarget(token));
+                    break;
+                }
+                case EColumn::Weight: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for weight");
+                    poolBuilder->AddWeight(localIdx, FromString<float>(token));
+                    break;
+                }
+                case EColumn::Auxiliary: {
+                    break;
+                }
+                case EColumn::GroupId: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for GroupId");
+                    poolBuilder->AddQueryId(localIdx, CalcGroupIdFor(token));
+                    break;
+                }
+                case EColumn::GroupWeight: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for GroupWeight");
+                    poolBuilder->AddWeight(localIdx, FromString<float>(token));
+                    break;
+                }
+                case EColumn::SubgroupId: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for SubgroupId");
+                    poolBuilder->AddSubgroupId(localIdx, CalcSubgroupIdFor(token));
+                    break;
+                }
+                case EColumn::Baseline: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for Baseline");
+                    poolBuilder->AddBaseline(localIdx, baselineIdx, FromString<double>(token));
+                    ++baselineIdx;
+                    break;
+                }
+                case EColumn::DocId: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for DocId");
+                    poolBuilder->AddDocId(localIdx, token);
+                    break;
+                }
+                case EColumn::Timestamp: {
+                    CB_ENSURE(token.length() != 0, "empty values not supported for Timestamp");
+                    poolBuilder->AddTimestamp(localIdx, FromString<ui64>(token));
+                    break;
+                }
+                default: {
+                    CB_ENSURE(false, "wrong column type");
                 }
-                ++tokenCount;
             }
-            poolBuilder->AddAllFloatFeatures(lineIdx, features);
-            CB_ENSURE(tokenCount == columnsDescription.ysize(), "wrong columns number in pool line " <<
-                      AsyncRowProcessor.GetLinesProcessed() + lineIdx + 1 << ": expected " << columnsDescription.ysize() << ", found " << tokenCount);
+            ++tokenCount;
+        }
+        poolBuilder->AddAllFloatFeatures(localIdx, *features);
+        CB_ENSURE(tokenCount == columnsDescription.ysize(), "wrong columns number in pool line " <<
+                  lineNumber << ": expected " << columnsDescription.ysize() << ", found " << tokenCount);
+    }
+
+
+    void TCBDsvDataProvider::ProcessBlock(IPoolBuilder* poolBuilder) {
+        poolBuilder->StartNextBlock(AsyncRowProcessor.GetParseBufferSize());
+
+        auto parseBlock = [&](TString& line, int lineIdx) {
+            ParseLine(line,
+                      lineIdx,
+                      AsyncRowProcessor.GetLinesProcessed() + lineIdx + 1,
+                      &FeaturesBuffers[Args.LocalExecutor->GetWorkerThreadId()],
+                      poolBuilder);
         };
 
         AsyncRowProcessor.ProcessBlock(parseBlock);
     }
 
+
+    void TCBDsvDataProvider::StartAsyncRead() {
+        if (!IsAsyncReadStarted) {
+            AsyncRowProcessor.ReadBlockAsync(GetReadFunc());
+            IsAsyncReadStarted = true;
+        }
+    }
+
+
+    bool TCBDsvDataProvider::IsPoolFileMappable() const {
+        // pipes and other special files are read line by line
+        return TFileStat(Args.PoolPath.Path).IsFile();
+    }
+
+
+    const char* TCBDsvDataProvider::AlignToLines(const char* position, const char* dataBegin, const char* fileEnd) const {
+        if (position <= dataBegin) {
+            return dataBegin;
+        }
+        if (position >= fileEnd) {
+            return fileEnd;
+        }
+        const char* lineBegin = position[-1] == '\n' ? position : GetNextLineBegin(position, fileEnd);
+        if (GroupIdColumnIdx < 0 || lineBegin == fileEnd) {
+            return lineBegin;
+        }
+        // group of the previous line is read with the range of its first line
+        const char* prevLineBegin = lineBegin - 1;
+        while (prevLineBegin > dataBegin && prevLineBegin[-1] != '\n') {
+            --prevLineBegin;
+        }
+        const TStringBuf prevGroupId = GetToken(GetLine(prevLineBegin, lineBegin), FieldDelimiter, GroupIdColumnIdx);
+        while (lineBegin < fileEnd) {
+            const char* nextLineBegin = GetNextLineBegin(lineBegin, fileEnd);
+            if (GetToken(GetLine(lineBegin, nextLineBegin), FieldDelimiter, GroupIdColumnIdx) != prevGroupId) {
+                break;
+            }
+            lineBegin = nextLineBegin;
+        }
+        return lineBegin;
+    }
+
+
+    void TCBDsvDataProvider::DoMapped(IPoolBuilder* poolBuilder) {
+        TFileMap fileMap(Args.PoolPath.Path);
+        const size_t fileSize = fileMap.Length();
+        CB_ENSURE(fileSize > 0, "TCBDsvDataProvider: no data rows in pool");
+        fileMap.Map(0, fileSize);
+        const char* const fileBegin = static_cast<const char*>(fileMap.Ptr());
+        const char* const fileEnd = fileBegin + fileSize;
+        const char* const dataBegin = Args.DsvPoolFormatParams.Format.HasHeader ? GetNextLineBegin(fileBegin, fileEnd) : fileBegin;
+
+        TVector<std::pair<const char*, const char*>> ranges; // byte ranges of whole lines to read
+        if (Args.ByteRanges.empty()) {
+            ranges.emplace_back(dataBegin, fileEnd);
+        } else {
+            CB_ENSURE(!Args.PairsFilePath.Inited(), "TCBDsvDataProvider: pairs can not be read for byte ranges of pool");
+            for (const auto& byteRange : Args.ByteRanges) {
+                CB_ENSURE(byteRange.first <= byteRange.second, "TCBDsvDataProvider: invalid byte range");
+                const char* rangeBegin = AlignToLines(fileBegin + Min<ui64>(byteRange.first, fileSize), dataBegin, fileEnd);
+                const char* rangeEnd = AlignToLines(fileBegin + Min<ui64>(byteRange.second, fileSize), dataBegin, fileEnd);
+                if (rangeBegin < rangeEnd) {
+                    ranges.emplace_back(rangeBegin, rangeEnd);
+                }
+            }
+        }
+        ptrdiff_t rangesSize = 0;
+        for (const auto& range : ranges) {
+            rangesSize += range.second - range.first;
+        }
+
+        const int threadCount = Args.LocalExecutor->GetThreadCount() + 1;
+        TVector<std::pair<const char*, const char*>> chunks; // [chunkIdx] byte ranges of whole lines
+        TVector<ui32> chunkLineOffsets; // [chunkIdx] index of the first chunk line in wave
+        ui64 linesProcessed = 0;
+        bool isBuilderStarted = false;
+        for (const auto& range : ranges) {
+            const char* const rangeEnd = range.second;
+            for (const char* waveBegin = range.first; waveBegin < rangeEnd; waveBegin = chunks.back().second) {
+                chunks.clear();
+                for (const char* chunkBegin = waveBegin; chunkBegin < rangeEnd && chunks.ysize() < threadCount; chunkBegin = chunks.back().second) {
+                    const char* chunkEnd = rangeEnd - chunkBegin > MAPPED_CHUNK_SIZE ? GetNextLineBegin(chunkBegin + MAPPED_CHUNK_SIZE - 1, rangeEnd) : rangeEnd;
+                    chunks.emplace_back(chunkBegin, chunkEnd);
+                }
+
+                chunkLineOffsets.yresize(chunks.size());
+                Args.LocalExecutor->ExecRangeWithThrow([&](int chunkIdx) {
+                    chunkLineOffsets[chunkIdx] = CountLines(chunks[chunkIdx].first, chunks[chunkIdx].second);
+                }, 0, chunks.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+                ui32 waveLineCount = 0;
+                for (auto& chunkLineOffset : chunkLineOffsets) {
+                    const ui32 chunkLineCount = chunkLineOffset;
+                    chunkLineOffset = waveLineCount;
+                    waveLineCount += chunkLineCount;
+                }
+
+                if (!isBuilderStarted) {
+                    // storage is reserved by the line density of the first wave and grows if it is not enough
+                    const double waveSize = chunks.back().second - waveBegin;
+                    const ui64 estimatedDocCount = waveLineCount * (rangesSize / waveSize);
+                    StartBuilder(/*inBlock*/ false, Min<ui64>(estimatedDocCount, Max<int>()), /*offset*/ 0, poolBuilder);
+                    isBuilderStarted = true;
+                }
+                poolBuilder->StartNextBlock(waveLineCount);
+                Args.LocalExecutor->ExecRangeWithThrow([&](int chunkIdx) {
+                    TVector<float> features;
+                    ui32 localIdx = chunkLineOffsets[chunkIdx];
+                    ForEachLine(chunks[chunkIdx].first, chunks[chunkIdx].second, [&](TStringBuf line) {
+                        ParseLine(line, localIdx, linesProcessed + localIdx + 1, &features, poolBuilder);
+                        ++localIdx;
+                    });
+                }, 0, chunks.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+                linesProcessed += waveLineCount;
+            }
+        }
+        if (!isBuilderStarted) {
+            // a byte range can have no line beginnings
+            CB_ENSURE(!Args.ByteRanges.empty(), "TCBDsvDataProvider: no data rows in pool");
+            StartBuilder(/*inBlock*/ false, /*docCount*/ 0, /*offset*/ 0, poolBuilder);
+        }
+
+        FinalizeBuilder(/*inBlock*/ false, poolBuilder);
+    }
+
     namespace {
 
     TDocDataProviderObjectFactory::TRegistrator<TCBDsvDataProvider> DefDataProviderReg("");
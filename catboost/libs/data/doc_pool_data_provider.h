@@ -13,8 +13,11 @@
 #include <library/threading/local_executor/local_executor.h>
 
 #include <util/generic/string.h>
+#include <util/generic/strbuf.h>
 #include <util/generic/vector.h>
 
+#include <array>
+
 
 namespace NCB {
 
@@ -27,6 +30,8 @@ namespace NCB {
         TVector<TString> ClassNames;
         ui32 BlockSize;
         NPar::TLocalExecutor* LocalExecutor;
+        // byte ranges of pool file to read, lines are read by ranges with their first byte, see TCBDsvDataProvider::DoMapped
+        TVector<std::pair<ui64, ui64>> ByteRanges = {};
     };
 
 
@@ -60,7 +65,7 @@ namespace NCB {
 
         explicit TTargetConverter(const TVector<TString>& classNames);
 
-        float operator()(const TString& word) const;
+        float operator()(TStringBuf word) const;
 
     private:
         TVector<TString> ClassNames;
@@ -175,10 +180,18 @@ namespace NCB {
         }
 
         void Do(IPoolBuilder* poolBuilder) override {
-            TBase::Do(GetReadFunc(), poolBuilder);
+            if (IsPoolFileMappable()) {
+                DoMapped(poolBuilder);
+            } else {
+                CB_ENSURE(Args.ByteRanges.empty(), "TCBDsvDataProvider: byte ranges can be read only from regular files");
+                StartAsyncRead();
+                TBase::Do(GetReadFunc(), poolBuilder);
+            }
         }
 
         bool DoBlock(IPoolBuilder* poolBuilder) override {
+            CB_ENSURE(Args.ByteRanges.empty(), "TCBDsvDataProvider::DoBlock does not support byte ranges");
+            StartAsyncRead();
             return TBase::DoBlock(GetReadFunc(), poolBuilder);
         }
 
@@ -187,21 +200,45 @@ namespace NCB {
         // call after ColumnDescription initialization
         void InitFeatureIds(const TMaybe<TString>& header);
 
+        // files that are not mapped can be pipes which can not be read twice to count lines, builder storage grows instead
         int GetDocCount() override {
-            return (int)LineDataReader->GetDataLineCount();
+            return 0;
         }
 
         void StartBuilder(bool inBlock, int docCount, int offset, IPoolBuilder* poolBuilder) override;
 
         void ProcessBlock(IPoolBuilder* poolBuilder) override;
 
+    protected:
+        bool IsPoolFileMappable() const;
+
+        /*
+         * Maps pool file to memory and parses it in waves of byte ranges split at line ends,
+         * ranges of one wave are parsed in parallel and documents are added to poolBuilder
+         * without counting lines of the whole file in advance.
+         * If Args.ByteRanges are set, only lines starting in them are read and only their pages are touched
+         */
+        void DoMapped(IPoolBuilder* poolBuilder);
+
+        // Beginning of the first line starting at position or after it, lines of one group are not split
+        const char* AlignToLines(const char* position, const char* dataBegin, const char* fileEnd) const;
+
+        // reading is started lazily as DoMapped does not need it
+        void StartAsyncRead();
+
+        // lineNumber is used in error messages, features is a reusable buffer
+        void ParseLine(TStringBuf line, ui32 localIdx, ui64 lineNumber, TVector<float>* features, IPoolBuilder* poolBuilder) const;
+
     protected:
         TVector<bool> FeatureIgnored; // init in process
         char FieldDelimiter;
         TTargetConverter ConvertTarget;
         THolder<NCB::ILineDataReader> LineDataReader;
+        bool IsAsyncReadStarted = false;
+        std::array<TVector<float>, CB_THREAD_LIMIT> FeaturesBuffers; // [workerThreadId], used by ProcessBlock
 
         TVector<int> CatFeatures;
+        int GroupIdColumnIdx = -1; // groups are not split between byte ranges
     };
 
 
@@ -6,8 +6,11 @@
 
 #include <library/threading/local_executor/local_executor.h>
 
+#include <util/generic/algorithm.h>
 #include <util/generic/hash.h>
 
+#include <util/system/fstat.h>
+
 
 namespace NCB {
 
@@ -21,14 +24,16 @@ namespace NCB {
         {
         }
 
+        // docCount is only reserved, documents are added by StartNextBlock
         void Start(const TPoolMetaInfo& poolMetaInfo,
                    int docCount,
                    const TVector<int>& catFeatureIds) override {
             Cursor = NotSet;
             NextCursor = 0;
+            DocIdsOffset = NotSet;
             FeatureCount = poolMetaInfo.FeatureCount;
             BaselineCount = poolMetaInfo.BaselineCount;
-            Pool->Docs.Resize(docCount,
+            Pool->Docs.Resize(/*docCount*/ 0,
                               FeatureCount,
                               BaselineCount,
                               poolMetaInfo.HasGroupId,
@@ -36,11 +41,25 @@ namespace NCB {
             Pool->CatFeatures = catFeatureIds;
             Pool->FeatureId.assign(FeatureCount, TString());
             Pool->MetaInfo = poolMetaInfo;
+            ForEachDocsColumn([docCount] (auto& column) {
+                column.reserve(docCount);
+            });
         }
 
         void StartNextBlock(ui32 blockSize) override {
             Cursor = NextCursor;
             NextCursor = Cursor + blockSize;
+            auto& docs = Pool->Docs;
+            const int oldDocCount = docs.GetDocCount();
+            if (NextCursor > static_cast<ui32>(oldDocCount)) {
+                ForEachDocsColumn([this] (auto& column) {
+                    column.resize(NextCursor);
+                });
+                Fill(docs.Weight.begin() + oldDocCount, docs.Weight.end(), 1.0f);
+                if (DocIdsOffset != NotSet) {
+                    GenerateDocIds(DocIdsOffset, oldDocCount);
+                }
+            }
         }
 
         float GetCatFeatureValue(const TStringBuf& feature) override {
@@ -115,10 +134,10 @@ namespace NCB {
             return MakeArrayRef(Pool->Docs.Weight.data(), Pool->Docs.Weight.size());
         }
 
+        // ids of documents added by later blocks are generated as well
         void GenerateDocIds(int offset) override {
-            for (int ind = 0; ind < Pool->Docs.Id.ysize(); ++ind) {
-                Pool->Docs.Id[ind] = ToString(offset + ind);
-            }
+            DocIdsOffset = offset;
+            GenerateDocIds(offset, /*begin*/ 0);
         }
 
         void Finish() override {
@@ -133,6 +152,33 @@ namespace NCB {
         }
 
     private:
+        template <class TFunc>
+        void ForEachDocsColumn(TFunc&& func) {
+            auto& docs = Pool->Docs;
+            for (auto& factor : docs.Factors) {
+                func(factor);
+            }
+            for (auto& dim : docs.Baseline) {
+                func(dim);
+            }
+            func(docs.Target);
+            func(docs.Weight);
+            func(docs.Id);
+            if (Pool->MetaInfo.HasGroupId) {
+                func(docs.QueryId);
+            }
+            if (Pool->MetaInfo.HasSubgroupIds) {
+                func(docs.SubgroupId);
+            }
+            func(docs.Timestamp);
+        }
+
+        void GenerateDocIds(int offset, int begin) {
+            for (int ind = begin; ind < Pool->Docs.Id.ysize(); ++ind) {
+                Pool->Docs.Id[ind] = ToString(offset + ind);
+            }
+        }
+
         struct THashPart {
             THashMap<int, TString> CatFeatureHashes;
         };
@@ -140,6 +186,7 @@ namespace NCB {
         static constexpr const int NotSet = -1;
         ui32 Cursor = NotSet;
         ui32 NextCursor = 0;
+        int DocIdsOffset = NotSet;
         ui32 FeatureCount = 0;
         ui32 BaselineCount = 0;
         std::array<THashPart, CB_THREAD_LIMIT> HashMapParts;
@@ -177,13 +224,14 @@ namespace NCB {
         );
     }
 
-    void ReadPool(
+    static void ReadPoolByteRanges(
         const TPathWithScheme& poolPath,
         const TPathWithScheme& pairsFilePath,
         const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
         const TVector<int>& ignoredFeatures,
         bool verbose,
         const TVector<TString>& classNames,
+        TVector<std::pair<ui64, ui64>>&& byteRanges,
         NPar::TLocalExecutor* localExecutor,
         IPoolBuilder* poolBuilder
     ) {
@@ -204,7 +252,8 @@ namespace NCB {
                  ignoredFeatures,
                  classNames,
                  10000, // TODO: make it a named constant
-                 localExecutor
+                 localExecutor,
+                 std::move(byteRanges)
             }
         );
 
@@ -213,6 +262,29 @@ namespace NCB {
         SetVerboseLogingMode();
     }
 
+    void ReadPool(
+        const TPathWithScheme& poolPath,
+        const TPathWithScheme& pairsFilePath,
+        const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
+        const TVector<int>& ignoredFeatures,
+        bool verbose,
+        const TVector<TString>& classNames,
+        NPar::TLocalExecutor* localExecutor,
+        IPoolBuilder* poolBuilder
+    ) {
+        ReadPoolByteRanges(
+            poolPath,
+            pairsFilePath,
+            dsvPoolFormatParams,
+            ignoredFeatures,
+            verbose,
+            classNames,
+            /*byteRanges*/ {},
+            localExecutor,
+            poolBuilder
+        );
+    }
+
     void ReadPool(
         const TPathWithScheme& poolPath,
         const TPathWithScheme& pairsFilePath,
@@ -227,4 +299,74 @@ namespace NCB {
         ReadPool(poolPath, pairsFilePath, dsvPoolFormatParams, {}, verbose, noNames, &localExecutor, &poolBuilder);
     }
 
+    bool CanReadPoolByteRanges(const TPathWithScheme& poolPath) {
+        return (poolPath.Scheme.empty() || poolPath.Scheme == "dsv") && TFileStat(poolPath.Path).IsFile();
+    }
+
+    void ReadPoolPart(
+        const TPathWithScheme& poolPath,
+        const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
+        const TVector<int>& ignoredFeatures,
+        std::pair<ui64, ui64> byteRange,
+        const TVector<TString>& classNames,
+        NPar::TLocalExecutor* localExecutor,
+        TPool* pool
+    ) {
+        CB_ENSURE(CanReadPoolByteRanges(poolPath), "Only dsv pool files can be read by parts");
+        CB_ENSURE(byteRange.first <= byteRange.second, "Invalid byte range of pool part");
+        TPoolBuilder builder(*localExecutor, pool);
+        ReadPoolByteRanges(
+            poolPath,
+            /*pairsFilePath*/ TPathWithScheme(),
+            dsvPoolFormatParams,
+            ignoredFeatures,
+            /*verbose*/ false,
+            classNames,
+            {byteRange},
+            localExecutor,
+            &builder
+        );
+    }
+
+    ui64 ReadPoolSample(
+        const TPathWithScheme& poolPath,
+        const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
+        const TVector<int>& ignoredFeatures,
+        ui64 sampleSize,
+        const TVector<TString>& classNames,
+        NPar::TLocalExecutor* localExecutor,
+        TPool* pool
+    ) {
+        CB_ENSURE(CanReadPoolByteRanges(poolPath), "Only dsv pool files can be sampled");
+        CB_ENSURE(sampleSize > 0, "Pool sample should not be empty");
+        const ui64 fileSize = TFileStat(poolPath.Path).Size;
+        // blocks are spread over the whole file as pools are often sorted by target or time
+        constexpr ui64 SampleBlockCount = 256;
+        TVector<std::pair<ui64, ui64>> byteRanges;
+        if (sampleSize < fileSize) {
+            const ui64 blockCount = Min<ui64>(SampleBlockCount, sampleSize);
+            for (ui64 blockIdx = 0; blockIdx < blockCount; ++blockIdx) {
+                const ui64 blockBegin = fileSize / blockCount * blockIdx;
+                byteRanges.emplace_back(blockBegin, blockBegin + sampleSize / blockCount);
+            }
+        }
+        TPoolBuilder builder(*localExecutor, pool);
+        ReadPoolByteRanges(
+            poolPath,
+            /*pairsFilePath*/ TPathWithScheme(),
+            dsvPoolFormatParams,
+            ignoredFeatures,
+            /*verbose*/ false,
+            classNames,
+            std::move(byteRanges),
+            localExecutor,
+            &builder
+        );
+        const ui64 sampleDocCount = pool->Docs.GetDocCount();
+        CB_ENSURE(sampleDocCount > 0, "No documents in pool sample, pool lines should be shorter than " << sampleSize / SampleBlockCount << " bytes");
+        if (sampleSize >= fileSize) {
+            return sampleDocCount;
+        }
+        return sampleDocCount * (static_cast<double>(fileSize) / (sampleSize / SampleBlockCount * SampleBlockCount));
+    }
 }
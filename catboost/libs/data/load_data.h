@@ -19,12 +19,14 @@
 #include <util/generic/set.h>
 
 #include <string>
+#include <utility>
 
 
 namespace NCB {
 
     class IPoolBuilder {
     public:
+        // docCount is an estimate for preallocation, each StartNextBlock adds blockSize documents
         virtual void Start(const TPoolMetaInfo& poolMetaInfo,
                            int docCount,
                            const TVector<int>& catFeatureIds) = 0;
@@ -78,4 +80,28 @@ namespace NCB {
                   bool verbose,
                   IPoolBuilder& poolBuilder);
 
+    /// Pools of regular dsv files can be read by byte ranges
+    bool CanReadPoolByteRanges(const TPathWithScheme& poolPath);
+
+    /// Read only lines starting in [byteRange.first, byteRange.second) of pool file, groups are not split,
+    /// so that a part of a large pool fits in memory and only this part is read from disk.
+    /// Byte ranges that cover the file read each document once. Pairs are not read, documents are renumbered from 0.
+    void ReadPoolPart(const TPathWithScheme& poolPath,
+                      const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
+                      const TVector<int>& ignoredFeatures,
+                      std::pair<ui64, ui64> byteRange,
+                      const TVector<TString>& classNames,
+                      NPar::TLocalExecutor* localExecutor,
+                      TPool* pool);
+
+    /// Read about sampleSize bytes of pool file in evenly spaced blocks of whole lines (or groups),
+    /// returns the estimate of document count of the whole pool
+    ui64 ReadPoolSample(const TPathWithScheme& poolPath,
+                        const NCatboostOptions::TDsvPoolFormatParams& dsvPoolFormatParams,
+                        const TVector<int>& ignoredFeatures,
+                        ui64 sampleSize,
+                        const TVector<TString>& classNames,
+                        NPar::TLocalExecutor* localExecutor,
+                        TPool* pool);
+
 }
@@ -1,4 +1,5 @@
 #include <catboost/libs/data/load_data.h>
+#include <catboost/libs/data_types/groupid.h>
 
 #include <library/threading/local_executor/local_executor.h>
 
@@ -8,6 +9,7 @@
 #include <util/random/fast.h>
 #include <util/generic/guid.h>
 #include <util/stream/file.h>
+#include <util/system/file.h>
 
 using namespace std;
 using namespace NCB;
@@ -58,4 +60,114 @@ Y_UNIT_TEST_SUITE(TDataLoadTest) {
             }
         }
     }
+
+    Y_UNIT_TEST(TestFilePartRead) {
+        TReallyFastRng32 rng(1);
+        const size_t TestDocCount = 25000; // several blocks of reader
+        const size_t FactorCount = 3;
+        TVector<float> target(TestDocCount);
+        TString TestFileName = "sample_pool_part.tsv";
+        {
+            TOFStream writer(TestFileName);
+            writer << "Label\tGroupId\tA\tB\tC" << Endl;
+            for (size_t docIdx = 0; docIdx < TestDocCount; ++docIdx) {
+                target[docIdx] = rng.GenRandReal2();
+                writer << target[docIdx] << "\t" << docIdx / 7;
+                for (size_t j = 0; j < FactorCount; ++j) {
+                    writer << "\t" << docIdx * FactorCount + j;
+                }
+                writer << Endl;
+            }
+        }
+        TString TestCdFileName = "sample_pool_part.cd";
+        {
+            TOFStream writer(TestCdFileName);
+            writer << "0\tLabel" << Endl;
+            writer << "1\tGroupId" << Endl;
+        }
+        NCatboostOptions::TDsvPoolFormatParams dsvPoolFormatParams;
+        dsvPoolFormatParams.Format.HasHeader = true;
+        dsvPoolFormatParams.CdFilePath = TPathWithScheme(TestCdFileName, "file");
+        NPar::TLocalExecutor localExecutor;
+        localExecutor.RunAdditionalThreads(1);
+
+        // parts are split in the middle of lines and groups
+        const ui64 fileSize = TFile(TestFileName, OpenExisting | RdOnly).GetLength();
+        const TVector<ui64> partBounds = {0, 3, fileSize / 3 + 5, fileSize / 2 - 11, fileSize};
+        size_t docIdx = 0;
+        for (size_t partIdx = 0; partIdx + 1 < partBounds.size(); ++partIdx) {
+            TPool pool;
+            ReadPoolPart(TPathWithScheme(TestFileName, "dsv"),
+                         dsvPoolFormatParams,
+                         /*ignoredFeatures*/ {},
+                         {partBounds[partIdx], partBounds[partIdx + 1]},
+                         TVector<TString>(),
+                         &localExecutor,
+                         &pool);
+
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.GetEffectiveFactorCount(), FactorCount);
+            if (pool.Docs.GetDocCount() > 0) {
+                UNIT_ASSERT_VALUES_EQUAL(docIdx % 7, 0); // groups are not split
+            }
+            for (size_t i = 0; i < pool.Docs.GetDocCount(); ++i, ++docIdx) {
+                UNIT_ASSERT(docIdx < TestDocCount);
+                UNIT_ASSERT_DOUBLES_EQUAL(pool.Docs.Target[i], target[docIdx], 1e-5);
+                for (size_t j = 0; j < FactorCount; ++j) {
+                    UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Factors[j][i], docIdx * FactorCount + j);
+                }
+                UNIT_ASSERT_VALUES_EQUAL(pool.Docs.QueryId[i], CalcGroupIdFor(ToString(docIdx / 7)));
+            }
+        }
+        UNIT_ASSERT_VALUES_EQUAL(docIdx, TestDocCount);
+
+        TPool sample;
+        const ui64 docCountEstimate = ReadPoolSample(TPathWithScheme(TestFileName, "dsv"),
+                                                     dsvPoolFormatParams,
+                                                     /*ignoredFeatures*/ {},
+                                                     fileSize / 10,
+                                                     TVector<TString>(),
+                                                     &localExecutor,
+                                                     &sample);
+        UNIT_ASSERT(sample.Docs.GetDocCount() < TestDocCount / 5);
+        UNIT_ASSERT(docCountEstimate > TestDocCount * 0.9 && docCountEstimate < TestDocCount * 1.1);
+        for (size_t i = 1; i < sample.Docs.GetDocCount(); ++i) {
+            UNIT_ASSERT(sample.Docs.Factors[0][i - 1] < sample.Docs.Factors[0][i]);
+        }
+    }
+
+    Y_UNIT_TEST(TestFileReadWithHeaderAndCRLF) {
+        const size_t TestDocCount = 1000;
+        TString TestFileName = "sample_pool_crlf.tsv";
+        {
+            TOFStream writer(TestFileName);
+            writer << "Label\tA\tB\r\n";
+            for (size_t docIdx = 0; docIdx < TestDocCount; ++docIdx) {
+                writer << docIdx % 2 << "\t" << docIdx << "\t" << 0.5;
+                if (docIdx + 1 < TestDocCount) { // last line has no line end
+                    writer << "\r\n";
+                }
+            }
+        }
+        NCatboostOptions::TDsvPoolFormatParams dsvPoolFormatParams;
+        dsvPoolFormatParams.Format.HasHeader = true;
+        TPool pool;
+        ReadPool(TPathWithScheme(TestFileName, "dsv"),
+                 TPathWithScheme(),
+                 dsvPoolFormatParams,
+                 /*ignoredFeatures*/ {},
+                 4,
+                 false,
+                 TVector<TString>(),
+                 &pool);
+
+        UNIT_ASSERT_VALUES_EQUAL(pool.Docs.GetDocCount(), TestDocCount);
+        UNIT_ASSERT_VALUES_EQUAL(pool.FeatureId, TVector<TString>({"A", "B"}));
+        for (size_t i = 0; i < TestDocCount; ++i) {
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Target[i], i % 2);
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Factors[0][i], i);
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Factors[1][i], 0.5);
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Weight[i], 1.0f);
+            UNIT_ASSERT_VALUES_EQUAL(pool.Docs.Id[i], ToString(i));
+        }
+    }
 }
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <catboost/libs/algo/calc_score_cache.h>
+#include <catboost/libs/algo/ctr_helper.h>
 #include <catboost/libs/algo/fold.h>
 #include <catboost/libs/algo/online_predictor.h>
 #include <catboost/libs/algo/score_calcer.h>
 #include <catboost/libs/algo/target_classifier.h>
 #include <catboost/libs/algo/dataset.h>
+#include <catboost/libs/helpers/exception.h>
 #include <catboost/libs/helpers/restorable_rng.h>
 #include <catboost/libs/metrics/metric.h>
 #include <catboost/libs/options/catboost_options.h>
@@ -36,25 +38,199 @@ public:
     SAVELOAD(Data);
 };
 
+// Bucket stats sent as floats, see TStats3D. Count stays double, since float sums of document counts
+// or weights are exact only up to 2^24
+struct TBucketStatsSingleWire {
+    float SumWeightedDelta;
+    float SumWeight;
+    float SumDelta;
+    double Count;
+    SAVELOAD(SumWeightedDelta, SumWeight, SumDelta, Count);
+};
+
 struct TStats3D {
     TVector<TBucketStats> Stats; // [bodyTail & approxDim][leaf][bucket]
     int BucketCount;
     int MaxLeafCount;
+    ESplitType SplitType = ESplitType::FloatFeature; // one hot features are scored differently
+    bool IsSinglePrecisionWire = false; // stats are sent as floats, see TObliviousTreeLearnerOptions::SinglePrecisionScoreStats
     TStats3D() = default;
-    TStats3D(const TVector<TBucketStats>& stats, int bucketCount, int maxLeafCount)
-    : Stats(stats)
+    TStats3D(TVector<TBucketStats>&& stats, int bucketCount, int maxLeafCount, ESplitType splitType, bool isSinglePrecisionWire)
+    : Stats(std::move(stats))
     , BucketCount(bucketCount)
     , MaxLeafCount(maxLeafCount)
+    , SplitType(splitType)
+    , IsSinglePrecisionWire(isSinglePrecisionWire)
     {
     }
-    SAVELOAD(Stats, BucketCount, MaxLeafCount);
+
+    // Wire format: header, bitmask of nonempty buckets and values of nonempty buckets only,
+    // buckets of leaves not reached yet and of rare feature values are mostly empty
+    int operator&(IBinSaver& f) {
+        f.Add(1, &BucketCount);
+        f.Add(2, &MaxLeafCount);
+        f.Add(3, &SplitType);
+        f.Add(4, &IsSinglePrecisionWire);
+        ui64 statsCount = Stats.size();
+        f.Add(5, &statsCount);
+        TVector<ui64> isNonEmpty; // bitmask [statsIdx]
+        if (f.IsReading()) {
+            f.Add(6, &isNonEmpty);
+            Stats.yresize(statsCount);
+            if (IsSinglePrecisionWire) {
+                TVector<TBucketStatsSingleWire> values;
+                f.Add(7, &values);
+                UnpackNonEmpty(isNonEmpty, values);
+            } else {
+                TVector<TBucketStats> values;
+                f.Add(7, &values);
+                UnpackNonEmpty(isNonEmpty, values);
+            }
+        } else {
+            isNonEmpty.resize((statsCount + 63) / 64);
+            size_t nonEmptyCount = 0;
+            for (ui64 statsIdx = 0; statsIdx < statsCount; ++statsIdx) {
+                if (!IsEmpty(Stats[statsIdx])) {
+                    isNonEmpty[statsIdx / 64] |= 1ULL << (statsIdx % 64);
+                    ++nonEmptyCount;
+                }
+            }
+            f.Add(6, &isNonEmpty);
+            if (IsSinglePrecisionWire) {
+                TVector<TBucketStatsSingleWire> values = PackNonEmpty<TBucketStatsSingleWire>(isNonEmpty, nonEmptyCount);
+                f.Add(7, &values);
+            } else {
+                TVector<TBucketStats> values = PackNonEmpty<TBucketStats>(isNonEmpty, nonEmptyCount);
+                f.Add(7, &values);
+            }
+        }
+        return 0;
+    }
+
+private:
+    static bool IsEmpty(const TBucketStats& stats) {
+        return stats.Count == 0 && stats.SumWeight == 0 && stats.SumWeightedDelta == 0 && stats.SumDelta == 0;
+    }
+
+    static bool IsSet(const TVector<ui64>& bitmask, size_t idx) {
+        return (bitmask[idx / 64] >> (idx % 64)) & 1;
+    }
+
+    template <typename TWireStats>
+    TVector<TWireStats> PackNonEmpty(const TVector<ui64>& isNonEmpty, size_t nonEmptyCount) const {
+        TVector<TWireStats> values;
+        values.yresize(nonEmptyCount);
+        size_t valueIdx = 0;
+        for (size_t statsIdx = 0; statsIdx < Stats.size(); ++statsIdx) {
+            if (IsSet(isNonEmpty, statsIdx)) {
+                const TBucketStats& stats = Stats[statsIdx];
+                values[valueIdx++] = {
+                    static_cast<decltype(TWireStats::SumWeightedDelta)>(stats.SumWeightedDelta),
+                    static_cast<decltype(TWireStats::SumWeight)>(stats.SumWeight),
+                    static_cast<decltype(TWireStats::SumDelta)>(stats.SumDelta),
+                    static_cast<decltype(TWireStats::Count)>(stats.Count)
+                };
+            }
+        }
+        return values;
+    }
+
+    template <typename TWireStats>
+    void UnpackNonEmpty(const TVector<ui64>& isNonEmpty, const TVector<TWireStats>& values) {
+        size_t valueIdx = 0;
+        for (size_t statsIdx = 0; statsIdx < Stats.size(); ++statsIdx) {
+            if (IsSet(isNonEmpty, statsIdx)) {
+                CB_ENSURE(valueIdx < values.size(), "Corrupted bucket stats");
+                const TWireStats& value = values[valueIdx++];
+                Stats[statsIdx] = {value.SumWeightedDelta, value.SumWeight, value.SumDelta, value.Count};
+            } else {
+                Stats[statsIdx] = {0, 0, 0, 0};
+            }
+        }
+        CB_ENSURE(valueIdx == values.size(), "Corrupted bucket stats");
+    }
+};
+
+// Online ctr of a projection requested by master
+struct TOnlineCtrRequest {
+    TProjection Projection;
+    TVector<TCtrInfo> CtrInfo;
+    bool DropCached = false; // worker recomputes the ctr even if it is cached
+    SAVELOAD(Projection, CtrInfo, DropCached);
+};
+
+// Distinct ctr hash values of worker learn documents and their target class counts
+struct TCtrHashStats {
+    bool IsCached = false; // ctr is already computed by worker, only FeatureValueCount is filled
+    size_t FeatureValueCount = 0;
+    TVector<ui64> Hashes; // in order of first occurrence in worker plain fold
+    TVector<int> DocCounts; // [hashIdx]
+    TVector<TVector<int>> ClassCounts; // [targetClassifierIdx][hashIdx * targetClassesCount + classIdx], empty for classifiers unused by ctrs
+    SAVELOAD(IsCached, FeatureValueCount, Hashes, DocCounts, ClassCounts);
 };
 
+// Leaves of worker hash values and counters of learn documents on preceding workers, see ComputeShardOnlineCTRs
+struct TCtrShardCounters {
+    TOnlineCtrRequest Request;
+    TVector<ui32> HashLeaves; // [hashIdx] in TCtrHashStats::Hashes order
+    ui32 LeafCount = 0;
+    size_t FeatureValueCount = 0;
+    TVector<TVector<int>> PrefixClassCounts; // [targetClassifierIdx][leafIdx * targetClassesCount + classIdx]
+    TVector<int> CounterTotal; // [leafIdx]
+    int CounterDenominator = 0;
+    SAVELOAD(Request, HashLeaves, LeafCount, FeatureValueCount, PrefixClassCounts, CounterTotal, CounterDenominator);
+};
+
+using TOnlineCtrRequests = TVector<TOnlineCtrRequest>;
+using TMetricIndices = TVector<int>; // indices of metrics created by CreateMetrics
+using TMetricStats = TVector<TVector<double>>; // [metricIdx] TMetricHolder::Stats
+using TCtrHashStatsList = TVector<TCtrHashStats>; // [projection]
+using TCtrShardCountersList = TVector<TCtrShardCounters>; // [projection]
 using TStats5D = TVector<TVector<TStats3D>>; // [cand][subCand][bodyTail & approxDim][leaf][bucket]
 using TStats4D = TVector<TStats3D>; // [subCand][bodyTail & approxDim][leaf][bucket]
 using TIsLeafEmpty = TVector<bool>;
 using TSums = TVector<TSum>;
 
+// Part of learn pool file that worker reads and binarizes itself, see TSystemOptions::WorkersLoadLearnPool
+struct TWorkerPoolPart {
+    TString PoolPath; // [scheme://]path, empty if master sends binarized part in TTrainData::TrainData
+    TString PairsFilePath; // [scheme://]path, empty if there are no pairs
+    TString CdFilePath; // [scheme://]path, empty if there is no column description
+    bool HasHeader = false;
+    char Delimiter = '\t';
+    TVector<int> IgnoredFeatures;
+    std::pair<ui64, ui64> ByteRange; // lines starting in this range of pool file, see NCB::ReadPoolPart
+    TVector<TVector<float>> FloatFeatureBorders; // [floatFeatureIdx]
+    TVector<int> CatFeatures; // flat indices
+    TAllFeatures FeaturesLayout; // first document of pool sample binarized by master, holds one hot values and storage of features
+    bool IsDefined() const {
+        return !PoolPath.empty();
+    }
+    SAVELOAD(PoolPath, PairsFilePath, CdFilePath, HasHeader, Delimiter, IgnoredFeatures, ByteRange, FloatFeatureBorders, CatFeatures, FeaturesLayout);
+};
+
+// Documents read by worker from its pool part, see TPoolPartLoader
+struct TPoolPartStats {
+    int DocCount = 0;
+    double SumWeight = 0;
+    SAVELOAD(DocCount, SumWeight);
+};
+
+// Place of worker part in learn set and totals over all workers, see TPlainFoldBuilder
+struct TPlainFoldParams {
+    int DocOffset = 0; // index of the first document of the part in pool file order, pairs are numbered in this order
+    int AllDocCount = 0;
+    double SumAllWeights = 0;
+    SAVELOAD(DocOffset, AllDocCount, SumAllWeights);
+};
+
+// Documents in leaves of the tree on worker, see TCalcApproxStarter
+struct TLeafStats {
+    TVector<int> DocCounts; // [leafIdx]
+    TVector<double> SumWeights; // [leafIdx]
+    SAVELOAD(DocCounts, SumWeights);
+};
+
 struct TTrainData : public IObjectBase {
     OBJECT_NOCOPY_METHODS(TTrainData);
 public:
@@ -65,28 +241,25 @@ public:
         ui64 randomSeed,
         int approxDimension,
         const TString& stringParams,
-        int allDocCount,
-        double sumAllWeights)
+        const TWorkerPoolPart& poolPart = TWorkerPoolPart())
     : TrainData(trainData)
     , TargetClassifiers(targetClassifiers)
     , SplitCounts(splitCounts)
     , RandomSeed(randomSeed)
     , ApproxDimension(approxDimension)
     , StringParams(stringParams)
-    , AllDocCount(allDocCount)
-    , SumAllWeights(sumAllWeights)
+    , PoolPart(poolPart)
     {
     }
-    ::TDataset TrainData;
+    ::TDataset TrainData; // empty if PoolPart is defined, use GetTrainData on workers
     TVector<TTargetClassifier> TargetClassifiers;
     TVector<int> SplitCounts;
     ui64 RandomSeed;
     int ApproxDimension;
     TString StringParams;
-    int AllDocCount;
-    double SumAllWeights;
+    TWorkerPoolPart PoolPart;
 
-    SAVELOAD(TrainData, TargetClassifiers, SplitCounts, RandomSeed, ApproxDimension, StringParams, AllDocCount, SumAllWeights);
+    SAVELOAD(TrainData, TargetClassifiers, SplitCounts, RandomSeed, ApproxDimension, StringParams, PoolPart);
 };
 
 struct TLocalTensorSearchData {
@@ -111,6 +284,9 @@ struct TLocalTensorSearchData {
     int AllDocCount;
     double SumAllWeights;
 
+    ::TDataset LoadedTrainData; // learn part read by worker itself if TTrainData::PoolPart is defined
+    TVector<ui64> LoadedDocIndices; // [doc in pool part file order] index in LoadedTrainData, which is shuffled
+
     NCatboostOptions::TCatBoostOptions Params;
     TLocalTensorSearchData()
     : Params(ETaskType::CPU)
@@ -120,4 +296,8 @@ struct TLocalTensorSearchData {
         return *Singleton<TLocalTensorSearchData>();
     }
 };
+
+inline const ::TDataset& GetTrainData(const TTrainData& trainData) {
+    return trainData.PoolPart.IsDefined() ? TLocalTensorSearchData::GetRef().LoadedTrainData : trainData.TrainData;
+}
 } // NCatboostDistributed
@@ -2,24 +2,127 @@
 
 #include <catboost/libs/algo/approx_calcer.h>
 #include <catboost/libs/algo/error_functions.h>
+#include <catboost/libs/algo/greedy_tensor_search.h>
+#include <catboost/libs/algo/index_hash_calcer.h>
+#include <catboost/libs/algo/online_ctr.h>
+#include <catboost/libs/data/doc_pool_data_provider.h>
+#include <catboost/libs/data/load_data.h>
 #include <catboost/libs/helpers/exception.h>
+#include <catboost/libs/helpers/permutation.h>
+#include <catboost/libs/metrics/metric.h>
+
+#include <util/generic/algorithm.h>
+#include <util/generic/ymath.h>
+
+#include <numeric>
 
 namespace NCatboostDistributed {
-void TPlainFoldBuilder::DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* /*unused*/) const {
+static void InitLocalData(const TTrainData& trainData, int hostId, TLocalTensorSearchData* localData) {
+    localData->Rand = new TRestorableFastRng64(trainData.RandomSeed + hostId);
+    NJson::TJsonValue jsonParams;
+    const bool jsonParamsOK = ReadJsonTree(trainData.StringParams, &jsonParams);
+    Y_ASSERT(jsonParamsOK);
+    localData->Params.Load(jsonParams);
+    localData->StoreExpApprox = IsStoreExpApprox(localData->Params.LossFunctionDescription->GetLossFunction());
+}
+
+// Reads lines of the byte range of pool file and prepares them as master prepares learn pool sample.
+// Documents are shuffled within the part, parts follow in file order, see MapLoadPlainFold
+void TPoolPartLoader::DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* poolPartStats) const {
     NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
     auto& localData = TLocalTensorSearchData::GetRef();
-    auto& plainFold = localData.PlainFold;
-    localData.Rand = new TRestorableFastRng64(trainData->RandomSeed + hostId);
+    InitLocalData(*trainData, hostId, &localData);
+    const auto& poolPart = trainData->PoolPart;
+    const auto& params = localData.Params;
 
-    NJson::TJsonValue jsonParams;
-    const bool jsonParamsOK = ReadJsonTree(trainData->StringParams, &jsonParams);
-    Y_ASSERT(jsonParamsOK);
-    localData.Params.Load(jsonParams);
-    localData.StoreExpApprox = IsStoreExpApprox(localData.Params.LossFunctionDescription->GetLossFunction());
-    plainFold = TFold::BuildPlainFold(trainData->TrainData,
+    NCatboostOptions::TDsvPoolFormatParams dsvPoolFormatParams;
+    dsvPoolFormatParams.Format.HasHeader = poolPart.HasHeader;
+    dsvPoolFormatParams.Format.Delimiter = poolPart.Delimiter;
+    if (!poolPart.CdFilePath.empty()) {
+        dsvPoolFormatParams.CdFilePath = NCB::TPathWithScheme(poolPart.CdFilePath);
+    }
+    TPool pool;
+    NCB::ReadPoolPart(NCB::TPathWithScheme(poolPart.PoolPath),
+        dsvPoolFormatParams,
+        poolPart.IgnoredFeatures,
+        poolPart.ByteRange,
+        params.DataProcessingOptions->ClassNames,
+        &NPar::LocalExecutor(),
+        &pool);
+
+    TVector<ui64> indices(pool.Docs.GetDocCount());
+    std::iota(indices.begin(), indices.end(), 0);
+    Shuffle(pool.Docs.QueryId, *localData.Rand, &indices);
+    localData.LoadedDocIndices = InvertPermutation(indices);
+    ApplyPermutation(localData.LoadedDocIndices, &pool, &NPar::LocalExecutor());
+
+    auto& trainPart = localData.LoadedTrainData;
+    trainPart = BuildDataset(pool);
+    // distributed training supports 1D approxes only, so class labels need no converter
+    Preprocess(params.LossFunctionDescription, params.DataProcessingOptions->ClassWeights, TLabelConverter(), trainPart);
+
+    TVector<TFloatFeature> floatFeatures;
+    for (int floatFeatureIdx = 0; floatFeatureIdx < poolPart.FloatFeatureBorders.ysize(); ++floatFeatureIdx) {
+        floatFeatures.emplace_back(/*hasNans*/ false, floatFeatureIdx, /*flatFeatureIdx*/ -1, poolPart.FloatFeatureBorders[floatFeatureIdx]);
+    }
+    // binarized as a test set of the sample, so that cat feature values are remapped as on master
+    // and values unseen in the sample are appended to OneHotValues, ctr hashes are computed from the values themselves
+    PrepareAllFeaturesTest(THashSet<int>(poolPart.CatFeatures.begin(), poolPart.CatFeatures.end()),
+        floatFeatures,
+        poolPart.FeaturesLayout,
+        /*allowNansOnlyInTest*/ true,
+        params.DataProcessingOptions->FloatFeaturesBinarization->NanMode,
+        /*clearPool*/ true,
+        NPar::LocalExecutor(),
+        /*selectedDocIndices*/ {},
+        &pool.Docs,
+        &trainPart.AllFeatures);
+
+    poolPartStats->Data.DocCount = trainPart.GetSampleCount();
+    poolPartStats->Data.SumWeight = trainPart.Weights.empty()
+        ? trainPart.GetSampleCount()
+        : Accumulate(trainPart.Weights.begin(), trainPart.Weights.end(), 0.0);
+}
+
+// Pairs of the whole pool numbered in file order, only pairs of documents of the part are kept
+static void LoadPoolPartPairs(const TString& pairsFilePath,
+                              const TPlainFoldParams& plainFoldParams,
+                              const TVector<ui64>& loadedDocIndices,
+                              ::TDataset* trainPart) {
+    const int docOffset = plainFoldParams.DocOffset;
+    const int docCount = loadedDocIndices.ysize();
+    TVector<TPair> pairs = NCB::ReadPairs(NCB::TPathWithScheme(pairsFilePath), plainFoldParams.AllDocCount);
+    trainPart->Pairs.clear();
+    for (const auto& pair : pairs) {
+        const int winnerId = pair.WinnerId - docOffset;
+        const int loserId = pair.LoserId - docOffset;
+        if (winnerId < 0 || winnerId >= docCount || loserId < 0 || loserId >= docCount) {
+            continue;
+        }
+        trainPart->Pairs.emplace_back(loadedDocIndices[winnerId], loadedDocIndices[loserId], pair.Weight);
+    }
+    if (trainPart->HasGroupWeight) {
+        NCB::WeightPairs(trainPart->Weights, &trainPart->Pairs);
+    }
+}
+
+void TPlainFoldBuilder::DoMap(NPar::IUserContext* ctx, int hostId, TInput* plainFoldParams, TOutput* /*unused*/) const {
+    NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
+    auto& localData = TLocalTensorSearchData::GetRef();
+    auto& plainFold = localData.PlainFold;
+    if (trainData->PoolPart.IsDefined()) {
+        // parameters are set by TPoolPartLoader
+        if (!trainData->PoolPart.PairsFilePath.empty()) {
+            LoadPoolPartPairs(trainData->PoolPart.PairsFilePath, plainFoldParams->Data, localData.LoadedDocIndices, &localData.LoadedTrainData);
+        }
+        UpdateQueryInfo(&localData.LoadedTrainData);
+    } else {
+        InitLocalData(*trainData, hostId, &localData);
+    }
+    plainFold = TFold::BuildPlainFold(GetTrainData(*trainData),
         trainData->TargetClassifiers,
         /*shuffle*/ false,
-        trainData->TrainData.GetSampleCount(),
+        GetTrainData(*trainData).GetSampleCount(),
         trainData->ApproxDimension,
         localData.StoreExpApprox,
         IsPairwiseError(localData.Params.LossFunctionDescription->GetLossFunction()),
@@ -29,11 +132,11 @@ void TPlainFoldBuilder::DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unu
     localData.SampledDocs.Create({plainFold}, isPairwiseScoring, GetBernoulliSampleRate(localData.Params.ObliviousTreeOptions->BootstrapConfig));
     localData.SmallestSplitSideDocs.Create({plainFold}, isPairwiseScoring);
     localData.PrevTreeLevelStats.Create({plainFold},
-        CountNonCtrBuckets(trainData->SplitCounts, trainData->TrainData.AllFeatures.OneHotValues),
+        CountNonCtrBuckets(trainData->SplitCounts, GetTrainData(*trainData).AllFeatures.OneHotValues),
         localData.Params.ObliviousTreeOptions->MaxDepth);
     localData.Indices.yresize(plainFold.LearnPermutation.ysize());
-    localData.AllDocCount = trainData->AllDocCount;
-    localData.SumAllWeights = trainData->SumAllWeights;
+    localData.AllDocCount = plainFoldParams->Data.AllDocCount;
+    localData.SumAllWeights = plainFoldParams->Data.SumAllWeights;
 }
 
 void TTensorSearchStarter::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* /*unused*/) const {
@@ -41,6 +144,7 @@ void TTensorSearchStarter::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TI
     localData.Depth = 0;
     Fill(localData.Indices.begin(), localData.Indices.end(), 0);
     localData.PrevTreeLevelStats.GarbageCollect();
+    localData.PlainFold.TrimOnlineCTR(MAX_ONLINE_CTR_FEATURES, GetMaxOnlineCTRMemory(localData.Params, /*foldCount*/ 1));
 }
 
 void TBootstrapMaker::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* /*unused*/) const {
@@ -51,6 +155,123 @@ void TBootstrapMaker::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput*
         &localData.SampledDocs,
         &NPar::LocalExecutor(),
         localData.Rand.Get());
+    if (IsSampledOutSiblingScoring(localData.Params)) {
+        localData.SmallestSplitSideDocs.SelectSampledOutSibling(localData.Depth, localData.PlainFold, localData.Indices, localData.SampledDocs, &NPar::LocalExecutor());
+    }
+}
+
+// Replaces ctr hash values of plain fold documents by their indices in distinctHashes, which are in order of first occurrence
+static void EnumerateCtrHashes(const TProjection& proj,
+                               const TAllFeatures& allFeatures,
+                               const TFold& fold,
+                               TVector<ui64>* hashIndices,
+                               TVector<ui64>* distinctHashes) {
+    hashIndices->yresize(fold.LearnPermutation.size());
+    // workers remap cat feature values unseen by master independently, so hashes are computed from the values themselves
+    CalcHashesParallel(proj, allFeatures, 0, &fold.LearnPermutation, /*calculateExactCatHashes*/ true, &NPar::LocalExecutor(), hashIndices->begin(), hashIndices->end());
+    TDenseHash<ui64, ui32> hashToIdx;
+    distinctHashes->clear();
+    for (auto& hash : *hashIndices) {
+        bool isInserted = false;
+        auto& hashIdx = hashToIdx.GetMutable(hash, &isInserted);
+        if (isInserted) {
+            hashIdx = distinctHashes->size();
+            distinctHashes->push_back(hash);
+        }
+        hash = hashIdx;
+    }
+}
+
+void CollectCtrHashStats(const TOnlineCtrRequest& request, const TAllFeatures& allFeatures, const TFold& fold, TCtrHashStats* stats) {
+    TVector<ui64> hashIndices;
+    EnumerateCtrHashes(request.Projection, allFeatures, fold, &hashIndices, &stats->Hashes);
+    const size_t hashCount = stats->Hashes.size();
+    stats->DocCounts.assign(hashCount, 0);
+    for (ui64 hashIdx : hashIndices) {
+        ++stats->DocCounts[hashIdx];
+    }
+    stats->ClassCounts.resize(fold.TargetClassesCount.size());
+    for (const auto& ctrInfo : request.CtrInfo) {
+        const ui32 classifierIdx = ctrInfo.TargetClassifierIdx;
+        auto& classCounts = stats->ClassCounts[classifierIdx];
+        if (ctrInfo.Type == ECtrType::Counter || !classCounts.empty()) {
+            continue;
+        }
+        const int targetClassesCount = fold.TargetClassesCount[classifierIdx];
+        const auto& targetClass = fold.LearnTargetClass[classifierIdx];
+        classCounts.assign(hashCount * targetClassesCount, 0);
+        for (int doc = 0; doc < hashIndices.ysize(); ++doc) {
+            ++classCounts[hashIndices[doc] * targetClassesCount + targetClass[doc]];
+        }
+    }
+}
+
+void CalcShardOnlineCtrs(const TCtrShardCounters& counters, const TAllFeatures& allFeatures, const TFold& fold, NPar::TLocalExecutor* localExecutor, TOnlineCTR* dst) {
+    TVector<ui64> leafIndices;
+    TVector<ui64> distinctHashes;
+    EnumerateCtrHashes(counters.Request.Projection, allFeatures, fold, &leafIndices, &distinctHashes);
+    Y_ASSERT(distinctHashes.size() == counters.HashLeaves.size());
+    for (auto& leafIdx : leafIndices) {
+        leafIdx = counters.HashLeaves[leafIdx];
+    }
+    ComputeShardOnlineCTRs(leafIndices,
+        counters.LeafCount,
+        counters.FeatureValueCount,
+        counters.Request.CtrInfo,
+        counters.PrefixClassCounts,
+        counters.CounterTotal,
+        counters.CounterDenominator,
+        fold,
+        localExecutor,
+        dst);
+}
+
+void TOnlineCtrHashCollector::DoMap(NPar::IUserContext* ctx, int hostId, TInput* requests, TOutput* hashStats) const {
+    NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
+    auto& localData = TLocalTensorSearchData::GetRef();
+    auto& plainFold = localData.PlainFold;
+    const int requestCount = requests->Data.ysize();
+    hashStats->Data.resize(requestCount);
+    for (int requestIdx = 0; requestIdx < requestCount; ++requestIdx) {
+        const auto& request = requests->Data[requestIdx];
+        auto& stats = hashStats->Data[requestIdx];
+        plainFold.MarkCtrUsed(request.Projection);
+        auto& ctr = plainFold.GetCtrRef(request.Projection);
+        if (request.DropCached) {
+            ctr.Feature.clear();
+        }
+        stats.FeatureValueCount = ctr.FeatureValueCount;
+        stats.IsCached = !ctr.Feature.empty();
+    }
+    NPar::LocalExecutor().ExecRange([&](int requestIdx) {
+        auto& stats = hashStats->Data[requestIdx];
+        if (!stats.IsCached) {
+            CollectCtrHashStats(requests->Data[requestIdx], GetTrainData(*trainData).AllFeatures, plainFold, &stats);
+        }
+    }, 0, requestCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
+void TOnlineCtrCalcer::DoMap(NPar::IUserContext* ctx, int hostId, TInput* shardCounters, TOutput* /*unused*/) const {
+    NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
+    auto& localData = TLocalTensorSearchData::GetRef();
+    auto& plainFold = localData.PlainFold;
+    const int projectionCount = shardCounters->Data.ysize();
+    TVector<TOnlineCTR*> dstCtrs(projectionCount);
+    for (int projectionIdx = 0; projectionIdx < projectionCount; ++projectionIdx) {
+        dstCtrs[projectionIdx] = &plainFold.GetCtrRef(shardCounters->Data[projectionIdx].Request.Projection); // not thread-safe
+    }
+    NPar::LocalExecutor().ExecRange([&](int projectionIdx) {
+        CalcShardOnlineCtrs(shardCounters->Data[projectionIdx], GetTrainData(*trainData).AllFeatures, plainFold, &NPar::LocalExecutor(), dstCtrs[projectionIdx]);
+    }, 0, projectionCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
+void TCtrHashStatsCollector::DoMap(NPar::IUserContext* ctx, int hostId, TInput* requests, TOutput* hashStats) const {
+    NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
+    const auto& localData = TLocalTensorSearchData::GetRef();
+    hashStats->Data.resize(requests->Data.size());
+    NPar::LocalExecutor().ExecRange([&](int requestIdx) {
+        CollectCtrHashStats(requests->Data[requestIdx], GetTrainData(*trainData).AllFeatures, localData.PlainFold, &hashStats->Data[requestIdx]);
+    }, 0, requests->Data.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
 }
 
 void TScoreCalcer::DoMap(NPar::IUserContext* ctx, int hostId, TInput* candidateList, TOutput* bucketStats) const {
@@ -65,11 +286,10 @@ void TScoreCalcer::DoMap(NPar::IUserContext* ctx, int hostId, TInput* candidateL
         NPar::LocalExecutor().ExecRange([&](int oneCandidate) {
             if (candidate.Candidates[oneCandidate].SplitCandidate.Type == ESplitType::OnlineCtr) {
                 const auto& proj = candidate.Candidates[oneCandidate].SplitCandidate.Ctr.Projection;
-                // so far distributed training works only for floating-point features
-                // this assert fails because we do call ComputeOnlineCRTs like we do in single node training
-                Y_ASSERT(!localData.PlainFold.GetCtrRef(proj).Feature.empty());
+                // online ctrs are computed by TOnlineCtrCalcer before scoring
+                Y_ASSERT(!localData.PlainFold.GetCtr(proj).Feature.empty());
             }
-            allScores[oneCandidate] = CalcStats3D(trainData->TrainData.AllFeatures,
+            allScores[oneCandidate] = CalcStats3D(GetTrainData(*trainData).AllFeatures,
                                         trainData->SplitCounts,
                                         localData.PlainFold.GetAllCtrs(),
                                         localData.SampledDocs,
@@ -90,11 +310,10 @@ void TRemoteBinCalcer::DoMap(NPar::IUserContext* ctx, int hostId, TInput* candid
     for (int subcandidateIdx = 0; subcandidateIdx < candidate->Candidates.ysize(); ++subcandidateIdx) {
         if (candidate->Candidates[subcandidateIdx].SplitCandidate.Type == ESplitType::OnlineCtr) {
             const auto& proj = candidate->Candidates[subcandidateIdx].SplitCandidate.Ctr.Projection;
-            // so far distributed training works only for floating-point features
-            // this assert fails because we do call ComputeOnlineCRTs like we do in single node training
-            Y_ASSERT(!localData.PlainFold.GetCtrRef(proj).Feature.empty());
+            // online ctrs are computed by TOnlineCtrCalcer before scoring
+            Y_ASSERT(!localData.PlainFold.GetCtr(proj).Feature.empty());
         }
-        (*bucketStats)[subcandidateIdx] = CalcStats3D(trainData->TrainData.AllFeatures,
+        (*bucketStats)[subcandidateIdx] = CalcStats3D(GetTrainData(*trainData).AllFeatures,
                                         trainData->SplitCounts,
                                         localData.PlainFold.GetAllCtrs(),
                                         localData.SampledDocs,
@@ -107,23 +326,12 @@ void TRemoteBinCalcer::DoMap(NPar::IUserContext* ctx, int hostId, TInput* candid
 }
 
 void TRemoteBinCalcer::DoReduce(TVector<TOutput>* bucketStatsFromAllWorkers, TOutput* bucketStats) const { // vector<TStats4D> -> TStats4D
-    const int workerCount = bucketStatsFromAllWorkers->ysize();
-    *bucketStats = (*bucketStatsFromAllWorkers)[0];
-    const int leafCount = 1U << TLocalTensorSearchData::GetRef().Depth;
-    for (int workerIdx = 1; workerIdx < workerCount; ++workerIdx) {
-        const int subcandidateCount = bucketStats->ysize();
-        for (int subcandidateIdx = 0; subcandidateIdx < subcandidateCount; ++subcandidateIdx) {
-            const auto& stats = (*bucketStatsFromAllWorkers)[workerIdx][subcandidateIdx];
-            const int splitStatsCount = stats.BucketCount * stats.MaxLeafCount;
-            for (int statsIdx = 0; statsIdx * splitStatsCount < stats.Stats.ysize(); ++statsIdx) { // bodytail + dim
-                TBucketStats* firstStatsData = GetDataPtr((*bucketStats)[subcandidateIdx].Stats) + statsIdx * splitStatsCount;
-                const TBucketStats* statsData = GetDataPtr(stats.Stats) + statsIdx * splitStatsCount;
-                for (int bucketIdx = 0; bucketIdx < stats.BucketCount * leafCount; ++bucketIdx) { // bucket, leaf
-                    firstStatsData[bucketIdx].Add(statsData[bucketIdx]);
-                }
-            }
-        }
+    TVector<TOutput*> statsFromAllWorkers;
+    for (auto& workerStats : *bucketStatsFromAllWorkers) {
+        statsFromAllWorkers.push_back(&workerStats);
     }
+    SumStats4D(statsFromAllWorkers, &NPar::LocalExecutor());
+    *bucketStats = std::move((*bucketStatsFromAllWorkers)[0]);
 }
 
 void TRemoteScoreCalcer::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* bucketStats, TOutput* scores) const { // TStats4D -> TVector<TVector<double>> [subcandidate][bucket]
@@ -131,17 +339,21 @@ void TRemoteScoreCalcer::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInp
     scores->yresize(bucketStats->ysize());
     const int subcandidateCount = bucketStats->ysize();
     for (int subcandidateIdx = 0; subcandidateIdx < subcandidateCount; ++subcandidateIdx) {
-        (*scores)[subcandidateIdx] = GetScores(GetScoreBins((*bucketStats)[subcandidateIdx], ESplitType::FloatFeature, localData.Depth, localData.SumAllWeights, localData.AllDocCount, localData.Params));
+        (*scores)[subcandidateIdx] = GetScores(GetScoreBins((*bucketStats)[subcandidateIdx], (*bucketStats)[subcandidateIdx].SplitType, localData.Depth, localData.SumAllWeights, localData.AllDocCount, localData.Params));
     }
 }
 
-void TLeafIndexSetter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* bestSplitCandidate, TOutput* /*unused*/) const {
+void TLeafIndexSetter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* bestSplitCandidate, TOutput* isLeafEmpty) const {
     const TSplit bestSplit(bestSplitCandidate->Data.SplitCandidate, bestSplitCandidate->Data.BestBinBorderId);
-    Y_ASSERT(bestSplit.Type != ESplitType::OnlineCtr);
     auto& localData = TLocalTensorSearchData::GetRef();
+    if (bestSplit.Type == ESplitType::OnlineCtr) {
+        const auto& ctrs = localData.PlainFold.GetCtrs(bestSplit.Ctr.Projection);
+        CB_ENSURE(ctrs.has(bestSplit.Ctr.Projection) && !ctrs.at(bestSplit.Ctr.Projection).Feature.empty(),
+            "Online ctr of the best split is not computed on worker " << hostId);
+    }
     NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
     SetPermutedIndices(bestSplit,
-        trainData->TrainData.AllFeatures,
+        GetTrainData(*trainData).AllFeatures,
         localData.Depth + 1,
         localData.PlainFold,
         &localData.Indices,
@@ -150,10 +362,6 @@ void TLeafIndexSetter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* bestSp
         localData.SampledDocs.UpdateIndices(localData.Indices, &NPar::LocalExecutor());
         localData.SmallestSplitSideDocs.SelectSmallestSplitSide(localData.Depth + 1, localData.SampledDocs, &NPar::LocalExecutor());
     }
-}
-
-void TEmptyLeafFinder::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* isLeafEmpty) const {
-    auto& localData = TLocalTensorSearchData::GetRef();
     isLeafEmpty->Data = GetIsLeafEmpty(localData.Depth + 1, localData.Indices);
     ++localData.Depth; // tree level completed
 }
@@ -205,13 +413,13 @@ template<> void TBucketSimpleUpdater<TCustomError>::DoMap(NPar::IUserContext* /*
 template void TBucketSimpleUpdater<TUserDefinedPerObjectError>::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* sums) const;
 template void TBucketSimpleUpdater<TUserDefinedQuerywiseError>::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* sums) const;
 
-void TCalcApproxStarter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* splitTree, TOutput* /*unused*/) const {
+void TCalcApproxStarter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* splitTree, TOutput* leafStats) const {
     auto& localData = TLocalTensorSearchData::GetRef();
     Y_ASSERT(localData.PlainFold.GetApproxDimension() == 1);
     NPar::TCtxPtr<TTrainData> trainData(ctx, SHARED_ID_TRAIN_DATA, hostId);
     localData.Indices = BuildIndices(localData.PlainFold,
         splitTree->Data,
-        trainData->TrainData,
+        GetTrainData(*trainData),
         /*testDataPtrs*/ {},
         &NPar::LocalExecutor());
     if (localData.ApproxDeltas.empty()) {
@@ -223,6 +431,17 @@ void TCalcApproxStarter::DoMap(NPar::IUserContext* ctx, int hostId, TInput* spli
     Fill(localData.Buckets.begin(), localData.Buckets.end(), TSum(localData.Params.ObliviousTreeOptions->LeavesEstimationIterations));
     localData.LeafValues.yresize(splitTree->Data.GetLeafCount());
     localData.GradientIteration = 0;
+
+    const int leafCount = splitTree->Data.GetLeafCount();
+    const auto& learnWeights = localData.PlainFold.GetLearnWeights();
+    auto& stats = leafStats->Data;
+    stats.DocCounts.assign(leafCount, 0);
+    stats.SumWeights.assign(leafCount, 0);
+    for (int doc = 0; doc < localData.PlainFold.GetLearnSampleCount(); ++doc) {
+        const TIndexType leafIdx = localData.Indices[doc];
+        ++stats.DocCounts[leafIdx];
+        stats.SumWeights[leafIdx] += learnWeights.empty() ? 1.0 : learnWeights[doc];
+    }
 }
 
 void TDeltaSimpleUpdater::DoMap(NPar::IUserContext* /*unused*/, int /*unused*/, TInput* sums, TOutput* /*unused*/) const {
@@ -259,6 +478,41 @@ void TApproxSimpleUpdater::DoMap(NPar::IUserContext* /*unused*/, int /*unused*/,
     }
 }
 
+void TErrorCalcer::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* metricIndices, TOutput* metricStats) const {
+    const auto& localData = TLocalTensorSearchData::GetRef();
+    const auto& plainFold = localData.PlainFold;
+    // custom eval metric is not computed on workers, see MapCalcLearnErrors
+    const auto metrics = CreateMetrics(localData.Params.LossFunctionDescription,
+        localData.Params.MetricOptions,
+        /*evalMetricDescriptor*/ Nothing(),
+        plainFold.GetApproxDimension());
+    const int docCount = plainFold.GetLearnSampleCount();
+    TVector<TVector<double>> approx = plainFold.BodyTailArr[0].Approx; // plain fold approx of all documents
+    if (localData.StoreExpApprox) {
+        for (auto& approxDim : approx) {
+            for (auto& value : approxDim) {
+                value = log(value);
+            }
+        }
+    }
+    metricStats->Data.resize(metricIndices->Data.size());
+    for (int idx = 0; idx < metricIndices->Data.ysize(); ++idx) {
+        const auto& metric = metrics[metricIndices->Data[idx]];
+        Y_ASSERT(metric->IsAdditiveMetric());
+        if (docCount == 0) {
+            continue;
+        }
+        const bool isPerObject = metric->GetErrorType() == EErrorType::PerObjectError;
+        metricStats->Data[idx] = metric->Eval(approx,
+            plainFold.LearnTarget,
+            plainFold.GetLearnWeights(),
+            plainFold.LearnQueriesInfo,
+            /*begin*/ 0,
+            /*end*/ isPerObject ? docCount : plainFold.LearnQueriesInfo.ysize(),
+            NPar::LocalExecutor()).Stats;
+    }
+}
+
 template<typename TError>
 void TDerivativeSetter<TError>::DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* /*unused*/) const {
     auto& localData = TLocalTensorSearchData::GetRef();
@@ -298,7 +552,6 @@ REGISTER_SAVELOAD_NM_CLASS(0xd66d485, NCatboostDistributed, TScoreCalcer);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d585, NCatboostDistributed, TRemoteBinCalcer);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d685, NCatboostDistributed, TRemoteScoreCalcer);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d486, NCatboostDistributed, TLeafIndexSetter);
-REGISTER_SAVELOAD_NM_CLASS(0xd66d487, NCatboostDistributed, TEmptyLeafFinder);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d488, NCatboostDistributed, TCalcApproxStarter);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d489, NCatboostDistributed, TDeltaSimpleUpdater);
 REGISTER_SAVELOAD_NM_CLASS(0xd66d48a, NCatboostDistributed, TApproxSimpleUpdater);
@@ -336,3 +589,16 @@ REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4ab, NCatboostDistributed, TDerivativeSe
 REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4ac, NCatboostDistributed, TDerivativeSetter, TCustomError);
 REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4ad, NCatboostDistributed, TDerivativeSetter, TUserDefinedPerObjectError);
 REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4ae, NCatboostDistributed, TDerivativeSetter, TUserDefinedQuerywiseError);
+REGISTER_SAVELOAD_NM_CLASS(0xd66d4af, NCatboostDistributed, TOnlineCtrHashCollector);
+REGISTER_SAVELOAD_NM_CLASS(0xd66d4b0, NCatboostDistributed, TOnlineCtrCalcer);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b1, NCatboostDistributed, TEnvelope, TOnlineCtrRequests);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b2, NCatboostDistributed, TEnvelope, TCtrHashStatsList);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b3, NCatboostDistributed, TEnvelope, TCtrShardCountersList);
+REGISTER_SAVELOAD_NM_CLASS(0xd66d4b4, NCatboostDistributed, TPoolPartLoader);
+REGISTER_SAVELOAD_NM_CLASS(0xd66d4b5, NCatboostDistributed, TCtrHashStatsCollector);
+REGISTER_SAVELOAD_NM_CLASS(0xd66d4b6, NCatboostDistributed, TErrorCalcer);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b7, NCatboostDistributed, TEnvelope, TPoolPartStats);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b8, NCatboostDistributed, TEnvelope, TPlainFoldParams);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4b9, NCatboostDistributed, TEnvelope, TLeafStats);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4ba, NCatboostDistributed, TEnvelope, TMetricIndices);
+REGISTER_SAVELOAD_TEMPL1_NM_CLASS(0xd66d4bb, NCatboostDistributed, TEnvelope, TMetricStats);
@@ -16,9 +16,13 @@ struct TUnusedInitializedParam {
 private:
     char Zero;
 };
-class TPlainFoldBuilder: public NPar::TMapReduceCmd<TUnusedInitializedParam, TUnusedInitializedParam> {
+class TPoolPartLoader: public NPar::TMapReduceCmd<TUnusedInitializedParam, TEnvelope<TPoolPartStats>> {
+    OBJECT_NOCOPY_METHODS(TPoolPartLoader);
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* poolPartStats) const final;
+};
+class TPlainFoldBuilder: public NPar::TMapReduceCmd<TEnvelope<TPlainFoldParams>, TUnusedInitializedParam> {
     OBJECT_NOCOPY_METHODS(TPlainFoldBuilder);
-    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* /*unused*/) const final;
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* plainFoldParams, TOutput* /*unused*/) const final;
 };
 class TTensorSearchStarter: public NPar::TMapReduceCmd<TUnusedInitializedParam, TUnusedInitializedParam> {
     OBJECT_NOCOPY_METHODS(TTensorSearchStarter);
@@ -28,6 +32,22 @@ class TBootstrapMaker: public NPar::TMapReduceCmd<TUnusedInitializedParam, TUnus
     OBJECT_NOCOPY_METHODS(TBootstrapMaker);
     void DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* /*unused*/) const final;
 };
+class TOnlineCtrHashCollector: public NPar::TMapReduceCmd<TEnvelope<TOnlineCtrRequests>, TEnvelope<TCtrHashStatsList>> {
+    OBJECT_NOCOPY_METHODS(TOnlineCtrHashCollector);
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* requests, TOutput* hashStats) const final;
+};
+class TOnlineCtrCalcer: public NPar::TMapReduceCmd<TEnvelope<TCtrShardCountersList>, TUnusedInitializedParam> {
+    OBJECT_NOCOPY_METHODS(TOnlineCtrCalcer);
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* shardCounters, TOutput* /*unused*/) const final;
+};
+class TCtrHashStatsCollector: public NPar::TMapReduceCmd<TEnvelope<TOnlineCtrRequests>, TEnvelope<TCtrHashStatsList>> { // for test ctrs and final ctrs, plain fold is unchanged
+    OBJECT_NOCOPY_METHODS(TCtrHashStatsCollector);
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* requests, TOutput* hashStats) const final;
+};
+// Distinct ctr hash values of fold documents and their document and target class counts, see TOnlineCtrHashCollector
+void CollectCtrHashStats(const TOnlineCtrRequest& request, const TAllFeatures& allFeatures, const TFold& fold, TCtrHashStats* stats);
+// Online ctrs of fold documents seeded with counters from master, see TOnlineCtrCalcer
+void CalcShardOnlineCtrs(const TCtrShardCounters& counters, const TAllFeatures& allFeatures, const TFold& fold, NPar::TLocalExecutor* localExecutor, TOnlineCTR* dst);
 class TScoreCalcer: public NPar::TMapReduceCmd<TEnvelope<TCandidateList>, TEnvelope<TStats5D>> { // [cand][subcand][bodytail + dim][leaf][bucket]
     OBJECT_NOCOPY_METHODS(TScoreCalcer);
     void DoMap(NPar::IUserContext* ctx, int hostId, TInput* candidateList, TOutput* bucketStats) const final;
@@ -41,22 +61,18 @@ class TRemoteScoreCalcer: public NPar::TMapReduceCmd<TStats4D, TVector<TVector<d
     OBJECT_NOCOPY_METHODS(TRemoteScoreCalcer);
     void DoMap(NPar::IUserContext* ctx, int hostId, TInput* bucketStats, TOutput* scores) const final;
 };
-class TLeafIndexSetter: public NPar::TMapReduceCmd<TEnvelope<TCandidateInfo>, TUnusedInitializedParam> {
+class TLeafIndexSetter: public NPar::TMapReduceCmd<TEnvelope<TCandidateInfo>, TEnvelope<TIsLeafEmpty>> { // sets indices and finds empty leaves in one round trip
     OBJECT_NOCOPY_METHODS(TLeafIndexSetter);
-    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* bestSplitCandidate, TOutput* /*unused*/) const final;
-};
-class TEmptyLeafFinder: public NPar::TMapReduceCmd<TUnusedInitializedParam, TEnvelope<TIsLeafEmpty>> {
-    OBJECT_NOCOPY_METHODS(TEmptyLeafFinder);
-    void DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* isLeafEmpty) const final;
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* bestSplitCandidate, TOutput* isLeafEmpty) const final;
 };
 template<typename TError>
 class TBucketSimpleUpdater: public NPar::TMapReduceCmd<TUnusedInitializedParam, TEnvelope<TSums>> {
     OBJECT_NOCOPY_METHODS(TBucketSimpleUpdater);
     void DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* /*unused*/, TOutput* sums) const final;
 };
-class TCalcApproxStarter: public NPar::TMapReduceCmd<TEnvelope<TSplitTree>, TUnusedInitializedParam> {
+class TCalcApproxStarter: public NPar::TMapReduceCmd<TEnvelope<TSplitTree>, TEnvelope<TLeafStats>> {
     OBJECT_NOCOPY_METHODS(TCalcApproxStarter);
-    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* splitTree, TOutput* /*unused*/) const final;
+    void DoMap(NPar::IUserContext* ctx, int hostId, TInput* splitTree, TOutput* leafStats) const final;
 };
 class TDeltaSimpleUpdater: public NPar::TMapReduceCmd<TEnvelope<TSums>, TUnusedInitializedParam> {
     OBJECT_NOCOPY_METHODS(TDeltaSimpleUpdater);
@@ -66,6 +82,10 @@ class TApproxSimpleUpdater: public NPar::TMapReduceCmd<TUnusedInitializedParam,
     OBJECT_NOCOPY_METHODS(TApproxSimpleUpdater);
     void DoMap(NPar::IUserContext* ctx, int hostId, TInput* /*unused*/, TOutput* /*unused*/) const final;
 };
+class TErrorCalcer: public NPar::TMapReduceCmd<TEnvelope<TMetricIndices>, TEnvelope<TMetricStats>> {
+    OBJECT_NOCOPY_METHODS(TErrorCalcer);
+    void DoMap(NPar::IUserContext* /*ctx*/, int /*hostId*/, TInput* metricIndices, TOutput* metricStats) const final;
+};
 template<typename TError>
 class TDerivativeSetter: public NPar::TMapReduceCmd<TUnusedInitializedParam, TUnusedInitializedParam> {
     OBJECT_NOCOPY_METHODS(TDerivativeSetter);
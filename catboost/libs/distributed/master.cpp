@@ -1,14 +1,27 @@
 #include "master.h"
 #include "mappers.h"
 
+#include <catboost/libs/algo/approx_calcer.h>
 #include <catboost/libs/algo/error_functions.h>
 #include <catboost/libs/algo/index_calcer.h>
+#include <catboost/libs/algo/index_hash_calcer.h>
+#include <catboost/libs/algo/online_ctr.h>
 #include <catboost/libs/helpers/data_split.h>
+#include <catboost/libs/logging/logging.h>
+#include <catboost/libs/metrics/metric.h>
 
+#include <library/containers/dense_hash/dense_hash.h>
 #include <library/par/par_settings.h>
 
+#include <util/generic/algorithm.h>
+#include <util/string/builder.h>
+#include <util/system/fstat.h>
+
 using namespace NCatboostDistributed;
 
+// Candidates are scored in this many pipelined jobs, see MapRemoteCalcScore
+static constexpr int REMOTE_SCORE_BATCH_COUNT = 4;
+
 template<typename TData>
 static TVector<TData> GetWorkerPart(const TVector<TData>& column, const std::pair<size_t, size_t>& part) {
     const size_t columnSize = column.size();
@@ -29,11 +42,34 @@ static TVector<TVector<TData>> GetWorkerPart(const TVector<TVector<TData>>& mast
     return workerPart;
 }
 
+static TSparseFloatFeature GetWorkerPart(const TSparseFloatFeature& sparseFeature, const std::pair<size_t, size_t>& part) {
+    TSparseFloatFeature workerPart;
+    if (!sparseFeature.IsSparse()) {
+        return workerPart;
+    }
+    // worker part may start past the last document if there are fewer documents than workers
+    const size_t partEndDoc = Min<size_t>(part.second, sparseFeature.DocCount);
+    workerPart.DocCount = partEndDoc > part.first ? partEndDoc - part.first : 0;
+    workerPart.DefaultBin = sparseFeature.DefaultBin;
+    const auto partBegin = LowerBound(sparseFeature.DocIndices.begin(), sparseFeature.DocIndices.end(), part.first);
+    const auto partEnd = LowerBound(partBegin, sparseFeature.DocIndices.end(), part.second);
+    for (auto docIt = partBegin; docIt != partEnd; ++docIt) {
+        workerPart.DocIndices.push_back(*docIt - part.first);
+        workerPart.Bins.push_back(sparseFeature.Bins[docIt - sparseFeature.DocIndices.begin()]);
+    }
+    return workerPart;
+}
+
 static TAllFeatures GetWorkerPart(const TAllFeatures& allFeatures, const std::pair<size_t, size_t>& part) {
     TAllFeatures workerPart;
     workerPart.FloatHistograms = GetWorkerPart(allFeatures.FloatHistograms, part);
+    workerPart.PackedFloatHistograms = GetWorkerPart(allFeatures.PackedFloatHistograms, part);
+    workerPart.FloatFeaturesPacking = allFeatures.FloatFeaturesPacking;
+    for (const auto& sparseFeature : allFeatures.SparseFloatFeatures) {
+        workerPart.SparseFloatFeatures.emplace_back(GetWorkerPart(sparseFeature, part));
+    }
     workerPart.CatFeaturesRemapped = GetWorkerPart(allFeatures.CatFeaturesRemapped, part);
-    workerPart.OneHotValues = GetWorkerPart(allFeatures.OneHotValues, part);
+    workerPart.OneHotValues = allFeatures.OneHotValues; // [catFeatureIdx][remapped value], not per document
     workerPart.IsOneHot = allFeatures.IsOneHot;
     return workerPart;
 }
@@ -64,6 +100,19 @@ static TVector<typename TMapper::TOutput> ApplyMapper(int workerCount, TObj<NPar
     return mapperOutput;
 }
 
+template<typename TMapper>
+static TVector<typename TMapper::TOutput> ApplyMapperPerWorker(TObj<NPar::IEnvironment> environment, TVector<typename TMapper::TInput>* workerInputs) {
+    NPar::TJobDescription job;
+    job.SetCurrentOperation(new TMapper());
+    for (int workerIdx = 0; workerIdx < workerInputs->ysize(); ++workerIdx) {
+        job.AddQuery(workerIdx, (*workerInputs)[workerIdx]);
+    }
+    NPar::TJobExecutor exec(&job, environment);
+    TVector<typename TMapper::TOutput> mapperOutput;
+    exec.GetResultVec(&mapperOutput);
+    return mapperOutput;
+}
+
 void InitializeMaster(TLearnContext* ctx) {
     Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
     const auto& systemOptions = ctx->Params.SystemOptions;
@@ -86,37 +135,97 @@ void FinalizeMaster(TLearnContext* ctx) {
     }
 }
 
-void MapBuildPlainFold(const ::TDataset& trainData, TLearnContext* ctx) {
-    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
-    const auto& plainFold = ctx->LearnProgress.Folds[0];
-    Y_ASSERT(plainFold.PermutationBlockSize == plainFold.LearnPermutation.ysize());
-    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
-    TVector<std::pair<size_t, size_t>> workerParts;
-    if (trainData.QueryId.empty()) {
-        workerParts = Split(trainData.GetSampleCount(), workerCount);
-    } else {
-        workerParts = Split(trainData.GetSampleCount(), trainData.QueryId, workerCount);
-    }
+// Sends each worker its part of train data or a description of the part to read from learn pool file
+static void SetWorkerTrainData(const ::TDataset* trainData,
+                               const TVector<std::pair<size_t, size_t>>& workerParts,
+                               const TVector<TWorkerPoolPart>& workerPoolParts,
+                               TLearnContext* ctx) {
     const ui64 randomSeed = ctx->Rand.GenRand();
     const auto& splitCounts = CountSplits(ctx->LearnProgress.FloatFeatures);
     const auto& targetClassifiers = ctx->CtrsHelper.GetTargetClassifiers();
     NJson::TJsonValue jsonParams;
     ctx->Params.Save(&jsonParams);
     const TString stringParams = ToString(jsonParams);
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
     for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
         ctx->SharedTrainData->SetContextData(workerIdx,
             new NCatboostDistributed::TTrainData(
-                GetWorkerPart(trainData, workerParts[workerIdx]),
+                trainData != nullptr ? GetWorkerPart(*trainData, workerParts[workerIdx]) : ::TDataset(),
                 targetClassifiers,
                 splitCounts,
                 randomSeed,
                 ctx->LearnProgress.ApproxDimension,
                 stringParams,
-                plainFold.GetLearnSampleCount(),
-                plainFold.GetSumWeight()),
+                workerPoolParts.empty() ? TWorkerPoolPart() : workerPoolParts[workerIdx]),
             NPar::DELETE_RAW_DATA); // only workers
     }
-    ApplyMapper<TPlainFoldBuilder>(workerCount, ctx->SharedTrainData);
+}
+
+void MapBuildPlainFold(const ::TDataset& trainData, TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    TVector<std::pair<size_t, size_t>> workerParts;
+    if (trainData.QueryId.empty()) {
+        workerParts = Split(trainData.GetSampleCount(), workerCount);
+    } else {
+        workerParts = Split(trainData.GetSampleCount(), trainData.QueryId, workerCount);
+    }
+    SetWorkerTrainData(&trainData, workerParts, /*workerPoolParts*/ {}, ctx);
+    const auto& plainFold = ctx->LearnProgress.Folds[0];
+    Y_ASSERT(plainFold.PermutationBlockSize == plainFold.LearnPermutation.ysize());
+    ctx->AllDocCount = plainFold.GetLearnSampleCount();
+    ctx->SumAllWeights = plainFold.GetSumWeight();
+    TVector<TEnvelope<TPlainFoldParams>> plainFoldParams(workerCount);
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        plainFoldParams[workerIdx].Data.DocOffset = workerParts[workerIdx].first;
+        plainFoldParams[workerIdx].Data.AllDocCount = ctx->AllDocCount;
+        plainFoldParams[workerIdx].Data.SumAllWeights = ctx->SumAllWeights;
+    }
+    ApplyMapperPerWorker<TPlainFoldBuilder>(ctx->SharedTrainData, &plainFoldParams);
+}
+
+void MapLoadPlainFold(const NCatboostOptions::TPoolLoadParams& loadOptions, const ::TDataset& sampleData, TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    CB_ENSURE(sampleData.GetSampleCount() > 0, "Learn pool sample is empty");
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    TWorkerPoolPart poolPart;
+    poolPart.PoolPath = ToString(loadOptions.LearnSetPath);
+    poolPart.PairsFilePath = ToString(loadOptions.PairsFilePath);
+    poolPart.CdFilePath = ToString(loadOptions.DsvPoolFormatParams.CdFilePath);
+    poolPart.HasHeader = loadOptions.DsvPoolFormatParams.Format.HasHeader;
+    poolPart.Delimiter = loadOptions.DsvPoolFormatParams.Format.Delimiter;
+    poolPart.IgnoredFeatures = loadOptions.IgnoredFeatures;
+    for (const auto& floatFeature : ctx->LearnProgress.FloatFeatures) {
+        poolPart.FloatFeatureBorders.push_back(floatFeature.Borders);
+    }
+    poolPart.CatFeatures.assign(ctx->CatFeatures.begin(), ctx->CatFeatures.end());
+    poolPart.FeaturesLayout = GetWorkerPart(sampleData.AllFeatures, {0, 1});
+    // equal byte ranges, workers skip the partial line or group at the start of their ranges
+    const ui64 poolSize = TFileStat(loadOptions.LearnSetPath.Path).Size;
+    TVector<TWorkerPoolPart> workerPoolParts(workerCount, poolPart);
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        workerPoolParts[workerIdx].ByteRange = {poolSize * workerIdx / workerCount, poolSize * (workerIdx + 1) / workerCount};
+    }
+    SetWorkerTrainData(/*trainData*/ nullptr, /*workerParts*/ {}, workerPoolParts, ctx);
+    const auto poolPartStats = ApplyMapper<TPoolPartLoader>(workerCount, ctx->SharedTrainData);
+
+    TVector<TEnvelope<TPlainFoldParams>> plainFoldParams(workerCount);
+    int allDocCount = 0;
+    double sumAllWeights = 0;
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        plainFoldParams[workerIdx].Data.DocOffset = allDocCount;
+        allDocCount += poolPartStats[workerIdx].Data.DocCount;
+        sumAllWeights += poolPartStats[workerIdx].Data.SumWeight;
+    }
+    CB_ENSURE(allDocCount > 0, "Learn pool is empty");
+    ctx->AllDocCount = allDocCount;
+    ctx->SumAllWeights = sumAllWeights;
+    for (auto& params : plainFoldParams) {
+        params.Data.AllDocCount = allDocCount;
+        params.Data.SumAllWeights = sumAllWeights;
+    }
+    ApplyMapperPerWorker<TPlainFoldBuilder>(ctx->SharedTrainData, &plainFoldParams);
+    MATRIXNET_INFO_LOG << "Workers loaded " << allDocCount << " learn documents" << Endl;
 }
 
 void MapTensorSearchStart(TLearnContext* ctx) {
@@ -129,35 +238,499 @@ void MapBootstrap(TLearnContext* ctx) {
     ApplyMapper<TBootstrapMaker>(ctx->RootEnvironment->GetSlaveCount(), ctx->SharedTrainData);
 }
 
+namespace {
+    // Leaves of ctr hash values of all workers and of test documents, see AssignCtrLeaves
+    struct TCtrLeaves {
+        TVector<TVector<ui32>> WorkerHashLeaves; // [workerIdx][hashIdx]
+        size_t LearnLeafCount = 0;
+        TVector<ui64> TestLeaves; // [doc of concatenated test sets]
+        TVector<int> LeafDocCounts; // [leafIdx], test documents are counted for Counter ctrs with ECounterCalc::Full
+        bool HasCounterCtrs = false;
+        int CounterDenominator = 0;
+    };
+}
+
+// Leaves are assigned as ComputeReindexHash and UpdateReindexHash do for the whole learn set and test sets
+static TCtrLeaves AssignCtrLeaves(const TOnlineCtrRequest& request,
+                                  const TVector<const TCtrHashStats*>& workerStats,
+                                  const TDatasetPtrs& testDataPtrs,
+                                  const NCatboostOptions::TCatFeatureParams& catFeatureParams) {
+    const int workerCount = workerStats.ysize();
+    TDenseHash<ui64, ui32> hashToGlobalIdx;
+    TVector<int> globalDocCounts;
+    TVector<TVector<ui32>> workerGlobalIdx(workerCount);
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        const auto& stats = *workerStats[workerIdx];
+        workerGlobalIdx[workerIdx].yresize(stats.Hashes.size());
+        for (int hashIdx = 0; hashIdx < stats.Hashes.ysize(); ++hashIdx) {
+            bool isInserted = false;
+            auto& globalIdx = hashToGlobalIdx.GetMutable(stats.Hashes[hashIdx], &isInserted);
+            if (isInserted) {
+                globalIdx = globalDocCounts.size();
+                globalDocCounts.push_back(0);
+            }
+            globalDocCounts[globalIdx] += stats.DocCounts[hashIdx];
+            workerGlobalIdx[workerIdx][hashIdx] = globalIdx;
+        }
+    }
+    const size_t distinctCount = globalDocCounts.size();
+    const size_t learnSampleCount = Accumulate(globalDocCounts.begin(), globalDocCounts.end(), size_t(0));
+
+    ui64 topSize = catFeatureParams.CtrLeafCountLimit;
+    if (request.Projection.IsSingleCatFeature() && catFeatureParams.StoreAllSimpleCtrs) {
+        topSize = Max<ui64>();
+    }
+    TVector<ui32> globalLeaves(distinctCount);
+    TVector<bool> isKept(distinctCount, true); // test documents with dropped hash values get new leaves
+    TCtrLeaves leaves;
+    leaves.LearnLeafCount = distinctCount;
+    if (topSize <= learnSampleCount && distinctCount > topSize) {
+        TVector<ui32> byFrequency(distinctCount);
+        Iota(byFrequency.begin(), byFrequency.end(), 0);
+        StableSort(byFrequency.begin(), byFrequency.end(), [&] (ui32 lhs, ui32 rhs) {
+            return globalDocCounts[lhs] > globalDocCounts[rhs];
+        });
+        for (size_t rank = 0; rank < distinctCount; ++rank) {
+            globalLeaves[byFrequency[rank]] = Min<size_t>(rank, topSize - 1);
+            isKept[byFrequency[rank]] = rank < topSize;
+        }
+        leaves.LearnLeafCount = topSize;
+    } else {
+        Iota(globalLeaves.begin(), globalLeaves.end(), 0);
+    }
+    leaves.WorkerHashLeaves.resize(workerCount);
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        auto& hashLeaves = leaves.WorkerHashLeaves[workerIdx];
+        hashLeaves.yresize(workerGlobalIdx[workerIdx].size());
+        for (int hashIdx = 0; hashIdx < hashLeaves.ysize(); ++hashIdx) {
+            hashLeaves[hashIdx] = globalLeaves[workerGlobalIdx[workerIdx][hashIdx]];
+        }
+    }
+
+    leaves.HasCounterCtrs = AnyOf(request.CtrInfo, [] (const auto& info) { return info.Type == ECtrType::Counter; });
+    const bool countTestDocs = leaves.HasCounterCtrs && catFeatureParams.CounterCalcMethod == ECounterCalc::Full;
+    auto& leafDocCounts = leaves.LeafDocCounts;
+    leafDocCounts.resize(leaves.LearnLeafCount);
+    for (size_t globalIdx = 0; globalIdx < distinctCount; ++globalIdx) {
+        leafDocCounts[globalLeaves[globalIdx]] += globalDocCounts[globalIdx];
+    }
+    TDenseHash<ui64, ui32> testHashToLeaf;
+    leaves.TestLeaves.yresize(GetSampleCount(testDataPtrs));
+    auto testLeafIt = leaves.TestLeaves.begin();
+    for (const TDataset* testData : testDataPtrs) {
+        // exact hashes, as workers enumerate them, since remapped values of workers and test sets differ
+        const auto testLeavesEnd = testLeafIt + testData->GetSampleCount();
+        CalcHashes(request.Projection, testData->AllFeatures, 0, nullptr, /*calculateExactCatHashes*/ true, testLeafIt, testLeavesEnd);
+        for (; testLeafIt != testLeavesEnd; ++testLeafIt) {
+            const ui64 hash = *testLeafIt;
+            const auto learnIt = hashToGlobalIdx.Find(hash);
+            ui32 leafIdx;
+            if (learnIt != hashToGlobalIdx.end() && isKept[learnIt.Value()]) {
+                leafIdx = globalLeaves[learnIt.Value()];
+            } else {
+                bool isInserted = false;
+                auto& testLeafIdx = testHashToLeaf.GetMutable(hash, &isInserted);
+                if (isInserted) {
+                    testLeafIdx = leafDocCounts.size();
+                    leafDocCounts.push_back(0);
+                }
+                leafIdx = testLeafIdx;
+            }
+            if (countTestDocs) {
+                ++leafDocCounts[leafIdx];
+            }
+            *testLeafIt = leafIdx;
+        }
+    }
+    leaves.CounterDenominator = leaves.HasCounterCtrs ? *MaxElement(leafDocCounts.begin(), leafDocCounts.end()) : 0;
+    return leaves;
+}
+
+static TVector<bool> GetUsedClassifiers(const TOnlineCtrRequest& request, int targetClassifierCount) {
+    TVector<bool> isClassifierUsed(targetClassifierCount);
+    for (const auto& info : request.CtrInfo) {
+        isClassifierUsed[info.TargetClassifierIdx] |= info.Type != ECtrType::Counter;
+    }
+    return isClassifierUsed;
+}
+
+void BuildShardCounters(const TOnlineCtrRequest& request,
+                        const TVector<const TCtrHashStats*>& workerStats,
+                        const TVector<int>& targetClassesCount,
+                        const TDatasetPtrs& testDataPtrs,
+                        const NCatboostOptions::TCatFeatureParams& catFeatureParams,
+                        const TVector<TCtrShardCounters*>& workerCounters) {
+    const int workerCount = workerStats.ysize();
+    const TCtrLeaves leaves = AssignCtrLeaves(request, workerStats, testDataPtrs, catFeatureParams);
+    const size_t leafCount = leaves.LearnLeafCount;
+    const TVector<bool> isClassifierUsed = GetUsedClassifiers(request, targetClassesCount.ysize());
+    TVector<TVector<int>> runningClassCounts(targetClassesCount.size()); // [targetClassifierIdx][leafIdx * targetClassesCount + classIdx]
+    for (int classifierIdx = 0; classifierIdx < targetClassesCount.ysize(); ++classifierIdx) {
+        if (isClassifierUsed[classifierIdx]) {
+            runningClassCounts[classifierIdx].resize(leafCount * targetClassesCount[classifierIdx]);
+        }
+    }
+    TVector<ui32> globalToWorkerLeaf(leafCount, Max<ui32>());
+    for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+        const auto& stats = *workerStats[workerIdx];
+        const auto& hashLeaves = leaves.WorkerHashLeaves[workerIdx];
+        auto& counters = *workerCounters[workerIdx];
+        counters.Request = request;
+        counters.FeatureValueCount = leaves.LeafDocCounts.size();
+        counters.CounterDenominator = leaves.CounterDenominator;
+        counters.HashLeaves.yresize(stats.Hashes.size());
+        TVector<ui32> workerLeavesGlobal;
+        for (int hashIdx = 0; hashIdx < stats.Hashes.ysize(); ++hashIdx) {
+            const ui32 globalLeaf = hashLeaves[hashIdx];
+            if (globalToWorkerLeaf[globalLeaf] == Max<ui32>()) {
+                globalToWorkerLeaf[globalLeaf] = workerLeavesGlobal.size();
+                workerLeavesGlobal.push_back(globalLeaf);
+            }
+            counters.HashLeaves[hashIdx] = globalToWorkerLeaf[globalLeaf];
+        }
+        counters.LeafCount = workerLeavesGlobal.size();
+        if (leaves.HasCounterCtrs) {
+            counters.CounterTotal.yresize(counters.LeafCount);
+            for (ui32 leafIdx = 0; leafIdx < counters.LeafCount; ++leafIdx) {
+                counters.CounterTotal[leafIdx] = leaves.LeafDocCounts[workerLeavesGlobal[leafIdx]];
+            }
+        }
+        counters.PrefixClassCounts.resize(targetClassesCount.size());
+        for (int classifierIdx = 0; classifierIdx < targetClassesCount.ysize(); ++classifierIdx) {
+            if (!isClassifierUsed[classifierIdx]) {
+                continue;
+            }
+            const int classCount = targetClassesCount[classifierIdx];
+            auto& running = runningClassCounts[classifierIdx];
+            auto& prefix = counters.PrefixClassCounts[classifierIdx];
+            prefix.yresize(counters.LeafCount * classCount);
+            for (ui32 leafIdx = 0; leafIdx < counters.LeafCount; ++leafIdx) {
+                Copy(running.begin() + workerLeavesGlobal[leafIdx] * classCount,
+                    running.begin() + (workerLeavesGlobal[leafIdx] + 1) * classCount,
+                    prefix.begin() + leafIdx * classCount);
+            }
+            const auto& workerClassCounts = stats.ClassCounts[classifierIdx];
+            for (int hashIdx = 0; hashIdx < stats.Hashes.ysize(); ++hashIdx) {
+                const ui32 globalLeaf = hashLeaves[hashIdx];
+                for (int classIdx = 0; classIdx < classCount; ++classIdx) {
+                    running[globalLeaf * classCount + classIdx] += workerClassCounts[hashIdx * classCount + classIdx];
+                }
+            }
+        }
+        for (ui32 globalLeaf : workerLeavesGlobal) {
+            globalToWorkerLeaf[globalLeaf] = Max<ui32>();
+        }
+    }
+}
+
+void CalcTestOnlineCtr(const TOnlineCtrRequest& request,
+                       const TVector<const TCtrHashStats*>& workerStats,
+                       const TDatasetPtrs& testDataPtrs,
+                       const NCatboostOptions::TCatFeatureParams& catFeatureParams,
+                       const TFold& fold,
+                       NPar::TLocalExecutor* localExecutor,
+                       TOnlineCTR* dst) {
+    const TCtrLeaves leaves = AssignCtrLeaves(request, workerStats, testDataPtrs, catFeatureParams);
+    const auto& targetClassesCount = fold.TargetClassesCount;
+    const TVector<bool> isClassifierUsed = GetUsedClassifiers(request, targetClassesCount.ysize());
+    TVector<TVector<int>> learnClassCounts(targetClassesCount.size()); // [targetClassifierIdx][leafIdx * targetClassesCount + classIdx]
+    for (int classifierIdx = 0; classifierIdx < targetClassesCount.ysize(); ++classifierIdx) {
+        if (!isClassifierUsed[classifierIdx]) {
+            continue;
+        }
+        const int classCount = targetClassesCount[classifierIdx];
+        auto& classCounts = learnClassCounts[classifierIdx];
+        classCounts.resize(leaves.LearnLeafCount * classCount);
+        for (int workerIdx = 0; workerIdx < workerStats.ysize(); ++workerIdx) {
+            const auto& hashLeaves = leaves.WorkerHashLeaves[workerIdx];
+            const auto& workerClassCounts = workerStats[workerIdx]->ClassCounts[classifierIdx];
+            for (int hashIdx = 0; hashIdx < hashLeaves.ysize(); ++hashIdx) {
+                for (int classIdx = 0; classIdx < classCount; ++classIdx) {
+                    classCounts[hashLeaves[hashIdx] * classCount + classIdx] += workerClassCounts[hashIdx * classCount + classIdx];
+                }
+            }
+        }
+    }
+    const size_t leafCount = leaves.LeafDocCounts.size();
+    ComputeTestOnlineCTRs(leaves.TestLeaves,
+        testDataPtrs,
+        leafCount,
+        /*featureValueCount*/ leafCount,
+        request.CtrInfo,
+        learnClassCounts,
+        leaves.HasCounterCtrs ? leaves.LeafDocCounts : TVector<int>(),
+        leaves.CounterDenominator,
+        fold,
+        localExecutor,
+        dst);
+}
+
+TCtrValueTable BuildFinalCtrTable(const TModelCtrBase& ctrBase,
+                                  const TOnlineCtrRequest& request,
+                                  const TVector<const TCtrHashStats*>& workerStats,
+                                  int targetClassesCount,
+                                  const TDatasetPtrs& testDataPtrs,
+                                  const NCatboostOptions::TCatFeatureParams& catFeatureParams) {
+    const ECtrType ctrType = ctrBase.CtrType;
+    CB_ENSURE(ctrType != ECtrType::FloatTargetMeanValue, "Distributed training does not support ctr type " << ctrType);
+    const bool useClassCounts = ctrType != ECtrType::Counter && ctrType != ECtrType::FeatureFreq;
+    TDenseHash<ui64, ui32> hashToGlobalIdx;
+    TVector<ui64> globalHashes;
+    TVector<int> globalDocCounts;
+    TVector<int> globalClassCounts; // [globalIdx * targetClassesCount + classIdx]
+    auto addHash = [&] (ui64 hash) -> ui32 {
+        bool isInserted = false;
+        auto& globalIdx = hashToGlobalIdx.GetMutable(hash, &isInserted);
+        if (isInserted) {
+            globalIdx = globalHashes.size();
+            globalHashes.push_back(hash);
+            globalDocCounts.push_back(0);
+            if (useClassCounts) {
+                globalClassCounts.resize(globalClassCounts.size() + targetClassesCount);
+            }
+        }
+        return globalIdx;
+    };
+    for (const TCtrHashStats* stats : workerStats) {
+        const auto& workerClassCounts = stats->ClassCounts[ctrBase.TargetBorderClassifierIdx];
+        for (int hashIdx = 0; hashIdx < stats->Hashes.ysize(); ++hashIdx) {
+            const ui32 globalIdx = addHash(stats->Hashes[hashIdx]);
+            globalDocCounts[globalIdx] += stats->DocCounts[hashIdx];
+            if (useClassCounts) {
+                for (int classIdx = 0; classIdx < targetClassesCount; ++classIdx) {
+                    globalClassCounts[globalIdx * targetClassesCount + classIdx] += workerClassCounts[hashIdx * targetClassesCount + classIdx];
+                }
+            }
+        }
+    }
+    if (ctrType == ECtrType::Counter && catFeatureParams.CounterCalcMethod == ECounterCalc::Full) {
+        TVector<ui64> testHashes;
+        for (const TDataset* testData : testDataPtrs) {
+            testHashes.yresize(testData->GetSampleCount());
+            CalcHashes(request.Projection, testData->AllFeatures, 0, nullptr, /*calculateExactCatHashes*/ true, testHashes.begin(), testHashes.end());
+            for (ui64 hash : testHashes) {
+                ++globalDocCounts[addHash(hash)];
+            }
+        }
+    }
+    const size_t distinctCount = globalHashes.size();
+    const size_t sampleCount = Accumulate(globalDocCounts.begin(), globalDocCounts.end(), size_t(0));
+
+    // same leaves as CalcFinalCtrsImpl assigns, documents with dropped hash values go to the last leaf
+    ui64 topSize = catFeatureParams.CtrLeafCountLimit;
+    if (request.Projection.IsSingleCatFeature() && catFeatureParams.StoreAllSimpleCtrs) {
+        topSize = Max<ui64>();
+    }
+    TVector<ui32> byFrequency(distinctCount);
+    Iota(byFrequency.begin(), byFrequency.end(), 0);
+    size_t leafCount = distinctCount;
+    if (topSize <= sampleCount && distinctCount > topSize) {
+        StableSort(byFrequency.begin(), byFrequency.end(), [&] (ui32 lhs, ui32 rhs) {
+            return globalDocCounts[lhs] > globalDocCounts[rhs];
+        });
+        leafCount = topSize;
+    }
+    TCtrValueTable table;
+    auto hashIndexBuilder = table.GetIndexHashBuilder(leafCount);
+    for (size_t leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+        hashIndexBuilder.SetIndex(globalHashes[byFrequency[leafIdx]], leafIdx);
+    }
+    if (ctrType == ECtrType::BinarizedTargetMeanValue) {
+        auto ctrMean = table.AllocateBlobAndGetArrayRef<TCtrMeanHistory>(leafCount);
+        const int targetBorderCount = targetClassesCount - 1;
+        for (size_t rank = 0; rank < distinctCount; ++rank) {
+            const ui32 globalIdx = byFrequency[rank];
+            auto& elem = ctrMean[Min(rank, leafCount - 1)];
+            for (int classIdx = 0; classIdx < targetClassesCount; ++classIdx) {
+                const int classDocCount = globalClassCounts[globalIdx * targetClassesCount + classIdx];
+                elem.Sum += static_cast<float>(classIdx) / targetBorderCount * classDocCount;
+                elem.Count += classDocCount;
+            }
+        }
+    } else if (ctrType == ECtrType::Counter || ctrType == ECtrType::FeatureFreq) {
+        auto ctrIntArray = table.AllocateBlobAndGetArrayRef<int>(leafCount);
+        for (size_t rank = 0; rank < distinctCount; ++rank) {
+            ctrIntArray[Min(rank, leafCount - 1)] += globalDocCounts[byFrequency[rank]];
+        }
+        if (ctrType == ECtrType::Counter) {
+            table.CounterDenominator = leafCount > 0 ? *MaxElement(ctrIntArray.begin(), ctrIntArray.end()) : 0;
+        } else {
+            table.CounterDenominator = static_cast<int>(sampleCount);
+        }
+    } else {
+        table.TargetClassesCount = targetClassesCount;
+        auto ctrIntArray = table.AllocateBlobAndGetArrayRef<int>(leafCount * targetClassesCount);
+        for (size_t rank = 0; rank < distinctCount; ++rank) {
+            const ui32 globalIdx = byFrequency[rank];
+            const size_t leafIdx = Min(rank, leafCount - 1);
+            for (int classIdx = 0; classIdx < targetClassesCount; ++classIdx) {
+                ctrIntArray[leafIdx * targetClassesCount + classIdx] += globalClassCounts[globalIdx * targetClassesCount + classIdx];
+            }
+        }
+    }
+    table.ModelCtrBase = ctrBase;
+    return table;
+}
+
+static TOnlineCtrRequests MakeCtrRequests(const TVector<TProjection>& projections, const TLearnContext& ctx) {
+    TOnlineCtrRequests requests(projections.size());
+    for (int projectionIdx = 0; projectionIdx < projections.ysize(); ++projectionIdx) {
+        requests[projectionIdx].Projection = projections[projectionIdx];
+        requests[projectionIdx].CtrInfo = ctx.CtrsHelper.GetCtrInfo(projections[projectionIdx]);
+    }
+    return requests;
+}
+
+void MapCalcOnlineCtrs(const TDatasetPtrs& testDataPtrs, const TVector<TProjection>& projections, TFold* fold, TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    if (projections.empty()) {
+        return;
+    }
+    // workers hold consecutive parts of learn data and compute ctrs in this order, see TPlainFoldBuilder
+    CB_ENSURE(fold->PermutationBlockSize == fold->GetLearnSampleCount(), "Distributed training computes online ctrs of unshuffled plain fold only");
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    const TOnlineCtrRequests requests = MakeCtrRequests(projections, *ctx);
+    TVector<TOnlineCtrHashCollector::TOutput> hashStatsFromAllWorkers = ApplyMapper<TOnlineCtrHashCollector>(workerCount, ctx->SharedTrainData, TEnvelope<TOnlineCtrRequests>(requests));
+    // workers trim ctr caches by memory usage of their parts, a ctr evicted by some workers only is recomputed by all of them
+    TOnlineCtrRequests partlyCachedRequests;
+    TVector<int> partlyCachedRequestIdx;
+    for (int requestIdx = 0; requestIdx < requests.ysize(); ++requestIdx) {
+        const int cachedCount = CountIf(hashStatsFromAllWorkers, [=] (const auto& workerStats) { return workerStats.Data[requestIdx].IsCached; });
+        if (cachedCount > 0 && cachedCount < workerCount) {
+            partlyCachedRequestIdx.push_back(requestIdx);
+            partlyCachedRequests.push_back(requests[requestIdx]);
+            partlyCachedRequests.back().DropCached = true;
+        }
+    }
+    if (!partlyCachedRequests.empty()) {
+        TVector<TOnlineCtrHashCollector::TOutput> recollectedHashStats = ApplyMapper<TOnlineCtrHashCollector>(workerCount, ctx->SharedTrainData, TEnvelope<TOnlineCtrRequests>(partlyCachedRequests));
+        for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+            for (int partlyCachedIdx = 0; partlyCachedIdx < partlyCachedRequestIdx.ysize(); ++partlyCachedIdx) {
+                hashStatsFromAllWorkers[workerIdx].Data[partlyCachedRequestIdx[partlyCachedIdx]] = std::move(recollectedHashStats[workerIdx].Data[partlyCachedIdx]);
+            }
+        }
+    }
+    TVector<int> missingCtrRequestIdx;
+    for (int requestIdx = 0; requestIdx < requests.ysize(); ++requestIdx) {
+        const bool isCached = hashStatsFromAllWorkers[0].Data[requestIdx].IsCached;
+        if (isCached) {
+            auto& ctr = fold->GetCtrRef(requests[requestIdx].Projection);
+            if (ctr.Feature.empty()) {
+                ctr.FeatureValueCount = hashStatsFromAllWorkers[0].Data[requestIdx].FeatureValueCount;
+            }
+        } else {
+            missingCtrRequestIdx.push_back(requestIdx);
+        }
+    }
+    if (missingCtrRequestIdx.empty()) {
+        return;
+    }
+
+    const auto& targetClassesCount = ctx->LearnProgress.Folds[0].TargetClassesCount;
+    TVector<TEnvelope<TCtrShardCountersList>> workerCounters(workerCount);
+    for (auto& counters : workerCounters) {
+        counters.Data.resize(missingCtrRequestIdx.size());
+    }
+    ctx->LocalExecutor.ExecRange([&] (int missingCtrIdx) {
+        const int requestIdx = missingCtrRequestIdx[missingCtrIdx];
+        TVector<const TCtrHashStats*> workerStats(workerCount);
+        TVector<TCtrShardCounters*> counters(workerCount);
+        for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+            workerStats[workerIdx] = &hashStatsFromAllWorkers[workerIdx].Data[requestIdx];
+            counters[workerIdx] = &workerCounters[workerIdx].Data[missingCtrIdx];
+        }
+        BuildShardCounters(requests[requestIdx], workerStats, targetClassesCount, testDataPtrs, ctx->Params.CatFeatureParams.Get(), counters);
+    }, 0, missingCtrRequestIdx.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+    for (int missingCtrIdx = 0; missingCtrIdx < missingCtrRequestIdx.ysize(); ++missingCtrIdx) {
+        auto& ctr = fold->GetCtrRef(requests[missingCtrRequestIdx[missingCtrIdx]].Projection);
+        if (ctr.Feature.empty()) {
+            ctr.FeatureValueCount = workerCounters[0].Data[missingCtrIdx].FeatureValueCount;
+        }
+    }
+    ApplyMapperPerWorker<TOnlineCtrCalcer>(ctx->SharedTrainData, &workerCounters);
+}
+
+void MapCalcTestOnlineCtrs(const TDatasetPtrs& testDataPtrs, const TVector<TProjection>& projections, TFold* fold, TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    if (projections.empty()) {
+        return;
+    }
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    const TOnlineCtrRequests requests = MakeCtrRequests(projections, *ctx);
+    const auto hashStatsFromAllWorkers = ApplyMapper<TCtrHashStatsCollector>(workerCount, ctx->SharedTrainData, TEnvelope<TOnlineCtrRequests>(requests));
+    TVector<TOnlineCTR*> dstCtrs;
+    for (const auto& request : requests) {
+        fold->MarkCtrUsed(request.Projection);
+        dstCtrs.push_back(&fold->GetCtrRef(request.Projection)); // not thread-safe
+    }
+    ctx->LocalExecutor.ExecRange([&] (int requestIdx) {
+        TVector<const TCtrHashStats*> workerStats(workerCount);
+        for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+            workerStats[workerIdx] = &hashStatsFromAllWorkers[workerIdx].Data[requestIdx];
+        }
+        CalcTestOnlineCtr(requests[requestIdx], workerStats, testDataPtrs, ctx->Params.CatFeatureParams.Get(), *fold, &ctx->LocalExecutor, dstCtrs[requestIdx]);
+    }, 0, requests.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
+TVector<TCtrValueTable> MapCalcFinalCtrs(const TVector<TModelCtrBase>& ctrBases,
+                                         const TVector<TProjection>& projections,
+                                         const TDatasetPtrs& testDataPtrs,
+                                         TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    Y_ASSERT(ctrBases.size() == projections.size());
+    // one request per projection, workers collect class counts of all target classifiers used by its ctrs
+    TOnlineCtrRequests requests;
+    THashMap<TProjection, int> projectionToRequestIdx;
+    TVector<int> ctrRequestIdx;
+    for (int ctrIdx = 0; ctrIdx < ctrBases.ysize(); ++ctrIdx) {
+        const auto insertResult = projectionToRequestIdx.insert({projections[ctrIdx], requests.ysize()});
+        if (insertResult.second) {
+            requests.emplace_back();
+            requests.back().Projection = projections[ctrIdx];
+        }
+        TCtrInfo ctrInfo;
+        ctrInfo.Type = ctrBases[ctrIdx].CtrType;
+        ctrInfo.TargetClassifierIdx = ctrBases[ctrIdx].TargetBorderClassifierIdx;
+        requests[insertResult.first->second].CtrInfo.push_back(ctrInfo);
+        ctrRequestIdx.push_back(insertResult.first->second);
+    }
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    const auto hashStatsFromAllWorkers = ApplyMapper<TCtrHashStatsCollector>(workerCount, ctx->SharedTrainData, TEnvelope<TOnlineCtrRequests>(requests));
+    TVector<TCtrValueTable> tables(ctrBases.size());
+    ctx->LocalExecutor.ExecRange([&] (int ctrIdx) {
+        const int requestIdx = ctrRequestIdx[ctrIdx];
+        TVector<const TCtrHashStats*> workerStats(workerCount);
+        for (int workerIdx = 0; workerIdx < workerCount; ++workerIdx) {
+            workerStats[workerIdx] = &hashStatsFromAllWorkers[workerIdx].Data[requestIdx];
+        }
+        const auto& ctrBase = ctrBases[ctrIdx];
+        tables[ctrIdx] = BuildFinalCtrTable(ctrBase,
+            requests[requestIdx],
+            workerStats,
+            ctx->LearnProgress.AveragingFold.TargetClassesCount[ctrBase.TargetBorderClassifierIdx],
+            testDataPtrs,
+            ctx->Params.CatFeatureParams.Get());
+    }, 0, ctrBases.ysize(), NPar::TLocalExecutor::WAIT_COMPLETE);
+    return tables;
+}
+
 // TODO(espetrov): Remove unused code.
 void MapCalcScore(double scoreStDev, int depth, TCandidateList* candidateList, TLearnContext* ctx) {
     Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
     const int workerCount = ctx->RootEnvironment->GetSlaveCount();
     TVector<TScoreCalcer::TOutput> allStatsFromAllWorkers = ApplyMapper<TScoreCalcer>(workerCount, ctx->SharedTrainData, TEnvelope<TCandidateList>(*candidateList));
     // reduce aross workers
-    const int leafCount = 1U << depth;
     const int candidateCount = candidateList->ysize();
-    for (int workerIdx = 1; workerIdx < workerCount; ++workerIdx) {
-        ctx->LocalExecutor.ExecRange([&] (int candidateIdx) {
-            const int subcandidateCount = (*candidateList)[candidateIdx].Candidates.ysize();
-            for (int subcandidateIdx = 0; subcandidateIdx < subcandidateCount; ++subcandidateIdx) {
-                auto& firstStats = allStatsFromAllWorkers[0].Data[candidateIdx][subcandidateIdx];
-                const auto& stats = allStatsFromAllWorkers[workerIdx].Data[candidateIdx][subcandidateIdx];
-                const int splitStatsCount = firstStats.BucketCount * firstStats.MaxLeafCount;
-                for (int statsIdx = 0; statsIdx * splitStatsCount < firstStats.Stats.ysize(); ++statsIdx) {
-                    TBucketStats* firstStatsData = GetDataPtr(firstStats.Stats) + statsIdx * splitStatsCount;
-                    const TBucketStats* statsData = GetDataPtr(stats.Stats) + statsIdx * splitStatsCount;
-                    for (int bucketIdx = 0; bucketIdx < firstStats.BucketCount * leafCount; ++bucketIdx) {
-                        firstStatsData[bucketIdx].Add(statsData[bucketIdx]);
-                    }
-                }
-            }
-        }, NPar::TLocalExecutor::TExecRangeParams(0, candidateCount), NPar::TLocalExecutor::WAIT_COMPLETE);
-    }
+    ctx->LocalExecutor.ExecRange([&] (int candidateIdx) {
+        TVector<TStats4D*> statsFromAllWorkers;
+        for (auto& workerStats : allStatsFromAllWorkers) {
+            statsFromAllWorkers.push_back(&workerStats.Data[candidateIdx]);
+        }
+        SumStats4D(statsFromAllWorkers, &ctx->LocalExecutor);
+    }, 0, candidateCount, NPar::TLocalExecutor::WAIT_COMPLETE);
     // set best split for each candidate
     const ui64 randSeed = ctx->Rand.GenRand();
 
-    const auto& plainFold = ctx->LearnProgress.Folds[0];
     ctx->LocalExecutor.ExecRange([&] (int candidateIdx) {
         const auto& allStats = allStatsFromAllWorkers[0].Data[candidateIdx];
         auto& candidate = (*candidateList)[candidateIdx];
@@ -165,39 +738,47 @@ void MapCalcScore(double scoreStDev, int depth, TCandidateList* candidateList, T
         TVector<TVector<double>> allScores(subcandidateCount);
         for (int subcandidateIdx = 0; subcandidateIdx < subcandidateCount; ++subcandidateIdx) {
             const auto& splitInfo = candidate.Candidates[subcandidateIdx];
-            allScores[subcandidateIdx] = GetScores(GetScoreBins(allStats[subcandidateIdx], splitInfo.SplitCandidate.Type, depth, plainFold.GetSumWeight(), plainFold.GetLearnSampleCount(), ctx->Params));
+            allScores[subcandidateIdx] = GetScores(GetScoreBins(allStats[subcandidateIdx], splitInfo.SplitCandidate.Type, depth, ctx->SumAllWeights, ctx->AllDocCount, ctx->Params));
         }
         SetBestScore(randSeed + candidateIdx, allScores, scoreStDev, &candidate.Candidates);
     }, 0, candidateCount, NPar::TLocalExecutor::WAIT_COMPLETE);
 }
 
-void MapRemoteCalcScore(double scoreStDev, int /*depth*/, TCandidateList* candidateList, TLearnContext* ctx) {
+void MapRemoteCalcScore(double scoreStDev, int depth, TCandidateList* candidateList, TLearnContext* ctx) {
     Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
-    NPar::TJobDescription job;
-    NPar::Map(&job, new TRemoteBinCalcer(), candidateList); // candidateList[i] -map-> {TStats4D[i][worker]} -reduce-> TStats4D[i]
-    NPar::RemoteMap(&job, new TRemoteScoreCalcer); // TStats4D[i] -remote_map-> Scores[i]
-    NPar::TJobExecutor exec(&job, ctx->SharedTrainData);
-    TVector<typename TRemoteScoreCalcer::TOutput> allScores; // [candidate][subcandidate][bucket]
-    exec.GetRemoteMapResults(&allScores);
-    // set best split for each candidate
     const int candidateCount = candidateList->ysize();
-    Y_ASSERT(candidateCount == allScores.ysize());
     const ui64 randSeed = ctx->Rand.GenRand();
-    ctx->LocalExecutor.ExecRange([&] (int candidateIdx) {
-        SetBestScore(randSeed + candidateIdx, allScores[candidateIdx], scoreStDev, &(*candidateList)[candidateIdx].Candidates);
-    }, 0, candidateCount, NPar::TLocalExecutor::WAIT_COMPLETE);
-}
-
-void MapSetIndices(const TCandidateInfo& bestSplitCandidate, TLearnContext* ctx) {
-    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
-    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
-    ApplyMapper<TLeafIndexSetter>(workerCount, ctx->SharedTrainData, TEnvelope<TCandidateInfo>(bestSplitCandidate));
+    // all batches are sent at once, best scores of a batch are selected while workers compute later batches
+    const int batchCount = Min(candidateCount, REMOTE_SCORE_BATCH_COUNT);
+    const int batchSize = batchCount > 0 ? (candidateCount + batchCount - 1) / batchCount : 0;
+    TVector<THolder<NPar::TJobExecutor>> executors;
+    for (int batchStart = 0; batchStart < candidateCount; batchStart += batchSize) {
+        TCandidateList batch(candidateList->begin() + batchStart, candidateList->begin() + Min(batchStart + batchSize, candidateCount));
+        NPar::TJobDescription job;
+        NPar::Map(&job, new TRemoteBinCalcer(), &batch); // candidateList[i] -map-> {TStats4D[i][worker]} -reduce-> TStats4D[i]
+        NPar::RemoteMap(&job, new TRemoteScoreCalcer); // TStats4D[i] -remote_map-> Scores[i]
+        executors.emplace_back(MakeHolder<NPar::TJobExecutor>(&job, ctx->SharedTrainData));
+    }
+    ctx->Profile.AddOperation(TStringBuilder() << "Send score batches " << depth);
+    for (int batchIdx = 0; batchIdx < executors.ysize(); ++batchIdx) {
+        TVector<typename TRemoteScoreCalcer::TOutput> allScores; // [candidate][subcandidate][bucket]
+        executors[batchIdx]->GetRemoteMapResults(&allScores);
+        ctx->Profile.AddOperation(TStringBuilder() << "Wait for score batches " << depth);
+        // set best split for each candidate
+        const int batchStart = batchIdx * batchSize;
+        const int batchCandidateCount = Min(batchSize, candidateCount - batchStart);
+        Y_ASSERT(batchCandidateCount == allScores.ysize());
+        ctx->LocalExecutor.ExecRange([&] (int candidateIdx) {
+            SetBestScore(randSeed + batchStart + candidateIdx, allScores[candidateIdx], scoreStDev, &(*candidateList)[batchStart + candidateIdx].Candidates);
+        }, 0, batchCandidateCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+        ctx->Profile.AddOperation(TStringBuilder() << "Select best scores " << depth);
+    }
 }
 
-int MapGetRedundantSplitIdx(TLearnContext* ctx) {
+int MapSetIndices(const TCandidateInfo& bestSplitCandidate, TLearnContext* ctx) {
     Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
     const int workerCount = ctx->RootEnvironment->GetSlaveCount();
-    TVector<TEmptyLeafFinder::TOutput> isLeafEmptyFromAllWorkers = ApplyMapper<TEmptyLeafFinder>(workerCount, ctx->SharedTrainData); // poll workers
+    TVector<TLeafIndexSetter::TOutput> isLeafEmptyFromAllWorkers = ApplyMapper<TLeafIndexSetter>(workerCount, ctx->SharedTrainData, TEnvelope<TCandidateInfo>(bestSplitCandidate));
     for (int workerIdx = 1; workerIdx < workerCount; ++workerIdx) {
         for (int leafIdx = 0; leafIdx < isLeafEmptyFromAllWorkers[0].Data.ysize(); ++leafIdx) {
             isLeafEmptyFromAllWorkers[0].Data[leafIdx] &= isLeafEmptyFromAllWorkers[workerIdx].Data[leafIdx];
@@ -207,12 +788,24 @@ int MapGetRedundantSplitIdx(TLearnContext* ctx) {
 }
 
 template<typename TError>
-void MapSetApproxes(const TSplitTree& splitTree, TLearnContext* ctx) {
+void MapSetApproxes(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx) {
     Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
     const int workerCount = ctx->RootEnvironment->GetSlaveCount();
-    ApplyMapper<TCalcApproxStarter>(workerCount, ctx->SharedTrainData, TEnvelope<TSplitTree>(splitTree));
+    const int leafCount = splitTree.GetLeafCount();
+    TVector<TCalcApproxStarter::TOutput> leafStatsFromAllWorkers = ApplyMapper<TCalcApproxStarter>(workerCount, ctx->SharedTrainData, TEnvelope<TSplitTree>(splitTree));
+    leafStats->DocCounts.assign(leafCount, 0);
+    leafStats->SumWeights.assign(leafCount, 0);
+    for (const auto& workerLeafStats : leafStatsFromAllWorkers) {
+        for (int leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+            leafStats->DocCounts[leafIdx] += workerLeafStats.Data.DocCounts[leafIdx];
+            leafStats->SumWeights[leafIdx] += workerLeafStats.Data.SumWeights[leafIdx];
+        }
+    }
     const int gradientIterations = ctx->Params.ObliviousTreeOptions->LeavesEstimationIterations;
-    TSums buckets(splitTree.GetLeafCount(), TSum(gradientIterations));
+    TSums buckets(leafCount, TSum(gradientIterations));
+    // leaf values over all learn documents are the sum of per iteration deltas, as in CalcLeafValuesSimple
+    treeValues->assign(1, TVector<double>(leafCount));
+    TVector<double> leafDeltas;
     for (int it = 0; it < gradientIterations; ++it) {
         TVector<typename TBucketSimpleUpdater<TError>::TOutput> bucketsFromAllWorkers = ApplyMapper<TBucketSimpleUpdater<TError>>(workerCount, ctx->SharedTrainData);
         // reduce across workers
@@ -232,26 +825,47 @@ void MapSetApproxes(const TSplitTree& splitTree, TLearnContext* ctx) {
                 }
             }
         }
+        CalcMixedModelSimple(buckets, /*pairwiseWeightSums*/ {}, it, ctx->Params, ctx->SumAllWeights, ctx->AllDocCount, &leafDeltas);
+        for (int leafIdx = 0; leafIdx < leafCount; ++leafIdx) {
+            (*treeValues)[0][leafIdx] += leafDeltas[leafIdx];
+        }
         // calc model and update approx deltas on workers
         ApplyMapper<TDeltaSimpleUpdater>(workerCount, ctx->SharedTrainData, TEnvelope<TSums>(buckets));
     }
     ApplyMapper<TApproxSimpleUpdater>(workerCount, ctx->SharedTrainData);
 }
 
-template void MapSetApproxes<TCrossEntropyError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TRMSEError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TQuantileError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TLogLinQuantileError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TMAPError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TPoissonError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TMultiClassError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TMultiClassOneVsAllError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TPairLogitError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TQueryRmseError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TQuerySoftMaxError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TCustomError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TUserDefinedPerObjectError>(const TSplitTree& splitTree, TLearnContext* ctx);
-template void MapSetApproxes<TUserDefinedQuerywiseError>(const TSplitTree& splitTree, TLearnContext* ctx);
+template void MapSetApproxes<TCrossEntropyError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TRMSEError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TQuantileError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TLogLinQuantileError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TMAPError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TPoissonError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TMultiClassError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TMultiClassOneVsAllError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TPairLogitError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TQueryRmseError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TQuerySoftMaxError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TCustomError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TUserDefinedPerObjectError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+template void MapSetApproxes<TUserDefinedQuerywiseError>(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, TLeafStats* leafStats, TLearnContext* ctx);
+
+TVector<double> MapCalcLearnErrors(const TVector<THolder<IMetric>>& metrics, const TVector<int>& metricIndices, TLearnContext* ctx) {
+    Y_ASSERT(ctx->Params.SystemOptions->IsMaster());
+    const int workerCount = ctx->RootEnvironment->GetSlaveCount();
+    TVector<TErrorCalcer::TOutput> statsFromAllWorkers = ApplyMapper<TErrorCalcer>(workerCount, ctx->SharedTrainData, TEnvelope<TMetricIndices>(metricIndices));
+    TVector<double> errors;
+    for (int idx = 0; idx < metricIndices.ysize(); ++idx) {
+        TMetricHolder sumStats;
+        for (const auto& workerStats : statsFromAllWorkers) {
+            TMetricHolder stats;
+            stats.Stats = workerStats.Data[idx];
+            sumStats.Add(stats);
+        }
+        errors.push_back(metrics[metricIndices[idx]]->GetFinalError(sumStats));
+    }
+    return errors;
+}
 
 template<typename TError>
 void MapSetDerivatives(TLearnContext* ctx) {
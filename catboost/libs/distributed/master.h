@@ -1,21 +1,64 @@
 #pragma once
 
+#include "data_types.h"
+
 #include <catboost/libs/algo/learn_context.h>
 #include <catboost/libs/algo/split.h>
 #include <catboost/libs/algo/tensor_search_helpers.h>
 #include <catboost/libs/algo/dataset.h>
+#include <catboost/libs/metrics/metric.h>
+#include <catboost/libs/model/ctr_value_table.h>
+#include <catboost/libs/options/load_options.h>
 
 void InitializeMaster(TLearnContext* ctx);
 void FinalizeMaster(TLearnContext* ctx);
 void MapBuildPlainFold(const TDataset& trainData, TLearnContext* ctx);
+// Workers read equal byte ranges of learn pool file and binarize them with borders and one-hot values of sampleData,
+// master holds the sample only and gets the number and total weight of all learn documents
+void MapLoadPlainFold(const NCatboostOptions::TPoolLoadParams& loadOptions, const TDataset& sampleData, TLearnContext* ctx);
 void MapTensorSearchStart(TLearnContext* ctx);
 void MapBootstrap(TLearnContext* ctx);
+// Workers compute online ctrs of projections missing in their plain folds, fold gets FeatureValueCount of the ctrs
+void MapCalcOnlineCtrs(const TDatasetPtrs& testDataPtrs, const TVector<TProjection>& projections, TFold* fold, TLearnContext* ctx);
+// Leaves of ctr hash values are assigned over all workers as ComputeReindexHash does for the whole learn set,
+// so workers, which hold consecutive parts of plain fold, compute the same ctr values as a single host does
+void BuildShardCounters(const NCatboostDistributed::TOnlineCtrRequest& request,
+                        const TVector<const NCatboostDistributed::TCtrHashStats*>& workerStats,
+                        const TVector<int>& targetClassesCount,
+                        const TDatasetPtrs& testDataPtrs,
+                        const NCatboostOptions::TCatFeatureParams& catFeatureParams,
+                        const TVector<NCatboostDistributed::TCtrShardCounters*>& workerCounters);
+// Online ctr of test documents, which follow all learn documents of workers, dst holds test part only, see ComputeTestOnlineCTRs
+void CalcTestOnlineCtr(const NCatboostDistributed::TOnlineCtrRequest& request,
+                       const TVector<const NCatboostDistributed::TCtrHashStats*>& workerStats,
+                       const TDatasetPtrs& testDataPtrs,
+                       const NCatboostOptions::TCatFeatureParams& catFeatureParams,
+                       const TFold& fold,
+                       NPar::TLocalExecutor* localExecutor,
+                       TOnlineCTR* dst);
+// Master computes online ctrs of test documents from hash stats of workers, fold is the averaging fold of master
+void MapCalcTestOnlineCtrs(const TDatasetPtrs& testDataPtrs, const TVector<TProjection>& projections, TFold* fold, TLearnContext* ctx);
+// Final ctr table over learn documents of all workers, same as CalcFinalCtrs computes for the whole learn set
+TCtrValueTable BuildFinalCtrTable(const TModelCtrBase& ctrBase,
+                                  const NCatboostDistributed::TOnlineCtrRequest& request,
+                                  const TVector<const NCatboostDistributed::TCtrHashStats*>& workerStats,
+                                  int targetClassesCount,
+                                  const TDatasetPtrs& testDataPtrs,
+                                  const NCatboostOptions::TCatFeatureParams& catFeatureParams);
+// projections[i] is the projection of ctrBases[i]
+TVector<TCtrValueTable> MapCalcFinalCtrs(const TVector<TModelCtrBase>& ctrBases,
+                                         const TVector<TProjection>& projections,
+                                         const TDatasetPtrs& testDataPtrs,
+                                         TLearnContext* ctx);
 void MapCalcScore(double scoreStDev, int depth, TCandidateList* candidateList, TLearnContext* ctx);
 void MapRemoteCalcScore(double scoreStDev, int depth, TCandidateList* candidateList, TLearnContext* ctx);
-void MapSetIndices(const TCandidateInfo& bestSplitCandidate, TLearnContext* ctx);
-int MapGetRedundantSplitIdx(TLearnContext* ctx);
+// Sets leaf indices of the best split on workers, returns index of redundant split or -1, see GetRedundantSplitIdx
+int MapSetIndices(const TCandidateInfo& bestSplitCandidate, TLearnContext* ctx);
 template<typename TError>
 void MapSetDerivatives(TLearnContext* ctx);
+// Updates approxes of workers, treeValues are leaf values over all learn documents before learning rate is applied
 template<typename TError>
-void MapSetApproxes(const TSplitTree& splitTree, TLearnContext* ctx);
+void MapSetApproxes(const TSplitTree& splitTree, TVector<TVector<double>>* treeValues, NCatboostDistributed::TLeafStats* leafStats, TLearnContext* ctx);
+// Errors of additive metrics over learn documents of all workers, metricIndices are indices in metrics
+TVector<double> MapCalcLearnErrors(const TVector<THolder<IMetric>>& metrics, const TVector<int>& metricIndices, TLearnContext* ctx);
 
@@ -24,6 +24,20 @@ static void CalcStatsImpl(const TIsCaching& isCaching,
     }
 }
 
+template<typename TFullIndexType>
+static void CalcSampledOutSiblingStatsImpl(const TVector<TFullIndexType>& singleIdx,
+        const TCalcScoreFold& fold,
+        const TStatsIndexer& indexer,
+        int depth,
+        int splitStatsCount,
+        TBucketStats* allDocsStats,
+        TBucketStats* sampleStats) {
+    const int sampleStatsCount = indexer.CalcSize(depth);
+    for (int dim = 0; dim < fold.GetApproxDimension(); ++dim) {
+        CalcSampledOutSiblingStatsKernel(singleIdx, fold, indexer, depth, dim, allDocsStats + dim * splitStatsCount, sampleStats + dim * sampleStatsCount);
+    }
+}
+
 TStats3D CalcStats3D(const TAllFeatures& af,
         const TVector<int>& splitsCount,
         const std::tuple<const TOnlineCTRHash&, const TOnlineCTRHash&>& allCtrs,
@@ -57,16 +71,45 @@ TStats3D CalcStats3D(const TAllFeatures& af,
         }
     };
     const auto& treeOptions = fitParams.ObliviousTreeOptions.Get();
+    const bool isSinglePrecisionWire = treeOptions.SinglePrecisionScoreStats.Get();
+    const int blockCount = fold.GetBodyTailCount() * fold.GetApproxDimension();
+    if (IsSampledOutSiblingScoring(fitParams)) {
+        const int splitStatsCount = indexer.CalcSize(treeOptions.MaxDepth);
+        bool areStatsDirty;
+        TVector<TBucketStats, TPoolAllocator>& allDocsStats = statsFromPrevTree->GetStats(split, blockCount * splitStatsCount, &areStatsDirty); // thread-safe access
+        if (depth == 0 || !areStatsDirty) {
+            TVector<TBucketStats> sampleStats;
+            sampleStats.yresize(blockCount * indexer.CalcSize(depth));
+            if (bucketIndexBits <= 8) {
+                TVector<ui8> singleIdx;
+                BuildSingleIndex(prevLevelData, af, allCtrs, split, indexer, &singleIdx);
+                CalcSampledOutSiblingStatsImpl(singleIdx, prevLevelData, indexer, depth, splitStatsCount, GetDataPtr(allDocsStats), GetDataPtr(sampleStats));
+            } else if (bucketIndexBits <= 16) {
+                TVector<ui16> singleIdx;
+                BuildSingleIndex(prevLevelData, af, allCtrs, split, indexer, &singleIdx);
+                CalcSampledOutSiblingStatsImpl(singleIdx, prevLevelData, indexer, depth, splitStatsCount, GetDataPtr(allDocsStats), GetDataPtr(sampleStats));
+            } else if (bucketIndexBits <= 32) {
+                TVector<ui32> singleIdx;
+                BuildSingleIndex(prevLevelData, af, allCtrs, split, indexer, &singleIdx);
+                CalcSampledOutSiblingStatsImpl(singleIdx, prevLevelData, indexer, depth, splitStatsCount, GetDataPtr(allDocsStats), GetDataPtr(sampleStats));
+            } else {
+                CB_ENSURE(false, "too deep or too much splitsCount for score calculation");
+            }
+            return TStats3D(std::move(sampleStats), bucketCount, 1U << depth, split.Type, isSinglePrecisionWire);
+        }
+        // stats of all documents are unknown for candidates not scored on the previous level, the sample is scanned instead
+        statsFromPrevTree->Erase(split);
+    }
     if (!IsSamplingPerTree(treeOptions)) {
         TVector<TBucketStats> scratchSplitStats;
         const int splitStatsCount = indexer.CalcSize(depth);
-        const int statsCount = fold.GetBodyTailCount() * fold.GetApproxDimension() * splitStatsCount;
+        const int statsCount = blockCount * splitStatsCount;
         scratchSplitStats.yresize(statsCount);
         SelectCalcStatsImpl(/*isCaching*/ std::false_type(), fold, splitStatsCount, &scratchSplitStats);
-        return TStats3D(scratchSplitStats, bucketCount, 1U << depth);
+        return TStats3D(std::move(scratchSplitStats), bucketCount, 1U << depth, split.Type, isSinglePrecisionWire);
     } else {
         const int splitStatsCount = indexer.CalcSize(treeOptions.MaxDepth);
-        const int statsCount = fold.GetBodyTailCount() * fold.GetApproxDimension() * splitStatsCount;
+        const int statsCount = blockCount * splitStatsCount;
         bool areStatsDirty;
         TVector<TBucketStats, TPoolAllocator>& splitStats = statsFromPrevTree->GetStats(split, statsCount, &areStatsDirty); // thread-safe access
         if (depth == 0 || areStatsDirty) {
@@ -74,7 +117,15 @@ TStats3D CalcStats3D(const TAllFeatures& af,
         } else {
             SelectCalcStatsImpl(/*isCaching*/ std::true_type(), prevLevelData, splitStatsCount, &splitStats);
         }
-        return TStats3D(TVector<TBucketStats>(splitStats.begin(), splitStats.end()), bucketCount, 1U << treeOptions.MaxDepth);
+        // cache keeps leaves of max depth, only leaves of current depth are sent
+        const int usedSplitStatsCount = indexer.CalcSize(depth);
+        TVector<TBucketStats> usedSplitStats;
+        usedSplitStats.yresize(blockCount * usedSplitStatsCount);
+        for (int blockIdx = 0; blockIdx < blockCount; ++blockIdx) {
+            const auto blockStart = splitStats.begin() + blockIdx * splitStatsCount;
+            Copy(blockStart, blockStart + usedSplitStatsCount, usedSplitStats.begin() + blockIdx * usedSplitStatsCount);
+        }
+        return TStats3D(std::move(usedSplitStats), bucketCount, 1U << depth, split.Type, isSinglePrecisionWire);
     }
     CB_ENSURE(false, "too deep or too much splitsCount for score calculation");
 }
@@ -99,3 +150,28 @@ TVector<TScoreBin> GetScoreBins(
     }
     return scoreBin;
 }
+
+static void AddStats3D(const TStats3D& stats, TStats3D* dst) {
+    Y_ASSERT(stats.Stats.size() == dst->Stats.size());
+    TBucketStats* dstData = GetDataPtr(dst->Stats);
+    const TBucketStats* statsData = GetDataPtr(stats.Stats);
+    for (int statsIdx = 0; statsIdx < stats.Stats.ysize(); ++statsIdx) {
+        dstData[statsIdx].Add(statsData[statsIdx]);
+    }
+}
+
+void SumStats4D(const TVector<NCatboostDistributed::TStats4D*>& statsFromAllWorkers, NPar::TLocalExecutor* localExecutor) {
+    const int workerCount = statsFromAllWorkers.ysize();
+    if (workerCount < 2) {
+        return;
+    }
+    const int subcandidateCount = statsFromAllWorkers[0]->ysize();
+    for (int step = 1; step < workerCount; step *= 2) {
+        const int pairCount = (workerCount - step + 2 * step - 1) / (2 * step);
+        localExecutor->ExecRange([&] (int taskIdx) {
+            const int workerIdx = taskIdx / subcandidateCount * 2 * step;
+            const int subcandidateIdx = taskIdx % subcandidateCount;
+            AddStats3D((*statsFromAllWorkers[workerIdx + step])[subcandidateIdx], &(*statsFromAllWorkers[workerIdx])[subcandidateIdx]);
+        }, 0, pairCount * subcandidateCount, NPar::TLocalExecutor::WAIT_COMPLETE);
+    }
+}
@@ -20,3 +20,10 @@ TVector<TScoreBin> GetScoreBins(
         double sumAllWeights,
         int allDocCount,
         const NCatboostOptions::TCatBoostOptions& fitParams);
+
+// Sums stats received from all workers into statsFromAllWorkers[0] on the host which reduces them,
+// it doesn't change network traffic: stats are added pairwise in log2(workerCount) rounds to sum
+// pairs of one round in parallel
+void SumStats4D(
+        const TVector<NCatboostDistributed::TStats4D*>& statsFromAllWorkers,
+        NPar::TLocalExecutor* localExecutor);
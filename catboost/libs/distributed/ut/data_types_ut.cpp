@@ -0,0 +1,85 @@
+#include <catboost/libs/distributed/data_types.h>
+
+#include <library/binsaver/mem_io.h>
+#include <library/unittest/registar.h>
+
+#include <util/generic/vector.h>
+#include <util/random/fast.h>
+
+using namespace NCatboostDistributed;
+
+static TStats3D MakeStats3D(int statsCount, bool isSinglePrecisionWire, TReallyFastRng32* rng) {
+    TVector<TBucketStats> stats(statsCount, TBucketStats{0, 0, 0, 0});
+    for (auto& bucketStats : stats) {
+        // about half of buckets are empty
+        if (rng->GenRandReal2() < 0.5) {
+            bucketStats = {rng->GenRandReal2() - 0.5, rng->GenRandReal2() * 10, rng->GenRandReal2() - 0.5, static_cast<double>(rng->Uniform(100))};
+        }
+    }
+    return TStats3D(std::move(stats), /*bucketCount*/ 5, /*maxLeafCount*/ 4, ESplitType::OneHotFeature, isSinglePrecisionWire);
+}
+
+static TStats3D SaveLoad(TStats3D& stats) {
+    TVector<TVector<char>> buffer;
+    SerializeToMem(&buffer, stats);
+    TStats3D loaded;
+    SerializeFromMem(&buffer, loaded);
+    return loaded;
+}
+
+static void CheckHeader(const TStats3D& loaded, const TStats3D& stats) {
+    UNIT_ASSERT_VALUES_EQUAL(loaded.BucketCount, stats.BucketCount);
+    UNIT_ASSERT_VALUES_EQUAL(loaded.MaxLeafCount, stats.MaxLeafCount);
+    UNIT_ASSERT_EQUAL(loaded.SplitType, stats.SplitType);
+    UNIT_ASSERT_VALUES_EQUAL(loaded.IsSinglePrecisionWire, stats.IsSinglePrecisionWire);
+    UNIT_ASSERT_VALUES_EQUAL(loaded.Stats.size(), stats.Stats.size());
+}
+
+Y_UNIT_TEST_SUITE(TDistributedDataTypesTest) {
+    Y_UNIT_TEST(TestStats3DSaveLoad) {
+        TReallyFastRng32 rng(7);
+        // bitmask of nonempty buckets has a partial last word
+        for (int statsCount : {0, 1, 64, 150}) {
+            TStats3D stats = MakeStats3D(statsCount, /*isSinglePrecisionWire*/ false, &rng);
+            const TStats3D loaded = SaveLoad(stats);
+            CheckHeader(loaded, stats);
+            for (int statsIdx = 0; statsIdx < statsCount; ++statsIdx) {
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumWeightedDelta, stats.Stats[statsIdx].SumWeightedDelta);
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumWeight, stats.Stats[statsIdx].SumWeight);
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumDelta, stats.Stats[statsIdx].SumDelta);
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].Count, stats.Stats[statsIdx].Count);
+            }
+        }
+
+        // only sum of deltas is nonzero, the bucket is still sent
+        TStats3D stats(TVector<TBucketStats>{{0, 0, 0, 0}, {0, 0, 0.25, 0}}, /*bucketCount*/ 2, /*maxLeafCount*/ 1, ESplitType::FloatFeature, /*isSinglePrecisionWire*/ false);
+        const TStats3D loaded = SaveLoad(stats);
+        CheckHeader(loaded, stats);
+        UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[0].SumDelta, 0.0);
+        UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[1].SumDelta, 0.25);
+    }
+
+    Y_UNIT_TEST(TestSinglePrecisionStats3DSaveLoad) {
+        TReallyFastRng32 rng(7);
+        for (int statsCount : {0, 1, 64, 150}) {
+            TStats3D stats = MakeStats3D(statsCount, /*isSinglePrecisionWire*/ true, &rng);
+            const TStats3D loaded = SaveLoad(stats);
+            CheckHeader(loaded, stats);
+            for (int statsIdx = 0; statsIdx < statsCount; ++statsIdx) {
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumWeightedDelta, static_cast<float>(stats.Stats[statsIdx].SumWeightedDelta));
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumWeight, static_cast<float>(stats.Stats[statsIdx].SumWeight));
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].SumDelta, static_cast<float>(stats.Stats[statsIdx].SumDelta));
+                UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[statsIdx].Count, stats.Stats[statsIdx].Count);
+            }
+        }
+
+        // counts are not rounded to float precision
+        const double largeCount = (1 << 24) + 1;
+        const double largeWeightedCount = 100000000.5;
+        TStats3D stats(TVector<TBucketStats>{{1, 2, 3, largeCount}, {1, 2, 3, largeWeightedCount}}, /*bucketCount*/ 2, /*maxLeafCount*/ 1, ESplitType::FloatFeature, /*isSinglePrecisionWire*/ true);
+        const TStats3D loaded = SaveLoad(stats);
+        CheckHeader(loaded, stats);
+        UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[0].Count, largeCount);
+        UNIT_ASSERT_VALUES_EQUAL(loaded.Stats[1].Count, largeWeightedCount);
+    }
+}
@@ -0,0 +1,230 @@
+#include <catboost/libs/algo/dataset.h>
+#include <catboost/libs/algo/fold.h>
+#include <catboost/libs/algo/index_hash_calcer.h>
+#include <catboost/libs/algo/learn_context.h>
+#include <catboost/libs/algo/online_ctr.h>
+#include <catboost/libs/distributed/mappers.h>
+#include <catboost/libs/distributed/master.h>
+#include <catboost/libs/helpers/restorable_rng.h>
+#include <catboost/libs/model/ctr_value_table.h>
+#include <catboost/libs/options/catboost_options.h>
+#include <catboost/libs/options/output_file_options.h>
+
+#include <library/unittest/registar.h>
+
+#include <util/generic/vector.h>
+#include <util/random/fast.h>
+
+using namespace NCatboostDistributed;
+
+static TDataset MakeCatFeaturesDataset(size_t docCount, int catFeatureCount, int valueCount, bool withTarget, TReallyFastRng32* rng) {
+    TDataset data;
+    auto& allFeatures = data.AllFeatures;
+    allFeatures.CatFeaturesRemapped.resize(catFeatureCount);
+    allFeatures.OneHotValues.resize(catFeatureCount);
+    allFeatures.IsOneHot.resize(catFeatureCount, false);
+    for (int featureIdx = 0; featureIdx < catFeatureCount; ++featureIdx) {
+        for (int value = 0; value < valueCount; ++value) {
+            allFeatures.OneHotValues[featureIdx].push_back(value);
+        }
+        for (size_t doc = 0; doc < docCount; ++doc) {
+            // value 0 is the most frequent one, so that ctr leaf count limit keeps the same values as on single host
+            allFeatures.CatFeaturesRemapped[featureIdx].push_back(rng->GenRandReal2() < 0.3 ? 0 : rng->Uniform(valueCount));
+        }
+    }
+    data.Target.resize(docCount);
+    for (size_t doc = 0; doc < docCount; ++doc) {
+        data.Target[doc] = withTarget ? rng->GenRandReal2() : 0.0f;
+    }
+    return data;
+}
+
+static TDataset GetShard(const TDataset& data, size_t docBegin, size_t docEnd) {
+    TDataset shard;
+    shard.AllFeatures.OneHotValues = data.AllFeatures.OneHotValues;
+    shard.AllFeatures.IsOneHot = data.AllFeatures.IsOneHot;
+    for (const auto& featureValues : data.AllFeatures.CatFeaturesRemapped) {
+        shard.AllFeatures.CatFeaturesRemapped.emplace_back(featureValues.begin() + docBegin, featureValues.begin() + docEnd);
+    }
+    shard.Target.assign(data.Target.begin() + docBegin, data.Target.begin() + docEnd);
+    return shard;
+}
+
+static void CheckCtrBinsEqual(const TOnlineCTR& expectedCtr,
+                              const TOnlineCTR& ctr,
+                              const TVector<TCtrInfo>& ctrInfo,
+                              const TVector<int>& targetClassesCount,
+                              size_t expectedDocBegin,
+                              size_t docBegin,
+                              size_t docCount) {
+    UNIT_ASSERT_VALUES_EQUAL(ctr.FeatureValueCount, expectedCtr.FeatureValueCount);
+    UNIT_ASSERT_VALUES_EQUAL(ctr.Feature.size(), ctrInfo.size());
+    for (int ctrIdx = 0; ctrIdx < ctrInfo.ysize(); ++ctrIdx) {
+        const int targetBorderCount = GetTargetBorderCount(ctrInfo[ctrIdx], targetClassesCount[ctrInfo[ctrIdx].TargetClassifierIdx]);
+        for (int border = 0; border < targetBorderCount; ++border) {
+            for (int priorIdx = 0; priorIdx < ctrInfo[ctrIdx].Priors.ysize(); ++priorIdx) {
+                const TPackedBins expectedBins = expectedCtr.GetCtrBins(ctrIdx, border, priorIdx);
+                const TPackedBins bins = ctr.GetCtrBins(ctrIdx, border, priorIdx);
+                for (size_t doc = 0; doc < docCount; ++doc) {
+                    UNIT_ASSERT_VALUES_EQUAL(bins[docBegin + doc], expectedBins[expectedDocBegin + doc]);
+                }
+            }
+        }
+    }
+}
+
+// Tables may differ in bucket layout, so values are compared for hashes of all documents
+static void CheckFinalCtrTablesEqual(const TCtrValueTable& expectedTable, const TCtrValueTable& table, ECtrType ctrType, const TVector<ui64>& hashes) {
+    UNIT_ASSERT_VALUES_EQUAL(table.CounterDenominator, expectedTable.CounterDenominator);
+    UNIT_ASSERT_VALUES_EQUAL(table.TargetClassesCount, expectedTable.TargetClassesCount);
+    const auto expectedIndex = expectedTable.GetIndexHashViewer();
+    const auto index = table.GetIndexHashViewer();
+    UNIT_ASSERT_VALUES_EQUAL(index.GetBucketCount(), expectedIndex.GetBucketCount());
+    for (ui64 hash : hashes) {
+        const ui32 expectedIdx = expectedIndex.GetIndex(hash);
+        const ui32 idx = index.GetIndex(hash);
+        UNIT_ASSERT_VALUES_EQUAL(idx == NCatboost::TDenseIndexHashView::NotFoundIndex, expectedIdx == NCatboost::TDenseIndexHashView::NotFoundIndex);
+        if (idx == NCatboost::TDenseIndexHashView::NotFoundIndex) {
+            continue;
+        }
+        if (ctrType == ECtrType::BinarizedTargetMeanValue) {
+            const auto& expectedMean = expectedTable.GetTypedArrayRefForBlobData<TCtrMeanHistory>()[expectedIdx];
+            const auto& mean = table.GetTypedArrayRefForBlobData<TCtrMeanHistory>()[idx];
+            UNIT_ASSERT_VALUES_EQUAL(mean.Count, expectedMean.Count);
+            UNIT_ASSERT_DOUBLES_EQUAL(mean.Sum, expectedMean.Sum, 1e-3);
+        } else {
+            const int stride = Max(table.TargetClassesCount, 1);
+            const auto expectedCounts = expectedTable.GetTypedArrayRefForBlobData<int>();
+            const auto counts = table.GetTypedArrayRefForBlobData<int>();
+            for (int classIdx = 0; classIdx < stride; ++classIdx) {
+                UNIT_ASSERT_VALUES_EQUAL(counts[idx * stride + classIdx], expectedCounts[expectedIdx * stride + classIdx]);
+            }
+        }
+    }
+}
+
+static void CheckShardOnlineCtrsEqualSingleHostCtrs(ECounterCalc counterCalcMethod, ui64 ctrLeafCountLimit) {
+    const size_t docCount = 2000;
+    const int catFeatureCount = 2;
+    const int valueCount = 10;
+
+    TReallyFastRng32 rng(23);
+    const TDataset learnData = MakeCatFeaturesDataset(docCount, catFeatureCount, valueCount, /*withTarget*/ true, &rng);
+    // test documents have values unseen in learn data, they get their own leaves
+    const TDataset testData = MakeCatFeaturesDataset(300, catFeatureCount, valueCount + 5, /*withTarget*/ false, &rng);
+    const TDatasetPtrs testDataPtrs = {&testData};
+
+    NCatboostOptions::TCatBoostOptions options(ETaskType::CPU);
+    options.SystemOptions->NumThreads.Set(4);
+    auto& catFeatureParams = options.CatFeatureParams.Get();
+    catFeatureParams.CounterCalcMethod.Set(counterCalcMethod);
+    catFeatureParams.CtrLeafCountLimit.Set(ctrLeafCountLimit);
+    TVector<NCatboostOptions::TCtrDescription> ctrDescriptions;
+    auto addCtrDescription = [&] (ECtrType type, ui32 targetBorderCount) {
+        ctrDescriptions.emplace_back(type,
+            TVector<NCatboostOptions::TPrior>{{0.0f, 1.0f}, {0.5f, 1.0f}, {1.0f, 1.0f}},
+            NCatboostOptions::TBinarizationOptions(EBorderSelectionType::Uniform, 15),
+            NCatboostOptions::TBinarizationOptions(EBorderSelectionType::Uniform, targetBorderCount));
+    };
+    addCtrDescription(ECtrType::Borders, /*targetBorderCount*/ 1);
+    addCtrDescription(ECtrType::Borders, /*targetBorderCount*/ 2);
+    addCtrDescription(ECtrType::Buckets, /*targetBorderCount*/ 2);
+    addCtrDescription(ECtrType::BinarizedTargetMeanValue, /*targetBorderCount*/ 2);
+    addCtrDescription(ECtrType::Counter, /*targetBorderCount*/ 1);
+    catFeatureParams.SimpleCtrs.Set(ctrDescriptions);
+    catFeatureParams.CombinationCtrs.Set(ctrDescriptions);
+    options.SetNotSpecifiedOptionsToDefaults();
+
+    TLearnContext ctx(options, Nothing(), Nothing(), NCatboostOptions::TOutputFilesOptions(ETaskType::CPU),
+        catFeatureCount, /*catFeatures*/ {0, 1}, /*featuresId*/ {});
+    ctx.CtrsHelper.InitCtrHelper(ctx.Params.CatFeatureParams, ctx.Layout, learnData.Target, ELossFunction::RMSE,
+        /*objectiveDescriptor*/ Nothing(), /*allowConstLabel*/ false);
+    const auto& targetClassifiers = ctx.CtrsHelper.GetTargetClassifiers();
+
+    TRestorableFastRng64 rand(0);
+    const TFold plainFold = TFold::BuildPlainFold(learnData, targetClassifiers, /*shuffle*/ false, docCount,
+        /*approxDimension*/ 1, /*storeExpApproxes*/ false, /*hasPairwiseWeights*/ false, rand);
+
+    TVector<TProjection> projections(3);
+    projections[0].AddCatFeature(0);
+    projections[1].AddCatFeature(1);
+    projections[2].AddCatFeature(0);
+    projections[2].AddCatFeature(1);
+
+    for (const TVector<size_t>& shardBorders : {TVector<size_t>{0, 1000, docCount}, TVector<size_t>{0, 700, 1300, docCount}}) {
+        const int shardCount = shardBorders.ysize() - 1;
+        TVector<TDataset> shards;
+        TVector<TFold> shardFolds;
+        for (int shardIdx = 0; shardIdx < shardCount; ++shardIdx) {
+            shards.push_back(GetShard(learnData, shardBorders[shardIdx], shardBorders[shardIdx + 1]));
+            shardFolds.push_back(TFold::BuildPlainFold(shards.back(), targetClassifiers, /*shuffle*/ false, shards.back().GetSampleCount(),
+                /*approxDimension*/ 1, /*storeExpApproxes*/ false, /*hasPairwiseWeights*/ false, rand));
+        }
+        for (const auto& proj : projections) {
+            TOnlineCTR singleHostCtr;
+            ComputeOnlineCTRs(learnData, testDataPtrs, plainFold, proj, &ctx, &ctx.LocalExecutor, &singleHostCtr);
+
+            TOnlineCtrRequest request;
+            request.Projection = proj;
+            request.CtrInfo = ctx.CtrsHelper.GetCtrInfo(proj);
+            TVector<TCtrHashStats> hashStats(shardCount);
+            TVector<const TCtrHashStats*> hashStatsPtrs;
+            TVector<TCtrShardCounters> counters(shardCount);
+            TVector<TCtrShardCounters*> countersPtrs;
+            for (int shardIdx = 0; shardIdx < shardCount; ++shardIdx) {
+                CollectCtrHashStats(request, shards[shardIdx].AllFeatures, shardFolds[shardIdx], &hashStats[shardIdx]);
+                hashStatsPtrs.push_back(&hashStats[shardIdx]);
+                countersPtrs.push_back(&counters[shardIdx]);
+            }
+            BuildShardCounters(request, hashStatsPtrs, plainFold.TargetClassesCount, testDataPtrs, ctx.Params.CatFeatureParams.Get(), countersPtrs);
+
+            for (int shardIdx = 0; shardIdx < shardCount; ++shardIdx) {
+                TOnlineCTR shardCtr;
+                CalcShardOnlineCtrs(counters[shardIdx], shards[shardIdx].AllFeatures, shardFolds[shardIdx], &ctx.LocalExecutor, &shardCtr);
+                CheckCtrBinsEqual(singleHostCtr, shardCtr, request.CtrInfo, plainFold.TargetClassesCount,
+                    /*expectedDocBegin*/ shardBorders[shardIdx], /*docBegin*/ 0, shardBorders[shardIdx + 1] - shardBorders[shardIdx]);
+            }
+
+            // test documents follow learn documents of the fold in both ctrs
+            TOnlineCTR testCtr;
+            CalcTestOnlineCtr(request, hashStatsPtrs, testDataPtrs, ctx.Params.CatFeatureParams.Get(), plainFold, &ctx.LocalExecutor, &testCtr);
+            CheckCtrBinsEqual(singleHostCtr, testCtr, request.CtrInfo, plainFold.TargetClassesCount,
+                /*expectedDocBegin*/ docCount, /*docBegin*/ docCount, testData.GetSampleCount());
+
+            TVector<ui64> hashes(docCount + testData.GetSampleCount());
+            CalcHashes(proj, learnData.AllFeatures, 0, nullptr, /*calculateExactCatHashes*/ true, hashes.begin(), hashes.begin() + docCount);
+            CalcHashes(proj, testData.AllFeatures, 0, nullptr, /*calculateExactCatHashes*/ true, hashes.begin() + docCount, hashes.end());
+            for (const auto& ctrInfo : request.CtrInfo) {
+                TModelCtrBase ctrBase;
+                ctrBase.CtrType = ctrInfo.Type;
+                ctrBase.TargetBorderClassifierIdx = ctrInfo.TargetClassifierIdx;
+                const int targetClassesCount = plainFold.TargetClassesCount[ctrInfo.TargetClassifierIdx];
+                TCtrValueTable singleHostTable;
+                CalcFinalCtrs(ctrInfo.Type,
+                    proj,
+                    learnData,
+                    testDataPtrs,
+                    plainFold.LearnPermutation,
+                    plainFold.LearnTargetClass[ctrInfo.TargetClassifierIdx],
+                    targetClassesCount,
+                    ctx.Params.CatFeatureParams->CtrLeafCountLimit,
+                    ctx.Params.CatFeatureParams->StoreAllSimpleCtrs,
+                    ctx.Params.CatFeatureParams->CounterCalcMethod,
+                    &singleHostTable);
+                const TCtrValueTable table = BuildFinalCtrTable(ctrBase, request, hashStatsPtrs, targetClassesCount, testDataPtrs, ctx.Params.CatFeatureParams.Get());
+                CheckFinalCtrTablesEqual(singleHostTable, table, ctrInfo.Type, hashes);
+            }
+        }
+    }
+}
+
+Y_UNIT_TEST_SUITE(TDistributedOnlineCtrTest) {
+    // online ctrs of learn and test documents and final ctr tables
+    Y_UNIT_TEST(TestShardOnlineCtrsEqualSingleHostCtrs) {
+        for (ECounterCalc counterCalcMethod : {ECounterCalc::Full, ECounterCalc::SkipTest}) {
+            CheckShardOnlineCtrsEqualSingleHostCtrs(counterCalcMethod, /*ctrLeafCountLimit*/ Max<ui64>());
+            // all learn documents share one leaf, test documents of less frequent values get their own leaves
+            CheckShardOnlineCtrsEqualSingleHostCtrs(counterCalcMethod, /*ctrLeafCountLimit*/ 1);
+        }
+    }
+}
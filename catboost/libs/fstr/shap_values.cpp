@@ -299,19 +299,27 @@ static void MapBinFeaturesToClasses(
     TVector<TVector<int>> binFeaturesCombinations;
     binFeaturesCombinations.reserve(featureCount);
 
+    // features with many borders occupy several binarized buckets, each of them is mapped to the same feature
     for (const TFloatFeature& floatFeature : forest.FloatFeatures) {
-        binFeaturesCombinations.emplace_back(1, floatFeature.FlatFeatureIndex);
+        for (int bucketIdx = 0; bucketIdx < GetBinFeatureBucketCount(floatFeature.Borders.ysize()); ++bucketIdx) {
+            binFeaturesCombinations.emplace_back(1, floatFeature.FlatFeatureIndex);
+        }
     }
 
     for (const TOneHotFeature& oneHotFeature: forest.OneHotFeatures) {
-        binFeaturesCombinations.emplace_back(1, oneHotFeature.CatFeatureIndex);
+        for (int bucketIdx = 0; bucketIdx < GetBinFeatureBucketCount(oneHotFeature.Values.ysize()); ++bucketIdx) {
+            binFeaturesCombinations.emplace_back(1, oneHotFeature.CatFeatureIndex);
+        }
     }
 
     for (const TCtrFeature& ctrFeature : forest.CtrFeatures) {
         const TFeatureCombination& combination = ctrFeature.Ctr.Base.Projection;
-        binFeaturesCombinations.emplace_back();
+        TVector<int> combinationFeatures;
         for (int catFeatureIdx : combination.CatFeatures) {
-            binFeaturesCombinations.back().push_back(forest.CatFeatures[catFeatureIdx].FlatFeatureIndex);
+            combinationFeatures.push_back(forest.CatFeatures[catFeatureIdx].FlatFeatureIndex);
+        }
+        for (int bucketIdx = 0; bucketIdx < GetBinFeatureBucketCount(ctrFeature.Borders.ysize()); ++bucketIdx) {
+            binFeaturesCombinations.push_back(combinationFeatures);
         }
     }
 
@@ -2,6 +2,7 @@
 
 #include <util/generic/array_ref.h>
 #include <util/digest/numeric.h>
+#include <util/system/compiler.h>
 
 namespace NCatboost {
 
@@ -43,6 +44,26 @@ namespace NCatboost {
             return NotFoundIndex;
         }
 
+        /**
+         * Resolve all hashes, result is the same as GetIndex call for each hash.
+         * First bucket of each lookup is prefetched prefetchDistance lookups ahead, so cache misses
+         * on big tables overlap instead of being paid one after another.
+         */
+        void GetIndexes(TConstArrayRef<ui64> hashes, ui32* indexes) const {
+            const size_t prefetchDistance = 16;
+            const size_t count = hashes.size();
+            const size_t prefetchEnd = count < prefetchDistance ? count : prefetchDistance;
+            for (size_t i = 0; i < prefetchEnd; ++i) {
+                Y_PREFETCH_READ(Buckets.data() + (hashes[i] & HashMask), 3);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if (i + prefetchDistance < count) {
+                    Y_PREFETCH_READ(Buckets.data() + (hashes[i + prefetchDistance] & HashMask), 3);
+                }
+                indexes[i] = GetIndex(hashes[i]);
+            }
+        }
+
         const TConstArrayRef<TBucket> GetBuckets() const {
             return Buckets;
         }
@@ -0,0 +1,170 @@
+#include <catboost/libs/model/formula_evaluator.h>
+#include <catboost/libs/model/model.h>
+#include <catboost/libs/model/quantized_leaves.h>
+
+#include <library/testing/benchmark/bench.h>
+
+#include <util/generic/singleton.h>
+#include <util/generic/vector.h>
+#include <util/random/fast.h>
+
+/*
+ * Each block benchmark iteration processes FORMULA_EVALUATION_BLOCK_SIZE documents,
+ * so per document time is iteration time divided by block size.
+ */
+
+namespace {
+    constexpr int FloatFeatureCount = 100;
+    constexpr int BorderCount = 32;
+    constexpr int TreeCount = 1000;
+    constexpr int TreeDepth = 6;
+
+    struct TBenchmarkData {
+        TFullModel Model;
+        TVector<float> Features; // [featureIdx][docIdx]
+        TVector<ui8> BinFeatures;
+        TQuantizedLeafValues Int16LeafValues;
+        TQuantizedLeafValues Int8LeafValues;
+
+        TBenchmarkData() {
+            TReallyFastRng32 rng(0);
+            for (int featureIdx = 0; featureIdx < FloatFeatureCount; ++featureIdx) {
+                TVector<float> borders;
+                for (int borderIdx = 0; borderIdx < BorderCount; ++borderIdx) {
+                    borders.push_back((float)borderIdx / BorderCount);
+                }
+                Model.ObliviousTrees.FloatFeatures.emplace_back(false, featureIdx, featureIdx, borders);
+            }
+            for (int treeIdx = 0; treeIdx < TreeCount; ++treeIdx) {
+                TVector<int> tree;
+                for (int depth = 0; depth < TreeDepth; ++depth) {
+                    tree.push_back(rng.Uniform(FloatFeatureCount * BorderCount));
+                }
+                Model.ObliviousTrees.AddBinTree(tree);
+                for (int leafIdx = 0; leafIdx < (1 << TreeDepth); ++leafIdx) {
+                    Model.ObliviousTrees.LeafValues.push_back(rng.GenRandReal1());
+                }
+            }
+            Model.UpdateDynamicData();
+
+            Features.resize(FloatFeatureCount * FORMULA_EVALUATION_BLOCK_SIZE);
+            for (auto& value : Features) {
+                value = rng.GenRandReal1();
+            }
+            BinFeatures.resize(FloatFeatureCount * FORMULA_EVALUATION_BLOCK_SIZE);
+            Binarize(/*useAvx2*/ false, BinFeatures.data());
+            Int16LeafValues = TQuantizedLeafValues::Build(Model.ObliviousTrees, ELeafValuesQuantization::Int16);
+            Int8LeafValues = TQuantizedLeafValues::Build(Model.ObliviousTrees, ELeafValuesQuantization::Int8);
+        }
+
+        void Binarize(bool useAvx2, ui8* result) const {
+            memset(result, 0, FloatFeatureCount * FORMULA_EVALUATION_BLOCK_SIZE);
+            for (int featureIdx = 0; featureIdx < FloatFeatureCount; ++featureIdx) {
+                const float* featureValues = Features.data() + featureIdx * FORMULA_EVALUATION_BLOCK_SIZE;
+                const auto& borders = Model.ObliviousTrees.FloatFeatures[featureIdx].Borders;
+                if (useAvx2) {
+                    BinarizeFloats<false>(
+                        FORMULA_EVALUATION_BLOCK_SIZE,
+                        [featureValues](size_t index) { return featureValues[index]; },
+                        borders,
+                        0,
+                        result);
+                } else {
+                    BinarizeFloatsSse<false>(
+                        FORMULA_EVALUATION_BLOCK_SIZE,
+                        [featureValues](size_t index) { return featureValues[index]; },
+                        borders,
+                        0,
+                        result);
+                }
+            }
+        }
+
+        void CalcTrees(bool useAvx2) const {
+            TVector<TCalcerIndexType> indexesVec(FORMULA_EVALUATION_BLOCK_SIZE);
+            TVector<double> results(FORMULA_EVALUATION_BLOCK_SIZE);
+            auto calcTrees = GetCalcTreesFunction(Model, FORMULA_EVALUATION_BLOCK_SIZE, useAvx2);
+            calcTrees(
+                Model,
+                BinFeatures.data(),
+                FORMULA_EVALUATION_BLOCK_SIZE,
+                indexesVec.data(),
+                0,
+                Model.GetTreeCount(),
+                results.data());
+            Y_DO_NOT_OPTIMIZE_AWAY(results.data());
+        }
+
+        void CalcTreesQuantized(const TQuantizedLeafValues& leafValues) const {
+            TVector<double> results(FORMULA_EVALUATION_BLOCK_SIZE);
+            ::CalcTreesQuantized(
+                Model,
+                leafValues,
+                BinFeatures.data(),
+                FORMULA_EVALUATION_BLOCK_SIZE,
+                0,
+                Model.GetTreeCount(),
+                results.data());
+            Y_DO_NOT_OPTIMIZE_AWAY(results.data());
+        }
+    };
+}
+
+Y_CPU_BENCHMARK(BinarizeFloatsSse, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    TVector<ui8> binFeatures(data.BinFeatures.size());
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.Binarize(/*useAvx2*/ false, binFeatures.data());
+        Y_DO_NOT_OPTIMIZE_AWAY(binFeatures.data());
+    }
+}
+
+Y_CPU_BENCHMARK(BinarizeFloatsDispatched, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    TVector<ui8> binFeatures(data.BinFeatures.size());
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.Binarize(/*useAvx2*/ true, binFeatures.data());
+        Y_DO_NOT_OPTIMIZE_AWAY(binFeatures.data());
+    }
+}
+
+Y_CPU_BENCHMARK(CalcTreesSse, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.CalcTrees(/*useAvx2*/ false);
+    }
+}
+
+Y_CPU_BENCHMARK(CalcTreesDispatched, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.CalcTrees(/*useAvx2*/ true);
+    }
+}
+
+Y_CPU_BENCHMARK(CalcTreesQuantizedInt16, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.CalcTreesQuantized(data.Int16LeafValues);
+    }
+}
+
+Y_CPU_BENCHMARK(CalcTreesQuantizedInt8, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        data.CalcTreesQuantized(data.Int8LeafValues);
+    }
+}
+
+Y_CPU_BENCHMARK(CalcFlatSingle, iface) {
+    const auto& data = *Singleton<TBenchmarkData>();
+    TVector<float> features(FloatFeatureCount);
+    TVector<double> result(1);
+    for (size_t i = 0; i < iface.Iterations(); ++i) {
+        for (int featureIdx = 0; featureIdx < FloatFeatureCount; ++featureIdx) {
+            features[featureIdx] = data.Features[featureIdx * FORMULA_EVALUATION_BLOCK_SIZE + i % FORMULA_EVALUATION_BLOCK_SIZE];
+        }
+        data.Model.CalcFlatSingle(features, result);
+        Y_DO_NOT_OPTIMIZE_AWAY(result[0]);
+    }
+}
@@ -28,3 +28,15 @@ void TCtrData::Load(IInputStream* s) {
         LearnCtrs[ctrBase] = std::move(table);
     }
 }
+
+void TCtrData::LoadNonOwning(TMemoryInput* in) {
+    const size_t cnt = ::LoadSize(in);
+    LearnCtrs.reserve(cnt);
+
+    for (size_t i = 0; i != cnt; ++i) {
+        TCtrValueTable table;
+        table.LoadThin(in);
+        TModelCtrBase ctrBase = table.ModelCtrBase;
+        LearnCtrs[ctrBase] = std::move(table);
+    }
+}
@@ -18,6 +18,11 @@ struct TCtrData {
     void Save(IOutputStream* s) const;
 
     void Load(IInputStream* s);
+
+    /**
+     * Load ctr tables as views into memory stream buffer. Buffer should outlive ctr data.
+     */
+    void LoadNonOwning(TMemoryInput* in);
 };
 
 struct TCtrDataStreamWriter {
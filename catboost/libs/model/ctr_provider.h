@@ -5,8 +5,18 @@
 #include "features.h"
 #include "ctr_value_table.h"
 #include <util/generic/array_ref.h>
+#include <util/generic/ptr.h>
 
 
+/**
+ * Document independent part of CalcCtrs for a list of ctrs, created by provider for a model, see TFullModel::CtrCalcPlan
+ */
+class ICtrCalcPlan : public TThrRefBase {
+public:
+    virtual ~ICtrCalcPlan() {
+    }
+};
+
 class ICtrProvider : public TThrRefBase {
 public:
     virtual ~ICtrProvider() {
@@ -16,6 +26,7 @@ public:
 
     virtual void CalcCtrs(
         const TVector<TModelCtr>& neededCtrs,
+        const ICtrCalcPlan* plan, // made by CreateCtrCalcPlan, can be null or made for other ctrs
         const TConstArrayRef<ui8>& binarizedFeatures, // vector of binarized float & one hot features
         const TConstArrayRef<int>& hashedCatFeatures,
         size_t docCount,
@@ -26,6 +37,14 @@ public:
         const TVector<TOneHotFeature>& oheFeatures,
         const TVector<TCatFeature>& catFeatures) = 0;
 
+    /**
+     * Called after SetupBinFeatureIndexes with all ctrs used by model, provider can precompute
+     * everything that doesn't depend on documents for CalcCtrs calls with the same ctrs list
+     */
+    virtual TIntrusivePtr<ICtrCalcPlan> CreateCtrCalcPlan(const TVector<TModelCtr>& /*neededCtrs*/) const {
+        return nullptr;
+    }
+
     virtual void AddCtrCalcerData(TCtrValueTable&& valueTable) = 0;
     virtual bool IsSerializable() const {
         return false;
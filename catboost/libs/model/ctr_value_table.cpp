@@ -1,6 +1,7 @@
 #include "ctr_value_table.h"
 #include "flatbuffers_serializer_helper.h"
 #include <catboost/libs/model/flatbuffers/model.fbs.h>
+#include <catboost/libs/helpers/exception.h>
 #include <util/stream/input.h>
 #include <util/ysaveload.h>
 
@@ -62,3 +63,28 @@ void TCtrValueTable::LoadSolid(void* buf, size_t length) {
     solid.CTRBlob.assign(ctrValueTable->CTRBlob()->data(),
                          ctrValueTable->CTRBlob()->data() + ctrValueTable->CTRBlob()->size());
 }
+
+void TCtrValueTable::LoadThin(TMemoryInput* in) {
+    const ui32 size = LoadSize(in);
+    CB_ENSURE(in->Avail() >= size, "Unexpected end of ctr value table data");
+    const char* buf = in->Buf();
+    in->Skip(size);
+    LoadThin(buf, size);
+}
+
+void TCtrValueTable::LoadThin(const void* buf, size_t length) {
+    {
+        flatbuffers::Verifier verifier(static_cast<const ui8*>(buf), length);
+        CB_ENSURE(NCatBoostFbs::VerifyTCtrValueTableBuffer(verifier), "Flatbuffers ctr value table verification failed");
+    }
+    Impl = TThinTable();
+    auto& thin = Impl.As<TThinTable>();
+    auto ctrValueTable = flatbuffers::GetRoot<NCatBoostFbs::TCtrValueTable>(buf);
+    ModelCtrBase.FBDeserialize(ctrValueTable->ModelCtrBase());
+    CounterDenominator = ctrValueTable->CounterDenominator();
+    TargetClassesCount = ctrValueTable->TargetClassesCount();
+    thin.IndexBuckets = MakeArrayRef(
+        (const NCatboost::TBucket*)ctrValueTable->IndexHashRaw()->data(),
+        ctrValueTable->IndexHashRaw()->size() / sizeof(NCatboost::TBucket));
+    thin.CTRBlob = MakeArrayRef(ctrValueTable->CTRBlob()->data(), ctrValueTable->CTRBlob()->size());
+}
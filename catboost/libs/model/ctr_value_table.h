@@ -8,6 +8,7 @@
 #include <util/generic/variant.h>
 #include <tuple>
 #include <util/stream/input.h>
+#include <util/stream/mem.h>
 #include <util/stream/output.h>
 
 class TCtrValueTable {
@@ -88,6 +89,13 @@ public:
 
     void LoadSolid(void* buf, size_t length);
 
+    /**
+     * Load table as view into memory stream buffer without copying. Buffer should outlive the table.
+     */
+    void LoadThin(TMemoryInput* in);
+
+    void LoadThin(const void* buf, size_t length);
+
     bool operator==(const TCtrValueTable& other) const {
         return std::tie(CounterDenominator, TargetClassesCount, Impl) ==
                std::tie(other.CounterDenominator, other.TargetClassesCount, other.Impl);
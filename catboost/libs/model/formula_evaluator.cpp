@@ -69,7 +69,10 @@ void CalcIndexes(
     ui32* __restrict indexesVec,
     const TRepackedBin* __restrict treeSplitsCurPtr,
     int curTreeSize) {
-    // TODO(kirillovs): add sse dispatching here
+    if (NX86::CachedHaveAVX2()) {
+        CalcIndexesAvx2(needXorMask, binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+        return;
+    }
     if (needXorMask) {
         CalcIndexesBasic<true, 0>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
     } else {
@@ -219,6 +222,21 @@ Y_FORCE_INLINE void CalcIndexesSse(
 #undef STORE_16_DOCS_RESULT
 }
 
+template<bool UseAvx2, bool NeedXorMask, size_t SSEBlockCount>
+Y_FORCE_INLINE void CalcIndexesSimd(
+        const ui8* __restrict binFeatures,
+        size_t docCountInBlock,
+        ui8* __restrict indexesVec,
+        const TRepackedBin* __restrict treeSplitsCurPtr,
+        const int curTreeSize) {
+    // AVX2 kernel processes 32 documents at once, so it is useless for smaller blocks
+    if (UseAvx2 && SSEBlockCount > 1) {
+        CalcIndexesAvx2(NeedXorMask, binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    } else {
+        CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    }
+}
+
 template<typename TIndexType>
 Y_FORCE_INLINE void CalculateLeafValues(const size_t docCountInBlock, const double* __restrict treeLeafPtr, const TIndexType* __restrict indexesPtr, double* __restrict writePtr) {
     Y_PREFETCH_READ(treeLeafPtr, 3);
@@ -320,7 +338,7 @@ Y_FORCE_INLINE void CalculateLeafValuesMulti(const size_t docCountInBlock, const
     }
 }
 
-template<bool IsSingleClassModel, bool NeedXorMask, int SSEBlockCount>
+template<bool IsSingleClassModel, bool NeedXorMask, bool UseAvx2, int SSEBlockCount>
 Y_FORCE_INLINE void CalcTreesBlockedImpl(
     const TFullModel& model,
     const ui8* __restrict binFeatures,
@@ -357,13 +375,13 @@ Y_FORCE_INLINE void CalcTreesBlockedImpl(
         auto treeEnd4 = treeStart + (((treeEnd - treeStart) | 0x3) ^ 0x3);
         for (size_t treeId = treeStart; treeId < treeEnd4; treeId += 4) {
             memset(indexesVec, 0, sizeof(ui32) * docCountInBlock);
-            CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 0, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId]);
+            CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 0, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId]);
             treeSplitsCurPtr += model.ObliviousTrees.TreeSizes[treeId];
-            CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 1, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 1]);
+            CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 1, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 1]);
             treeSplitsCurPtr += model.ObliviousTrees.TreeSizes[treeId + 1];
-            CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 2, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 2]);
+            CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 2, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 2]);
             treeSplitsCurPtr += model.ObliviousTrees.TreeSizes[treeId + 2];
-            CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 3, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 3]);
+            CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec + docCountInBlock * 3, treeSplitsCurPtr, model.ObliviousTrees.TreeSizes[treeId + 3]);
             treeSplitsCurPtr += model.ObliviousTrees.TreeSizes[treeId + 3];
 
             CalculateLeafValues4<SSEBlockCount>(
@@ -388,7 +406,7 @@ Y_FORCE_INLINE void CalcTreesBlockedImpl(
         auto curTreeSize = model.ObliviousTrees.TreeSizes[treeId];
         memset(indexesVec, 0, sizeof(ui32) * docCountInBlock);
         if (curTreeSize <= 8) {
-            CalcIndexesSse<NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+            CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
             if (IsSingleClassModel) { // single class model
                 CalculateLeafValues(docCountInBlock, treeLeafPtr + firstLeafOffsetsPtr[treeId], indexesVec, resultsPtr);
             } else { // mutliclass model
@@ -406,7 +424,7 @@ Y_FORCE_INLINE void CalcTreesBlockedImpl(
     }
 }
 
-template<bool IsSingleClassModel, bool NeedXorMask>
+template<bool IsSingleClassModel, bool NeedXorMask, bool UseAvx2>
 inline void CalcTreesBlocked(
     const TFullModel& model,
     const ui8* __restrict binFeatures,
@@ -417,53 +435,56 @@ inline void CalcTreesBlocked(
     double* __restrict resultsPtr) {
     switch (docCountInBlock / SSE_BLOCK_SIZE) {
     case 0:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 0>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 0>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 1:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 1>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 1>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 2:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 2>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 2>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 3:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 3>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 3>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 4:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 4>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 4>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 5:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 5>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 5>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 6:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 6>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 6>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 7:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 7>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 7>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     case 8:
-        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, 8>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
+        CalcTreesBlockedImpl<IsSingleClassModel, NeedXorMask, UseAvx2, 8>(model, binFeatures, docCountInBlock, indexesVec, treeStart, treeEnd, resultsPtr);
         break;
     default:
         Y_UNREACHABLE();
     }
 }
 
-template<bool IsSingleClassModel, bool NeedXorMask>
-inline void CalcTreesSingleDocImpl(
-    const TFullModel& model,
+/**
+ * Evaluates a run of trees with the same depth for one document.
+ * Depth is a compile time constant for all depths up to 16, so depth loop is fully unrolled and there is no per tree branching.
+ * Depth == -1 stands for generic implementation which uses runtime treeDepth.
+ */
+template<bool IsSingleClassModel, bool NeedXorMask, int Depth>
+Y_FORCE_INLINE void CalcSameDepthTreesSingleDoc(
+    const int approxDimension,
     const ui8* __restrict binFeatures,
-    size_t,
-    TCalcerIndexType* __restrict,
-    size_t treeStart,
-    size_t treeEnd,
+    const int treeDepth,
+    const size_t treeCount,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    const double* __restrict treeLeafPtr,
     double* __restrict results)
 {
-    const TRepackedBin* treeSplitsCurPtr =
-        model.ObliviousTrees.GetRepackedBins().data() + model.ObliviousTrees.TreeStartOffsets[treeStart];
-    double result = 0.0;
-    const double* treeLeafPtr = model.ObliviousTrees.GetFirstLeafPtrForTree(treeStart);
-    for (size_t treeId = treeStart; treeId < treeEnd; ++treeId) {
-        const auto curTreeSize = model.ObliviousTrees.TreeSizes[treeId];
+    const int curTreeSize = Depth >= 0 ? Depth : treeDepth;
+    const size_t treeLeafCount = (1 << curTreeSize) * (IsSingleClassModel ? 1 : approxDimension);
+    double result = results[0];
+    for (size_t treeId = 0; treeId < treeCount; ++treeId) {
         TCalcerIndexType index = 0;
         for (int depth = 0; depth < curTreeSize; ++depth) {
             const ui8 borderVal = (ui8)(treeSplitsCurPtr[depth].SplitIdx);
@@ -478,12 +499,12 @@ inline void CalcTreesSingleDocImpl(
         if (IsSingleClassModel) { // single class model
             result += treeLeafPtr[index];
         } else { // mutliclass model
-            auto leafValuePtr = treeLeafPtr + index * model.ObliviousTrees.ApproxDimension;
-            for (int classId = 0; classId < model.ObliviousTrees.ApproxDimension; ++classId) {
+            auto leafValuePtr = treeLeafPtr + index * approxDimension;
+            for (int classId = 0; classId < approxDimension; ++classId) {
                 results[classId] += leafValuePtr[classId];
             }
         }
-        treeLeafPtr += (1 << curTreeSize) * model.ObliviousTrees.ApproxDimension;
+        treeLeafPtr += treeLeafCount;
         treeSplitsCurPtr += curTreeSize;
     }
     if (IsSingleClassModel) {
@@ -491,8 +512,149 @@ inline void CalcTreesSingleDocImpl(
     }
 }
 
-TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountInBlock) {
+template<bool IsSingleClassModel, bool NeedXorMask>
+inline void CalcTreesSingleDocImpl(
+    const TFullModel& model,
+    const ui8* __restrict binFeatures,
+    size_t,
+    TCalcerIndexType* __restrict,
+    size_t treeStart,
+    size_t treeEnd,
+    double* __restrict results)
+{
+    const TRepackedBin* treeSplitsCurPtr =
+        model.ObliviousTrees.GetRepackedBins().data() + model.ObliviousTrees.TreeStartOffsets[treeStart];
+    double result = 0.0;
+    double* resultsPtr = IsSingleClassModel ? &result : results;
+    const double* treeLeafPtr = model.ObliviousTrees.GetFirstLeafPtrForTree(treeStart);
+    const auto& treeDepthRunEnds = model.ObliviousTrees.GetTreeDepthRunEnds();
+    const int approxDimension = model.ObliviousTrees.ApproxDimension;
+    size_t treeId = treeStart;
+    while (treeId < treeEnd) {
+        const auto curTreeSize = model.ObliviousTrees.TreeSizes[treeId];
+        const size_t runEnd = Min(treeDepthRunEnds[treeId], treeEnd);
+        switch (curTreeSize) {
+        case 0:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 0>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 1:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 1>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 2:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 2>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 3:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 3>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 4:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 4>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 5:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 5>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 6:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 6>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 7:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 7>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 8:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 8>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 9:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 9>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 10:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 10>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 11:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 11>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 12:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 12>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 13:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 13>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 14:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 14>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 15:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 15>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        case 16:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, 16>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+            break;
+        default:
+            CalcSameDepthTreesSingleDoc<IsSingleClassModel, NeedXorMask, -1>(approxDimension, binFeatures, curTreeSize, runEnd - treeId, treeSplitsCurPtr, treeLeafPtr, resultsPtr);
+        }
+        treeLeafPtr += (runEnd - treeId) * (1 << curTreeSize) * approxDimension;
+        treeSplitsCurPtr += (runEnd - treeId) * curTreeSize;
+        treeId = runEnd;
+    }
+    if (IsSingleClassModel) {
+        results[0] = result;
+    }
+}
+
+template<bool NeedXorMask, bool UseAvx2, size_t SSEBlockCount>
+static void CalcIndexesUi8Impl(
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui8* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize)
+{
+    CalcIndexesSimd<UseAvx2, NeedXorMask, SSEBlockCount>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+}
+
+template<bool NeedXorMask, bool UseAvx2>
+static TCalcIndexesUi8Function GetCalcIndexesUi8Function(size_t docCountInBlock) {
+    switch (docCountInBlock / SSE_BLOCK_SIZE) {
+    case 0:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 0>;
+    case 1:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 1>;
+    case 2:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 2>;
+    case 3:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 3>;
+    case 4:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 4>;
+    case 5:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 5>;
+    case 6:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 6>;
+    case 7:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 7>;
+    case 8:
+        return CalcIndexesUi8Impl<NeedXorMask, UseAvx2, 8>;
+    default:
+        Y_UNREACHABLE();
+    }
+}
+
+TCalcIndexesUi8Function GetCalcIndexesUi8Function(bool needXorMask, size_t docCountInBlock, bool allowAvx2) {
+    const bool useAvx2 = allowAvx2 && NX86::CachedHaveAVX2();
+    if (needXorMask) {
+        return useAvx2 ? GetCalcIndexesUi8Function<true, true>(docCountInBlock) : GetCalcIndexesUi8Function<true, false>(docCountInBlock);
+    } else {
+        return useAvx2 ? GetCalcIndexesUi8Function<false, true>(docCountInBlock) : GetCalcIndexesUi8Function<false, false>(docCountInBlock);
+    }
+}
+
+template<bool IsSingleClassModel, bool NeedXorMask>
+static TTreeCalcFunction GetCalcTreesBlockedFunction(bool useAvx2) {
+    if (useAvx2) {
+        return CalcTreesBlocked<IsSingleClassModel, NeedXorMask, true>;
+    } else {
+        return CalcTreesBlocked<IsSingleClassModel, NeedXorMask, false>;
+    }
+}
+
+TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountInBlock, bool allowAvx2) {
     const bool hasOneHots = !model.ObliviousTrees.OneHotFeatures.empty();
+    const bool useAvx2 = allowAvx2 && NX86::CachedHaveAVX2();
     if (model.ObliviousTrees.ApproxDimension == 1) {
         if (docCountInBlock == 1) {
             if (hasOneHots) {
@@ -502,9 +664,9 @@ TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountI
             }
         } else {
             if (hasOneHots) {
-                return CalcTreesBlocked<true, true>;
+                return GetCalcTreesBlockedFunction<true, true>(useAvx2);
             } else {
-                return CalcTreesBlocked<true, false>;
+                return GetCalcTreesBlockedFunction<true, false>(useAvx2);
             }
         }
     } else {
@@ -516,9 +678,9 @@ TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountI
             }
         } else {
             if (hasOneHots) {
-                return CalcTreesBlocked<false, true>;
+                return GetCalcTreesBlockedFunction<false, true>(useAvx2);
             } else {
-                return CalcTreesBlocked<false, false>;
+                return GetCalcTreesBlockedFunction<false, false>(useAvx2);
             }
         }
     }
@@ -2,26 +2,33 @@
 
 #include "model.h"
 #include <catboost/libs/helpers/exception.h>
+#include <library/threading/local_executor/local_executor.h>
 #include <util/generic/ymath.h>
+#include <util/system/cpu_id.h>
+#include <util/thread/singleton.h>
 #include <emmintrin.h>
 
 constexpr size_t FORMULA_EVALUATION_BLOCK_SIZE = 128;
 
 inline void OneHotBinsFromTransposedCatFeatures(
     const TVector<TOneHotFeature>& OneHotFeatures,
-    const THashMap<int, int> catFeaturePackedIndex,
+    const THashMap<int, int>& catFeaturePackedIndex,
     const size_t docCount,
     ui8*& result,
     TVector<int>& transposedHash) {
     for (const auto& oheFeature : OneHotFeatures) {
         const auto catIdx = catFeaturePackedIndex.at(oheFeature.CatFeatureIndex);
-        for (size_t docId = 0; docId < docCount; ++docId) {
-            const auto val = transposedHash[catIdx * docCount + docId];
-            for (size_t borderIdx = 0; borderIdx < oheFeature.Values.size(); ++borderIdx) {
-                result[docId] |= (ui8)(val == oheFeature.Values[borderIdx]) * (borderIdx + 1);
+        const size_t valueCount = oheFeature.Values.size();
+        for (size_t bucketStart = 0; bucketStart == 0 || bucketStart < valueCount; bucketStart += MAX_VALUES_PER_BIN) {
+            const size_t bucketEnd = Min(valueCount, bucketStart + MAX_VALUES_PER_BIN);
+            for (size_t docId = 0; docId < docCount; ++docId) {
+                const auto val = transposedHash[catIdx * docCount + docId];
+                for (size_t borderIdx = bucketStart; borderIdx < bucketEnd; ++borderIdx) {
+                    result[docId] |= (ui8)(val == oheFeature.Values[borderIdx]) * (borderIdx - bucketStart + 1);
+                }
             }
+            result += docCount;
         }
-        result += docCount;
     }
 }
 
@@ -76,7 +83,7 @@ Y_FORCE_INLINE void BinarizeFloats(
 
 #else
 template<bool UseNanSubstitution, typename TFloatFeatureAccessor>
-Y_FORCE_INLINE void BinarizeFloats(
+Y_FORCE_INLINE void BinarizeFloatsSse(
     const size_t docCount,
     TFloatFeatureAccessor floatAccessor,
     const TConstArrayRef<float> borders,
@@ -156,8 +163,80 @@ Y_FORCE_INLINE void BinarizeFloats(
     result += docCount;
 }
 
+/**
+ * AVX2 binarization kernel for contiguous float values, defined in formula_evaluator_avx2.cpp
+ */
+void BinarizeFloatsAvx2(
+    const float* __restrict values,
+    size_t docCount,
+    const float* __restrict borders,
+    size_t borderCount,
+    ui8* __restrict result) noexcept;
+
+template<bool UseNanSubstitution, typename TFloatFeatureAccessor>
+Y_FORCE_INLINE void BinarizeFloats(
+    const size_t docCount,
+    TFloatFeatureAccessor floatAccessor,
+    const TConstArrayRef<float> borders,
+    size_t start,
+    ui8*& result,
+    const float nanSubstitutionValue = 0.0f
+) {
+    size_t avx2DocCount = 0;
+    if (docCount >= 32 && NX86::CachedHaveAVX2()) {
+        avx2DocCount = (docCount | 0x1f) ^ 0x1f;
+        float values[FORMULA_EVALUATION_BLOCK_SIZE];
+        for (size_t blockStart = 0; blockStart < avx2DocCount; blockStart += FORMULA_EVALUATION_BLOCK_SIZE) {
+            const size_t docCountInBlock = Min(FORMULA_EVALUATION_BLOCK_SIZE, avx2DocCount - blockStart);
+            for (size_t docId = 0; docId < docCountInBlock; ++docId) {
+                values[docId] = floatAccessor(start + blockStart + docId);
+                if (UseNanSubstitution && IsNan(values[docId])) {
+                    values[docId] = nanSubstitutionValue;
+                }
+            }
+            BinarizeFloatsAvx2(values, docCountInBlock, borders.data(), borders.size(), result + blockStart);
+        }
+    }
+    ui8* tailResult = result + avx2DocCount;
+    BinarizeFloatsSse<UseNanSubstitution>(
+        docCount - avx2DocCount,
+        floatAccessor,
+        borders,
+        start + avx2DocCount,
+        tailResult,
+        nanSubstitutionValue);
+    result += docCount;
+}
+
 #endif
 
+/**
+ * Binarize feature into GetBinFeatureBucketCount(borders.size()) consecutive ui8 buckets
+ */
+template<bool UseNanSubstitution, typename TFloatFeatureAccessor>
+Y_FORCE_INLINE void BinarizeFloatsToBuckets(
+    const size_t docCount,
+    TFloatFeatureAccessor floatAccessor,
+    const TConstArrayRef<float> borders,
+    size_t start,
+    ui8*& result,
+    const float nanSubstitutionValue = 0.0f
+) {
+    if (borders.size() <= MAX_VALUES_PER_BIN) {
+        BinarizeFloats<UseNanSubstitution>(docCount, floatAccessor, borders, start, result, nanSubstitutionValue);
+        return;
+    }
+    for (size_t bucketStart = 0; bucketStart < borders.size(); bucketStart += MAX_VALUES_PER_BIN) {
+        BinarizeFloats<UseNanSubstitution>(
+            docCount,
+            floatAccessor,
+            TConstArrayRef<float>(borders.data() + bucketStart, Min<size_t>(MAX_VALUES_PER_BIN, borders.size() - bucketStart)),
+            start,
+            result,
+            nanSubstitutionValue);
+    }
+}
+
 /**
 * This function binarizes
 */
@@ -177,7 +256,7 @@ inline void BinarizeFeatures(
     std::fill(result.begin(), result.end(), 0);
     for (const auto& floatFeature : model.ObliviousTrees.FloatFeatures) {
         if (!floatFeature.HasNans || floatFeature.NanValueTreatment == NCatBoostFbs::ENanValueTreatment_AsIs) {
-            BinarizeFloats<false>(
+            BinarizeFloatsToBuckets<false>(
                 docCount,
                 [&floatFeature, floatAccessor](size_t index) { return floatAccessor(floatFeature, index); },
                 floatFeature.Borders,
@@ -186,7 +265,7 @@ inline void BinarizeFeatures(
         } else {
             const float infinity = std::numeric_limits<float>::infinity();
             if (floatFeature.NanValueTreatment == NCatBoostFbs::ENanValueTreatment_AsFalse) {
-                BinarizeFloats<true>(
+                BinarizeFloatsToBuckets<true>(
                     docCount,
                     [&floatFeature, floatAccessor](size_t index) { return floatAccessor(floatFeature, index); },
                     floatFeature.Borders,
@@ -195,7 +274,7 @@ inline void BinarizeFeatures(
                     -infinity);
             } else {
                 Y_ASSERT(floatFeature.NanValueTreatment == NCatBoostFbs::ENanValueTreatment_AsTrue);
-                BinarizeFloats<true>(
+                BinarizeFloatsToBuckets<true>(
                     docCount,
                     [&floatFeature, floatAccessor](size_t index) { return floatAccessor(floatFeature, index); },
                     floatFeature.Borders,
@@ -214,14 +293,16 @@ inline void BinarizeFeatures(
                 idx += docCount;
             }
         }
-        THashMap<int, int> catFeaturePackedIndexes;
-        for (int i = 0; i < model.ObliviousTrees.CatFeatures.ysize(); ++i) {
-            catFeaturePackedIndexes[model.ObliviousTrees.CatFeatures[i].FeatureIndex] = i;
-        }
-        OneHotBinsFromTransposedCatFeatures(model.ObliviousTrees.OneHotFeatures, catFeaturePackedIndexes, docCount, resultPtr, transposedHash);
+        OneHotBinsFromTransposedCatFeatures(
+            model.ObliviousTrees.OneHotFeatures,
+            model.ObliviousTrees.GetCatFeaturePackedIndexes(),
+            docCount,
+            resultPtr,
+            transposedHash);
         if (!model.ObliviousTrees.GetUsedModelCtrs().empty()) {
             model.CtrProvider->CalcCtrs(
                 model.ObliviousTrees.GetUsedModelCtrs(),
+                model.CtrCalcPlan.Get(),
                 result,
                 transposedHash,
                 docCount,
@@ -231,7 +312,7 @@ inline void BinarizeFeatures(
         for (size_t i = 0; i < model.ObliviousTrees.CtrFeatures.size(); ++i) {
             const auto& ctr = model.ObliviousTrees.CtrFeatures[i];
             auto ctrFloatsPtr = &ctrs[i * docCount];
-            BinarizeFloats<false>(
+            BinarizeFloatsToBuckets<false>(
                 docCount,
                 [ctrFloatsPtr](size_t index) { return ctrFloatsPtr[index]; },
                 ctr.Borders,
@@ -260,7 +341,55 @@ void CalcIndexes(
     const TRepackedBin* __restrict treeSplitsCurPtr,
     int curTreeSize);
 
-TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountInBlock);
+/**
+ * AVX2 leaf index kernels, defined in formula_evaluator_avx2.cpp
+ * ui8 version overwrites indexesVec and supports trees with depth <= 8, ui32 version ORs bits into indexesVec
+ */
+void CalcIndexesAvx2(
+    bool needXorMask,
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui8* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) noexcept;
+
+void CalcIndexesAvx2(
+    bool needXorMask,
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui32* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) noexcept;
+
+using TCalcIndexesUi8Function = void (*)(
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui8* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize);
+
+/**
+ * Select blocked ui8 leaf index kernel for block size, the same one CalcTreesBlocked uses for trees with depth <= 8.
+ * indexesVec should be zeroed before the call.
+ */
+TCalcIndexesUi8Function GetCalcIndexesUi8Function(bool needXorMask, size_t docCountInBlock, bool allowAvx2 = true);
+
+/**
+ * Select trees evaluation function for model and block size
+ * @param model
+ * @param docCountInBlock
+ * @param allowAvx2 use AVX2 kernels if host cpu supports them, switch off only to compare with SSE code path
+ */
+TTreeCalcFunction GetCalcTreesFunction(const TFullModel& model, size_t docCountInBlock, bool allowAvx2 = true);
+
+/**
+ * Scratch buffers reused between model evaluation calls on the same thread,
+ * so single object evaluation doesn't allocate memory after warm up
+ */
+struct TFormulaEvaluatorBuffers {
+    TVector<int> TransposedHash;
+    TVector<float> Ctrs;
+};
 
 template<class X>
 inline X* GetAligned(X* val) {
@@ -294,8 +423,9 @@ inline void CalcGeneric(
     if (docCount == 1) {
         CB_ENSURE((int)results.size() == model.ObliviousTrees.ApproxDimension);
         std::fill(results.begin(), results.end(), 0.0);
-        TVector<int> transposedHash(model.ObliviousTrees.CatFeatures.size());
-        TVector<float> ctrs(model.ObliviousTrees.GetUsedModelCtrs().size());
+        auto& buffers = *FastTlsSingleton<TFormulaEvaluatorBuffers>();
+        buffers.TransposedHash.yresize(model.ObliviousTrees.CatFeatures.size());
+        buffers.Ctrs.yresize(model.ObliviousTrees.GetUsedModelCtrs().size());
         BinarizeFeatures(
             model,
             floatFeatureAccessor,
@@ -303,8 +433,8 @@ inline void CalcGeneric(
             0,
             1,
             binFeatures,
-            transposedHash,
-            ctrs
+            buffers.TransposedHash,
+            buffers.Ctrs
         );
         calcTrees(
                 model,
@@ -394,6 +524,75 @@ private:
     ui64 BlockSize;
 };
 
+constexpr size_t MIN_TREES_PER_APPLY_THREAD = 64;
+
+/**
+ * Multithreaded version of CalcGeneric.
+ * Large batches are split between threads by document blocks. If there are not enough document blocks to load all threads,
+ * features are binarized once and trees are split into ranges evaluated in parallel, then per range results are summed up.
+ */
+template<typename TFloatFeatureAccessor, typename TCatFeatureAccessor>
+inline void CalcGenericParallel(
+    const TFullModel& model,
+    TFloatFeatureAccessor floatFeatureAccessor,
+    TCatFeatureAccessor catFeaturesAccessor,
+    size_t docCount,
+    size_t treeStart,
+    size_t treeEnd,
+    TArrayRef<double> results,
+    NPar::TLocalExecutor& executor)
+{
+    const size_t threadCount = executor.GetThreadCount() + 1; //one for current thread
+    const size_t approxDimension = model.ObliviousTrees.ApproxDimension;
+    CB_ENSURE(results.size() == docCount * approxDimension);
+    const size_t docBlockCount = (docCount + FORMULA_EVALUATION_BLOCK_SIZE - 1) / FORMULA_EVALUATION_BLOCK_SIZE;
+    const size_t treeBlockCount = Min(threadCount, Max<size_t>(1, (treeEnd - treeStart) / MIN_TREES_PER_APPLY_THREAD));
+    if (threadCount == 1 || docCount == 0) {
+        CalcGeneric(model, floatFeatureAccessor, catFeaturesAccessor, docCount, treeStart, treeEnd, results);
+        return;
+    }
+    if (docBlockCount < threadCount && treeBlockCount > 1) {
+        // tree parallel evaluation for small batches
+        TFeatureCachedTreeEvaluator evaluator(model, floatFeatureAccessor, catFeaturesAccessor, docCount);
+        NPar::TLocalExecutor::TExecRangeParams blockParams(treeStart, treeEnd);
+        blockParams.SetBlockCount(treeBlockCount);
+        TVector<TVector<double>> blockResults(blockParams.GetBlockCount(), TVector<double>(results.size()));
+        executor.ExecRange([&](int blockId) {
+            const int blockFirstId = blockParams.FirstId + blockId * blockParams.GetBlockSize();
+            const int blockLastId = Min(blockParams.LastId, blockFirstId + blockParams.GetBlockSize());
+            evaluator.Calc(blockFirstId, blockLastId, blockResults[blockId]);
+        }, 0, blockParams.GetBlockCount(), NPar::TLocalExecutor::WAIT_COMPLETE);
+        std::fill(results.begin(), results.end(), 0.0);
+        for (const auto& blockResult : blockResults) {
+            for (size_t i = 0; i < results.size(); ++i) {
+                results[i] += blockResult[i];
+            }
+        }
+        return;
+    }
+    // document parallel evaluation, block boundaries are aligned to evaluation block size
+    NPar::TLocalExecutor::TExecRangeParams blockParams(0, docBlockCount);
+    blockParams.SetBlockCount(Min(threadCount, docBlockCount));
+    executor.ExecRange([&](int blockId) {
+        const size_t blockFirstId = (blockParams.FirstId + blockId * blockParams.GetBlockSize()) * FORMULA_EVALUATION_BLOCK_SIZE;
+        const size_t blockLastId = Min(
+            docCount,
+            (size_t)Min(blockParams.LastId, blockParams.FirstId + (blockId + 1) * blockParams.GetBlockSize()) * FORMULA_EVALUATION_BLOCK_SIZE);
+        CalcGeneric(
+            model,
+            [&floatFeatureAccessor, blockFirstId](const TFloatFeature& floatFeature, size_t index) {
+                return floatFeatureAccessor(floatFeature, blockFirstId + index);
+            },
+            [&catFeaturesAccessor, blockFirstId](const TCatFeature& catFeature, size_t index) {
+                return catFeaturesAccessor(catFeature, blockFirstId + index);
+            },
+            blockLastId - blockFirstId,
+            treeStart,
+            treeEnd,
+            MakeArrayRef(results.data() + blockFirstId * approxDimension, (blockLastId - blockFirstId) * approxDimension));
+    }, 0, blockParams.GetBlockCount(), NPar::TLocalExecutor::WAIT_COMPLETE);
+}
+
 template<typename TFloatFeatureAccessor, typename TCatFeatureAccessor>
 inline TVector<TVector<double>> CalcTreeIntervalsGeneric(
     const TFullModel& model,
@@ -0,0 +1,153 @@
+#include "repacked_bin.h"
+
+#include <util/system/types.h>
+
+#include <immintrin.h>
+
+/*
+ * This file is compiled with AVX2 code generation enabled, so only plain types should be used here:
+ * any inline function from common headers could be emitted with AVX2 instructions and picked by linker for
+ * the whole binary. Dispatching between implementations is done in formula_evaluator.h/.cpp.
+ */
+
+constexpr size_t AVX2_BLOCK_SIZE = 32;
+
+void BinarizeFloatsAvx2(
+    const float* __restrict values,
+    size_t docCount,
+    const float* __restrict borders,
+    size_t borderCount,
+    ui8* __restrict result) noexcept {
+    // packs instructions work inside 128-bit lanes, so we restore documents order with one permute at the end
+    const __m256i permuteIdx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const auto docCount32 = (docCount | 0x1f) ^ 0x1f;
+    for (size_t docId = 0; docId < docCount32; docId += AVX2_BLOCK_SIZE) {
+        const __m256 floats0 = _mm256_loadu_ps(values + docId + 0);
+        const __m256 floats1 = _mm256_loadu_ps(values + docId + 8);
+        const __m256 floats2 = _mm256_loadu_ps(values + docId + 16);
+        const __m256 floats3 = _mm256_loadu_ps(values + docId + 24);
+        __m256i resultVec = _mm256_setzero_si256();
+        for (size_t borderId = 0; borderId < borderCount; ++borderId) {
+            const __m256 borderVec = _mm256_set1_ps(borders[borderId]);
+            const __m256i r0 = _mm256_castps_si256(_mm256_cmp_ps(floats0, borderVec, _CMP_GT_OQ));
+            const __m256i r1 = _mm256_castps_si256(_mm256_cmp_ps(floats1, borderVec, _CMP_GT_OQ));
+            const __m256i r2 = _mm256_castps_si256(_mm256_cmp_ps(floats2, borderVec, _CMP_GT_OQ));
+            const __m256i r3 = _mm256_castps_si256(_mm256_cmp_ps(floats3, borderVec, _CMP_GT_OQ));
+            const __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(r0, r1), _mm256_packs_epi32(r2, r3));
+            // packed contains -1 for each passed border
+            resultVec = _mm256_sub_epi8(resultVec, packed);
+        }
+        resultVec = _mm256_permutevar8x32_epi32(resultVec, permuteIdx);
+        _mm256_storeu_si256((__m256i*)(result + docId), resultVec);
+    }
+    for (size_t docId = docCount32; docId < docCount; ++docId) {
+        const float val = values[docId];
+        for (size_t borderId = 0; borderId < borderCount; ++borderId) {
+            result[docId] += (ui8)(val > borders[borderId]);
+        }
+    }
+}
+
+#define _mm256_cmpge_epu8(a, b) _mm256_cmpeq_epi8(_mm256_max_epu8((a), (b)), (a))
+
+template<bool NeedXorMask>
+static inline void CalcIndexesAvx2Impl(
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui8* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) {
+    const auto docCount32 = (docCountInBlock | 0x1f) ^ 0x1f;
+    for (size_t docId = 0; docId < docCount32; docId += AVX2_BLOCK_SIZE) {
+        __m256i resultVec = _mm256_setzero_si256();
+        __m256i mask = _mm256_set1_epi8(0x01);
+        for (int depth = 0; depth < curTreeSize; ++depth) {
+            const ui8* __restrict binFeaturePtr = binFeatures + treeSplitsCurPtr[depth].FeatureIndex * docCountInBlock + docId;
+            const __m256i borderValVec = _mm256_set1_epi8(treeSplitsCurPtr[depth].SplitIdx);
+            __m256i val = _mm256_loadu_si256((const __m256i*)binFeaturePtr);
+            if (NeedXorMask) {
+                val = _mm256_xor_si256(val, _mm256_set1_epi8(treeSplitsCurPtr[depth].XorMask));
+            }
+            resultVec = _mm256_or_si256(resultVec, _mm256_and_si256(_mm256_cmpge_epu8(val, borderValVec), mask));
+            mask = _mm256_slli_epi16(mask, 1);
+        }
+        _mm256_storeu_si256((__m256i*)(indexesVec + docId), resultVec);
+    }
+    for (size_t docId = docCount32; docId < docCountInBlock; ++docId) {
+        ui8 index = 0;
+        for (int depth = 0; depth < curTreeSize; ++depth) {
+            const ui8 binFeature = binFeatures[treeSplitsCurPtr[depth].FeatureIndex * docCountInBlock + docId];
+            if (NeedXorMask) {
+                index |= ((binFeature ^ treeSplitsCurPtr[depth].XorMask) >= treeSplitsCurPtr[depth].SplitIdx) << depth;
+            } else {
+                index |= (binFeature >= treeSplitsCurPtr[depth].SplitIdx) << depth;
+            }
+        }
+        indexesVec[docId] = index;
+    }
+}
+
+#undef _mm256_cmpge_epu8
+
+template<bool NeedXorMask>
+static inline void CalcIndexesAvx2Impl(
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui32* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) {
+    const auto docCount8 = (docCountInBlock | 0x7) ^ 0x7;
+    for (size_t docId = 0; docId < docCount8; docId += 8) {
+        __m256i resultVec = _mm256_loadu_si256((const __m256i*)(indexesVec + docId));
+        for (int depth = 0; depth < curTreeSize; ++depth) {
+            const ui8* __restrict binFeaturePtr = binFeatures + treeSplitsCurPtr[depth].FeatureIndex * docCountInBlock + docId;
+            // bins are zero extended to 32 bits, so signed comparison with (splitIdx - 1) is enough
+            const __m256i borderValVec = _mm256_set1_epi32((int)treeSplitsCurPtr[depth].SplitIdx - 1);
+            __m256i val = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)binFeaturePtr));
+            if (NeedXorMask) {
+                val = _mm256_xor_si256(val, _mm256_set1_epi32(treeSplitsCurPtr[depth].XorMask));
+            }
+            const __m256i bit = _mm256_set1_epi32(1 << depth);
+            resultVec = _mm256_or_si256(resultVec, _mm256_and_si256(_mm256_cmpgt_epi32(val, borderValVec), bit));
+        }
+        _mm256_storeu_si256((__m256i*)(indexesVec + docId), resultVec);
+    }
+    for (size_t docId = docCount8; docId < docCountInBlock; ++docId) {
+        for (int depth = 0; depth < curTreeSize; ++depth) {
+            const ui8 binFeature = binFeatures[treeSplitsCurPtr[depth].FeatureIndex * docCountInBlock + docId];
+            if (NeedXorMask) {
+                indexesVec[docId] |= ((binFeature ^ treeSplitsCurPtr[depth].XorMask) >= treeSplitsCurPtr[depth].SplitIdx) << depth;
+            } else {
+                indexesVec[docId] |= (binFeature >= treeSplitsCurPtr[depth].SplitIdx) << depth;
+            }
+        }
+    }
+}
+
+void CalcIndexesAvx2(
+    bool needXorMask,
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui8* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) noexcept {
+    if (needXorMask) {
+        CalcIndexesAvx2Impl<true>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    } else {
+        CalcIndexesAvx2Impl<false>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    }
+}
+
+void CalcIndexesAvx2(
+    bool needXorMask,
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    ui32* __restrict indexesVec,
+    const TRepackedBin* __restrict treeSplitsCurPtr,
+    int curTreeSize) noexcept {
+    if (needXorMask) {
+        CalcIndexesAvx2Impl<true>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    } else {
+        CalcIndexesAvx2Impl<false>(binFeatures, docCountInBlock, indexesVec, treeSplitsCurPtr, curTreeSize);
+    }
+}
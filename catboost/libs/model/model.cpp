@@ -17,6 +17,7 @@
 
 #include <util/string/builder.h>
 #include <util/stream/buffer.h>
+#include <util/stream/mem.h>
 #include <util/stream/str.h>
 #include <util/stream/file.h>
 
@@ -59,13 +60,17 @@ static NJson::TJsonValue RemoveInvalidParams(const NJson::TJsonValue& params) {
     return result;
 }
 
+static void RemoveInvalidModelParams(TFullModel* model) {
+    NJson::TJsonValue paramsJson = ReadTJsonValue(model->ModelInfo.at("params"));
+    paramsJson["flat_params"] = RemoveInvalidParams(paramsJson["flat_params"]);
+    model->ModelInfo["params"] = ToString<NJson::TJsonValue>(paramsJson);
+}
+
 TFullModel ReadModel(IInputStream* modelStream, EModelType format) {
     TFullModel model;
     if (format == EModelType::CatboostBinary) {
         Load(modelStream, model);
-        NJson::TJsonValue paramsJson = ReadTJsonValue(model.ModelInfo.at("params"));
-        paramsJson["flat_params"] = RemoveInvalidParams(paramsJson["flat_params"]);
-        model.ModelInfo["params"] = ToString<NJson::TJsonValue>(paramsJson);
+        RemoveInvalidModelParams(&model);
     } else {
         CoreML::Specification::Model coreMLModel;
         CB_ENSURE(coreMLModel.ParseFromString(modelStream->ReadAll()), "coreml model deserialization failed");
@@ -85,6 +90,21 @@ TFullModel ReadModel(const void* binaryBuffer, size_t binaryBufferSize, EModelTy
     return ReadModel(&bs, format);
 }
 
+static TFullModel ReadModelNonOwning(const TBlob& modelBlob) {
+    TFullModel model;
+    model.LoadNonOwning(modelBlob);
+    RemoveInvalidModelParams(&model);
+    return model;
+}
+
+TFullModel ReadModelNonOwning(const void* binaryBuffer, size_t binaryBufferSize) {
+    return ReadModelNonOwning(TBlob::NoCopy(binaryBuffer, binaryBufferSize));
+}
+
+TFullModel ReadModelMapped(const TString& modelFile) {
+    return ReadModelNonOwning(TBlob::FromFile(modelFile));
+}
+
 void OutputModelCoreML(const TFullModel& model, const TString& modelFile, const NJson::TJsonValue& userParameters) {
     CoreML::Specification::Model outModel;
     outModel.set_specificationversion(1);
@@ -231,7 +251,19 @@ void TObliviousTrees::UpdateMetadata() const {
         ref.TreeFirstLeafOffsets[i] = currentOffset;
         currentOffset += (1 << TreeSizes[i]) * ApproxDimension;
     }
+    ref.TreeDepthRunEnds.resize(TreeSizes.size());
+    for (size_t i = TreeSizes.size(); i > 0; --i) {
+        const size_t treeId = i - 1;
+        if (i == TreeSizes.size() || TreeSizes[i] != TreeSizes[treeId]) {
+            ref.TreeDepthRunEnds[treeId] = i;
+        } else {
+            ref.TreeDepthRunEnds[treeId] = ref.TreeDepthRunEnds[i];
+        }
+    }
 
+    for (int i = 0; i < CatFeatures.ysize(); ++i) {
+        ref.CatFeaturePackedIndexes[CatFeatures[i].FeatureIndex] = i;
+    }
     for (const auto& ctrFeature : CtrFeatures) {
         ref.UsedModelCtrs.push_back(ctrFeature.Ctr);
     }
@@ -242,10 +274,10 @@ void TObliviousTrees::UpdateMetadata() const {
             TFloatSplit fs{feature.FeatureIndex, feature.Borders[borderId]};
             ref.BinFeatures.emplace_back(fs);
             auto& bf = splitIds.emplace_back();
-            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount;
-            bf.SplitIdx = borderId + 1;
+            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount + borderId / MAX_VALUES_PER_BIN;
+            bf.SplitIdx = borderId % MAX_VALUES_PER_BIN + 1;
         }
-        ++ref.EffectiveBinFeaturesBucketCount;
+        ref.EffectiveBinFeaturesBucketCount += GetBinFeatureBucketCount(feature.Borders.ysize());
     }
     for (size_t i = 0; i < OneHotFeatures.size(); ++i) {
         const auto& feature = OneHotFeatures[i];
@@ -253,10 +285,10 @@ void TObliviousTrees::UpdateMetadata() const {
             TOneHotSplit oh{feature.CatFeatureIndex, feature.Values[valueId]};
             ref.BinFeatures.emplace_back(oh);
             auto& bf = splitIds.emplace_back();
-            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount;
-            bf.SplitIdx = valueId + 1;
+            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount + valueId / MAX_VALUES_PER_BIN;
+            bf.SplitIdx = valueId % MAX_VALUES_PER_BIN + 1;
         }
-        ++ref.EffectiveBinFeaturesBucketCount;
+        ref.EffectiveBinFeaturesBucketCount += GetBinFeatureBucketCount(feature.Values.ysize());
     }
     for (size_t i = 0; i < CtrFeatures.size(); ++i) {
         const auto& feature = CtrFeatures[i];
@@ -266,16 +298,16 @@ void TObliviousTrees::UpdateMetadata() const {
             ctrSplit.Border = feature.Borders[borderId];
             ref.BinFeatures.emplace_back(std::move(ctrSplit));
             auto& bf = splitIds.emplace_back();
-            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount;
-            bf.SplitIdx = borderId + 1;
+            bf.FeatureIdx = ref.EffectiveBinFeaturesBucketCount + borderId / MAX_VALUES_PER_BIN;
+            bf.SplitIdx = borderId % MAX_VALUES_PER_BIN + 1;
         }
-        ++ref.EffectiveBinFeaturesBucketCount;
+        ref.EffectiveBinFeaturesBucketCount += GetBinFeatureBucketCount(feature.Borders.ysize());
     }
     for (const auto& binSplit : TreeSplits) {
         const auto& feature = ref.BinFeatures[binSplit];
         const auto& featureIndex = splitIds[binSplit];
         Y_ENSURE(featureIndex.FeatureIdx <= 0xffff, "To many features in model, ask catboost team for support");
-        Y_ENSURE(featureIndex.SplitIdx <= 254, "To many splits in feature, ask catboost team for support");
+        Y_ASSERT(featureIndex.SplitIdx <= MAX_VALUES_PER_BIN);
         TRepackedBin rb;
         rb.FeatureIndex = featureIndex.FeatureIdx;
         if (feature.Type != ESplitType::OneHotFeature) {
@@ -313,6 +345,33 @@ void TFullModel::CalcFlat(const TVector<TConstArrayRef<float>>& features,
     );
 }
 
+void TFullModel::CalcFlat(const TVector<TConstArrayRef<float>>& features,
+                          size_t treeStart,
+                          size_t treeEnd,
+                          TArrayRef<double> results,
+                          NPar::TLocalExecutor& executor) const {
+    const auto expectedFlatVecSize = ObliviousTrees.GetFlatFeatureVectorExpectedSize();
+    for (const auto& flatFeaturesVec : features) {
+        CB_ENSURE(flatFeaturesVec.size() >= expectedFlatVecSize,
+                  "insufficient flat features vector size: " << flatFeaturesVec.size()
+                                                             << " expected: " << expectedFlatVecSize);
+    }
+    CalcGenericParallel(
+        *this,
+        [&features](const TFloatFeature& floatFeature, size_t index) -> float {
+            return features[index][floatFeature.FlatFeatureIndex];
+        },
+        [&features](const TCatFeature& catFeature, size_t index) -> int {
+            return ConvertFloatCatFeatureToIntHash(features[index][catFeature.FlatFeatureIndex]);
+        },
+        features.size(),
+        treeStart,
+        treeEnd,
+        results,
+        executor
+    );
+}
+
 void TFullModel::CalcFlatSingle(const TConstArrayRef<float>& features, size_t treeStart, size_t treeEnd, TArrayRef<double> results) const {
     CalcGeneric(
         *this,
@@ -382,6 +441,41 @@ void TFullModel::Calc(const TVector<TConstArrayRef<float>>& floatFeatures,
     );
 }
 
+void TFullModel::Calc(const TVector<TConstArrayRef<float>>& floatFeatures,
+                      const TVector<TConstArrayRef<int>>& catFeatures,
+                      size_t treeStart,
+                      size_t treeEnd,
+                      TArrayRef<double> results,
+                      NPar::TLocalExecutor& executor) const {
+    if (!floatFeatures.empty() && !catFeatures.empty()) {
+        CB_ENSURE(catFeatures.size() == floatFeatures.size());
+    }
+    for (const auto& floatFeaturesVec : floatFeatures) {
+        CB_ENSURE(floatFeaturesVec.size() >= ObliviousTrees.GetNumFloatFeatures(),
+                  "insufficient float features vector size: " << floatFeaturesVec.size()
+                                                              << " expected: " << ObliviousTrees.GetNumFloatFeatures());
+    }
+    for (const auto& catFeaturesVec : catFeatures) {
+        CB_ENSURE(catFeaturesVec.size() >= ObliviousTrees.GetNumCatFeatures(),
+                  "insufficient cat features vector size: " << catFeaturesVec.size()
+                                                            << " expected: " << ObliviousTrees.GetNumCatFeatures());
+    }
+    CalcGenericParallel(
+        *this,
+        [&floatFeatures](const TFloatFeature& floatFeature, size_t index) -> float {
+            return floatFeatures[index][floatFeature.FeatureIndex];
+        },
+        [&catFeatures](const TCatFeature& catFeature, size_t index) -> int {
+            return catFeatures[index][catFeature.FeatureIndex];
+        },
+        floatFeatures.size(),
+        treeStart,
+        treeEnd,
+        results,
+        executor
+    );
+}
+
 void TFullModel::Calc(const TVector<TConstArrayRef<float>>& floatFeatures,
                              const TVector<TVector<TStringBuf>>& catFeatures, size_t treeStart, size_t treeEnd,
                              TArrayRef<double> results) const {
@@ -502,32 +596,29 @@ void TFullModel::Save(IOutputStream* s) const {
     }
 }
 
-void TFullModel::Load(IInputStream* s) {
+/**
+ * Deserialize flatbuffers model core into model trees and info
+ * @return model part identifiers stored after core
+ */
+static TVector<TString> DeserializeModelCore(const ui8* coreBuffer, size_t coreSize, TFullModel* model) {
     using namespace flatbuffers;
     using namespace NCatBoostFbs;
-    ui32 fileDescriptor;
-    ::Load(s, fileDescriptor);
-    CB_ENSURE(fileDescriptor == GetModelFormatDescriptor(), "Incorrect model file descriptor");
-    auto coreSize = ::LoadSize(s);
-    TArrayHolder<ui8> arrayHolder = new ui8[coreSize];
-    s->LoadOrFail(arrayHolder.Get(), coreSize);
-
     {
-        flatbuffers::Verifier verifier(arrayHolder.Get(), coreSize);
+        flatbuffers::Verifier verifier(coreBuffer, coreSize);
         CB_ENSURE(VerifyTModelCoreBuffer(verifier), "Flatbuffers model verification failed");
     }
-    auto fbModelCore = GetTModelCore(arrayHolder.Get());
+    auto fbModelCore = GetTModelCore(coreBuffer);
     CB_ENSURE(
         fbModelCore->FormatVersion() && fbModelCore->FormatVersion()->str() == CURRENT_CORE_FORMAT_STRING,
         "Unsupported model format: " << fbModelCore->FormatVersion()->str()
     );
     if (fbModelCore->ObliviousTrees()) {
-        ObliviousTrees.FBDeserialize(fbModelCore->ObliviousTrees());
+        model->ObliviousTrees.FBDeserialize(fbModelCore->ObliviousTrees());
     }
-    ModelInfo.clear();
+    model->ModelInfo.clear();
     if (fbModelCore->InfoMap()) {
         for (auto keyVal : *fbModelCore->InfoMap()) {
-            ModelInfo[keyVal->Key()->str()] = keyVal->Value()->str();
+            model->ModelInfo[keyVal->Key()->str()] = keyVal->Value()->str();
         }
     }
     TVector<TString> modelParts;
@@ -538,6 +629,20 @@ void TFullModel::Load(IInputStream* s) {
     }
     if (!modelParts.empty()) {
         CB_ENSURE(modelParts.size() == 1, "only single part model supported now");
+    }
+    return modelParts;
+}
+
+void TFullModel::Load(IInputStream* s) {
+    ui32 fileDescriptor;
+    ::Load(s, fileDescriptor);
+    CB_ENSURE(fileDescriptor == GetModelFormatDescriptor(), "Incorrect model file descriptor");
+    auto coreSize = ::LoadSize(s);
+    TArrayHolder<ui8> arrayHolder = new ui8[coreSize];
+    s->LoadOrFail(arrayHolder.Get(), coreSize);
+
+    const auto modelParts = DeserializeModelCore(arrayHolder.Get(), coreSize, this);
+    if (!modelParts.empty()) {
         CtrProvider = new TStaticCtrProvider;
         CB_ENSURE(modelParts[0] == CtrProvider->ModelPartIdentifier(), "only static ctr models supported");
         CtrProvider->Load(s);
@@ -545,6 +650,26 @@ void TFullModel::Load(IInputStream* s) {
     UpdateDynamicData();
 }
 
+void TFullModel::LoadNonOwning(const TBlob& modelBlob) {
+    TMemoryInput in(modelBlob.Data(), modelBlob.Size());
+    ui32 fileDescriptor;
+    ::Load(&in, fileDescriptor);
+    CB_ENSURE(fileDescriptor == GetModelFormatDescriptor(), "Incorrect model file descriptor");
+    auto coreSize = ::LoadSize(&in);
+    CB_ENSURE(in.Avail() >= coreSize, "Unexpected end of model data");
+    const ui8* coreBuffer = reinterpret_cast<const ui8*>(in.Buf());
+    in.Skip(coreSize);
+
+    const auto modelParts = DeserializeModelCore(coreBuffer, coreSize, this);
+    if (!modelParts.empty()) {
+        TIntrusivePtr<TStaticCtrProvider> staticCtrProvider = new TStaticCtrProvider;
+        CB_ENSURE(modelParts[0] == staticCtrProvider->ModelPartIdentifier(), "only static ctr models supported");
+        staticCtrProvider->LoadNonOwning(&in, modelBlob);
+        CtrProvider = staticCtrProvider;
+    }
+    UpdateDynamicData();
+}
+
 TVector<TString> GetModelUsedFeaturesNames(const TFullModel& model) {
     TVector<int> featuresIdxs;
     TVector<TString> featuresNames;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "features.h"
+#include "repacked_bin.h"
 #include "split.h"
 
 #include "static_ctr_provider.h"
@@ -12,7 +13,9 @@
 #include <catboost/libs/cat_feature/cat_feature.h>
 
 #include <library/json/json_reader.h>
+#include <library/threading/local_executor/local_executor.h>
 
+#include <util/memory/blob.h>
 #include <util/system/mutex.h>
 #include <util/stream/file.h>
 
@@ -40,11 +43,6 @@ class TModelPartsCachingSerializer;
     - TreeSizes - holds tree depth.
     - TreeStartOffsets - holds offset of first tree split in TreeSplits vector
 */
-struct TRepackedBin {
-    ui16 FeatureIndex = 0;
-    ui8 XorMask = 0;
-    ui8 SplitIdx = 0;
-};
 struct TObliviousTrees {
 
     /**
@@ -66,7 +64,7 @@ struct TObliviousTrees {
         * | featureIndex | xorMask |splitIdx| (e.g. featureIndex << 16 + xorMask << 8 + splitIdx )
         *
         * We use this layout to speed up model apply - we only need to store one byte for each float, ctr or one hot feature.
-        * TODO(kirillovs): Currently we don't support models with more than 255 splits for a feature, but this will be fixed soon.
+        * Features with more than MAX_VALUES_PER_BIN splits occupy several consecutive bytes, see GetBinFeatureBucketCount.
         */
 
 
@@ -78,6 +76,12 @@ struct TObliviousTrees {
 
         //! Offset of first tree leaf in flat tree leafs array
         TVector<size_t> TreeFirstLeafOffsets;
+
+        //! For each tree index of the first following tree with another depth, used to evaluate same depth trees in one pass
+        TVector<size_t> TreeDepthRunEnds;
+
+        //! Categorical feature index -> position in CatFeatures vector
+        THashMap<int, int> CatFeaturePackedIndexes;
     };
 
     //! Number of classes in model, in most cases equals to 1.
@@ -240,6 +244,16 @@ struct TObliviousTrees {
         return MetaData->TreeFirstLeafOffsets;
     }
 
+    const TVector<size_t>& GetTreeDepthRunEnds() const {
+        Y_ENSURE(MetaData.Defined(), "metadata should be initialized");
+        return MetaData->TreeDepthRunEnds;
+    }
+
+    const THashMap<int, int>& GetCatFeaturePackedIndexes() const {
+        Y_ENSURE(MetaData.Defined(), "metadata should be initialized");
+        return MetaData->CatFeaturePackedIndexes;
+    }
+
     const double* GetFirstLeafPtrForTree(size_t treeIdx) const {
         Y_ENSURE(MetaData.Defined(), "metadata should be initialized");
         return &LeafValues[MetaData->TreeFirstLeafOffsets[treeIdx]];
@@ -301,11 +315,17 @@ struct TFullModel {
      */
     THashMap<TString, TString> ModelInfo;
     TIntrusivePtr<ICtrProvider> CtrProvider;
+    /**
+     * Precomputed part of CtrProvider->CalcCtrs for ctrs used by this model, model copies can share
+     * CtrProvider, but each of them has its own plan, see UpdateDynamicData
+     */
+    TIntrusivePtr<ICtrCalcPlan> CtrCalcPlan;
 
     void Swap(TFullModel& other) {
         DoSwap(ObliviousTrees, other.ObliviousTrees);
         DoSwap(ModelInfo, other.ModelInfo);
         DoSwap(CtrProvider, other.CtrProvider);
+        DoSwap(CtrCalcPlan, other.CtrCalcPlan);
     }
 
     /**
@@ -351,6 +371,12 @@ struct TFullModel {
      * @param s IInputStream ptr
      */
     void Load(IInputStream* s);
+    /**
+     * Deserialize model from memory blob without copying CTR tables: they are kept as views into the blob.
+     * Model holds a reference to the blob, so for blobs made with TBlob::NoCopy memory should outlive the model.
+     * @param modelBlob serialized model in CatboostBinary format
+     */
+    void LoadNonOwning(const TBlob& modelBlob);
 
     //! Check if TFullModel instance has valid CTR provider.
     // If no ctr features present it will return true
@@ -390,6 +416,21 @@ struct TFullModel {
     void CalcFlat(const TVector<TConstArrayRef<float>>& features, TArrayRef<double> results) const {
         CalcFlat(features, 0, ObliviousTrees.TreeSizes.size(), results);
     }
+    /**
+     * Multithreaded CalcFlat. Large batches are split between threads by documents,
+     * small batches of large models are split between threads by tree ranges.
+     * @param[in] features vector of flat features array reference. First dimension is object index, second dimension is feature index.
+     * @param[in] treeStart Index of first tree in model to start evaluation
+     * @param[in] treeEnd Index of tree after the last tree in model to evaluate
+     * @param[out] results Flat double vector with indexation [objectIndex * ApproxDimension + classId].
+     * @param[in] executor local executor to run evaluation on, calling thread is used too
+     */
+    void CalcFlat(
+        const TVector<TConstArrayRef<float>>& features,
+        size_t treeStart,
+        size_t treeEnd,
+        TArrayRef<double> results,
+        NPar::TLocalExecutor& executor) const;
     /**
      * Same as CalcFlat method but for one object
      * @param[in] features flat features array reference. First dimension is object index, second dimension is feature index.
@@ -448,6 +489,21 @@ struct TFullModel {
               size_t treeStart,
               size_t treeEnd,
               TArrayRef<double> results) const;
+    /**
+     * Multithreaded version of Calc with hashed cat feature values, see CalcFlat with executor for details
+     * @param[in] floatFeatures
+     * @param[in] catFeatures hashed cat feature values
+     * @param[in] treeStart
+     * @param[in] treeEnd
+     * @param[out] results results indexation is [objectIndex * ApproxDimension + classId]
+     * @param[in] executor local executor to run evaluation on, calling thread is used too
+     */
+    void Calc(const TVector<TConstArrayRef<float>>& floatFeatures,
+              const TVector<TConstArrayRef<int>>& catFeatures,
+              size_t treeStart,
+              size_t treeEnd,
+              TArrayRef<double> results,
+              NPar::TLocalExecutor& executor) const;
     /**
      * Evaluate raw formula predictions on user data. Uses all model trees
      * @param floatFeatures
@@ -505,6 +561,7 @@ struct TFullModel {
     TFullModel CopyTreeRange(size_t begin, size_t end) const {
         TFullModel result = *this;
         result.ObliviousTrees.Truncate(begin, end);
+        result.UpdateCtrCalcPlan();
         return result;
     }
 
@@ -520,12 +577,30 @@ struct TFullModel {
                 ObliviousTrees.OneHotFeatures,
                 ObliviousTrees.CatFeatures);
         }
+        UpdateCtrCalcPlan();
+    }
+
+private:
+    void UpdateCtrCalcPlan() {
+        CtrCalcPlan.Reset();
+        if (CtrProvider && HasValidCtrProvider()) {
+            CtrCalcPlan = CtrProvider->CreateCtrCalcPlan(ObliviousTrees.GetUsedModelCtrs());
+        }
     }
 };
 
 void OutputModel(const TFullModel& model, const TString& modelFile);
 TFullModel ReadModel(const TString& modelFile, EModelType format = EModelType::CatboostBinary);
 TFullModel ReadModel(const void* binaryBuffer, size_t binaryBufferSize, EModelType format = EModelType::CatboostBinary);
+/**
+ * Read CatboostBinary model from memory buffer without copying CTR tables. Buffer should outlive the model.
+ */
+TFullModel ReadModelNonOwning(const void* binaryBuffer, size_t binaryBufferSize);
+/**
+ * Memory map CatboostBinary model file and keep CTR tables as views into the mapping.
+ * Mapping is owned by the model, so startup is fast and pages are shared between processes using the same file.
+ */
+TFullModel ReadModelMapped(const TString& modelFile);
 
 /**
  * Export model in our binary or protobuf CoreML format
@@ -225,6 +225,10 @@ namespace NCatboost {
 
     void TCatboostModelToCppConverter::WriteModelCatFeatures(const TFullModel& model) {
         CB_ENSURE(model.ObliviousTrees.ApproxDimension == 1, "MultiClassification model export to CPP is not supported.");
+        CB_ENSURE(
+            model.ObliviousTrees.GetEffectiveBinaryFeaturesBucketsCount() ==
+                model.ObliviousTrees.FloatFeatures.size() + model.ObliviousTrees.OneHotFeatures.size() + model.ObliviousTrees.CtrFeatures.size(),
+            "Export of models with more than " << MAX_VALUES_PER_BIN << " splits per feature is not supported.");
 
         WriteCTRStructs();
         Out << '\n';
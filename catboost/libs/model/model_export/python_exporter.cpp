@@ -198,6 +198,10 @@ namespace NCatboost {
 
     void TCatboostModelToPythonConverter::WriteModelCatFeatures(const TFullModel& model) {
         CB_ENSURE(model.ObliviousTrees.ApproxDimension == 1, "Export of MultiClassification model to Python is not supported.");
+        CB_ENSURE(
+            model.ObliviousTrees.GetEffectiveBinaryFeaturesBucketsCount() ==
+                model.ObliviousTrees.FloatFeatures.size() + model.ObliviousTrees.OneHotFeatures.size() + model.ObliviousTrees.CtrFeatures.size(),
+            "Export of models with more than " << MAX_VALUES_PER_BIN << " splits per feature is not supported.");
 
         if (!model.ObliviousTrees.GetUsedModelCtrs().empty()) {
             WriteCTRStructs();
@@ -0,0 +1,272 @@
+#include "quantized_leaves.h"
+
+#include <catboost/libs/helpers/exception.h>
+
+#include <util/generic/utility.h>
+#include <util/generic/ymath.h>
+#include <util/thread/singleton.h>
+
+#include <limits>
+
+template<typename TLeaf>
+static void QuantizeLeafValues(const TObliviousTrees& trees, TVector<float>* treeScales, TVector<TLeaf>* quantizedValues) {
+    const auto& firstLeafOffsets = trees.GetFirstLeafOffsets();
+    const double maxQuantizedValue = std::numeric_limits<TLeaf>::max();
+    treeScales->resize(trees.TreeSizes.size());
+    quantizedValues->resize(trees.LeafValues.size());
+    for (size_t treeId = 0; treeId < trees.TreeSizes.size(); ++treeId) {
+        const size_t leafStart = firstLeafOffsets[treeId];
+        const size_t leafEnd = leafStart + (size_t(1) << trees.TreeSizes[treeId]) * trees.ApproxDimension;
+        double maxAbsValue = 0.0;
+        for (size_t leafId = leafStart; leafId < leafEnd; ++leafId) {
+            maxAbsValue = Max(maxAbsValue, Abs(trees.LeafValues[leafId]));
+        }
+        const float scale = maxAbsValue / maxQuantizedValue;
+        (*treeScales)[treeId] = scale;
+        for (size_t leafId = leafStart; leafId < leafEnd; ++leafId) {
+            const double quantized = scale > 0 ? round(trees.LeafValues[leafId] / scale) : 0.0;
+            (*quantizedValues)[leafId] = (TLeaf)ClampVal(quantized, -maxQuantizedValue, maxQuantizedValue);
+        }
+    }
+}
+
+TQuantizedLeafValues TQuantizedLeafValues::Build(const TObliviousTrees& trees, ELeafValuesQuantization quantization) {
+    TQuantizedLeafValues result;
+    result.Quantization = quantization;
+    result.ApproxDimension = trees.ApproxDimension;
+    switch (quantization) {
+        case ELeafValuesQuantization::Int16:
+            QuantizeLeafValues(trees, &result.TreeScales, &result.Int16Values);
+            break;
+        case ELeafValuesQuantization::Int8:
+            QuantizeLeafValues(trees, &result.TreeScales, &result.Int8Values);
+            break;
+    }
+    return result;
+}
+
+double TQuantizedLeafValues::GetMaxAbsErrorBound(size_t treeStart, size_t treeEnd) const {
+    double bound = 0.0;
+    for (size_t treeId = treeStart; treeId < treeEnd; ++treeId) {
+        bound += 0.5 * TreeScales[treeId];
+    }
+    return bound;
+}
+
+namespace {
+    struct TQuantizedApplyBuffers {
+        TVector<ui8> ShallowIndexes;
+        TVector<ui32> DeepIndexes;
+        TVector<float> Accumulators;
+    };
+}
+
+template<typename TLeaf, typename TIndexType>
+Y_FORCE_INLINE static void AddQuantizedLeafValues(
+    size_t docCountInBlock,
+    size_t approxDimension,
+    float scale,
+    const TLeaf* __restrict treeLeafPtr,
+    const TIndexType* __restrict indexes,
+    float* __restrict accumulators)
+{
+    if (approxDimension == 1) {
+        for (size_t docId = 0; docId < docCountInBlock; ++docId) {
+            accumulators[docId] += scale * treeLeafPtr[indexes[docId]];
+        }
+    } else {
+        for (size_t docId = 0; docId < docCountInBlock; ++docId) {
+            const TLeaf* __restrict leafValuePtr = treeLeafPtr + indexes[docId] * approxDimension;
+            float* __restrict writePtr = accumulators + docId * approxDimension;
+            for (size_t classId = 0; classId < approxDimension; ++classId) {
+                writePtr[classId] += scale * leafValuePtr[classId];
+            }
+        }
+    }
+}
+
+// same as CalculateLeafValues4 in formula_evaluator.cpp: one pass over accumulators for four shallow trees
+template<typename TLeaf>
+Y_FORCE_INLINE static void AddQuantizedLeafValues4(
+    size_t docCountInBlock,
+    const float* __restrict scales,
+    const TLeaf* __restrict treeLeafPtr0,
+    const TLeaf* __restrict treeLeafPtr1,
+    const TLeaf* __restrict treeLeafPtr2,
+    const TLeaf* __restrict treeLeafPtr3,
+    const ui8* __restrict indexes,
+    float* __restrict accumulators)
+{
+    const ui8* __restrict indexes0 = indexes + docCountInBlock * 0;
+    const ui8* __restrict indexes1 = indexes + docCountInBlock * 1;
+    const ui8* __restrict indexes2 = indexes + docCountInBlock * 2;
+    const ui8* __restrict indexes3 = indexes + docCountInBlock * 3;
+    for (size_t docId = 0; docId < docCountInBlock; ++docId) {
+        accumulators[docId] +=
+            scales[0] * treeLeafPtr0[indexes0[docId]] +
+            scales[1] * treeLeafPtr1[indexes1[docId]] +
+            scales[2] * treeLeafPtr2[indexes2[docId]] +
+            scales[3] * treeLeafPtr3[indexes3[docId]];
+    }
+}
+
+template<typename TLeaf>
+static void CalcTreesQuantizedImpl(
+    const TFullModel& model,
+    const TVector<float>& treeScales,
+    const TLeaf* __restrict leafValues,
+    const ui8* __restrict binFeatures,
+    size_t docCountInBlock,
+    size_t treeStart,
+    size_t treeEnd,
+    double* __restrict results)
+{
+    const auto& trees = model.ObliviousTrees;
+    const bool needXorMask = !trees.OneHotFeatures.empty();
+    const size_t approxDimension = trees.ApproxDimension;
+    const auto& treeSizes = trees.TreeSizes;
+    const TRepackedBin* repackedBins = trees.GetRepackedBins().data();
+    const auto& firstLeafOffsets = trees.GetFirstLeafOffsets();
+    const auto calcShallowIndexes = GetCalcIndexesUi8Function(needXorMask, docCountInBlock);
+
+    auto& buffers = *FastTlsSingleton<TQuantizedApplyBuffers>();
+    buffers.ShallowIndexes.yresize(4 * docCountInBlock);
+    buffers.DeepIndexes.yresize(docCountInBlock);
+    buffers.Accumulators.assign(docCountInBlock * approxDimension, 0.0f);
+    ui8* __restrict shallowIndexes = buffers.ShallowIndexes.data();
+    ui32* __restrict deepIndexes = buffers.DeepIndexes.data();
+    float* __restrict accumulators = buffers.Accumulators.data();
+
+    auto flushAccumulators = [&] {
+        for (size_t i = 0; i < docCountInBlock * approxDimension; ++i) {
+            results[i] += accumulators[i];
+            accumulators[i] = 0.0f;
+        }
+    };
+
+    size_t treesSinceFlush = 0;
+    size_t treeId = treeStart;
+    while (treeId < treeEnd) {
+        const bool canProcessFourTrees = approxDimension == 1
+            && treeId + 4 <= treeEnd
+            && treesSinceFlush + 4 <= QUANTIZED_LEAVES_FLUSH_PERIOD
+            && Max(Max(treeSizes[treeId], treeSizes[treeId + 1]), Max(treeSizes[treeId + 2], treeSizes[treeId + 3])) <= 8;
+        if (canProcessFourTrees) {
+            memset(shallowIndexes, 0, 4 * docCountInBlock);
+            for (size_t i = 0; i < 4; ++i) {
+                calcShallowIndexes(
+                    binFeatures,
+                    docCountInBlock,
+                    shallowIndexes + docCountInBlock * i,
+                    repackedBins + trees.TreeStartOffsets[treeId + i],
+                    treeSizes[treeId + i]);
+            }
+            AddQuantizedLeafValues4(
+                docCountInBlock,
+                treeScales.data() + treeId,
+                leafValues + firstLeafOffsets[treeId + 0],
+                leafValues + firstLeafOffsets[treeId + 1],
+                leafValues + firstLeafOffsets[treeId + 2],
+                leafValues + firstLeafOffsets[treeId + 3],
+                shallowIndexes,
+                accumulators);
+            treeId += 4;
+            treesSinceFlush += 4;
+        } else {
+            const TLeaf* treeLeafPtr = leafValues + firstLeafOffsets[treeId];
+            const TRepackedBin* treeSplitsPtr = repackedBins + trees.TreeStartOffsets[treeId];
+            if (treeSizes[treeId] <= 8) {
+                memset(shallowIndexes, 0, docCountInBlock);
+                calcShallowIndexes(binFeatures, docCountInBlock, shallowIndexes, treeSplitsPtr, treeSizes[treeId]);
+                AddQuantizedLeafValues(docCountInBlock, approxDimension, treeScales[treeId], treeLeafPtr, shallowIndexes, accumulators);
+            } else {
+                memset(deepIndexes, 0, sizeof(ui32) * docCountInBlock);
+                CalcIndexes(needXorMask, binFeatures, docCountInBlock, deepIndexes, treeSplitsPtr, treeSizes[treeId]);
+                AddQuantizedLeafValues(docCountInBlock, approxDimension, treeScales[treeId], treeLeafPtr, deepIndexes, accumulators);
+            }
+            ++treeId;
+            ++treesSinceFlush;
+        }
+        if (treesSinceFlush == QUANTIZED_LEAVES_FLUSH_PERIOD) {
+            flushAccumulators();
+            treesSinceFlush = 0;
+        }
+    }
+    flushAccumulators();
+}
+
+void CalcTreesQuantized(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const ui8* binFeatures,
+    size_t docCountInBlock,
+    size_t treeStart,
+    size_t treeEnd,
+    double* results)
+{
+    switch (leafValues.Quantization) {
+        case ELeafValuesQuantization::Int16:
+            CalcTreesQuantizedImpl(model, leafValues.TreeScales, leafValues.Int16Values.data(), binFeatures, docCountInBlock, treeStart, treeEnd, results);
+            break;
+        case ELeafValuesQuantization::Int8:
+            CalcTreesQuantizedImpl(model, leafValues.TreeScales, leafValues.Int8Values.data(), binFeatures, docCountInBlock, treeStart, treeEnd, results);
+            break;
+    }
+}
+
+void CalcFlatQuantized(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const TVector<TConstArrayRef<float>>& features,
+    TArrayRef<double> results)
+{
+    const auto expectedFlatVecSize = model.ObliviousTrees.GetFlatFeatureVectorExpectedSize();
+    for (const auto& flatFeaturesVec : features) {
+        CB_ENSURE(flatFeaturesVec.size() >= expectedFlatVecSize,
+                  "insufficient flat features vector size: " << flatFeaturesVec.size()
+                                                             << " expected: " << expectedFlatVecSize);
+    }
+    CalcGenericQuantized(
+        model,
+        leafValues,
+        [&features](const TFloatFeature& floatFeature, size_t index) -> float {
+            return features[index][floatFeature.FlatFeatureIndex];
+        },
+        [&features](const TCatFeature& catFeature, size_t index) -> int {
+            return ConvertFloatCatFeatureToIntHash(features[index][catFeature.FlatFeatureIndex]);
+        },
+        features.size(),
+        0,
+        model.GetTreeCount(),
+        results
+    );
+}
+
+TLeafQuantizationReport BuildLeafQuantizationReport(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const TVector<TConstArrayRef<float>>& features)
+{
+    const size_t resultSize = features.size() * model.ObliviousTrees.ApproxDimension;
+    TVector<double> originalResults(resultSize);
+    model.CalcFlat(features, originalResults);
+    TVector<double> quantizedResults(resultSize);
+    CalcFlatQuantized(model, leafValues, features, quantizedResults);
+
+    TLeafQuantizationReport report;
+    for (size_t i = 0; i < resultSize; ++i) {
+        const double absError = Abs(originalResults[i] - quantizedResults[i]);
+        report.MaxAbsError = Max(report.MaxAbsError, absError);
+        report.MeanAbsError += absError;
+        if (originalResults[i] != 0.0) {
+            report.MaxRelativeError = Max(report.MaxRelativeError, absError / Abs(originalResults[i]));
+        }
+    }
+    if (resultSize > 0) {
+        report.MeanAbsError /= resultSize;
+    }
+    report.MaxAbsErrorBound = leafValues.GetMaxAbsErrorBound(0, leafValues.GetTreeCount());
+    report.OriginalLeafValuesBytes = model.ObliviousTrees.LeafValues.size() * sizeof(double);
+    report.QuantizedLeafValuesBytes = leafValues.GetMemoryUsage();
+    return report;
+}
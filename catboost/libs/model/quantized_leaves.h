@@ -0,0 +1,133 @@
+#pragma once
+
+#include "formula_evaluator.h"
+#include "model.h"
+
+#include <util/generic/vector.h>
+#include <util/system/types.h>
+
+/*
+ * Compact leaf values storage for inference of large models.
+ * Each tree leaf value is stored as integer q with per tree scale: leafValue ~= TreeScales[treeIdx] * q.
+ * Leaf values layout is the same as in TObliviousTrees::LeafValues, so TreeFirstLeafOffsets are reused.
+ */
+
+enum class ELeafValuesQuantization {
+    Int16,
+    Int8
+};
+
+struct TQuantizedLeafValues {
+    ELeafValuesQuantization Quantization = ELeafValuesQuantization::Int16;
+    int ApproxDimension = 1;
+    //! Per tree dequantization multiplier
+    TVector<float> TreeScales;
+    //! Only one of these vectors is filled, depending on Quantization
+    TVector<i16> Int16Values;
+    TVector<i8> Int8Values;
+
+public:
+    static TQuantizedLeafValues Build(const TObliviousTrees& trees, ELeafValuesQuantization quantization);
+
+    size_t GetTreeCount() const {
+        return TreeScales.size();
+    }
+
+    //! Memory used by quantized leaf values and scales
+    size_t GetMemoryUsage() const {
+        return TreeScales.size() * sizeof(float) + Int16Values.size() * sizeof(i16) + Int8Values.size() * sizeof(i8);
+    }
+
+    /**
+     * Upper bound of absolute prediction error caused by leaf rounding, for trees [treeStart, treeEnd).
+     * Float32 accumulation error is not included.
+     */
+    double GetMaxAbsErrorBound(size_t treeStart, size_t treeEnd) const;
+};
+
+/**
+ * Evaluate trees [treeStart, treeEnd) on binarized features block using quantized leaf values.
+ * Leaf indexes are computed by the same blocked ui8 kernels as in CalcTreesBlocked, four trees with depth <= 8 at a time.
+ * Leafs are accumulated in float32 and flushed to double results every QUANTIZED_LEAVES_FLUSH_PERIOD trees.
+ * Results are added to the values in results array.
+ */
+void CalcTreesQuantized(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const ui8* binFeatures,
+    size_t docCountInBlock,
+    size_t treeStart,
+    size_t treeEnd,
+    double* results);
+
+constexpr size_t QUANTIZED_LEAVES_FLUSH_PERIOD = 64;
+
+template<typename TFloatFeatureAccessor, typename TCatFeatureAccessor>
+inline void CalcGenericQuantized(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    TFloatFeatureAccessor floatFeatureAccessor,
+    TCatFeatureAccessor catFeaturesAccessor,
+    size_t docCount,
+    size_t treeStart,
+    size_t treeEnd,
+    TArrayRef<double> results)
+{
+    CB_ENSURE(leafValues.GetTreeCount() == model.GetTreeCount(), "quantized leaf values were built for another model");
+    CB_ENSURE(leafValues.ApproxDimension == model.ObliviousTrees.ApproxDimension);
+    CB_ENSURE(results.size() == docCount * model.ObliviousTrees.ApproxDimension);
+    std::fill(results.begin(), results.end(), 0.0);
+    const size_t blockSize = Min(FORMULA_EVALUATION_BLOCK_SIZE, docCount);
+    TVector<ui8> binFeatures(blockSize * model.ObliviousTrees.GetEffectiveBinaryFeaturesBucketsCount());
+    TVector<int> transposedHash(blockSize * model.ObliviousTrees.CatFeatures.size());
+    TVector<float> ctrs(model.ObliviousTrees.GetUsedModelCtrs().size() * blockSize);
+    for (size_t blockStart = 0; blockStart < docCount; blockStart += blockSize) {
+        const auto docCountInBlock = Min(blockSize, docCount - blockStart);
+        BinarizeFeatures(
+            model,
+            floatFeatureAccessor,
+            catFeaturesAccessor,
+            blockStart,
+            blockStart + docCountInBlock,
+            binFeatures,
+            transposedHash,
+            ctrs
+        );
+        CalcTreesQuantized(
+            model,
+            leafValues,
+            binFeatures.data(),
+            docCountInBlock,
+            treeStart,
+            treeEnd,
+            results.data() + blockStart * model.ObliviousTrees.ApproxDimension
+        );
+    }
+}
+
+/**
+ * Same as TFullModel::CalcFlat but with quantized leaf values
+ */
+void CalcFlatQuantized(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const TVector<TConstArrayRef<float>>& features,
+    TArrayRef<double> results);
+
+/**
+ * Difference between predictions with quantized and original leaf values on user data
+ */
+struct TLeafQuantizationReport {
+    double MaxAbsError = 0.0;
+    double MeanAbsError = 0.0;
+    double MaxRelativeError = 0.0;
+    //! Theoretical bound from leaf rounding, see TQuantizedLeafValues::GetMaxAbsErrorBound
+    double MaxAbsErrorBound = 0.0;
+    size_t OriginalLeafValuesBytes = 0;
+    size_t QuantizedLeafValuesBytes = 0;
+};
+
+TLeafQuantizationReport BuildLeafQuantizationReport(
+    const TFullModel& model,
+    const TQuantizedLeafValues& leafValues,
+    const TVector<TConstArrayRef<float>>& features);
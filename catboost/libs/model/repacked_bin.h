@@ -0,0 +1,26 @@
+#pragma once
+
+#include <util/system/types.h>
+
+/*!
+    \brief Binary condition of oblivious tree in a form suitable for fast model apply
+
+    Kept in a separate lightweight header so it could be used from instruction set specific
+    translation units without pulling in the whole model definition.
+*/
+struct TRepackedBin {
+    ui16 FeatureIndex = 0;
+    ui8 XorMask = 0;
+    ui8 SplitIdx = 0;
+};
+
+/*!
+    Binarized feature values are stored in ui8 buckets. Features with more than MAX_VALUES_PER_BIN borders
+    (or one hot values) are split into several consecutive buckets: bucket j holds the number of passed borders
+    among borders [j * MAX_VALUES_PER_BIN, (j + 1) * MAX_VALUES_PER_BIN), so ui8 apply kernels work unchanged.
+*/
+constexpr int MAX_VALUES_PER_BIN = 254;
+
+inline int GetBinFeatureBucketCount(int valueCount) {
+    return valueCount > 0 ? (valueCount + MAX_VALUES_PER_BIN - 1) / MAX_VALUES_PER_BIN : 1;
+}
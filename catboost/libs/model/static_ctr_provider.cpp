@@ -1,13 +1,69 @@
 #include "static_ctr_provider.h"
+#include "repacked_bin.h"
 
 #include <catboost/libs/helpers/exception.h>
 
-struct TCompressedModelCtr {
-    const TFeatureCombination* Projection;
-    TVector<const TModelCtr*> ModelCtrs;
-};
+#include <util/thread/singleton.h>
+
+#include <atomic>
+
+namespace {
+    // reused between calls on the same thread to avoid allocations on every model apply
+    struct TCtrCalcBuffers {
+        //! Plan for CalcCtrs calls without a valid plan of the model
+        TCtrCalcPlan Plan;
+        TVector<ui64> CtrHashes;
+        TVector<ui32> Buckets;
+    };
+}
+
+ui64 TStaticCtrProvider::GenerateCtrCalcPlanGeneration() {
+    static std::atomic<ui64> lastGeneration(0);
+    return ++lastGeneration;
+}
+
+void TStaticCtrProvider::InvalidateCtrCalcPlans() {
+    CtrCalcPlanGeneration = GenerateCtrCalcPlanGeneration();
+}
+
+void TStaticCtrProvider::BuildCtrCalcPlan(const TVector<TModelCtr>& neededCtrs, TCtrCalcPlan* plan) const {
+    plan->NeededCtrs = neededCtrs;
+    plan->Generation = CtrCalcPlanGeneration;
+    plan->Projections.clear();
+    plan->ValueTables.clear();
+    size_t projectionStart = 0;
+    for (size_t i = 1; i <= neededCtrs.size(); ++i) {
+        Y_ASSERT(i == neededCtrs.size() || neededCtrs[i - 1] < neededCtrs[i]); // needed ctrs should be sorted
+        if (i == neededCtrs.size() || neededCtrs[projectionStart].Base.Projection != neededCtrs[i].Base.Projection) {
+            const auto& proj = neededCtrs[projectionStart].Base.Projection;
+            auto& projectionPlan = plan->Projections.emplace_back();
+            for (const auto feature : proj.CatFeatures) {
+                projectionPlan.TransposedCatFeatureIndexes.push_back(CatFeatureIndex.at(feature));
+            }
+            for (const auto feature : proj.BinFeatures) {
+                projectionPlan.BinarizedIndexes.push_back(FloatFeatureIndexes.at(feature));
+            }
+            for (const auto feature : proj.OneHotFeatures) {
+                projectionPlan.BinarizedIndexes.push_back(OneHotFeatureIndexes.at(feature));
+            }
+            projectionPlan.CtrBegin = projectionStart;
+            projectionPlan.CtrEnd = i;
+            projectionStart = i;
+        }
+    }
+    for (const auto& ctr : neededCtrs) {
+        plan->ValueTables.push_back(&CtrData.LearnCtrs.at(ctr.Base));
+    }
+}
+
+TIntrusivePtr<ICtrCalcPlan> TStaticCtrProvider::CreateCtrCalcPlan(const TVector<TModelCtr>& neededCtrs) const {
+    TIntrusivePtr<TCtrCalcPlan> plan = new TCtrCalcPlan;
+    BuildCtrCalcPlan(neededCtrs, plan.Get());
+    return plan.Get();
+}
 
 void TStaticCtrProvider::CalcCtrs(const TVector<TModelCtr>& neededCtrs,
+                                  const ICtrCalcPlan* modelPlan,
                                   const TConstArrayRef<ui8>& binarizedFeatures,
                                   const TConstArrayRef<int>& hashedCatFeatures,
                                   size_t docCount,
@@ -15,44 +71,39 @@ void TStaticCtrProvider::CalcCtrs(const TVector<TModelCtr>& neededCtrs,
     if (neededCtrs.empty()) {
         return;
     }
-    TVector<TCompressedModelCtr> compressedModelCtrs;
-    compressedModelCtrs.emplace_back(TCompressedModelCtr{&neededCtrs[0].Base.Projection, {&neededCtrs[0]}});
-    for (size_t i = 1; i < neededCtrs.size(); ++i) {
-        Y_ASSERT(neededCtrs[i - 1] < neededCtrs[i]); // needed ctrs should be sorted
-        if (*(compressedModelCtrs.back().Projection) != neededCtrs[i].Base.Projection) {
-            compressedModelCtrs.emplace_back(TCompressedModelCtr{&neededCtrs[i].Base.Projection, {}});
+    auto& buffers = *FastTlsSingleton<TCtrCalcBuffers>();
+    // plans are matched by content: ctrs lists of different models can have the same address
+    const TCtrCalcPlan* plan = dynamic_cast<const TCtrCalcPlan*>(modelPlan);
+    if (plan == nullptr || !plan->IsBuiltFor(neededCtrs, CtrCalcPlanGeneration)) {
+        // e.g. another model sharing this provider has set up feature indexes
+        auto& threadPlan = buffers.Plan;
+        if (!threadPlan.IsBuiltFor(neededCtrs, CtrCalcPlanGeneration)) {
+            BuildCtrCalcPlan(neededCtrs, &threadPlan);
         }
-        compressedModelCtrs.back().ModelCtrs.push_back(&neededCtrs[i]);
+        plan = &threadPlan;
     }
     size_t samplesCount = docCount;
-    TVector<ui64> ctrHashes(samplesCount);
-    TVector<ui64> buckets(samplesCount);
+    auto& ctrHashes = buffers.CtrHashes;
+    auto& buckets = buffers.Buckets;
+    buckets.yresize(samplesCount);
     size_t resultIdx = 0;
     float* resultPtr = result.data();
-    TVector<int> transposedCatFeatureIndexes;
-    TVector<TBinFeatureIndexValue> binarizedIndexes;
-    for (size_t i = 0; i < compressedModelCtrs.size(); ++i) {
-        auto& proj = *compressedModelCtrs[i].Projection;
-        binarizedIndexes.clear();
-        transposedCatFeatureIndexes.clear();
-        for (const auto feature : proj.CatFeatures) {
-            transposedCatFeatureIndexes.push_back(CatFeatureIndex.at(feature));
-        }
-        for (const auto feature : proj.BinFeatures ) {
-            binarizedIndexes.push_back(FloatFeatureIndexes.at(feature));
-        }
-        for (const auto feature : proj.OneHotFeatures ) {
-            binarizedIndexes.push_back(OneHotFeatureIndexes.at(feature));
-        }
-        CalcHashes(binarizedFeatures, hashedCatFeatures, transposedCatFeatureIndexes, binarizedIndexes, docCount, &ctrHashes);
-        for (size_t j = 0; j < compressedModelCtrs[i].ModelCtrs.size(); ++j) {
-            auto& ctr = *compressedModelCtrs[i].ModelCtrs[j];
-            auto& learnCtr = CtrData.LearnCtrs.at(ctr.Base);
-            auto hashIndexResolver = learnCtr.GetIndexHashViewer();
+    for (const auto& projectionPlan : plan->Projections) {
+        CalcHashes(
+            binarizedFeatures,
+            hashedCatFeatures,
+            projectionPlan.TransposedCatFeatureIndexes,
+            projectionPlan.BinarizedIndexes,
+            docCount,
+            &ctrHashes);
+        for (size_t ctrIdx = projectionPlan.CtrBegin; ctrIdx < projectionPlan.CtrEnd; ++ctrIdx) {
+            auto& ctr = plan->NeededCtrs[ctrIdx];
+            auto& learnCtr = *plan->ValueTables[ctrIdx];
             const ECtrType ctrType = ctr.Base.CtrType;
             auto ptrBuckets = buckets.data();
-            for (size_t docId = 0; docId < samplesCount; ++docId) {
-                ptrBuckets[docId] = hashIndexResolver.GetIndex(ctrHashes[docId]);
+            // ctrs with the same base share value table, so their buckets are the same
+            if (ctrIdx == projectionPlan.CtrBegin || plan->ValueTables[ctrIdx - 1] != plan->ValueTables[ctrIdx]) {
+                learnCtr.GetIndexHashViewer().GetIndexes(ctrHashes, ptrBuckets);
             }
             if (ctrType == ECtrType::BinarizedTargetMeanValue || ctrType == ECtrType::FloatTargetMeanValue) {
                 const auto emptyVal = ctr.Calc(0.f, 0.f);
@@ -143,24 +194,33 @@ bool TStaticCtrProvider::HasNeededCtrs(const TVector<TModelCtr>& neededCtrs) con
 void TStaticCtrProvider::SetupBinFeatureIndexes(const TVector<TFloatFeature> &floatFeatures,
                                                 const TVector<TOneHotFeature> &oheFeatures,
                                                 const TVector<TCatFeature> &catFeatures) {
+    ResetCtrCalcPlan(); // plan holds feature indexes
     ui32 currentIndex = 0;
     FloatFeatureIndexes.clear();
     for (const auto& floatFeature : floatFeatures) {
-        for (size_t borderIdx = 0; borderIdx < floatFeature.Borders.size(); ++borderIdx) {
-            TBinFeatureIndexValue featureIdx{currentIndex, false, (ui8)(borderIdx + 1)};
+        for (int borderIdx = 0; borderIdx < floatFeature.Borders.ysize(); ++borderIdx) {
+            TBinFeatureIndexValue featureIdx{
+                currentIndex + borderIdx / MAX_VALUES_PER_BIN,
+                false,
+                (ui8)(borderIdx % MAX_VALUES_PER_BIN + 1)
+            };
             TFloatSplit split{floatFeature.FeatureIndex, floatFeature.Borders[borderIdx]};
             FloatFeatureIndexes[split] = featureIdx;
         }
-        ++currentIndex;
+        currentIndex += GetBinFeatureBucketCount(floatFeature.Borders.ysize());
     }
     OneHotFeatureIndexes.clear();
     for (const auto& oheFeature : oheFeatures) {
         for (int valueId = 0; valueId < oheFeature.Values.ysize(); ++valueId) {
-            TBinFeatureIndexValue featureIdx{currentIndex, true, (ui8)(valueId + 1)};
+            TBinFeatureIndexValue featureIdx{
+                currentIndex + valueId / MAX_VALUES_PER_BIN,
+                true,
+                (ui8)(valueId % MAX_VALUES_PER_BIN + 1)
+            };
             TOneHotSplit feature{oheFeature.CatFeatureIndex, oheFeature.Values[valueId]};
             OneHotFeatureIndexes[feature] = featureIdx;
         }
-        ++currentIndex;
+        currentIndex += GetBinFeatureBucketCount(oheFeature.Values.ysize());
     }
     CatFeatureIndex.clear();
     for (const auto& catFeature : catFeatures) {
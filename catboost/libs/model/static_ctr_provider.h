@@ -1,5 +1,6 @@
 #pragma once
 
+#include <util/memory/blob.h>
 #include <util/system/mutex.h>
 #include <library/threading/local_executor/local_executor.h>
 #include <catboost/libs/helpers/exception.h>
@@ -7,6 +8,30 @@
 #include "ctr_data.h"
 #include "split.h"
 
+/**
+ * Document independent part of CalcCtrs: ctrs grouped by projection with resolved feature indexes and value tables
+ */
+struct TCtrCalcPlan : public ICtrCalcPlan {
+    struct TProjectionPlan {
+        TVector<int> TransposedCatFeatureIndexes;
+        TVector<TBinFeatureIndexValue> BinarizedIndexes;
+        //! Range of projection ctrs in NeededCtrs
+        size_t CtrBegin = 0;
+        size_t CtrEnd = 0;
+    };
+
+    TVector<TModelCtr> NeededCtrs;
+    TVector<TProjectionPlan> Projections;
+    //! Value table for each of NeededCtrs
+    TVector<const TCtrValueTable*> ValueTables;
+    //! Provider state the plan was built for, see TStaticCtrProvider::CtrCalcPlanGeneration
+    ui64 Generation = 0;
+
+    bool IsBuiltFor(const TVector<TModelCtr>& neededCtrs, ui64 generation) const {
+        return Generation == generation && NeededCtrs == neededCtrs;
+    }
+};
+
 struct TStaticCtrProvider: public ICtrProvider {
 public:
     TStaticCtrProvider() = default;
@@ -18,6 +43,7 @@ public:
 
     void CalcCtrs(
         const TVector<TModelCtr>& neededCtrs,
+        const ICtrCalcPlan* plan,
         const TConstArrayRef<ui8>& binarizedFeatures, // vector of binarized float & one hot features
         const TConstArrayRef<int>& hashedCatFeatures,
         size_t docCount,
@@ -27,12 +53,16 @@ public:
         const TVector<TFloatFeature>& floatFeatures,
         const TVector<TOneHotFeature>& oheFeatures,
         const TVector<TCatFeature>& catFeatures) override;
+
+    TIntrusivePtr<ICtrCalcPlan> CreateCtrCalcPlan(const TVector<TModelCtr>& neededCtrs) const override;
+
     bool IsSerializable() const override {
         return true;
     }
     void AddCtrCalcerData(TCtrValueTable&& valueTable) override {
         auto ctrBase = valueTable.ModelCtrBase;
         CtrData.LearnCtrs[ctrBase] = std::move(valueTable);
+        InvalidateCtrCalcPlans(); // plans hold pointers to value tables
     }
 
     void Save(IOutputStream* out) const override {
@@ -41,6 +71,17 @@ public:
 
     void Load(IInputStream* inp) override {
         ::Load(inp, CtrData);
+        InvalidateCtrCalcPlans();
+    }
+
+    /**
+     * Load ctr tables as views into memory buffer, dataHolder should keep this buffer alive (can be empty if
+     * buffer lifetime is managed by user)
+     */
+    void LoadNonOwning(TMemoryInput* in, const TBlob& dataHolder) {
+        CtrData.LoadNonOwning(in);
+        DataHolder = dataHolder;
+        InvalidateCtrCalcPlans();
     }
 
     TString ModelPartIdentifier() const override {
@@ -62,6 +103,15 @@ public:
     ~TStaticCtrProvider() override {}
     TCtrData CtrData;
 private:
+    void BuildCtrCalcPlan(const TVector<TModelCtr>& neededCtrs, TCtrCalcPlan* plan) const;
+    //! Makes plans built for the current value tables and feature indexes stale
+    void InvalidateCtrCalcPlans();
+    static ui64 GenerateCtrCalcPlanGeneration();
+
+private:
+    TBlob DataHolder;
+    //! Process unique id of value tables and feature indexes state, plans built for another generation are stale
+    ui64 CtrCalcPlanGeneration = GenerateCtrCalcPlanGeneration();
     THashMap<TFloatSplit, TBinFeatureIndexValue> FloatFeatureIndexes;
     THashMap<int, int> CatFeatureIndex;
     THashMap<TOneHotSplit, TBinFeatureIndexValue> OneHotFeatureIndexes;
@@ -86,6 +136,7 @@ public:
 
     void CalcCtrs(
         const TVector<TModelCtr>& ,
+        const ICtrCalcPlan* ,
         const TConstArrayRef<ui8>& ,
         const TConstArrayRef<int>& ,
         size_t,
@@ -1,7 +1,10 @@
 #include <catboost/libs/model/model.h>
 #include <catboost/libs/model/formula_evaluator.h>
+#include <catboost/libs/model/quantized_leaves.h>
 #include <library/unittest/registar.h>
 
+#include <util/random/fast.h>
+
 using namespace std;
 
 TFullModel SimpleFloatModel() {
@@ -63,6 +66,30 @@ TFullModel MultiValueFloatModel() {
     return model;
 }
 
+TFullModel RandomFloatModel(int featureCount, int borderCount, int treeCount, int maxTreeDepth, TReallyFastRng32& rng) {
+    TFullModel model;
+    for (int featureIdx = 0; featureIdx < featureCount; ++featureIdx) {
+        TVector<float> borders;
+        for (int borderIdx = 0; borderIdx < borderCount; ++borderIdx) {
+            borders.push_back((float)borderIdx / borderCount);
+        }
+        model.ObliviousTrees.FloatFeatures.emplace_back(false, featureIdx, featureIdx, borders);
+    }
+    for (int treeIdx = 0; treeIdx < treeCount; ++treeIdx) {
+        const int treeDepth = 1 + rng.Uniform(maxTreeDepth);
+        TVector<int> tree;
+        for (int depth = 0; depth < treeDepth; ++depth) {
+            tree.push_back(rng.Uniform(featureCount * borderCount));
+        }
+        model.ObliviousTrees.AddBinTree(tree);
+        for (int leafIdx = 0; leafIdx < (1 << treeDepth); ++leafIdx) {
+            model.ObliviousTrees.LeafValues.push_back(rng.GenRandReal1());
+        }
+    }
+    model.UpdateDynamicData();
+    return model;
+}
+
 Y_UNIT_TEST_SUITE(TObliviousTreeModel) {
     Y_UNIT_TEST(TestFlatCalcFloat) {
         auto modelCalcer = SimpleFloatModel();
@@ -105,4 +132,148 @@ Y_UNIT_TEST_SUITE(TObliviousTreeModel) {
         };
         UNIT_ASSERT_EQUAL(canonVals, result);
     }
+
+    Y_UNIT_TEST(TestSimdDispatchMatchesSse) {
+        TReallyFastRng32 rng(0);
+        const int featureCount = 10;
+        const size_t docCount = 117;
+        auto model = RandomFloatModel(featureCount, 20, 50, 6, rng);
+        TVector<float> features(featureCount * docCount);
+        for (auto& value : features) {
+            value = rng.GenRandReal1();
+        }
+        TVector<ui8> sseBins(featureCount * docCount);
+        TVector<ui8> dispatchedBins(featureCount * docCount);
+        ui8* sseBinsPtr = sseBins.data();
+        ui8* dispatchedBinsPtr = dispatchedBins.data();
+        for (int featureIdx = 0; featureIdx < featureCount; ++featureIdx) {
+            const float* featureValues = features.data() + featureIdx * docCount;
+            const auto& borders = model.ObliviousTrees.FloatFeatures[featureIdx].Borders;
+            auto accessor = [featureValues](size_t index) { return featureValues[index]; };
+            BinarizeFloatsSse<false>(docCount, accessor, borders, 0, sseBinsPtr);
+            BinarizeFloats<false>(docCount, accessor, borders, 0, dispatchedBinsPtr);
+        }
+        UNIT_ASSERT_EQUAL(sseBins, dispatchedBins);
+
+        TVector<TCalcerIndexType> indexesVec(docCount);
+        TVector<double> sseResults(docCount);
+        TVector<double> dispatchedResults(docCount);
+        GetCalcTreesFunction(model, docCount, false)(model, sseBins.data(), docCount, indexesVec.data(), 0, model.GetTreeCount(), sseResults.data());
+        GetCalcTreesFunction(model, docCount, true)(model, sseBins.data(), docCount, indexesVec.data(), 0, model.GetTreeCount(), dispatchedResults.data());
+        UNIT_ASSERT_EQUAL(sseResults, dispatchedResults);
+    }
+
+    Y_UNIT_TEST(TestSingleDocMatchesBlocked) {
+        TReallyFastRng32 rng(0);
+        const int featureCount = 10;
+        const size_t docCount = 50;
+        auto model = RandomFloatModel(featureCount, 20, 200, 10, rng);
+        TVector<TVector<float>> features(docCount, TVector<float>(featureCount));
+        TVector<TConstArrayRef<float>> featureRefs;
+        for (auto& docFeatures : features) {
+            for (auto& value : docFeatures) {
+                value = rng.GenRandReal1();
+            }
+            featureRefs.push_back(docFeatures);
+        }
+        TVector<double> blockedResults(docCount);
+        model.CalcFlat(featureRefs, blockedResults);
+        for (size_t docId = 0; docId < docCount; ++docId) {
+            TVector<double> singleResult(1);
+            model.CalcFlatSingle(featureRefs[docId], singleResult);
+            UNIT_ASSERT_DOUBLES_EQUAL(blockedResults[docId], singleResult[0], 1e-9);
+
+            singleResult[0] = 0.0;
+            model.CalcFlatSingle(featureRefs[docId], 17, 123, singleResult);
+            TVector<double> rangeResults(2);
+            model.CalcFlat({featureRefs[docId], featureRefs[docId]}, 17, 123, rangeResults);
+            UNIT_ASSERT_DOUBLES_EQUAL(rangeResults[0], singleResult[0], 1e-9);
+        }
+    }
+
+    Y_UNIT_TEST(TestParallelCalcMatchesSequential) {
+        TReallyFastRng32 rng(0);
+        const int featureCount = 10;
+        auto model = RandomFloatModel(featureCount, 20, 500, 8, rng);
+        NPar::TLocalExecutor executor;
+        executor.RunAdditionalThreads(3);
+        // small batch is split by trees, large batch is split by documents
+        for (size_t docCount : {3, 1000}) {
+            TVector<TVector<float>> features(docCount, TVector<float>(featureCount));
+            TVector<TConstArrayRef<float>> featureRefs;
+            for (auto& docFeatures : features) {
+                for (auto& value : docFeatures) {
+                    value = rng.GenRandReal1();
+                }
+                featureRefs.push_back(docFeatures);
+            }
+            TVector<double> sequentialResults(docCount);
+            model.CalcFlat(featureRefs, sequentialResults);
+            TVector<double> parallelResults(docCount);
+            model.CalcFlat(featureRefs, 0, model.GetTreeCount(), parallelResults, executor);
+            for (size_t docId = 0; docId < docCount; ++docId) {
+                UNIT_ASSERT_DOUBLES_EQUAL(sequentialResults[docId], parallelResults[docId], 1e-9);
+            }
+        }
+    }
+
+    Y_UNIT_TEST(TestManyBordersPerFeature) {
+        TReallyFastRng32 rng(0);
+        const int featureCount = 3;
+        const int borderCount = 600;
+        const size_t docCount = 200;
+        auto model = RandomFloatModel(featureCount, borderCount, 100, 6, rng);
+        UNIT_ASSERT_VALUES_EQUAL(model.ObliviousTrees.GetEffectiveBinaryFeaturesBucketsCount(), featureCount * 3);
+        TVector<TVector<float>> features(docCount, TVector<float>(featureCount));
+        TVector<TConstArrayRef<float>> featureRefs;
+        for (auto& docFeatures : features) {
+            for (auto& value : docFeatures) {
+                value = rng.GenRandReal1();
+            }
+            featureRefs.push_back(docFeatures);
+        }
+        TVector<double> results(docCount);
+        model.CalcFlat(featureRefs, results);
+        const auto& trees = model.ObliviousTrees;
+        for (size_t docId = 0; docId < docCount; ++docId) {
+            double expected = 0.0;
+            for (size_t treeId = 0; treeId < model.GetTreeCount(); ++treeId) {
+                size_t leafIdx = 0;
+                for (int depth = 0; depth < trees.TreeSizes[treeId]; ++depth) {
+                    const int split = trees.TreeSplits[trees.TreeStartOffsets[treeId] + depth];
+                    const auto& feature = trees.FloatFeatures[split / borderCount];
+                    leafIdx |= (size_t)(features[docId][feature.FlatFeatureIndex] > feature.Borders[split % borderCount]) << depth;
+                }
+                expected += trees.LeafValues[trees.GetFirstLeafOffsets()[treeId] + leafIdx];
+            }
+            UNIT_ASSERT_DOUBLES_EQUAL(expected, results[docId], 1e-9);
+            TVector<double> singleResult(1);
+            model.CalcFlatSingle(featureRefs[docId], singleResult);
+            UNIT_ASSERT_DOUBLES_EQUAL(expected, singleResult[0], 1e-9);
+        }
+    }
+
+    Y_UNIT_TEST(TestQuantizedLeafValues) {
+        TReallyFastRng32 rng(0);
+        const int featureCount = 10;
+        const size_t docCount = 300;
+        // trees deeper than 8 take ui32 leaf indexes path, shallow ones are processed by four
+        auto model = RandomFloatModel(featureCount, 20, 200, 10, rng);
+        TVector<TVector<float>> features(docCount, TVector<float>(featureCount));
+        TVector<TConstArrayRef<float>> featureRefs;
+        for (auto& docFeatures : features) {
+            for (auto& value : docFeatures) {
+                value = rng.GenRandReal1();
+            }
+            featureRefs.push_back(docFeatures);
+        }
+        for (auto quantization : {ELeafValuesQuantization::Int16, ELeafValuesQuantization::Int8}) {
+            const auto leafValues = TQuantizedLeafValues::Build(model.ObliviousTrees, quantization);
+            const auto report = BuildLeafQuantizationReport(model, leafValues, featureRefs);
+            UNIT_ASSERT(report.MaxAbsErrorBound > 0.0);
+            UNIT_ASSERT(report.MaxAbsError <= report.MaxAbsErrorBound + 1e-4);
+            UNIT_ASSERT(report.MeanAbsError <= report.MaxAbsError);
+            UNIT_ASSERT(report.QuantizedLeafValuesBytes * 3 < report.OriginalLeafValuesBytes);
+        }
+    }
 }
@@ -1,5 +1,7 @@
 #include "model_test_helpers.h"
 
+#include <catboost/libs/model/static_ctr_provider.h>
+
 #include <library/unittest/registar.h>
 
 using namespace std;
@@ -14,6 +16,53 @@ Y_UNIT_TEST_SUITE(TModelSerialization) {
         UNIT_ASSERT_EQUAL(trainedModel, deserializedModel);
     }
 
+    Y_UNIT_TEST(TestSerializeDeserializeMappedModel) {
+        TFullModel trainedModel = TrainFloatCatboostModel();
+        OutputModel(trainedModel, "model.bin");
+        TFullModel mappedModel = ReadModelMapped("model.bin");
+        UNIT_ASSERT_EQUAL(trainedModel, mappedModel);
+        TString serializedModel = SerializeModel(trainedModel);
+        TFullModel nonOwningModel = ReadModelNonOwning(serializedModel.data(), serializedModel.size());
+        UNIT_ASSERT_EQUAL(trainedModel, nonOwningModel);
+    }
+
+    Y_UNIT_TEST(TestMappedModelWithCtrsPredictions) {
+        TFullModel trainedModel = TrainCatFeaturesCatboostModel();
+        UNIT_ASSERT(!trainedModel.ObliviousTrees.GetUsedModelCtrs().empty());
+        OutputModel(trainedModel, "ctr_model.bin");
+        TFullModel readModel = ReadModel("ctr_model.bin");
+        TFullModel mappedModel = ReadModelMapped("ctr_model.bin");
+        TString serializedModel = SerializeModel(trainedModel);
+        TFullModel nonOwningModel = ReadModelNonOwning(serializedModel.data(), serializedModel.size());
+
+        // ctr tables of non owning model should be views into the serialized buffer
+        const auto& ctrData = dynamic_cast<const TStaticCtrProvider&>(*nonOwningModel.CtrProvider).CtrData;
+        UNIT_ASSERT(!ctrData.LearnCtrs.empty());
+        for (const auto& ctrBaseAndTable : ctrData.LearnCtrs) {
+            const ui8* blob = ctrBaseAndTable.second.GetTypedArrayRefForBlobData<ui8>().data();
+            UNIT_ASSERT(blob >= (const ui8*)serializedModel.data());
+            UNIT_ASSERT(blob < (const ui8*)serializedModel.data() + serializedModel.size());
+        }
+
+        TVector<TVector<float>> features;
+        for (size_t docId = 0; docId < 40; ++docId) {
+            features.push_back({
+                (float)(docId % 7),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 6))),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 13)))
+            });
+        }
+        TVector<TConstArrayRef<float>> featureRefs(features.begin(), features.end());
+        TVector<double> readResults(features.size());
+        readModel.CalcFlat(featureRefs, readResults);
+        TVector<double> mappedResults(features.size());
+        mappedModel.CalcFlat(featureRefs, mappedResults);
+        TVector<double> nonOwningResults(features.size());
+        nonOwningModel.CalcFlat(featureRefs, nonOwningResults);
+        UNIT_ASSERT_EQUAL(readResults, mappedResults);
+        UNIT_ASSERT_EQUAL(readResults, nonOwningResults);
+    }
+
     Y_UNIT_TEST(TestSerializeDeserializeCoreML) {
         TFullModel trainedModel = TrainFloatCatboostModel();
         TStringStream strStream;
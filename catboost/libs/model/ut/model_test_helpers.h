@@ -2,7 +2,9 @@
 
 #include <catboost/libs/train_lib/train_model.h>
 
-TFullModel TrainFloatCatboostModel() {
+#include <util/generic/xrange.h>
+
+inline TFullModel TrainFloatCatboostModel() {
     TPool pool;
     pool.Docs.Resize(/*doc count*/3, /*factors count*/ 3, /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
     pool.Docs.Factors[0] = {+0.5f, +1.5f, -2.5f};
@@ -18,3 +20,25 @@ TFullModel TrainFloatCatboostModel() {
 
     return model;
 }
+
+inline TFullModel TrainCatFeaturesCatboostModel() {
+    const size_t docCount = 50;
+    TPool pool;
+    pool.Docs.Resize(docCount, /*factors count*/ 3, /*baseline dimension*/ 0, /*has queryId*/ false, /*has subgroupId*/ false);
+    pool.CatFeatures = {1, 2};
+    for (auto docId : xrange(docCount)) {
+        pool.Docs.Factors[0][docId] = docId % 7;
+        pool.SetCatFeatureHashWithBackMapUpdate(1, docId, ToString(docId % 5));
+        pool.SetCatFeatureHashWithBackMapUpdate(2, docId, ToString(docId % 11));
+        pool.Docs.Target[docId] = (docId % 5 + docId % 3) % 2;
+    }
+
+    TFullModel model;
+    TEvalResult evalResult;
+    NJson::TJsonValue params;
+    params.InsertValue("iterations", 10);
+    params.InsertValue("one_hot_max_size", 1);
+    TrainModel(params, Nothing(), Nothing(), pool, false, pool, "", &model, &evalResult);
+
+    return model;
+}
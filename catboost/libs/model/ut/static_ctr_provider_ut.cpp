@@ -0,0 +1,74 @@
+#include "model_test_helpers.h"
+
+#include <catboost/libs/model/static_ctr_provider.h>
+
+#include <library/unittest/registar.h>
+
+Y_UNIT_TEST_SUITE(TStaticCtrProviderTest) {
+    Y_UNIT_TEST(TestCtrCalcPlanMatchesOnTheFlyPlan) {
+        TFullModel model = TrainCatFeaturesCatboostModel();
+        UNIT_ASSERT(!model.ObliviousTrees.GetUsedModelCtrs().empty());
+
+        // same ctr tables, but precomputed plan is not set up, so CalcCtrs groups ctrs on every call
+        TFullModel noPlanModel = model;
+        noPlanModel.CtrCalcPlan.Reset();
+        auto& staticProvider = dynamic_cast<TStaticCtrProvider&>(*model.CtrProvider);
+        noPlanModel.CtrProvider = new TStaticCtrProvider(staticProvider.CtrData);
+        noPlanModel.CtrProvider->SetupBinFeatureIndexes(
+            noPlanModel.ObliviousTrees.FloatFeatures,
+            noPlanModel.ObliviousTrees.OneHotFeatures,
+            noPlanModel.ObliviousTrees.CatFeatures);
+
+        TVector<TVector<float>> features;
+        for (size_t docId = 0; docId < 40; ++docId) {
+            features.push_back({
+                (float)(docId % 7),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 6))),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 13)))
+            });
+        }
+        TVector<TConstArrayRef<float>> featureRefs(features.begin(), features.end());
+        TVector<double> results(features.size());
+        model.CalcFlat(featureRefs, results);
+        TVector<double> noPlanResults(features.size());
+        noPlanModel.CalcFlat(featureRefs, noPlanResults);
+        UNIT_ASSERT_EQUAL(results, noPlanResults);
+    }
+
+    Y_UNIT_TEST(TestModelCopiesSharingCtrProvider) {
+        TFullModel model = TrainCatFeaturesCatboostModel();
+        // truncated copy shares ctr provider with the original model, but has its own plan for fewer ctrs
+        TFullModel truncatedModel = model.CopyTreeRange(0, model.GetTreeCount() / 2);
+        UNIT_ASSERT(truncatedModel.CtrProvider.Get() == model.CtrProvider.Get());
+        TFullModel expectedTruncatedModel = truncatedModel;
+        auto& staticProvider = dynamic_cast<TStaticCtrProvider&>(*model.CtrProvider);
+        expectedTruncatedModel.CtrProvider = new TStaticCtrProvider(staticProvider.CtrData);
+        expectedTruncatedModel.UpdateDynamicData();
+
+        TVector<TVector<float>> features;
+        for (size_t docId = 0; docId < 20; ++docId) {
+            features.push_back({
+                (float)(docId % 7),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 6))),
+                ConvertCatFeatureHashToFloat(CalcCatFeatureHash(ToString(docId % 13)))
+            });
+        }
+        TVector<TConstArrayRef<float>> featureRefs(features.begin(), features.end());
+        TVector<double> expectedResults(features.size());
+        model.CalcFlat(featureRefs, expectedResults);
+        TVector<double> expectedTruncatedResults(features.size());
+        expectedTruncatedModel.CalcFlat(featureRefs, expectedTruncatedResults);
+        for (int iteration = 0; iteration < 3; ++iteration) {
+            if (iteration == 2) {
+                // sets up feature indexes of shared provider, plan of the original model becomes stale
+                truncatedModel.UpdateDynamicData();
+            }
+            TVector<double> truncatedResults(features.size());
+            truncatedModel.CalcFlat(featureRefs, truncatedResults);
+            UNIT_ASSERT_EQUAL(truncatedResults, expectedTruncatedResults);
+            TVector<double> results(features.size());
+            model.CalcFlat(featureRefs, results);
+            UNIT_ASSERT_EQUAL(results, expectedResults);
+        }
+    }
+}
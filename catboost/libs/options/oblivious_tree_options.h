@@ -24,6 +24,9 @@ namespace NCatboostOptions {
             , Rsm("rsm", 1.0, taskType)
             , SamplingFrequency("sampling_frequency", ESamplingFrequency::PerTreeLevel, taskType)
             , ModelSizeReg("model_size_reg", 0.5, taskType)
+            , SinglePrecisionScoreStats("single_precision_score_stats", false, taskType)
+            , CacheStatsWithoutSampling("cache_stats_without_sampling", false, taskType)
+            , CacheStatsWithBernoulliSampling("cache_stats_with_bernoulli_sampling", false, taskType)
             , ObservationsToBootstrap("observations_to_bootstrap", EObservationsToBootstrap::TestOnly, taskType) //it's specific for fold-based scheme, so here and not in bootstrap options
             , FoldSizeLossNormalization("fold_size_loss_normalization", false, taskType)
             , AddRidgeToTargetFunctionFlag("add_ridge_penalty_to_loss_function", false, taskType)
@@ -33,6 +36,9 @@ namespace NCatboostOptions {
         {
             Rsm.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::ExceptionOnChange);
             SamplingFrequency.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::ExceptionOnChange);
+            SinglePrecisionScoreStats.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::SkipWithWarning);
+            CacheStatsWithoutSampling.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::SkipWithWarning);
+            CacheStatsWithBernoulliSampling.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::SkipWithWarning);
 
             FoldSizeLossNormalization.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::ExceptionOnChange);
             AddRidgeToTargetFunctionFlag.ChangeLoadUnimplementedPolicy(ELoadUnimplementedPolicy::ExceptionOnChange);
@@ -52,7 +58,10 @@ namespace NCatboostOptions {
                         &ObservationsToBootstrap,
                         &PairwiseNonDiagReg,
                         &LeavesEstimationBacktrackingType,
-                        &SamplingFrequency);
+                        &SamplingFrequency,
+                        &SinglePrecisionScoreStats,
+                        &CacheStatsWithoutSampling,
+                        &CacheStatsWithBernoulliSampling);
 
             Validate();
         }
@@ -64,19 +73,23 @@ namespace NCatboostOptions {
                        ScoreFunction,
                        PairwiseNonDiagReg,
                        LeavesEstimationBacktrackingType,
-                       MaxCtrComplexityForBordersCaching, Rsm, ObservationsToBootstrap, SamplingFrequency);
+                       MaxCtrComplexityForBordersCaching, Rsm, ObservationsToBootstrap, SamplingFrequency,
+                       SinglePrecisionScoreStats, CacheStatsWithoutSampling, CacheStatsWithBernoulliSampling);
         }
 
         bool operator==(const TObliviousTreeLearnerOptions& rhs) const {
             return std::tie(MaxDepth, LeavesEstimationIterations, LeavesEstimationMethod, L2Reg, ModelSizeReg, RandomStrength,
                             BootstrapConfig, Rsm, SamplingFrequency, ObservationsToBootstrap, FoldSizeLossNormalization,
                             AddRidgeToTargetFunctionFlag, ScoreFunction, MaxCtrComplexityForBordersCaching,
-                            PairwiseNonDiagReg, LeavesEstimationBacktrackingType
+                            PairwiseNonDiagReg, LeavesEstimationBacktrackingType, SinglePrecisionScoreStats,
+                            CacheStatsWithoutSampling, CacheStatsWithBernoulliSampling
             ) ==
                    std::tie(rhs.MaxDepth, rhs.LeavesEstimationIterations, rhs.LeavesEstimationMethod, rhs.L2Reg, rhs.ModelSizeReg,
                             rhs.RandomStrength, rhs.BootstrapConfig, rhs.Rsm, rhs.SamplingFrequency,
                             rhs.ObservationsToBootstrap, rhs.FoldSizeLossNormalization, rhs.AddRidgeToTargetFunctionFlag,
-                            rhs.ScoreFunction, rhs.MaxCtrComplexityForBordersCaching, rhs.PairwiseNonDiagReg, rhs.LeavesEstimationBacktrackingType);
+                            rhs.ScoreFunction, rhs.MaxCtrComplexityForBordersCaching, rhs.PairwiseNonDiagReg, rhs.LeavesEstimationBacktrackingType,
+                            rhs.SinglePrecisionScoreStats, rhs.CacheStatsWithoutSampling,
+                            rhs.CacheStatsWithBernoulliSampling);
         }
 
         bool operator!=(const TObliviousTreeLearnerOptions& rhs) const {
@@ -105,6 +118,15 @@ namespace NCatboostOptions {
         TCpuOnlyOption<float> Rsm;
         TCpuOnlyOption<ESamplingFrequency> SamplingFrequency;
         TCpuOnlyOption<float> ModelSizeReg;
+        // accumulate score calculation bucket statistics in float by document blocks which are added to double statistics,
+        // sums over buckets are still in double
+        TCpuOnlyOption<bool> SinglePrecisionScoreStats;
+        // with per level sampling which gives the same sample on every level (no bootstrap, subsample 1, bagging temperature 0)
+        // keep bucket statistics of previous level for max depth and scan only the smallest side of each split
+        TCpuOnlyOption<bool> CacheStatsWithoutSampling;
+        // with per level Bernoulli sampling in plain mode keep bucket statistics of all documents of previous level,
+        // scan the smallest side of each split and sampled out documents of the other side
+        TCpuOnlyOption<bool> CacheStatsWithBernoulliSampling;
 
         TGpuOnlyOption<EObservationsToBootstrap> ObservationsToBootstrap;
         TGpuOnlyOption<bool> FoldSizeLossNormalization;
@@ -152,6 +152,9 @@ namespace NCatboostOptions {
         CopyOption(plainOptions, "fold_size_loss_normalization", &treeOptions, &seenKeys);
         CopyOption(plainOptions, "add_ridge_penalty_to_loss_function", &treeOptions, &seenKeys);
         CopyOption(plainOptions, "sampling_frequency", &treeOptions, &seenKeys);
+        CopyOption(plainOptions, "single_precision_score_stats", &treeOptions, &seenKeys);
+        CopyOption(plainOptions, "cache_stats_without_sampling", &treeOptions, &seenKeys);
+        CopyOption(plainOptions, "cache_stats_with_bernoulli_sampling", &treeOptions, &seenKeys);
         CopyOption(plainOptions, "dev_max_ctr_complexity_for_border_cache", &treeOptions, &seenKeys);
         CopyOption(plainOptions, "observations_to_bootstrap", &treeOptions, &seenKeys);
 
@@ -217,6 +220,7 @@ namespace NCatboostOptions {
         CopyOption(plainOptions, "node_type", &systemOptions, &seenKeys);
         CopyOption(plainOptions, "node_port", &systemOptions, &seenKeys);
         CopyOption(plainOptions, "file_with_hosts", &systemOptions, &seenKeys);
+        CopyOption(plainOptions, "workers_load_learn_pool", &systemOptions, &seenKeys);
 
 
         //rest
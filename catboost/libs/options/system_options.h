@@ -26,6 +26,7 @@ namespace NCatboostOptions {
         TCpuOnlyOption<ENodeType> NodeType;
         TCpuOnlyOption<TString> FileWithHosts;
         TCpuOnlyOption<ui32> NodePort;
+        TCpuOnlyOption<bool> WorkersLoadLearnPool; // workers read their parts of learn pool file instead of receiving them from master
 
         static ui32 GetUnusedNodePort() { return 0; }
         bool IsMaster() const;
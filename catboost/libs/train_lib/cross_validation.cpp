@@ -153,6 +153,7 @@ static void PrepareFolds(
             (size_t)contexts[foldIdx]->Params.CatFeatureParams->OneHotMaxSize,
             contexts[foldIdx]->Params.DataProcessingOptions->FloatFeaturesBinarization->NanMode,
             /*clearPool=*/false,
+            /*allowSparseFloatFeatures=*/IsSparseFloatFeaturesScoring(contexts[foldIdx]->Params),
             contexts[foldIdx]->LocalExecutor,
             docsInTrain[foldIdx],
             &pool.Docs,
@@ -330,7 +331,7 @@ void CrossValidate(
     const bool isPairwiseScoring = IsPairwiseScoring(ctx->Params.LossFunctionDescription->GetLossFunction());
     for (size_t foldIdx = 0; foldIdx < learnFolds.size(); ++foldIdx) {
         TLearnContext& ctx = *contexts[foldIdx];
-        if (IsSamplingPerTree(ctx.Params.ObliviousTreeOptions.Get())) {
+        if (IsSamplingPerTree(ctx.Params.ObliviousTreeOptions.Get()) || IsSampledOutSiblingScoring(ctx.Params)) {
             ctx.SmallestSplitSideDocs.Create(ctx.LearnProgress.Folds, isPairwiseScoring);
             ctx.PrevTreeLevelStats.Create(
                 ctx.LearnProgress.Folds,
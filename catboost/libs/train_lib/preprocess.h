@@ -7,12 +7,6 @@
 
 #include <util/generic/vector.h>
 
-/// Preprocess targets and weights of the `data` as required by loss.
-void Preprocess(const NCatboostOptions::TLossDescription& lossDescription,
-                const TVector<float>& classWeights,
-                const TLabelConverter& labelConverter,
-                TDataset& learnOrTestData);
-
 /// Check consistency of the data with loss and with each other, after Preprocess.
 /// Check 1 of 2: consistency of the learnData itself.
 void CheckLearnConsistency(
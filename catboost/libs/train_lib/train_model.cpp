@@ -42,18 +42,47 @@ static int GetThreadCount(const NCatboostOptions::TCatBoostOptions& options) {
     return Min<int>(options.SystemOptions->NumThreads, (int)NSystemInfo::CachedNumberOfCpus());
 }
 
+// Bytes of learn pool file read by master in distributed training, workers read their parts of the file
+static constexpr ui64 LEARN_POOL_SAMPLE_SIZE = 256 << 20;
+
+// Master holds a sample of learn pool, borders and one-hot values are computed on it, see MapLoadPlainFold
+struct TLearnPoolSample {
+    const NCatboostOptions::TPoolLoadParams* LoadOptions = nullptr;
+    ui64 PoolDocCountEstimate = 0;
+};
+
+// learnPoolSample is reset if the whole learn pool has to be read
 static void LoadPools(
     const NCatboostOptions::TPoolLoadParams& loadOptions,
     int threadCount,
     const TVector<TString>& classNames,
     TProfileInfo* profile,
+    TLearnPoolSample* learnPoolSample,
     TPool* learnPool,
     TVector<TPool>* testPools) {
 
     loadOptions.Validate();
 
     const bool verbose = false;
-    if (loadOptions.LearnSetPath.Inited()) {
+    if (loadOptions.LearnSetPath.Inited() && learnPoolSample->LoadOptions != nullptr) {
+        NPar::TLocalExecutor localExecutor;
+        localExecutor.RunAdditionalThreads(threadCount - 1);
+        learnPoolSample->PoolDocCountEstimate = NCB::ReadPoolSample(loadOptions.LearnSetPath,
+            loadOptions.DsvPoolFormatParams,
+            loadOptions.IgnoredFeatures,
+            LEARN_POOL_SAMPLE_SIZE,
+            classNames,
+            &localExecutor,
+            learnPool);
+        profile->AddOperation("Build learn pool sample");
+        if (learnPool->MetaInfo.HasTimestamp) {
+            // documents are ordered by timestamps over the whole pool
+            MATRIXNET_WARNING_LOG << "Workers can't read learn pool with timestamps, sending it to workers" << Endl;
+            *learnPoolSample = TLearnPoolSample();
+            *learnPool = TPool();
+        }
+    }
+    if (loadOptions.LearnSetPath.Inited() && learnPoolSample->LoadOptions == nullptr) {
         NCB::ReadPool(loadOptions.LearnSetPath,
                       loadOptions.PairsFilePath,
                       loadOptions.DsvPoolFormatParams,
@@ -139,6 +168,17 @@ static void Train(
         ctx->EvalMetricDescriptor,
         approxDimension
     );
+    if (!ctx->Params.SystemOptions->IsSingleHost()) {
+        // learn errors are sums of stats of workers, see MapCalcLearnErrors, workers create no custom eval metric
+        const bool isCustomEvalMetric = ctx->Params.MetricOptions->EvalMetric.IsSet()
+            && ctx->Params.MetricOptions->EvalMetric->GetLossFunction() == ELossFunction::Custom;
+        for (auto& metric : metrics) {
+            if (isCustomEvalMetric || !metric->IsAdditiveMetric()) {
+                MATRIXNET_WARNING_LOG << "Metric " << metric->GetDescription() << " is not computed on learn set in distributed training" << Endl;
+                metric->AddHint("skip_train", "true");
+            }
+        }
+    }
 
     EMetricBestValue bestValueType;
     float bestPossibleValue;
@@ -200,7 +240,7 @@ static void Train(
     }
 
     const bool isPairwiseScoring = IsPairwiseScoring(ctx->Params.LossFunctionDescription->GetLossFunction());
-    if (IsSamplingPerTree(ctx->Params.ObliviousTreeOptions.Get())) {
+    if (IsSamplingPerTree(ctx->Params.ObliviousTreeOptions.Get()) || IsSampledOutSiblingScoring(ctx->Params)) {
         ctx->SmallestSplitSideDocs.Create(ctx->LearnProgress.Folds, isPairwiseScoring);
         ctx->PrevTreeLevelStats.Create(
             ctx->LearnProgress.Folds,
@@ -315,6 +355,23 @@ class TCPUModelTrainer : public IModelTrainer {
         TFullModel* modelPtr,
         const TVector<TEvalResult*>& evalResultPtrs
     ) const override {
+        TrainModel(jsonParams, outputOptions, objectiveDescriptor, evalMetricDescriptor, learnPool, allowClearPool, testPoolPtrs,
+                   modelPtr, evalResultPtrs, /*learnPoolSample*/ nullptr);
+    }
+
+    // learnPoolSample is set if learnPool is a sample of learn pool file, workers read their parts of the file
+    void TrainModel(
+        const NJson::TJsonValue& jsonParams,
+        const NCatboostOptions::TOutputFilesOptions& outputOptions,
+        const TMaybe<TCustomObjectiveDescriptor>& objectiveDescriptor,
+        const TMaybe<TCustomMetricDescriptor>& evalMetricDescriptor,
+        TPool& learnPool,
+        bool allowClearPool,
+        const TVector<const TPool*>& testPoolPtrs,
+        TFullModel* modelPtr,
+        const TVector<TEvalResult*>& evalResultPtrs,
+        const TLearnPoolSample* learnPoolSample
+    ) const {
 
         auto sortedCatFeatures = learnPool.CatFeatures;
         Sort(sortedCatFeatures.begin(), sortedCatFeatures.end());
@@ -350,7 +407,7 @@ class TCPUModelTrainer : public IModelTrainer {
         NCatboostOptions::TOutputFilesOptions updatedOutputOptions = outputOptions;
 
         SetDataDependantDefaults(
-            learnPool.Docs.GetDocCount(),
+            learnPoolSample != nullptr ? learnPoolSample->PoolDocCountEstimate : learnPool.Docs.GetDocCount(),
             /*testPoolSize*/ GetDocCount(testPoolPtrs),
             /*hasTestLabels*/ testPoolPtrs.size() > 0 && IsConst(testPoolPtrs[0]->Docs.Target),
             learnPool.MetaInfo.HasWeights,
@@ -461,6 +518,7 @@ class TCPUModelTrainer : public IModelTrainer {
             catFeatureParams.OneHotMaxSize,
             ctx.Params.DataProcessingOptions->FloatFeaturesBinarization->NanMode,
             /*clearPoolAfterBinarization=*/allowClearPool,
+            /*allowSparseFloatFeatures=*/IsSparseFloatFeaturesScoring(ctx.Params),
             ctx.LocalExecutor,
             /*select=*/{},
             &learnPool.Docs,
@@ -506,9 +564,13 @@ class TCPUModelTrainer : public IModelTrainer {
         if (!systemOptions->IsSingleHost()) { // send target, weights, baseline (if present), binarized features to workers and ask them to create plain folds
             InitializeMaster(&ctx);
             CB_ENSURE(IsPlainMode(ctx.Params.BoostingOptions->BoostingType), "Distributed training requires plain boosting");
-            CB_ENSURE(learnPool.CatFeatures.empty(), "Distributed training requires all numeric data");
             CB_ENSURE(ctx.LearnProgress.ApproxDimension == 1, "Distributed training requires 1D approxes");
-            MapBuildPlainFold(learnData, &ctx);
+            if (learnPoolSample != nullptr) {
+                // learnData is a sample, workers read their parts of learn pool and binarize them as the sample
+                MapLoadPlainFold(*learnPoolSample->LoadOptions, learnData, &ctx);
+            } else {
+                MapBuildPlainFold(learnData, &ctx);
+            }
         }
         TVector<TVector<double>> oneRawValues(ctx.LearnProgress.ApproxDimension);
         TVector<TVector<TVector<double>>> rawValues(testDataPtrs.size(), oneRawValues);
@@ -548,7 +610,23 @@ class TCPUModelTrainer : public IModelTrainer {
 //                oheFeature.StringValues.push_back(learnPool.CatFeaturesHashToString.at(value));
 //            }
 //        }
+        // master may hold a sample of learn documents only, final ctrs are computed from hash stats of workers
+        THashMap<TModelCtrBase, TCtrValueTable> distributedCtrTables;
+        if (!ctx.Params.SystemOptions->IsSingleHost() && ctx.OutputOptions.GetFinalCtrComputationMode() == EFinalCtrComputationMode::Default) {
+            const TVector<TModelCtrBase> usedCtrBases = obliviousTrees.GetUsedModelCtrBases();
+            TVector<TProjection> projections;
+            for (const auto& ctr : usedCtrBases) {
+                projections.push_back(featureCombinationToProjectionMap.at(ctr.Projection));
+            }
+            TVector<TCtrValueTable> tables = MapCalcFinalCtrs(usedCtrBases, projections, testDataPtrs, &ctx);
+            for (int ctrIdx = 0; ctrIdx < usedCtrBases.ysize(); ++ctrIdx) {
+                distributedCtrTables.emplace(usedCtrBases[ctrIdx], std::move(tables[ctrIdx]));
+            }
+        }
         auto ctrTableGenerator = [&] (const TModelCtrBase& ctr) -> TCtrValueTable {
+            if (!distributedCtrTables.empty()) {
+                return distributedCtrTables.at(ctr);
+            }
             TCtrValueTable resTable;
             CalcFinalCtrs(
                 ctr.CtrType,
@@ -665,7 +743,16 @@ class TCPUModelTrainer : public IModelTrainer {
         TProfileInfo profile;
         TPool learnPool;
         TVector<TPool> testPools;
-        LoadPools(loadOptions, threadCount, catBoostOptions.DataProcessingOptions->ClassNames, &profile, &learnPool, &testPools);
+        TLearnPoolSample learnPoolSample;
+        const auto& systemOptions = catBoostOptions.SystemOptions;
+        if (systemOptions->IsMaster() && systemOptions->WorkersLoadLearnPool) {
+            if (loadOptions.CvParams.FoldCount == 0 && NCB::CanReadPoolByteRanges(loadOptions.LearnSetPath)) {
+                learnPoolSample.LoadOptions = &loadOptions;
+            } else {
+                MATRIXNET_WARNING_LOG << "Workers can read learn pool only if it is a dsv file and is not split, sending it to workers" << Endl;
+            }
+        }
+        LoadPools(loadOptions, threadCount, catBoostOptions.DataProcessingOptions->ClassNames, &profile, &learnPoolSample, &learnPool, &testPools);
 
         const auto evalFileName = outputOptions.CreateEvalFullPath();
         if (!evalFileName.empty() && !loadOptions.TestSetPaths.empty()) {
@@ -682,7 +769,7 @@ class TCPUModelTrainer : public IModelTrainer {
         TVector<TEvalResult> evalResults(Max(testPools.ysize(), 1)); // need at least one evalResult, maybe empty
 
         this->TrainModel(trainJson, outputOptions, Nothing(), Nothing(), learnPool, allowClearPool, GetConstPointers(testPools),
-                         nullptr, GetMutablePointers(evalResults));
+                         nullptr, GetMutablePointers(evalResults), learnPoolSample.LoadOptions != nullptr ? &learnPoolSample : nullptr);
 
         SetVerboseLogingMode();
         if (!evalFileName.empty()) {
@@ -1887,6 +1887,47 @@ def test_calc_no_target(boosting_type):
     assert(compare_evals(fit_output_eval_path, calc_output_eval_path))
 
 
+def test_calc_pipelined_output_equals_sequential():
+    model_path = yatest.common.test_output_path('model.bin')
+    cmd = (
+        CATBOOST_PATH,
+        'fit',
+        '--use-best-model', 'false',
+        '--loss-function', 'Logloss',
+        '-f', data_file('adult', 'train_small'),
+        '--column-description', data_file('adult', 'train.cd'),
+        '-i', '320',
+        '-w', '0.03',
+        '-T', '4',
+        '-r', '0',
+        '-m', model_path,
+    )
+    yatest.common.execute(cmd)
+
+    def run_calc(eval_path, queue_depth):
+        # with 320 stages calc takes blocks of 32 docs, so the pool is processed in several blocks
+        calc_cmd = (
+            CATBOOST_PATH,
+            'calc',
+            '--input-path', data_file('adult', 'test_small'),
+            '--column-description', data_file('adult', 'train.cd'),
+            '-m', model_path,
+            '--output-path', eval_path,
+            '--prediction-type', 'RawFormulaVal,Probability',
+            '--eval-period', '1',
+            '-T', '4',
+            '--pipeline-queue-depth', str(queue_depth),
+        )
+        yatest.common.execute(calc_cmd)
+
+    sequential_eval_path = yatest.common.test_output_path('sequential.eval')
+    run_calc(sequential_eval_path, 0)
+    for queue_depth in (1, 3):
+        pipelined_eval_path = yatest.common.test_output_path('pipelined_{}.eval'.format(queue_depth))
+        run_calc(pipelined_eval_path, queue_depth)
+        assert filecmp.cmp(sequential_eval_path, pipelined_eval_path, shallow=False)
+
+
 @pytest.mark.parametrize('boosting_type', BOOSTING_TYPE)
 def test_classification_progress_restore(boosting_type):
     def run_catboost(iters, model_path, eval_path, additional_params=None):